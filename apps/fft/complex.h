@@ -0,0 +1,46 @@
+#ifndef COMPLEX_H
+#define COMPLEX_H
+
+#include "Halide.h"
+
+// Complex number arithmetic. Complex numbers are represented with
+// Halide Tuples of their real and imaginary parts.
+inline Halide::Expr re(Halide::Tuple z) {
+    return z[0];
+}
+
+inline Halide::Expr im(Halide::Tuple z) {
+    return z[1];
+}
+
+inline Halide::Tuple add(Halide::Tuple za, Halide::Tuple zb) {
+    return Halide::Tuple(re(za) + re(zb), im(za) + im(zb));
+}
+
+inline Halide::Tuple sub(Halide::Tuple za, Halide::Tuple zb) {
+    return Halide::Tuple(re(za) - re(zb), im(za) - im(zb));
+}
+
+inline Halide::Tuple mul(Halide::Tuple za, Halide::Tuple zb) {
+    return Halide::Tuple(re(za)*re(zb) - im(za)*im(zb), re(za)*im(zb) + re(zb)*im(za));
+}
+
+// Scalar multiplication.
+inline Halide::Tuple scale(Halide::Expr x, Halide::Tuple z) {
+    return Halide::Tuple(x*re(z), x*im(z));
+}
+
+inline Halide::Tuple conj(Halide::Tuple z) {
+    return Halide::Tuple(re(z), -im(z));
+}
+
+// Multiplication by j*sign, which is just a swap and a negation.
+inline Halide::Tuple mul_j(Halide::Tuple z, float sign) {
+    return Halide::Tuple(-sign*im(z), sign*re(z));
+}
+
+inline Halide::Tuple selectz(Halide::Expr c, Halide::Tuple t, Halide::Tuple f) {
+    return Halide::Tuple(select(c, re(t), re(f)), select(c, im(t), im(f)));
+}
+
+#endif
@@ -0,0 +1,580 @@
+// This FFT is an implementation of the algorithm described in
+// http://research.microsoft.com/pubs/131400/fftgpusc08.pdf
+// This algorithm is more well suited to Halide than in-place
+// algorithms. It began as test/performance/fft.cpp.
+
+#include "fft.h"
+#include "complex.h"
+
+#include <cmath>
+#include <map>
+#include <sstream>
+
+using namespace Halide;
+
+namespace {
+
+const double kPi = 3.14159265358979323846;
+
+// Compute the product of the integers in R.
+int product(const std::vector<int> &R) {
+    int p = 1;
+    for (size_t i = 0; i < R.size(); i++) {
+        p *= R[i];
+    }
+    return p;
+}
+
+void add_implicit_args(std::vector<Var> &defined, Func implicit) {
+    // Add implicit args for each argument missing in defined from
+    // implicit's args.
+    for (int i = 0; static_cast<int>(defined.size()) < implicit.dimensions(); i++) {
+        defined.push_back(Var::implicit(i));
+    }
+}
+
+std::vector<Var> add_implicit_args(Var x0, Func implicit) {
+    std::vector<Var> ret;
+    ret.push_back(x0);
+    add_implicit_args(ret, implicit);
+    return ret;
+}
+
+std::vector<Var> add_implicit_args(Var x0, Var x1, Func implicit) {
+    std::vector<Var> ret;
+    ret.push_back(x0);
+    ret.push_back(x1);
+    add_implicit_args(ret, implicit);
+    return ret;
+}
+
+// Find the first argument of f that is a placeholder, or outermost if
+// no placeholders are found.
+Var outermost(Func f) {
+    for (int i = 0; i < f.dimensions(); i++) {
+        if (f.args()[i].is_implicit()) {
+            return f.args()[i];
+        }
+    }
+    return Var::outermost();
+}
+
+bool has_batch(Func f) {
+    for (int i = 0; i < f.dimensions(); i++) {
+        if (f.args()[i].is_implicit()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Compute exp(j*x)
+Tuple expj(Expr x) {
+    return Tuple(cos(x), sin(x));
+}
+
+// exp(j*sign*2*pi*k/N), as a constant.
+Tuple twiddle(int k, int N, float sign) {
+    double t = sign*2*kPi*k/N;
+    return Tuple((float)cos(t), (float)sin(t));
+}
+
+Tuple sumz(Tuple z, const std::string &s = "sum") {
+    return Tuple(sum(re(z), s + "_re"), sum(im(z), s + "_im"));
+}
+
+// Compute the complex DFT of size N on dimension 0 of x, for radices
+// without a specialized butterfly.
+Func dft_dim0(Func x, int N, float sign, const std::string &name) {
+    Var n("n");
+    Func X(name);
+    if (N <= 16) {
+        // Compute each output as a sum of the inputs times constant
+        // twiddle factors.
+        X(add_implicit_args(n, x)) = Tuple(undef<float>(), undef<float>());
+        for (int m = 0; m < N; m++) {
+            Tuple dft = x(0, _);
+            for (int k = 1; k < N; k++) {
+                if (m == 0) {
+                    dft = add(dft, x(k, _));
+                } else {
+                    dft = add(dft, mul(twiddle((m*k) % N, N, sign), x(k, _)));
+                }
+            }
+            X(m, _) = dft;
+        }
+    } else {
+        // If N is larger, we really shouldn't be using this algorithm
+        // for the DFT anyways.
+        RDom k(0, N);
+        X(n, _) = sumz(mul(expj((sign*2*(float)kPi*k*n)/N), x(k, _)));
+        X.unroll(n);
+    }
+    return X;
+}
+
+// Specializations for some small DFTs.
+Func dft2_dim0(Func x, float sign, const std::string &name) {
+    Var n("n");
+    Func X(name);
+    X(add_implicit_args(n, x)) = Tuple(undef<float>(), undef<float>());
+
+    Tuple x0 = x(0, _), x1 = x(1, _);
+    FuncRefExpr X0 = X(0, _), X1 = X(1, _);
+
+    X0 = add(x0, x1);
+    X1 = sub(x0, x1);
+
+    return X;
+}
+
+Func dft4_dim0(Func x, float sign, const std::string &name) {
+    Var n("n");
+    Func X(name);
+    X(add_implicit_args(n, x)) = Tuple(undef<float>(), undef<float>());
+
+    Tuple x0 = x(0, _), x1 = x(1, _), x2 = x(2, _), x3 = x(3, _);
+    FuncRefExpr X0 = X(0, _), X1 = X(1, _), X2 = X(2, _), X3 = X(3, _);
+
+    FuncRefExpr T0 = X(-1, _);
+    FuncRefExpr T2 = X(-2, _);
+    T0 = add(x0, x2);
+    T2 = add(x1, x3);
+    X0 = add(T0, T2);
+    X2 = sub(T0, T2);
+
+    FuncRefExpr T1 = T0;
+    FuncRefExpr T3 = T2;
+    T1 = sub(x0, x2);
+    T3 = mul_j(sub(x1, x3), sign);
+    X1 = add(T1, T3);
+    X3 = sub(T1, T3);
+
+    return X;
+}
+
+Func dft8_dim0(Func x, float sign, const std::string &name) {
+    const float sqrt2_2 = 0.70710678f;
+
+    Var n("n");
+    Func X(name);
+    X(add_implicit_args(n, x)) = Tuple(undef<float>(), undef<float>());
+
+    Tuple x0 = x(0, _), x1 = x(1, _), x2 = x(2, _), x3 = x(3, _);
+    Tuple x4 = x(4, _), x5 = x(5, _), x6 = x(6, _), x7 = x(7, _);
+    FuncRefExpr X0 = X(0, _), X1 = X(1, _), X2 = X(2, _), X3 = X(3, _);
+    FuncRefExpr X4 = X(4, _), X5 = X(5, _), X6 = X(6, _), X7 = X(7, _);
+
+    FuncRefExpr T0 = X(-1, _), T1 = X(-2, _), T2 = X(-3, _), T3 = X(-4, _);
+    FuncRefExpr T4 = X(-5, _), T5 = X(-6, _), T6 = X(-7, _), T7 = X(-8, _);
+
+    X0 = add(x0, x4);
+    X2 = add(x2, x6);
+    T0 = add(X0, X2);
+    T2 = sub(X0, X2);
+
+    X1 = sub(x0, x4);
+    X3 = mul_j(sub(x2, x6), sign);
+    T1 = add(X1, X3);
+    T3 = sub(X1, X3);
+
+    X4 = add(x1, x5);
+    X6 = add(x3, x7);
+    T4 = add(X4, X6);
+    T6 = mul_j(sub(X4, X6), sign);
+
+    X5 = sub(x1, x5);
+    X7 = mul_j(sub(x3, x7), sign);
+    T5 = mul(add(X5, X7), Tuple(sqrt2_2, sign*sqrt2_2));
+    T7 = mul(sub(X5, X7), Tuple(-sqrt2_2, sign*sqrt2_2));
+
+    X0 = add(T0, T4);
+    X1 = add(T1, T5);
+    X2 = add(T2, T6);
+    X3 = add(T3, T7);
+    X4 = sub(T0, T4);
+    X5 = sub(T1, T5);
+    X6 = sub(T2, T6);
+    X7 = sub(T3, T7);
+
+    return X;
+}
+
+std::map<std::pair<int, float>, Func> twiddles;
+
+// Return a function computing the twiddle factors exp(j*sign*2*pi*n/N)
+// from a table.
+Func W(int N, float sign) {
+    // Check to see if this set of twiddle factors is already computed.
+    Func &w = twiddles[std::make_pair(N, sign)];
+
+    if (!w.defined()) {
+        Image<float> reW(N), imW(N);
+        for (int n = 0; n < N; n++) {
+            double t = sign*2*kPi*n/N;
+            reW(n) = (float)cos(t);
+            imW(n) = (float)sin(t);
+        }
+        Var n("n");
+        w(n) = Tuple(reW(n), imW(n));
+    }
+
+    return w;
+}
+
+// Compute the N point DFT of dimension 1 (columns) of x using
+// radix R.
+Func fft_dim1(Func x, const std::vector<int> &NR, float sign, int group_size,
+              const std::string &prefix) {
+    int N = product(NR);
+    Var n0("n0"), n1("n1");
+
+    std::vector<Func> stages;
+
+    RVar r_, s_;
+    int S = 1;
+    for (size_t i = 0; i < NR.size(); i++) {
+        int R = NR[i];
+
+        std::stringstream stage_id;
+        stage_id << prefix << "_S" << S << "_R" << R;
+
+        Func exchange("x_" + stage_id.str());
+        Var r("r"), s("s");
+
+        // Load the points from each subtransform and apply the
+        // twiddle factors. Twiddle factors for S = 1 are all expj(0) = 1.
+        Func v("v_" + stage_id.str());
+        Tuple x_rs = x(n0, s + r*(N/R), _);
+        if (S > 1) {
+            Func W_RS = W(R*S, sign);
+            v(r, s, n0, _) = mul(selectz(r > 0, W_RS(r*(s%S)), Tuple(1.0f, 0.0f)), x_rs);
+        } else {
+            v(r, s, n0, _) = x_rs;
+        }
+
+        // Compute the R point DFT of the subtransform.
+        std::string V_name = "X_" + stage_id.str();
+        Func V;
+        switch (R) {
+        case 2: V = dft2_dim0(v, sign, V_name); break;
+        case 4: V = dft4_dim0(v, sign, V_name); break;
+        case 8: V = dft8_dim0(v, sign, V_name); break;
+        default: V = dft_dim0(v, R, sign, V_name); break;
+        }
+
+        // Write the subtransform and use it as input to the next
+        // pass.
+        exchange(add_implicit_args(n0, n1, x)) = Tuple(undef<float>(), undef<float>());
+        exchange.bound(n1, 0, N);
+
+        RDom rs(0, R, 0, N/R);
+        r_ = rs.x;
+        s_ = rs.y;
+        exchange(n0, (s_/S)*R*S + s_%S + r_*S, _) = V(r_, s_, n0, _);
+
+        if (S > 1) {
+            v.compute_at(exchange, s_).unroll(r);
+            v.reorder_storage(n0, r, s);
+        }
+
+        V.compute_at(exchange, s_);
+        V.reorder_storage(V.args()[2], V.args()[0], V.args()[1]);
+
+        // TODO: Understand why these all vectorize in all but the last stage.
+        if (S == N/R) {
+            v.vectorize(n0);
+            V.vectorize(V.args()[2]);
+            for (int i = 0; i < V.num_update_definitions(); i++) {
+                V.update(i).vectorize(V.args()[2]);
+            }
+        }
+
+        exchange.update().unroll(r_);
+        // Remember this stage for scheduling later.
+        stages.push_back(exchange);
+
+        x = exchange;
+        S *= R;
+    }
+
+    // Split the tile into groups of DFTs, and vectorize within the
+    // group.
+    Var group("g");
+    x.update().split(n0, group, n0, group_size).reorder(n0, r_, s_, group).vectorize(n0);
+    for (size_t i = 0; i < stages.size() - 1; i++) {
+        stages[i].compute_at(x, group).update().vectorize(n0);
+    }
+
+    return x;
+}
+
+// Transpose the first two dimensions of x.
+Func transpose(Func f, const std::string &name) {
+    std::vector<Var> argsT(f.args());
+    std::swap(argsT[0], argsT[1]);
+    Func fT(name);
+    fT(argsT) = f(f.args());
+    return fT;
+}
+
+int group_size(const Target &target, const FFTDesc &desc) {
+    return desc.vector_width > 0 ? desc.vector_width : target.natural_vector_size<float>();
+}
+
+std::string prefix_of(const FFTDesc &desc, const std::string &default_name) {
+    return desc.name.empty() ? default_name : desc.name;
+}
+
+// Schedule the result of a transform, which is where everything else
+// in the transform is computed.
+void schedule_result(Func result, int width, int group, const FFTDesc &desc) {
+    if (width >= group) {
+        result.vectorize(result.args()[0], group);
+    }
+    if (desc.parallel && has_batch(result)) {
+        result.parallel(outermost(result));
+    }
+}
+
+}  // namespace
+
+std::vector<int> radix_factor(int N) {
+    const int radices[] = { 8, 5, 4, 3, 2 };
+
+    std::vector<int> R;
+    for (size_t i = 0; i < sizeof(radices)/sizeof(radices[0]); i++) {
+        while (N % radices[i] == 0) {
+            R.push_back(radices[i]);
+            N /= radices[i];
+        }
+    }
+    if (N != 1 || R.empty()) {
+        R.push_back(N);
+    }
+
+    return R;
+}
+
+Func fft2d_c2c(Func x, int N0, int N1, float sign, const Target &target, const FFTDesc &desc) {
+    const int group = group_size(target, desc);
+    const std::string prefix = prefix_of(desc, sign < 0 ? "fft2d_c2c" : "ifft2d_c2c");
+
+    Var n0("n0"), n1("n1");
+
+    // Transpose the input to the FFT.
+    Func xT = transpose(x, prefix + "_xT");
+
+    // Compute the DFT of dimension 1 (originally dimension 0).
+    Func dft1T = fft_dim1(xT, radix_factor(N0), sign, group, prefix + "_dim0");
+
+    // Transpose back, and compute the DFT of dimension 1, unless this
+    // is a 1D transform.
+    Func dft = transpose(dft1T, prefix + "_dft0");
+    if (N1 > 1) {
+        dft = fft_dim1(dft, radix_factor(N1), sign, group, prefix + "_dim1");
+        dft.bound(dft.args()[0], 0, N0);
+        dft.bound(dft.args()[1], 0, N1);
+    }
+
+    Func result(prefix);
+    if (desc.gain != 1.0f) {
+        result(add_implicit_args(n0, n1, x)) = scale(desc.gain, dft(n0, n1, _));
+    } else {
+        result(add_implicit_args(n0, n1, x)) = dft(n0, n1, _);
+    }
+
+    Var outer = outermost(result);
+    xT.compute_at(result, outer);
+    if (N1 > 1) {
+        xT.unroll(xT.args()[0]);
+    }
+    if (N0 >= group) {
+        xT.vectorize(xT.args()[1], group);
+    }
+    dft1T.compute_at(result, outer);
+    if (N1 > 1) {
+        dft.compute_at(result, outer);
+    }
+    schedule_result(result, N0, group, desc);
+
+    return result;
+}
+
+Func fft2d_r2c(Func r, int N0, int N1, const Target &target, const FFTDesc &desc) {
+    user_assert(N0 % 2 == 0) << "The r2c FFT requires an even size in dimension 0, not " << N0 << "\n";
+    user_assert(N1 == 1 || N1 % 2 == 0) << "The r2c FFT requires an even size in dimension 1, not " << N1 << "\n";
+    const int group = group_size(target, desc);
+    const std::string prefix = prefix_of(desc, "fft2d_r2c");
+
+    Var n0("n0"), n1("n1");
+    Func result(prefix);
+
+    if (N1 == 1) {
+        // Compute the N0 point real DFT from an N0/2 point complex
+        // DFT of the even samples zipped with the odd ones,
+        // z = e + j*o.
+        const int M = N0/2;
+        Func zipped(prefix + "_zipped");
+        zipped(add_implicit_args(n0, n1, r)) = Tuple(r(2*n0, n1, _), r(2*n0 + 1, n1, _));
+
+        Func zippedT = transpose(zipped, prefix + "_zippedT");
+        Func dftT = fft_dim1(zippedT, radix_factor(M), -1.0f, group, prefix);
+
+        // By the conjugate symmetry of the DFTs E and O of the even
+        // and odd samples, E_k = (Z_k + conj(Z_(M-k)))/2, and
+        // O_k = -j*(Z_k - conj(Z_(M-k)))/2. The DFT of the whole
+        // signal is then X_k = E_k + W^k*O_k.
+        Tuple Z = dftT(n1, n0 % M, _);
+        Tuple symZ = conj(dftT(n1, (M - n0) % M, _));
+        Tuple E = add(Z, symZ);
+        Tuple O = mul_j(sub(Z, symZ), -1.0f);
+        Func W_N = W(N0, -1.0f);
+        result(add_implicit_args(n0, n1, r)) = scale(0.5f*desc.gain, add(E, mul(W_N(n0), O)));
+
+        zippedT.compute_at(result, outermost(result));
+        dftT.compute_at(result, outermost(result));
+        schedule_result(result, M + 1, group, desc);
+        return result;
+    }
+
+    // Combine pairs of real columns x, y into complex columns
+    // z = x + j*y. This allows us to compute two real DFTs using
+    // one complex FFT.
+
+    // Grab columns from each half of the input data to improve
+    // coherency of the zip/unzip operations, which improves
+    // vectorization.
+    // The zip location is aligned to the nearest group.
+    int zip_n = ((N0/2 - 1) | (group - 1)) + 1;
+    Func zipped(prefix + "_zipped");
+    zipped(add_implicit_args(n0, n1, r)) = Tuple(r(n0, n1, _),
+                                                 r(clamp(n0 + zip_n, 0, N0 - 1), n1, _));
+
+    // DFT down the columns first.
+    Func dft1 = fft_dim1(zipped, radix_factor(N1), -1.0f, group, prefix + "_dim1");
+
+    // Unzip the DFTs of the columns.
+    Func unzipped(prefix + "_unzipped");
+    // By linearity of the DFT, Z = X + j*Y, where X, Y, and Z are the
+    // DFTs of x, y and z.
+
+    // By the conjugate symmetry of real DFTs, computing Z_n +
+    // conj(Z_(N-n)) and Z_n - conj(Z_(N-n)) gives 2*X_n and 2*j*Y_n,
+    // respectively.
+    Tuple Z = dft1(n0%zip_n, n1, _);
+    Tuple symZ = dft1(n0%zip_n, (N1 - n1)%N1, _);
+    Tuple X = add(Z, conj(symZ));
+    Tuple Y = mul_j(sub(Z, conj(symZ)), -1.0f);
+    unzipped(add_implicit_args(n0, n1, r)) = scale(0.5f, selectz(n0 < zip_n, X, Y));
+
+    // Transpose so we can FFT dimension 0 (by making it dimension 1).
+    Func unzippedT = transpose(unzipped, prefix + "_unzippedT");
+
+    // DFT down the columns again (the rows of the original).
+    Func dftT = fft_dim1(unzippedT, radix_factor(N0), -1.0f, group, prefix + "_dim0");
+
+    // Transpose back.
+    if (desc.gain != 1.0f) {
+        result(add_implicit_args(n0, n1, r)) = scale(desc.gain, dftT(n1, n0, _));
+    } else {
+        result(add_implicit_args(n0, n1, r)) = dftT(n1, n0, _);
+    }
+    result.bound(n1, 0, N1/2 + 1);
+    result.unroll(n1);
+
+    unzipped.compute_at(dftT, Var("g")).vectorize(n0, group).unroll(n0);
+    dft1.compute_at(result, outermost(result));
+    dftT.compute_at(result, outermost(result));
+    schedule_result(result, N0, group, desc);
+
+    return result;
+}
+
+Func fft2d_c2r(Func c, int N0, int N1, const Target &target, const FFTDesc &desc) {
+    user_assert(N0 % 2 == 0) << "The c2r FFT requires an even size in dimension 0, not " << N0 << "\n";
+    user_assert(N1 == 1 || N1 % 2 == 0) << "The c2r FFT requires an even size in dimension 1, not " << N1 << "\n";
+    const int group = group_size(target, desc);
+    const std::string prefix = prefix_of(desc, "fft2d_c2r");
+
+    Var n0("n0"), n1("n1");
+    Func result(prefix);
+
+    if (N1 == 1) {
+        // The inverse of the 1D r2c transform above: rebuild the
+        // DFTs of the even and odd samples, E_k = (X_k +
+        // conj(X_(M-k)))/2 and O_k = W^-k*(X_k - conj(X_(M-k)))/2,
+        // and take the inverse DFT of Z = 2*(E + j*O), which
+        // has the even samples in its real part and the odd samples
+        // in its imaginary part.
+        const int M = N0/2;
+        Func W_N = W(N0, 1.0f);
+        Tuple X = c(n0, n1, _);
+        Tuple symX = conj(c(M - n0, n1, _));
+        Func zipped(prefix + "_zipped");
+        zipped(add_implicit_args(n0, n1, c)) =
+            add(add(X, symX), mul_j(mul(W_N(n0), sub(X, symX)), 1.0f));
+
+        Func zippedT = transpose(zipped, prefix + "_zippedT");
+        Func dftT = fft_dim1(zippedT, radix_factor(M), 1.0f, group, prefix);
+
+        Tuple z = dftT(n1, n0/2, _);
+        result(add_implicit_args(n0, n1, c)) = desc.gain*select(n0 % 2 == 0, re(z), im(z));
+
+        zippedT.compute_at(result, outermost(result));
+        dftT.compute_at(result, outermost(result));
+        schedule_result(result, N0, group, desc);
+        return result;
+    }
+
+    // Transpose the input.
+    Func cT = transpose(c, prefix + "_cT");
+    // Take the inverse DFT of the columns (rows in the final result).
+    Func dft0T = fft_dim1(cT, radix_factor(N0), 1.0f, group, prefix + "_dim0");
+
+    // Transpose so we can take the DFT of the columns again.
+    Func dft0 = transpose(dft0T, prefix + "_dft0");
+
+    // Zip two real DFTs X and Y into one complex DFT Z = X + j*Y
+    Func zipped(prefix + "_zipped");
+    // Construct the whole DFT domain of X and Y via conjugate
+    // symmetry. At n1 = N1/2, both branches are equal (the dft is
+    // real, so the conjugate is a no-op), so the slightly less
+    // intuitive form of this expression still works, but vectorizes
+    // more cleanly than n1 <= N1/2.
+    Tuple X = selectz(n1 < N1/2,
+                      dft0(n0, clamp(n1, 0, N1/2), _),
+                      conj(dft0(n0, clamp((N1 - n1)%N1, 0, N1/2), _)));
+
+    // The zip point is roughly half of the domain, aligned up to the
+    // nearest group.
+    int zip_n = ((N0/2 - 1) | (group - 1)) + 1;
+
+    Expr n0_Y = n0 + zip_n;
+    if (zip_n*2 != N0) {
+        // When the group-aligned zip location isn't exactly half of
+        // the domain, we need to clamp excess accesses.
+        n0_Y = clamp(n0_Y, 0, N0 - 1);
+    }
+    Tuple Y = selectz(n1 < N1/2,
+                      dft0(n0_Y, clamp(n1, 0, N1/2), _),
+                      conj(dft0(n0_Y, clamp((N1 - n1)%N1, 0, N1/2), _)));
+    zipped(add_implicit_args(n0, n1, c)) = add(X, mul_j(Y, 1.0f));
+
+    // Take the inverse DFT of the columns again.
+    Func dft = fft_dim1(zipped, radix_factor(N1), 1.0f, group, prefix + "_dim1");
+
+    // Extract the real inverse DFTs.
+    result(add_implicit_args(n0, n1, c)) = desc.gain*select(n0 < zip_n,
+                                                            re(dft(n0%zip_n, n1, _)),
+                                                            im(dft(n0%zip_n, n1, _)));
+    result.bound(n0, 0, N0);
+    result.bound(n1, 0, N1);
+
+    dft0.compute_at(dft, outermost(dft)).vectorize(dft0.args()[0], group).unroll(dft0.args()[0]);
+    dft0T.compute_at(dft, outermost(dft));
+    dft.compute_at(result, outermost(result));
+    schedule_result(result, N0, group, desc);
+
+    return result;
+}
@@ -0,0 +1,58 @@
+#ifndef FFT_H
+#define FFT_H
+
+#include <string>
+#include <vector>
+
+#include "Halide.h"
+
+// Options for the FFTs below.
+struct FFTDesc {
+    // A gain to apply to the result of the transform. None of the
+    // transforms are normalized, so a forward transform followed by
+    // an inverse one scales the signal by the number of points.
+    float gain;
+
+    // The number of transforms to compute at once, each in one lane
+    // of a vector. If zero, the natural vector width of the target is
+    // used.
+    int vector_width;
+
+    // Whether to compute the transforms of the batch dimensions in
+    // parallel.
+    bool parallel;
+
+    // A prefix for the names of the Funcs making up the transform.
+    std::string name;
+
+    FFTDesc() : gain(1.0f), vector_width(0), parallel(false) {}
+};
+
+// Compute a factorization of N into radices for which there are
+// specialized butterflies (8, 5, 4, 3, and 2), falling back to a
+// plain DFT for whatever is left.
+std::vector<int> radix_factor(int N);
+
+// All of these transform the first one or two dimensions of their
+// input. Any further dimensions are a batch of independent
+// transforms. A size N1 of 1 means a 1D transform of dimension 0 of
+// each row. sign = -1 indicates a forward transform, and sign = 1 an
+// inverse transform.
+
+// Compute the N0 x N1 complex DFT of x.
+Halide::Func fft2d_c2c(Halide::Func x, int N0, int N1, float sign,
+                       const Halide::Target &target, const FFTDesc &desc = FFTDesc());
+
+// Compute the N0 x N1 DFT of the real x. Because of the conjugate
+// symmetry of real DFTs, the result has dimensions N0 x (N1/2 + 1),
+// or (N0/2 + 1) if N1 is 1. N0 must be even, and so must N1 unless
+// it is 1.
+Halide::Func fft2d_r2c(Halide::Func r, int N0, int N1,
+                       const Halide::Target &target, const FFTDesc &desc = FFTDesc());
+
+// Compute the N0 x N1 inverse DFT of the transform of a real signal,
+// c, which has the dimensions of the result of fft2d_r2c.
+Halide::Func fft2d_c2r(Halide::Func c, int N0, int N1,
+                       const Halide::Target &target, const FFTDesc &desc = FFTDesc());
+
+#endif
@@ -0,0 +1,118 @@
+#include "Halide.h"
+
+#include "fft.h"
+
+namespace {
+
+using namespace Halide;
+
+enum class FFTTransform { C2C, R2C, C2R };
+enum class FFTDirection { Forward, Inverse };
+
+// A generator for batches of 1D and 2D FFTs of fixed size. Complex
+// numbers are stored interleaved: dimension 0 of complex buffers has
+// an extent of 2, the real and imaginary parts. Dimension 0 of real
+// buffers has an extent of 1. Dimensions 1 and 2 are the dimensions
+// transformed, and dimension 3 is the batch. If size1 is 1, dimension
+// 2 is a batch of 1D transforms too.
+class FFTGenerator : public Generator<FFTGenerator> {
+public:
+    GeneratorParam<int> size0{"size0", 32};
+    GeneratorParam<int> size1{"size1", 32};
+    GeneratorParam<FFTTransform> transform{"transform", FFTTransform::C2C,
+                                           {{"c2c", FFTTransform::C2C},
+                                            {"r2c", FFTTransform::R2C},
+                                            {"c2r", FFTTransform::C2R}}};
+    // Only c2c transforms can be either. r2c is always forward, and
+    // c2r inverse.
+    GeneratorParam<FFTDirection> direction{"direction", FFTDirection::Forward,
+                                           {{"forward", FFTDirection::Forward},
+                                            {"inverse", FFTDirection::Inverse}}};
+    GeneratorParam<float> gain{"gain", 1.0f};
+    GeneratorParam<int> vector_width{"vector_width", 0};
+    GeneratorParam<bool> parallel{"parallel", true};
+
+    ImageParam input{Float(32), 4, "input"};
+
+    Func build() {
+        const int N0 = size0, N1 = size1;
+        const bool complex_input = transform != FFTTransform::R2C;
+        const bool complex_output = transform != FFTTransform::C2R;
+
+        // The sizes of the transforms are fixed, so the input must be
+        // exactly the right size. The input of a c2r transform (and
+        // the output of an r2c one) is halved in its last transformed
+        // dimension.
+        int in_N0 = N0, in_N1 = N1, out_N0 = N0, out_N1 = N1;
+        int &half = N1 > 1 ? (complex_input ? in_N1 : out_N1) : (complex_input ? in_N0 : out_N0);
+        if (transform != FFTTransform::C2C) {
+            half = half/2 + 1;
+        }
+        input.set_bounds(0, 0, complex_input ? 2 : 1);
+        input.set_bounds(1, 0, in_N0);
+        input.set_bounds(2, 0, in_N1);
+
+        Var c("c"), n0("n0"), n1("n1"), b("b");
+
+        // Rounding up to whole vectors may read past the end of the
+        // rows of a batch of 1D transforms.
+        Func in = BoundaryConditions::repeat_edge(input);
+        Func x("x");
+        if (complex_input) {
+            x(n0, n1, b) = Tuple(in(0, n0, n1, b), in(1, n0, n1, b));
+        } else {
+            x(n0, n1, b) = in(0, n0, n1, b);
+        }
+
+        // Each batch is computed separately, so the transform itself
+        // doesn't need to be parallel.
+        FFTDesc desc;
+        desc.gain = gain;
+        desc.vector_width = vector_width;
+        desc.name = "fft";
+
+        Func fft;
+        switch ((FFTTransform)transform) {
+        case FFTTransform::C2C:
+            fft = fft2d_c2c(x, N0, N1, direction == FFTDirection::Forward ? -1.0f : 1.0f,
+                            target, desc);
+            break;
+        case FFTTransform::R2C:
+            fft = fft2d_r2c(x, N0, N1, target, desc);
+            break;
+        case FFTTransform::C2R:
+            fft = fft2d_c2r(x, N0, N1, target, desc);
+            break;
+        }
+
+        Func output("output");
+        if (complex_output) {
+            output(c, n0, n1, b) = select(c == 0, fft(n0, n1, b)[0], fft(n0, n1, b)[1]);
+        } else {
+            output(c, n0, n1, b) = fft(n0, n1, b);
+        }
+
+        output.output_buffer()
+            .set_bounds(0, 0, complex_output ? 2 : 1)
+            .set_bounds(1, 0, out_N0)
+            .set_bounds(2, 0, out_N1);
+
+        // Interleave the real and imaginary parts of vectors of the
+        // result as they are stored.
+        const int group = vector_width > 0 ? (int)vector_width : natural_vector_size<float>();
+        output.reorder(c, n0, n1, b).bound(c, 0, complex_output ? 2 : 1);
+        if (out_N0 >= group) {
+            output.vectorize(n0, group);
+        }
+        if (parallel) {
+            output.parallel(b);
+        }
+        fft.compute_at(output, b);
+
+        return output;
+    }
+};
+
+RegisterGenerator<FFTGenerator> register_fft{"fft"};
+
+}  // namespace
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "fft_forward_c2c.h"
+#include "fft_inverse_c2c.h"
+#include "fft_forward_r2c.h"
+#include "fft_inverse_c2r.h"
+#include "fft_forward_c2c_1d.h"
+#include "fft_forward_r2c_1d.h"
+#include "fft_inverse_c2r_1d.h"
+#include "fft_forward_c2c_48.h"
+#include "fft_forward_r2c_48.h"
+#include "fft_inverse_c2r_48.h"
+#include "fft_forward_r2c_1d_60.h"
+#include "fft_inverse_c2r_1d_60.h"
+
+#include "benchmark.h"
+#include "static_image.h"
+
+// The sizes the pipelines were generated for.
+const int N0 = 32, N1 = 32;
+const int N_1d = 1024, rows_1d = 8;
+const int N_48 = 48, N_60 = 60;
+const int batch = 16;
+
+const double kPi = 3.14159265358979323846;
+
+typedef int (*pipeline)(buffer_t *, buffer_t *);
+
+Image<float> random_image(int c, int x, int y, int b) {
+    Image<float> im(c, x, y, b);
+    for (int i = 0; i < b; i++) {
+        for (int j = 0; j < y; j++) {
+            for (int k = 0; k < x; k++) {
+                for (int l = 0; l < c; l++) {
+                    im(l, k, j, i) = (float)rand()/RAND_MAX - 0.5f;
+                }
+            }
+        }
+    }
+    return im;
+}
+
+// Compute the DFT of dimensions 1 and 2 of in (or just dimension 1
+// if n1 is 1) directly, for the outputs with k0 < m0 and k1 < m1.
+Image<float> reference_dft(Image<float> in, int n0, int n1, int m0, int m1, double sign) {
+    // Tables of the twiddle factors of each dimension.
+    std::vector<double> cos0(n0), sin0(n0), cos1(n1), sin1(n1);
+    for (int i = 0; i < n0; i++) {
+        cos0[i] = cos(sign*2*kPi*i/n0);
+        sin0[i] = sin(sign*2*kPi*i/n0);
+    }
+    for (int i = 0; i < n1; i++) {
+        cos1[i] = cos(sign*2*kPi*i/n1);
+        sin1[i] = sin(sign*2*kPi*i/n1);
+    }
+
+    Image<float> out(2, m0, in.extent(2), in.extent(3));
+    for (int b = 0; b < in.extent(3); b++) {
+        for (int row = 0; row < in.extent(2); row += n1) {
+            for (int k1 = 0; k1 < m1; k1++) {
+                for (int k0 = 0; k0 < m0; k0++) {
+                    double re = 0, im = 0;
+                    for (int i1 = 0; i1 < n1; i1++) {
+                        for (int i0 = 0; i0 < n0; i0++) {
+                            int t0 = (k0*i0) % n0, t1 = (k1*i1) % n1;
+                            double w_re = cos0[t0]*cos1[t1] - sin0[t0]*sin1[t1];
+                            double w_im = cos0[t0]*sin1[t1] + sin0[t0]*cos1[t1];
+                            double x_re = in(0, i0, row + i1, b);
+                            double x_im = in.extent(0) > 1 ? in(1, i0, row + i1, b) : 0.0;
+                            re += x_re*w_re - x_im*w_im;
+                            im += x_re*w_im + x_im*w_re;
+                        }
+                    }
+                    out(0, k0, row + k1, b) = (float)re;
+                    out(1, k0, row + k1, b) = (float)im;
+                }
+            }
+        }
+    }
+    return out;
+}
+
+// Check that a and b (scaled by scale) are the same, to within the
+// precision of a float FFT.
+bool check(const char *name, Image<float> a, Image<float> b, float scale = 1.0f) {
+    float max_error = 0, max_value = 0;
+    for (int i = 0; i < a.extent(3); i++) {
+        for (int j = 0; j < a.extent(2); j++) {
+            for (int k = 0; k < a.extent(1); k++) {
+                for (int l = 0; l < a.extent(0); l++) {
+                    float expected = b(l, k, j, i)*scale;
+                    max_error = std::max(max_error, std::abs(a(l, k, j, i) - expected));
+                    max_value = std::max(max_value, std::abs(expected));
+                }
+            }
+        }
+    }
+    if (max_error > 1e-4f*max_value) {
+        printf("%s: error of %g for values up to %g\n", name, max_error, max_value);
+        return false;
+    }
+    return true;
+}
+
+// For a description of the methodology used here, see
+// http://www.fftw.org/speed/method.html. flops_per_point is 5 for
+// complex transforms, and 2.5 for real ones.
+void bench(const char *name, pipeline p, Image<float> in, Image<float> out,
+           int transforms, int points, double flops_per_point) {
+    double t = benchmark(10, 10, [&]() { p(in, out); })*1e6/transforms;
+    printf("%-16s %8.3f us per transform, %8.1f MFLOP/s\n",
+           name, t, flops_per_point*points*log2((double)points)/t);
+}
+
+int main(int argc, char **argv) {
+    // 2D transforms, the same size as test/performance/fft.cpp, so
+    // the numbers can be compared.
+    {
+        Image<float> x = random_image(2, N0, N1, batch);
+        Image<float> X(2, N0, N1, batch), xX(2, N0, N1, batch);
+        if (fft_forward_c2c(x, X) != 0 || fft_inverse_c2c(X, xX) != 0) {
+            printf("c2c failed\n");
+            return -1;
+        }
+        if (!check("fft_forward_c2c", X, reference_dft(x, N0, N1, N0, N1, -1)) ||
+            !check("fft_inverse_c2c", xX, x, N0*N1)) {
+            return -1;
+        }
+
+        Image<float> r = random_image(1, N0, N1, batch);
+        Image<float> R(2, N0, N1/2 + 1, batch), rR(1, N0, N1, batch);
+        if (fft_forward_r2c(r, R) != 0 || fft_inverse_c2r(R, rR) != 0) {
+            printf("r2c/c2r failed\n");
+            return -1;
+        }
+        if (!check("fft_forward_r2c", R, reference_dft(r, N0, N1, N0, N1/2 + 1, -1)) ||
+            !check("fft_inverse_c2r", rR, r, N0*N1)) {
+            return -1;
+        }
+
+        printf("%d x %d:\n", N0, N1);
+        bench("c2c", fft_forward_c2c, x, X, batch, N0*N1, 5);
+        bench("r2c", fft_forward_r2c, r, R, batch, N0*N1, 2.5);
+        bench("c2r", fft_inverse_c2r, R, rR, batch, N0*N1, 2.5);
+    }
+
+    // Batches of 1D transforms of rows.
+    {
+        Image<float> x = random_image(2, N_1d, rows_1d, batch);
+        Image<float> X(2, N_1d, rows_1d, batch);
+        if (fft_forward_c2c_1d(x, X) != 0) {
+            printf("1D c2c failed\n");
+            return -1;
+        }
+        if (!check("fft_forward_c2c_1d", X, reference_dft(x, N_1d, 1, N_1d, 1, -1))) {
+            return -1;
+        }
+
+        Image<float> r = random_image(1, N_1d, rows_1d, batch);
+        Image<float> R(2, N_1d/2 + 1, rows_1d, batch), rR(1, N_1d, rows_1d, batch);
+        if (fft_forward_r2c_1d(r, R) != 0 || fft_inverse_c2r_1d(R, rR) != 0) {
+            printf("1D r2c/c2r failed\n");
+            return -1;
+        }
+        if (!check("fft_forward_r2c_1d", R, reference_dft(r, N_1d, 1, N_1d/2 + 1, 1, -1)) ||
+            !check("fft_inverse_c2r_1d", rR, r, N_1d)) {
+            return -1;
+        }
+
+        printf("%d x %d rows:\n", N_1d, rows_1d);
+        bench("c2c", fft_forward_c2c_1d, x, X, rows_1d*batch, N_1d, 5);
+        bench("r2c", fft_forward_r2c_1d, r, R, rows_1d*batch, N_1d, 2.5);
+        bench("c2r", fft_inverse_c2r_1d, R, rR, rows_1d*batch, N_1d, 2.5);
+    }
+
+    // Sizes that aren't powers of two. These are only checked for
+    // correctness.
+    {
+        Image<float> x = random_image(2, N_48, N_48, batch);
+        Image<float> X(2, N_48, N_48, batch);
+        if (fft_forward_c2c_48(x, X) != 0) {
+            printf("%d x %d c2c failed\n", N_48, N_48);
+            return -1;
+        }
+        if (!check("fft_forward_c2c_48", X, reference_dft(x, N_48, N_48, N_48, N_48, -1))) {
+            return -1;
+        }
+
+        Image<float> r = random_image(1, N_48, N_48, batch);
+        Image<float> R(2, N_48, N_48/2 + 1, batch), rR(1, N_48, N_48, batch);
+        if (fft_forward_r2c_48(r, R) != 0 || fft_inverse_c2r_48(R, rR) != 0) {
+            printf("%d x %d r2c/c2r failed\n", N_48, N_48);
+            return -1;
+        }
+        if (!check("fft_forward_r2c_48", R, reference_dft(r, N_48, N_48, N_48, N_48/2 + 1, -1)) ||
+            !check("fft_inverse_c2r_48", rR, r, N_48*N_48)) {
+            return -1;
+        }
+    }
+    {
+        Image<float> r = random_image(1, N_60, rows_1d, batch);
+        Image<float> R(2, N_60/2 + 1, rows_1d, batch), rR(1, N_60, rows_1d, batch);
+        if (fft_forward_r2c_1d_60(r, R) != 0 || fft_inverse_c2r_1d_60(R, rR) != 0) {
+            printf("%d point r2c/c2r failed\n", N_60);
+            return -1;
+        }
+        if (!check("fft_forward_r2c_1d_60", R, reference_dft(r, N_60, 1, N_60/2 + 1, 1, -1)) ||
+            !check("fft_inverse_c2r_1d_60", rR, r, N_60)) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
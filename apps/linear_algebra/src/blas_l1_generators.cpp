@@ -127,19 +127,15 @@ class DotGenerator :
         Var i("i");
         Func result;
         if (vectorize_) {
-            Func dot;
-
-            RDom k(0, size_vecs);
-            dot(i) += x_(k*vec_size + i) * y_(k*vec_size + i);
-
-            RDom lanes(0, vec_size);
+            // Sum a vector of products at a time. The vectors are
+            // accumulated across k.y, and added up at the end.
+            RDom k(0, vec_size, 0, size_vecs);
             RDom tail(size_vecs * vec_size, size_tail);
-            result(i) = undef<T>();
-            result(0) = sum(dot(lanes));
-            result(0) += sum(x_(tail) * y_(tail));
+            result(i) = cast<T>(0);
+            result(0) += x_(k.y*vec_size + k.x) * y_(k.y*vec_size + k.x);
+            result(0) += x_(tail) * y_(tail);
 
-            dot.compute_root().vectorize(i);
-            dot.update(0).vectorize(i);
+            result.update(0).atomic().vectorize(k.x);
         } else {
             RDom k(0, size);
             result(i) = undef<T>();
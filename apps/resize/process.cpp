@@ -0,0 +1,79 @@
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+#include "resize_linear_uint8.h"
+#include "resize_cubic_uint8.h"
+#include "resize_lanczos_uint8.h"
+#include "resize_cubic_float32.h"
+
+#include "static_image.h"
+#include "image_io.h"
+#include "benchmark.h"
+
+typedef int (*resize_fn)(buffer_t *, float, float, buffer_t *);
+
+template<typename T>
+void bench(const char *name, resize_fn f, Image<T> in, float scale, Image<T> out, int iterations) {
+    double t = benchmark(iterations, 1, [&]() {
+        f(in, scale, scale, out);
+    });
+    double megapixels = out.width() * out.height() / 1e6;
+    printf("%-16s %8.3f ms, %8.1f MP/s (output)\n", name, t * 1e3, megapixels / t);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 4) {
+        printf("Usage: ./process input scale output [timing_iterations]\n"
+               "e.g. ./process input.png 0.25 output.png 10\n"
+               "Images can be .png, .ppm, or .halide_image files.\n");
+        return 0;
+    }
+
+    const float scale = atof(argv[2]);
+    const int iterations = argc > 4 ? atoi(argv[4]) : 10;
+
+    // .halide_image files are memory-mapped instead of decoded and
+    // encoded, so that very large images are quick to load and save,
+    // and the result is written straight to the output file.
+    std::unique_ptr<MappedImage<uint8_t>> mapped_input, mapped_output;
+    Image<uint8_t> input;
+    if (ends_with_ignore_case(argv[1], ".halide_image")) {
+        mapped_input.reset(new MappedImage<uint8_t>(argv[1]));
+        input = mapped_input->image();
+    } else {
+        input = load<uint8_t>(argv[1]);
+    }
+
+    const int width = input.width() * scale, height = input.height() * scale;
+    Image<uint8_t> output;
+    if (ends_with_ignore_case(argv[3], ".halide_image")) {
+        mapped_output.reset(new MappedImage<uint8_t>(argv[3], width, height, input.channels()));
+        output = mapped_output->image();
+    } else {
+        output = Image<uint8_t>(width, height, input.channels());
+    }
+    printf("Resizing %dx%d to %dx%d\n", input.width(), input.height(), width, height);
+
+    bench("linear uint8", resize_linear_uint8, input, scale, output, iterations);
+    bench("lanczos uint8", resize_lanczos_uint8, input, scale, output, iterations);
+    bench("cubic uint8", resize_cubic_uint8, input, scale, output, iterations);
+    if (!mapped_output) {
+        save(output, argv[3]);
+    }
+
+    // The same resize of a float image, for comparison with the
+    // resize app, which always works in float.
+    Image<float> input_float(input.width(), input.height(), input.channels());
+    for (int c = 0; c < input.channels(); c++) {
+        for (int y = 0; y < input.height(); y++) {
+            for (int x = 0; x < input.width(); x++) {
+                input_float(x, y, c) = input(x, y, c) / 255.0f;
+            }
+        }
+    }
+    Image<float> output_float(width, height, input.channels());
+    bench("cubic float32", resize_cubic_float32, input_float, scale, output_float, iterations);
+
+    return 0;
+}
@@ -189,7 +189,8 @@ int main(int argc, char **argv) {
            kernelInfo[interpolationType].name);
 
     double min = benchmark(10, 1, [&]() { final.realize(out); });
-    std::cout << " took min=" << min * 1000 << ", avg=" << avg * 1000 << " msec." << std::endl;
+    std::cout << " took min=" << min * 1000 << " msec, "
+              << out_width * out_height / (min * 1e6) << " MP/s (output)." << std::endl;
 
     save(out, outfile);
 }
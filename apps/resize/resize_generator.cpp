@@ -0,0 +1,218 @@
+#include "Halide.h"
+
+namespace {
+
+using namespace Halide;
+
+enum class Interpolation { Box, Linear, Cubic, Lanczos };
+
+Expr kernel_box(Expr x) {
+    Expr xx = abs(x);
+    return select(xx <= 0.5f, 1.0f, 0.0f);
+}
+
+Expr kernel_linear(Expr x) {
+    Expr xx = abs(x);
+    return select(xx < 1.0f, 1.0f - xx, 0.0f);
+}
+
+Expr kernel_cubic(Expr x) {
+    Expr xx = abs(x);
+    Expr xx2 = xx * xx;
+    Expr xx3 = xx2 * xx;
+    float a = -0.5f;
+
+    return select(xx < 1.0f, (a + 2.0f) * xx3 - (a + 3.0f) * xx2 + 1,
+                  select (xx < 2.0f, a * xx3 - 5 * a * xx2 + 8 * a * xx - 4.0f * a,
+                          0.0f));
+}
+
+Expr sinc(Expr x) {
+    return sin(float(M_PI) * x) / x;
+}
+
+Expr kernel_lanczos(Expr x) {
+    Expr value = sinc(x) * sinc(x/3);
+    value = select(x == 0.0f, 1.0f, value); // Take care of singularity at zero
+    value = select(x > 3 || x < -3, 0.0f, value); // Clamp to zero out of bounds
+    return value;
+}
+
+struct KernelInfo {
+    float size;
+    Expr (*kernel)(Expr);
+};
+
+const KernelInfo kernel_info[] = {
+    { 0.5f, kernel_box },
+    { 1.0f, kernel_linear },
+    { 2.0f, kernel_cubic },
+    { 3.0f, kernel_lanczos }
+};
+
+// The fixed-point formats used for 8-bit images. The weights have 14
+// fractional bits, and the result of the vertical pass (stored as
+// 16 bits) has 6, which leaves room for the overshoot of kernels with
+// negative lobes.
+const int weight_bits = 14;
+const int intermediate_bits = 6;
+
+// The taps of the kernel along one dimension, for each output
+// coordinate along it: the input coordinate of the first tap, and the
+// normalized weight of each tap.
+struct Taps {
+    Func begin, weights;
+    Expr count;
+};
+
+// A separable resampling Generator for arbitrary scale factors. The
+// kernel is evaluated only once per tap per output row or column,
+// when building tables of the taps. The image is then resampled
+// vertically, then horizontally, with a vectorized weighted sum of
+// the taps from the tables. 8-bit images are resampled in fixed point.
+class Resize : public Generator<Resize> {
+public:
+    GeneratorParam<Interpolation> interpolation{"interpolation", Interpolation::Cubic,
+                                                {{"box", Interpolation::Box},
+                                                 {"linear", Interpolation::Linear},
+                                                 {"cubic", Interpolation::Cubic},
+                                                 {"lanczos", Interpolation::Lanczos}}};
+    // Either UInt(8) or Float(32). The output has the same type.
+    GeneratorParam<Type> input_type{"input_type", UInt(8)};
+
+    ImageParam input{UInt(8), 3, "input"};
+    // The size of the output relative to the input.
+    Param<float> scale_x{"scale_x", 1.0f, 0.0f, 1000.0f};
+    Param<float> scale_y{"scale_y", 1.0f, 0.0f, 1000.0f};
+
+    // Compute the taps for resampling a dimension of the given extent
+    // by a scale factor.
+    Taps make_taps(Var x, Expr scale, Expr extent, bool fixed_point) {
+        const KernelInfo &info = kernel_info[(int)(Interpolation)interpolation];
+        const std::string &n = x.name();
+        Var k("k");
+        Taps taps;
+
+        // For downscaling, widen the interpolation kernel to perform
+        // lowpass filtering.
+        Expr kernel_scale = min(scale, 1.0f);
+        Expr support = info.size / kernel_scale;
+        taps.count = min(cast<int>(2.0f * support) + 1, extent);
+
+        // The coordinate in the input that the center of each output
+        // pixel maps to. Near the edges, the window of taps is moved
+        // inside the image rather than reading outside of it. The
+        // normalization makes up for the part of the kernel that then
+        // falls outside the window.
+        Expr source = (x + 0.5f) / scale - 0.5f;
+        taps.begin = Func(n + "_begin");
+        taps.begin(x) = clamp(cast<int>(ceil(source - support)), 0, extent - taps.count);
+
+        RDom r(0, taps.count, n + "_r");
+        Func unnormalized(n + "_unnormalized"), total(n + "_total"), normalized(n + "_normalized");
+        unnormalized(x, k) = info.kernel((taps.begin(x) + k - source) * kernel_scale);
+        total(x) = 0.0f;
+        total(x) += unnormalized(x, r);
+        normalized(x, k) = unnormalized(x, k) / total(x);
+
+        unnormalized.compute_root();
+        total.compute_root();
+        normalized.compute_root();
+        taps.begin.compute_root();
+
+        if (!fixed_point) {
+            taps.weights = normalized;
+            return taps;
+        }
+
+        // Rounding the weights to fixed point changes their sum. Add
+        // the difference to the tap nearest the center of the kernel,
+        // so that flat regions of the image stay flat.
+        Func quantized(n + "_quantized"), quantized_total(n + "_quantized_total");
+        quantized(x, k) = cast<int16_t>(round(normalized(x, k) * (1 << weight_bits)));
+        quantized_total(x) = 0;
+        quantized_total(x) += cast<int>(quantized(x, r));
+        Expr center = clamp(cast<int>(round(source)) - taps.begin(x), 0, taps.count - 1);
+        Expr correction = select(k == center, (1 << weight_bits) - quantized_total(x), 0);
+        taps.weights = Func(n + "_weights");
+        taps.weights(x, k) = quantized(x, k) + cast<int16_t>(correction);
+
+        quantized.compute_root();
+        quantized_total.compute_root();
+        taps.weights.compute_root();
+        return taps;
+    }
+
+    Func build() {
+        const Type type = input_type;
+        user_assert(type == UInt(8) || type == Float(32))
+            << "The resize Generator only supports uint8 and float32 images\n";
+        const bool fixed_point = type.is_uint();
+        input = ImageParam(type, 3, "input");
+
+        Var x("x"), y("y"), c("c");
+
+        Taps tx = make_taps(x, scale_x, input.width(), fixed_point);
+        Taps ty = make_taps(y, scale_y, input.height(), fixed_point);
+        RDom rx(0, tx.count, "rx"), ry(0, ty.count, "ry");
+
+        // The tables are already clamped, but bounds inference can't
+        // see inside them.
+        Expr row = clamp(ty.begin(y), 0, input.height() - ty.count) + ry;
+        Expr col = clamp(tx.begin(x), 0, input.width() - tx.count) + rx;
+
+        // Resample vertically, then horizontally. The vertical pass
+        // reads whole rows of the input, and its result is stored
+        // along with the rows of the output that use it.
+        Func vert("vert"), vert_result("vert_result"), horiz("horiz"), output("output");
+        if (fixed_point) {
+            vert(x, y, c) = 0;
+            vert(x, y, c) += cast<int32_t>(ty.weights(y, ry)) * cast<int32_t>(input(x, row, c));
+            const int shift = weight_bits - intermediate_bits;
+            vert_result(x, y, c) =
+                cast<int16_t>(clamp((vert(x, y, c) + (1 << (shift - 1))) >> shift, -32768, 32767));
+
+            horiz(x, y, c) = 0;
+            horiz(x, y, c) += cast<int32_t>(tx.weights(x, rx)) * cast<int32_t>(vert_result(col, y, c));
+            const int bits = weight_bits + intermediate_bits;
+            output(x, y, c) = cast<uint8_t>(clamp((horiz(x, y, c) + (1 << (bits - 1))) >> bits, 0, 255));
+        } else {
+            vert(x, y, c) = 0.0f;
+            vert(x, y, c) += ty.weights(y, ry) * input(x, row, c);
+            vert_result(x, y, c) = vert(x, y, c);
+
+            horiz(x, y, c) = 0.0f;
+            horiz(x, y, c) += tx.weights(x, rx) * vert_result(col, y, c);
+            output(x, y, c) = horiz(x, y, c);
+        }
+
+        // The sums over the taps accumulate in registers, one vector
+        // of the result at a time.
+        const int vector_size = fixed_point ? natural_vector_size<int16_t>() : natural_vector_size<float>();
+        Var yi("yi");
+        output
+            .reorder(x, c, y)
+            .split(y, y, yi, 8)
+            .parallel(y)
+            .vectorize(x, vector_size);
+        vert_result
+            .compute_at(output, yi)
+            .vectorize(x, vector_size);
+        vert.compute_at(vert_result, x)
+            .vectorize(x);
+        vert.update()
+            .reorder(x, ry)
+            .vectorize(x);
+        horiz.compute_at(output, x)
+            .vectorize(x);
+        horiz.update()
+            .reorder(x, rx)
+            .vectorize(x);
+
+        return output;
+    }
+};
+
+RegisterGenerator<Resize> register_resize{"resize"};
+
+}  // namespace
@@ -1,5 +1,7 @@
 // This simple PNG IO library works with *both* the Halide::Image<T> type *and*
-// the simple static_image.h version. Also now includes PPM support for faster load/save.
+// the simple static_image.h version. Also now includes PPM support for faster load/save,
+// and the uncompressed .halide_image format from raw_image.h, which can also be
+// memory-mapped with no copy at all.
 // If you want the static_image.h version, to use in a program statically
 // linking against a Halide pipeline pre-compiled with Func::compile_to_file, you
 // need to explicitly #include static_image.h first.
@@ -14,6 +16,8 @@
 
 #define _assert(condition, ...) if (!(condition)) {fprintf(stderr, __VA_ARGS__); exit(-1);}
 
+#include "raw_image.h"
+
 // Convert to u8
 inline void convert(uint8_t in, uint8_t &out) {out = in;}
 inline void convert(uint16_t in, uint8_t &out) {out = in >> 8;}
@@ -383,8 +387,10 @@ Image<T> load(std::string filename) {
         return load_png<T>(filename);
     } else if (ends_with_ignore_case(filename, ".ppm")) {
         return load_ppm<T>(filename);
+    } else if (ends_with_ignore_case(filename, ".halide_image")) {
+        return load_raw<T>(filename);
     } else {
-        _assert(false, "[load] unsupported file extension (png|ppm supported)");
+        _assert(false, "[load] unsupported file extension (png|ppm|halide_image supported)");
     }
 }
 
@@ -394,8 +400,10 @@ void save(Image<T> im, std::string filename) {
         save_png<T>(im, filename);
     } else if (ends_with_ignore_case(filename, ".ppm")) {
         save_ppm<T>(im, filename);
+    } else if (ends_with_ignore_case(filename, ".halide_image")) {
+        save_raw<T>(im, filename);
     } else {
-        _assert(false, "[save] unsupported file extension (png|ppm supported)");
+        _assert(false, "[save] unsupported file extension (png|ppm|halide_image supported)");
     }
 }
 
@@ -0,0 +1,302 @@
+// A simple uncompressed image format, .halide_image, for benchmarking
+// pipelines on large inputs without paying for decoding them. The
+// pixels are stored exactly as they are in memory, so a file can be
+// memory-mapped straight into an Image with no copy. Like image_io.h,
+// this works with both the Halide::Image<T> type and the simple
+// static_image.h version (include static_image.h first for that).
+//
+// A file is a RawImageHeader, followed by the pixels at data_offset
+// (a multiple of the page size), with the strides given in the
+// header. All values are in the byte order of the machine that wrote
+// the file.
+
+#ifndef RAW_IMAGE_H
+#define RAW_IMAGE_H
+
+#include <stdint.h>
+#include <string.h>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <string>
+
+#include <fcntl.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef _assert
+#define _assert(condition, ...) if (!(condition)) {fprintf(stderr, __VA_ARGS__); exit(-1);}
+#endif
+
+struct RawImageHeader {
+    char magic[8];          // "HLIMAGE"
+    uint32_t byte_order;    // 0x01020304, to detect files from other machines.
+    uint32_t version;       // 1
+    uint32_t type_code;     // As halide_type_code_t: 0 = int, 1 = uint, 2 = float.
+    uint32_t bits;
+    uint32_t dimensions;
+    int32_t min[4], extent[4], stride[4];  // The strides are in elements.
+    uint64_t data_offset;   // From the start of the file, in bytes.
+};
+
+const uint32_t raw_image_byte_order = 0x01020304;
+const uint64_t raw_image_data_offset = 4096;
+
+template<typename T>
+uint32_t raw_image_type_code() {
+    return !std::numeric_limits<T>::is_integer ? 2 : std::numeric_limits<T>::is_signed ? 0 : 1;
+}
+
+// Make the header for a dense planar image of the given size, the
+// same layout as Image<T>(width, height, channels).
+template<typename T>
+RawImageHeader make_raw_image_header(int width, int height = 0, int channels = 0) {
+    RawImageHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "HLIMAGE", 8);
+    h.byte_order = raw_image_byte_order;
+    h.version = 1;
+    h.type_code = raw_image_type_code<T>();
+    h.bits = sizeof(T) * 8;
+    h.dimensions = channels ? 3 : height ? 2 : 1;
+    h.extent[0] = width;
+    h.extent[1] = height;
+    h.extent[2] = channels;
+    h.stride[0] = 1;
+    h.stride[1] = width;
+    h.stride[2] = width * (height ? height : 1);
+    h.data_offset = raw_image_data_offset;
+    return h;
+}
+
+// The number of bytes from the start of the data to the end of the
+// last element.
+inline uint64_t raw_image_data_size(const RawImageHeader &h) {
+    uint64_t last = 0;
+    for (uint32_t i = 0; i < h.dimensions; i++) {
+        _assert(h.extent[i] > 0 && h.stride[i] >= 0, "Raw image has a bad extent or stride\n");
+        last += (uint64_t)(h.extent[i] - 1) * h.stride[i];
+    }
+    return (last + 1) * (h.bits / 8);
+}
+
+template<typename T>
+void check_raw_image_header(const RawImageHeader &h, const std::string &filename) {
+    _assert(memcmp(h.magic, "HLIMAGE", 8) == 0, "%s is not a .halide_image file\n", filename.c_str());
+    _assert(h.byte_order == raw_image_byte_order, "%s was written on a machine of the other byte order\n", filename.c_str());
+    _assert(h.version == 1, "%s is a .halide_image of unknown version %u\n", filename.c_str(), h.version);
+    _assert(h.type_code == raw_image_type_code<T>() && h.bits == sizeof(T) * 8,
+            "%s has the wrong type of pixels\n", filename.c_str());
+    _assert(h.dimensions >= 1 && h.dimensions <= 4, "%s has %u dimensions\n", filename.c_str(), h.dimensions);
+}
+
+// A .halide_image file mapped into memory. The Image returned by
+// image() points straight at the mapping, so it's only valid while
+// the MappedImage exists. Pages are only read from disk when they're
+// first touched, so opening even a very large file is instant.
+template<typename T>
+class MappedImage {
+    uint8_t *base;
+    size_t size;
+    bool writable;
+    Image<T> im;
+
+    MappedImage(const MappedImage &);
+    MappedImage &operator=(const MappedImage &);
+
+    void map(const std::string &filename, int flags) {
+#ifdef _WIN32
+        // No mmap. Read the whole file instead.
+        FILE *f = fopen(filename.c_str(), "rb");
+        _assert(f, "File %s could not be opened for reading\n", filename.c_str());
+        fseek(f, 0, SEEK_END);
+        size = ftell(f);
+        fseek(f, 0, SEEK_SET);
+        base = new uint8_t[size];
+        _assert(fread(base, 1, size, f) == size, "Could not read %s\n", filename.c_str());
+        fclose(f);
+        this->filename = filename;
+#else
+        int fd = open(filename.c_str(), flags);
+        _assert(fd >= 0, "File %s could not be opened\n", filename.c_str());
+        struct stat st;
+        _assert(fstat(fd, &st) == 0, "Could not stat %s\n", filename.c_str());
+        size = st.st_size;
+        _assert(size >= sizeof(RawImageHeader), "%s is too small to be a .halide_image file\n", filename.c_str());
+        void *p = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+        _assert(p != MAP_FAILED, "Could not map %s\n", filename.c_str());
+        close(fd);
+        base = (uint8_t *)p;
+#endif
+
+        RawImageHeader h;
+        memcpy(&h, base, sizeof(h));
+        check_raw_image_header<T>(h, filename);
+        _assert(h.data_offset + raw_image_data_size(h) <= size, "%s is truncated\n", filename.c_str());
+
+        buffer_t buf;
+        memset(&buf, 0, sizeof(buf));
+        for (uint32_t i = 0; i < h.dimensions; i++) {
+            buf.min[i] = h.min[i];
+            buf.extent[i] = h.extent[i];
+            buf.stride[i] = h.stride[i];
+        }
+        buf.elem_size = sizeof(T);
+        buf.host = base + h.data_offset;
+        im = Image<T>(&buf);
+    }
+
+#ifdef _WIN32
+    std::string filename;
+#endif
+
+public:
+    // Map an existing file. If writable, changes to the image are
+    // written back to the file.
+    MappedImage(const std::string &filename, bool writable = false) : writable(writable) {
+        map(filename, writable ? O_RDWR : O_RDONLY);
+    }
+
+    // Create a new file for a dense planar image of the given size,
+    // and map it for writing, e.g. to realize the output of a
+    // pipeline directly into the file.
+    MappedImage(const std::string &filename, int width, int height, int channels = 0) : writable(true) {
+        RawImageHeader h = make_raw_image_header<T>(width, height, channels);
+        FILE *f = fopen(filename.c_str(), "wb");
+        _assert(f, "File %s could not be opened for writing\n", filename.c_str());
+        _assert(fwrite(&h, sizeof(h), 1, f) == 1, "Could not write to %s\n", filename.c_str());
+        // Extend the file to its full size by writing its last byte.
+        _assert(fseek(f, (long)(h.data_offset + raw_image_data_size(h) - 1), SEEK_SET) == 0 &&
+                fputc(0, f) != EOF, "Could not write to %s\n", filename.c_str());
+        fclose(f);
+        map(filename, O_RDWR);
+    }
+
+    ~MappedImage() {
+#ifdef _WIN32
+        if (writable) {
+            FILE *f = fopen(filename.c_str(), "wb");
+            if (f) {
+                fwrite(base, 1, size, f);
+                fclose(f);
+            }
+        }
+        delete[] base;
+#else
+        munmap(base, size);
+#endif
+    }
+
+    Image<T> image() const {
+        return im;
+    }
+};
+
+// Write an image to a .halide_image file a strip of rows at a time, so
+// that the whole image never has to be in memory at once. The file has
+// the same layout as Image<T>(width, height, channels). The strips
+// can be written in any order, and can have any layout themselves.
+template<typename T>
+class RawImageWriter {
+    FILE *f;
+    RawImageHeader h;
+    std::string filename;
+
+    RawImageWriter(const RawImageWriter &);
+    RawImageWriter &operator=(const RawImageWriter &);
+
+public:
+    RawImageWriter(const std::string &filename, int width, int height, int channels = 0) :
+        h(make_raw_image_header<T>(width, height, channels)), filename(filename) {
+        f = fopen(filename.c_str(), "wb");
+        _assert(f, "File %s could not be opened for writing\n", filename.c_str());
+        _assert(fwrite(&h, sizeof(h), 1, f) == 1, "Could not write to %s\n", filename.c_str());
+    }
+
+    // Write the rows strip.min(1) to strip.min(1) + strip.height() - 1
+    // of the image. The strip must be the full width of the image,
+    // with all of its channels.
+    void write(Image<T> strip) {
+        strip.copy_to_host();
+        const int width = h.extent[0];
+        const int height = h.extent[1] ? h.extent[1] : 1;
+        const int channels = h.extent[2] ? h.extent[2] : 1;
+        _assert(strip.width() == width && strip.channels() == channels,
+                "Strip written to %s doesn't match the width and channels of the image\n", filename.c_str());
+        const int y_min = strip.dimensions() > 1 ? strip.min(1) : 0;
+        _assert(y_min >= 0 && y_min + strip.height() <= height,
+                "Strip written to %s is outside of the image\n", filename.c_str());
+
+        T *row = new T[width];
+        for (int c = 0; c < channels; c++) {
+            for (int y = y_min; y < y_min + strip.height(); y++) {
+                const T *src = &strip(strip.min(0), y, c);
+                const int stride = strip.stride(0);
+                if (stride == 1) {
+                    memcpy(row, src, width * sizeof(T));
+                } else {
+                    for (int x = 0; x < width; x++) {
+                        row[x] = src[x * stride];
+                    }
+                }
+                uint64_t offset = h.data_offset + ((uint64_t)c * h.stride[2] + (uint64_t)y * h.stride[1]) * sizeof(T);
+                _assert(fseek(f, (long)offset, SEEK_SET) == 0 &&
+                        fwrite(row, sizeof(T), width, f) == (size_t)width,
+                        "Could not write to %s\n", filename.c_str());
+            }
+        }
+        delete[] row;
+    }
+
+    ~RawImageWriter() {
+        // Make sure the file is full size, even if the last rows
+        // weren't written.
+        const uint64_t end = h.data_offset + raw_image_data_size(h);
+        fseek(f, 0, SEEK_END);
+        if ((uint64_t)ftell(f) < end) {
+            fseek(f, (long)(end - 1), SEEK_SET);
+            fputc(0, f);
+        }
+        fclose(f);
+    }
+};
+
+// Load a .halide_image file into a new Image. To avoid the copy, use
+// a MappedImage instead.
+template<typename T>
+Image<T> load_raw(std::string filename) {
+    MappedImage<T> mapped(filename);
+    Image<T> src = mapped.image();
+    Image<T> im;
+    if (src.dimensions() > 2) {
+        im = Image<T>(src.width(), src.height(), src.channels());
+    } else if (src.dimensions() > 1) {
+        im = Image<T>(src.width(), src.height());
+    } else {
+        im = Image<T>(src.width());
+    }
+    for (int c = 0; c < src.channels(); c++) {
+        for (int y = 0; y < src.height(); y++) {
+            for (int x = 0; x < src.width(); x++) {
+                im(x, y, c) = src(x + src.min(0),
+                                  y + (src.dimensions() > 1 ? src.min(1) : 0),
+                                  c + (src.dimensions() > 2 ? src.min(2) : 0));
+            }
+        }
+    }
+    im.set_host_dirty();
+    return im;
+}
+
+template<typename T>
+void save_raw(Image<T> im, std::string filename) {
+    RawImageWriter<T> writer(filename, im.width(),
+                             im.dimensions() > 1 ? im.height() : 0,
+                             im.dimensions() > 2 ? im.channels() : 0);
+    writer.write(im);
+}
+
+#endif
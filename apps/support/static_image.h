@@ -78,6 +78,12 @@ public:
         initialize(x, y, z, w, interleaved);
     }
 
+    /** Wrap an existing buffer_t. The image doesn't own the memory
+     * it points to, which must outlive the image. */
+    explicit Image(const buffer_t *b) {
+        contents = new Contents(*b, NULL);
+    }
+
     Image(const Image &other) : contents(other.contents) {
         if (contents) {
             contents->ref_count++;
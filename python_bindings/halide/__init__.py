@@ -260,6 +260,19 @@ Func.parallel = lambda self, *a: _parallel0(self, *wrap_gpu_args(a))
 Func.vectorize = lambda self, *a: _vectorize0(self, *wrap_gpu_args_int(a))
 Func.unroll = lambda self, *a: _unroll0(self, *wrap_gpu_args_int(a))
 
+_realize0 = FuncType.realize
+
+def _func_realize(self, *args):
+    if len(args) in (1, 2) and isinstance(args[0], numpy.ndarray):
+        target = args[1] if len(args) == 2 else get_jit_target_from_environment()
+        realize_nogil(self, buffer_from_numpy(args[0], writable=True), target)
+        return args[0]
+    elif 1 <= len(args) <= 4 and all(isinstance(a, integer_types) for a in args):
+        return realize_nogil(self, list(args), get_jit_target_from_environment())
+    return _realize0(self, *args)
+
+FuncType.realize = _func_realize
+
 #Deprecated
 Func.cuda_blocks = lambda self, *a: _gpu_blocks0(self, *wrap_gpu_args_int(a))
 Func.cuda_single_thread = lambda self, *a: _gpu_single_thread0(self, *wrap_gpu_args_int(a))
@@ -306,7 +319,13 @@ class Func(object):
         the resulting buffer. The buffer should probably be instantly
         wrapped in an Image class.
 
-        One can use f.realize(Buffer) to realize into an existing buffer.
+        One can use f.realize(Buffer) to realize into an existing buffer,
+        or f.realize(array) to realize directly into the memory of a numpy
+        array, which is also returned. The array's dimensions are flipped
+        as described in flip_xy.
+
+        The GIL is released while the pipeline runs, so other Python threads
+        can run concurrently (including ones realizing other Funcs).
         """
 
     def compile_to_bitcode(self, filename, list_of_Argument, fn_name=""):
@@ -1005,13 +1024,14 @@ def _image_getattr(self, name):
         else:
             raise ValueError('Unknown type %r'%t)
         shape = tuple([D.extent(i) for i in range(D.dimensions())])
-        strides = tuple([D.stride(i)*(t.bits/8) for i in range(D.dimensions())])
+        strides = tuple([D.stride(i)*(t.bits//8) for i in range(D.dimensions())])
         if _flip_xy and len(strides) >= 2:
             strides = (strides[1], strides[0]) + strides[2:]
             shape = (shape[1], shape[0]) + shape[2:]
 
-        #print("About to call image_to_string on", type(self))
-        data = image_to_string(self)
+        # Point numpy directly at the image's memory. The returned array
+        # holds a reference to the image, which keeps the memory alive.
+        data = (buffer_host_address(to_buffer(self)), False)
         #print(type(data))
         #data = image_to_uint8(self)
         #data_p = get_image_bytes(self)
@@ -1086,16 +1106,41 @@ def _numpy_to_image(a, dtype, C):
     assign_array(ans, a.__array_interface__['data'][0], *strides)
     return ans
 
+_numpy_types = {numpy.dtype('int8'): Int(8),
+                numpy.dtype('int16'): Int(16),
+                numpy.dtype('int32'): Int(32),
+                numpy.dtype('uint8'): UInt(8),
+                numpy.dtype('uint16'): UInt(16),
+                numpy.dtype('uint32'): UInt(32),
+                numpy.dtype('float32'): Float(32),
+                numpy.dtype('float64'): Float(64)}
+
 def _numpy_to_type(a):
-    d = {numpy.dtype('int8'): Int(8),
-         numpy.dtype('int16'): Int(16),
-         numpy.dtype('int32'): Int(32),
-         numpy.dtype('uint8'): UInt(8),
-         numpy.dtype('uint16'): UInt(16),
-         numpy.dtype('uint32'): UInt(32),
-         numpy.dtype('float32'): Float(32),
-         numpy.dtype('float64'): Float(64)}
-    return d[a.dtype]
+    return _numpy_types[a.dtype]
+
+def _numpy_dense_in_x(a):
+    "True if a numpy array has unit stride in the dimension that becomes x."
+    xdim = 1 if (_flip_xy and a.ndim >= 2) else 0
+    return a.strides[xdim] == a.itemsize
+
+def buffer_from_numpy(a, writable=False):
+    """
+    Wrap the memory of a numpy array in a Buffer, without copying. The
+    dimensions are flipped as described in flip_xy. The Buffer object keeps
+    the array alive.
+
+    Halide assumes by default that inputs and outputs are dense in x, so
+    arrays that aren't (e.g. an interleaved [y, x, c] color image) can only
+    be used with pipelines that relax that constraint using set_stride.
+    """
+    if a.dtype not in _numpy_types or not a.dtype.isnative:
+        raise ValueError('Can\'t wrap a numpy array of dtype %s in a Buffer' % a.dtype)
+    # The view holds a reference to the array, and must outlive every
+    # Buffer that points into its memory.
+    view = pybuffer_view(a, writable)
+    b = buffer_from_pybuffer_view(view, _flip_xy)
+    b._pybuffer_view = view
+    return b
 
 class Image(object):
     """
@@ -1116,6 +1161,9 @@ class Image(object):
 
     If not provided (or None) then the typeval is inferred from the input argument.
 
+    A numpy array of the target type that is dense in x is wrapped without
+    copying, so the Image and the array share memory. Other arrays are copied.
+
     For PIL, numpy, and filename constructors, if scale is provided then the input is scaled by the floating point scale factor
     (for example, Image(filename, UInt(16), 1.0/256) reads a UInt(16) image rescaled to have maximum value 255). If omitted,
     scale is set to convert between source and target data type ranges, where int types range from 0 to maxval, and float types
@@ -1182,6 +1230,13 @@ class Image(object):
                     scale = float(out_range)/in_range
             if scale is not None:
                 contents = numpy.asarray(numpy.asarray(contents,'float')*float(scale), target_dtype)
+            if (contents.dtype == numpy.dtype(target_dtype) and contents.dtype.isnative and
+                1 <= contents.ndim <= 4 and _numpy_dense_in_x(contents)):
+                # Share the array's memory instead of copying it.
+                b = buffer_from_numpy(contents)
+                ans = C(b)
+                ans._pybuffer_view = b._pybuffer_view
+                return ans
             return _numpy_to_image(contents, target_dtype, C)
         elif isinstance(contents, ImageTypes+(ImageParamType,BufferType,Realization)):
             return C(contents)
@@ -1370,9 +1425,15 @@ for ParamT in ParamTypes: # + (DynUniform,):
 
 #UniformImage.__setitem__ = lambda x, key, value: assign(call(x, *[wrap(y) for y in key]), wrap(value)) if isinstance(key,tuple) else assign(call(x, key), wrap(value))
 
+def _image_param_set(self, y):
+    if isinstance(y, numpy.ndarray) or hasattr(y, 'putpixel'):
+        y = Image(y)
+    set(self, y)
+    self._bound = y           # Keep any wrapped numpy memory alive while bound
+
 for _ImageT in [ImageParamType]:
     _ImageT.__getitem__ = _generic_getitem_expr
-    _ImageT.set = lambda x, y: set(x, Image(y) if (isinstance(y,numpy.ndarray) or hasattr(y, 'putpixel')) else y)
+    _ImageT.set = _image_param_set
     #_ImageT.save = lambda x, y: save_png(x, y)
 
 # ----------------------------------------------------
@@ -1624,6 +1685,7 @@ class ImageParam(object):
     def set(self, I):
         """
         Bind a Buffer, Image, numpy array, or PIL image. Only relevant for jitting.
+        Numpy arrays are wrapped without copying where possible (see Image).
         """
 
     def get(self):
@@ -1975,6 +2037,43 @@ def test_numpy():
 
     print('halide.test_numpy:                   OK')
 
+def test_numpy_zero_copy():
+    x = Var()
+    y = Var()
+
+    # Images wrap numpy arrays without copying.
+    a = numpy.arange(48, dtype='int32').reshape(6, 8)
+    b = Image(a)
+    a[2, 3] = 1000
+    assert numpy.asarray(b)[2, 3] == 1000
+
+    # Inputs bound to ImageParams and outputs realized into numpy arrays.
+    ip = ImageParam(Int(32), 2)
+    ip.set(a)
+    f = Func()
+    f[x, y] = ip[x, y] * 2
+    out = numpy.zeros_like(a)
+    assert f.realize(out) is out
+    assert (out == a * 2).all()
+
+    # Pipelines realized from several threads at once.
+    import threading
+    outs = [numpy.zeros((64, 64), 'int32') for i in range(4)]
+    funcs = []
+    for i in range(4):
+        g = Func()
+        g[x, y] = x + y * 64 + i
+        funcs.append(g)
+    threads = [threading.Thread(target=funcs[i].realize, args=(outs[i],)) for i in range(4)]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    for i in range(4):
+        assert (outs[i] == numpy.arange(64 * 64).reshape(64, 64) + i).all()
+
+    print('halide.test_numpy_zero_copy:         OK')
+
 def test_minimal():
     f1 = Func()
     f2 = Func()
@@ -2075,6 +2174,7 @@ def test():
     test_blur()
     test_core()
     test_numpy()
+    test_numpy_zero_copy()
     test_image_constructors()
 
 
@@ -103,6 +103,17 @@ namespace Halide {
 %naturalvar VarOrRVar;
 %naturalvar Argument;
 
+// pybuffer_view and buffer_from_pybuffer_view report failure by
+// setting a Python exception.
+%exception pybuffer_view {
+    $action
+    if (PyErr_Occurred()) SWIG_fail;
+}
+%exception buffer_from_pybuffer_view {
+    $action
+    if (PyErr_Occurred()) SWIG_fail;
+}
+
 %include "Halide.h"
 %include "py_util.h"
 
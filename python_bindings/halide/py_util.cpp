@@ -4,7 +4,9 @@
 
 #include "py_util.h"
 #include "../../apps/support/image_io.h"
+#include <algorithm>
 #include <signal.h>
+#include <string.h>
 #include <string>
 #include "Python.h"
 #include "frameobject.h"
@@ -177,6 +179,145 @@ DEFINE_TYPE(float)
 DEFINE_TYPE(double)
 #undef DEFINE_TYPE
 
+namespace {
+
+// Map a struct-module format string, as used by the buffer protocol,
+// to a Halide type.
+bool type_from_format(const char *format, int itemsize, Type *t) {
+    if (!format) {
+        // No format means unsigned bytes.
+        *t = UInt(8);
+        return itemsize == 1;
+    }
+    // Only native byte order is supported.
+    if (*format == '@' || *format == '=' || *format == '<') {
+        format++;
+    }
+    if (format[0] == 0 || format[1] != 0) {
+        return false;
+    }
+    switch (*format) {
+    case 'b': case 'h': case 'i': case 'l': case 'q':
+        *t = Int(itemsize * 8);
+        break;
+    case 'B': case 'H': case 'I': case 'L': case 'Q':
+        *t = UInt(itemsize * 8);
+        break;
+    case 'f': case 'd':
+        *t = Float(itemsize * 8);
+        break;
+    case '?':
+        *t = UInt(8);
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+// Release the GIL only while the compiled code of a Func runs, and
+// clear the hooks again when the object goes out of scope.
+void *save_thread() {
+    return PyEval_SaveThread();
+}
+
+void restore_thread(void *state) {
+    PyEval_RestoreThread((PyThreadState *)state);
+}
+
+class ScopedNoGILCall {
+    Func &f;
+public:
+    ScopedNoGILCall(Func &f) : f(f) { f.set_jit_call_wrapper(save_thread, restore_thread); }
+    ~ScopedNoGILCall() { f.set_jit_call_wrapper(NULL, NULL); }
+};
+
+const char *pybuffer_view_name = "halide.pybuffer_view";
+
+void release_pybuffer_view(PyObject *capsule) {
+    Py_buffer *view = (Py_buffer *)PyCapsule_GetPointer(capsule, pybuffer_view_name);
+    if (view) {
+        PyBuffer_Release(view);
+        delete view;
+    }
+}
+
+}
+
+PyObject *pybuffer_view(PyObject *obj, bool writable) {
+    Py_buffer *view = new Py_buffer;
+    int flags = PyBUF_STRIDES | PyBUF_FORMAT;
+    if (writable) {
+        flags |= PyBUF_WRITABLE;
+    }
+    if (PyObject_GetBuffer(obj, view, flags) != 0) {
+        delete view;
+        return NULL;
+    }
+    PyObject *capsule = PyCapsule_New(view, pybuffer_view_name, release_pybuffer_view);
+    if (!capsule) {
+        PyBuffer_Release(view);
+        delete view;
+    }
+    return capsule;
+}
+
+Buffer buffer_from_pybuffer_view(PyObject *capsule, bool flip_xy) {
+    Py_buffer *view = (Py_buffer *)PyCapsule_GetPointer(capsule, pybuffer_view_name);
+    if (!view) {
+        return Buffer();
+    }
+
+    Type t;
+    if (!type_from_format(view->format, (int)view->itemsize, &t)) {
+        PyErr_Format(PyExc_ValueError, "Can't wrap a buffer with format '%s' in a halide Buffer",
+                     view->format ? view->format : "B");
+        return Buffer();
+    }
+
+    if (view->ndim < 1 || view->ndim > 4) {
+        PyErr_Format(PyExc_ValueError, "Can't wrap a %d-dimensional buffer in a halide Buffer",
+                     view->ndim);
+        return Buffer();
+    }
+
+    buffer_t buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.host = (uint8_t *)view->buf;
+    buf.elem_size = (int32_t)view->itemsize;
+    for (int i = 0; i < view->ndim; i++) {
+        if (view->strides[i] % view->itemsize != 0) {
+            PyErr_SetString(PyExc_ValueError,
+                            "Can't wrap a buffer with strides that aren't a multiple "
+                            "of the element size in a halide Buffer");
+            return Buffer();
+        }
+        buf.extent[i] = (int32_t)view->shape[i];
+        buf.stride[i] = (int32_t)(view->strides[i] / view->itemsize);
+    }
+    if (flip_xy && view->ndim >= 2) {
+        std::swap(buf.extent[0], buf.extent[1]);
+        std::swap(buf.stride[0], buf.stride[1]);
+    }
+
+    return Buffer(t, &buf);
+}
+
+size_t buffer_host_address(Buffer b) {
+    b.copy_to_host();
+    return (size_t)b.host_ptr();
+}
+
+Realization realize_nogil(Func &f, const std::vector<int32_t> &sizes, const Target &t) {
+    ScopedNoGILCall nogil(f);
+    return f.realize(sizes, t);
+}
+
+void realize_nogil(Func &f, Buffer dst, const Target &t) {
+    ScopedNoGILCall nogil(f);
+    f.realize(dst, t);
+}
+
 #define DEFINE_TYPE(T) \
 Expr call(Image<T> &a, Expr b) { return a(b); } \
 Expr call(Image<T> &a, Expr b, Expr c) { return a(b,c); } \
@@ -5,6 +5,7 @@
 #ifndef _py_util_h
 #define _py_util_h
 
+#include "Python.h"
 #include "Halide.h"
 #include <vector>
 
@@ -185,6 +186,30 @@ DEFINE_TYPE(float)
 DEFINE_TYPE(double)
 #undef DEFINE_TYPE
 
+/* Acquire a view of the memory of an object exposing the buffer
+   protocol (e.g. a numpy array), wrapped in a capsule that releases
+   the view when it is destroyed. On failure a Python exception is set
+   and NULL is returned. */
+PyObject *pybuffer_view(PyObject *obj, bool writable);
+
+/* Wrap the memory of a view returned by pybuffer_view in a Buffer,
+   without copying. If flip_xy is true the first two dimensions are
+   swapped, so that an array indexed as [y, x, ...] becomes a Buffer
+   indexed as (x, y, ...). The caller must keep the view alive for as
+   long as the Buffer is in use. On failure a Python exception is set
+   and an undefined Buffer is returned. */
+Buffer buffer_from_pybuffer_view(PyObject *view, bool flip_xy);
+
+/* The address of the element at the min coordinate of a Buffer, after
+   copying it back from the device if necessary. */
+size_t buffer_host_address(Buffer b);
+
+/* Realize a Func with the GIL released around the compiled code only,
+   so that other Python threads can run while the pipeline does.
+   Compilation and argument marshalling happen with the GIL held. */
+Realization realize_nogil(Func &f, const std::vector<int32_t> &sizes, const Target &t);
+void realize_nogil(Func &f, Buffer dst, const Target &t);
+
 #define DEFINE_TYPE(T) \
 void assign_array(Image<T> &a, size_t base, size_t xstride); \
 void assign_array(Image<T> &a, size_t base, size_t xstride, size_t ystride); \
@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <map>
+#include <set>
+#include <stdlib.h>
+
+#include "AutoSpecialize.h"
+#include "Debug.h"
+#include "IRVisitor.h"
+#include "IROperator.h"
+#include "IREquality.h"
+#include "Substitute.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Find the buffers referenced by a pipeline that are defined outside
+// of it (the inputs and outputs), and how many dimensions of each are
+// used. These are the buffers whose strides and extents are only known
+// at runtime.
+class FindExternalBuffers : public IRGraphVisitor {
+public:
+    map<string, int> dimensions;
+    set<string> defined;
+    // The constrained values of buffer fields, by the name of the field.
+    map<string, Expr> constraints;
+
+    using IRGraphVisitor::visit;
+
+    void visit(const Variable *op) {
+        size_t pos = op->name.rfind(".stride.");
+        if (pos == string::npos) return;
+        string dim = op->name.substr(pos + 8);
+        if (dim.empty() ||
+            dim.find_first_not_of("0123456789") != string::npos) {
+            return;
+        }
+        int d = atoi(dim.c_str());
+        string buf = op->name.substr(0, pos);
+        dimensions[buf] = std::max(dimensions[buf], d + 1);
+    }
+
+    void visit(const LetStmt *op) {
+        defined.insert(op->name);
+        if (ends_with(op->name, ".constrained")) {
+            constraints[op->name.substr(0, op->name.size() - 12)] = op->value;
+        }
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const Let *op) {
+        defined.insert(op->name);
+        IRGraphVisitor::visit(op);
+    }
+};
+
+// A single specialized copy of the pipeline. The condition is checked
+// at pipeline entry, and the replacements are substituted into the
+// body of the copy.
+struct Version {
+    string name;
+    Expr condition;
+    map<string, Expr> replacements;
+    // False if the condition contradicts a constraint.
+    bool possible;
+
+    Version() : possible(true) {}
+
+    void add_condition(Expr c) {
+        condition = condition.defined() ? (condition && c) : c;
+    }
+
+    // Replace a buffer field with a value known to be equal to it.
+    // If the field is constrained, the pipeline body uses the
+    // constrained version of it instead.
+    void add_replacement(const string &var, Expr value, const map<string, Expr> &constraints) {
+        replacements[var] = value;
+        if (constraints.count(var)) {
+            replacements[var + ".constrained"] = value;
+        }
+    }
+
+    // Specialize on a buffer field being equal to a constant. A field
+    // constrained to a constant already is known to the body, so
+    // there's nothing to add, unless the constants differ.
+    void add_fact(const string &var, int value, const map<string, Expr> &constraints) {
+        map<string, Expr>::const_iterator c = constraints.find(var);
+        if (c != constraints.end() && is_const(c->second)) {
+            possible = possible && equal(c->second, Expr(value));
+            return;
+        }
+        add_condition(Variable::make(Int(32), var) == value);
+        add_replacement(var, value, constraints);
+    }
+
+    // Whether this version can be taken, and differs from the generic
+    // one.
+    bool useful() const {
+        return possible && condition.defined();
+    }
+};
+
+// Cap the number of copies of the pipeline we emit. The generic
+// version is always emitted in addition to these.
+const size_t max_specialized_versions = 4;
+
+}
+
+Stmt auto_specialize(Stmt s, const vector<Function> &outputs,
+                     const string &pipeline_name, const Target &t) {
+
+    if (!t.has_feature(Target::AutoSpecialize)) {
+        return s;
+    }
+
+    if (t.has_gpu_feature() ||
+        t.has_feature(Target::OpenGLCompute) ||
+        t.has_feature(Target::OpenGL) ||
+        t.has_feature(Target::Renderscript)) {
+        // Device kernels are named after the loops that contain them,
+        // so they can't be duplicated across versions.
+        debug(1) << "Not auto-specializing " << pipeline_name << " for a GPU target\n";
+        return s;
+    }
+
+    FindExternalBuffers finder;
+    s.accept(&finder);
+
+    // Only consider buffers whose strides are free variables of the
+    // pipeline, and not those allocated inside it. Constrained fields
+    // (ImageParams and outputs have stride.0 constrained to 1 by
+    // default) are handled by Version::add_fact.
+    const map<string, Expr> &constraints = finder.constraints;
+    map<string, int> buffers;
+    for (std::pair<string, int> b : finder.dimensions) {
+        if (!finder.defined.count(b.first + ".stride.0")) {
+            buffers.insert(b);
+        }
+    }
+
+    if (buffers.empty()) {
+        debug(1) << "No external buffers to auto-specialize " << pipeline_name << " on\n";
+        return s;
+    }
+
+    // The output buffers, and the natural vector width for each.
+    map<string, int> output_vector_widths;
+    for (Function f : outputs) {
+        for (size_t i = 0; i < f.output_buffers().size(); i++) {
+            string name = f.output_buffers()[i].name();
+            if (buffers.count(name)) {
+                int lanes = t.natural_vector_size(f.output_types()[i]);
+                if (lanes > 1) {
+                    output_vector_widths[name] = lanes;
+                }
+            }
+        }
+    }
+
+    vector<Version> versions;
+
+    // Every buffer is dense in its innermost dimension, and the
+    // outputs have an extent that is a multiple of the vector width.
+    Version dense;
+    dense.name = "dense";
+    for (std::pair<string, int> b : buffers) {
+        dense.add_fact(b.first + ".stride.0", 1, constraints);
+    }
+
+    if (!output_vector_widths.empty()) {
+        Version dense_vec = dense;
+        dense_vec.name = "dense_vector_multiple";
+        for (std::pair<string, int> o : output_vector_widths) {
+            string extent_name = o.first + ".extent.0";
+            map<string, Expr>::const_iterator c = constraints.find(extent_name);
+            if (c != constraints.end() && is_const(c->second)) {
+                // The simplifier can already see whether it's a multiple.
+                continue;
+            }
+            Expr extent = Variable::make(Int(32), extent_name);
+            dense_vec.add_condition(extent % o.second == 0);
+            // Writing the extent as a multiple of the vector width
+            // lets the simplifier and modulus remainder analysis
+            // prove the vectorized loops have no tails.
+            dense_vec.add_replacement(extent_name, (extent / o.second) * o.second, constraints);
+        }
+        versions.push_back(dense_vec);
+    }
+
+    versions.push_back(dense);
+
+    // Buffers with at least three dimensions are interleaved with a
+    // small constant number of channels. The remaining buffers are
+    // dense.
+    bool any_multichannel = false;
+    for (std::pair<string, int> b : buffers) {
+        any_multichannel |= (b.second >= 3);
+    }
+
+    if (any_multichannel) {
+        for (int channels = 3; channels <= 4; channels++) {
+            Version interleaved;
+            interleaved.name = "interleaved_" + std::to_string(channels);
+            for (std::pair<string, int> b : buffers) {
+                if (b.second >= 3) {
+                    interleaved.add_fact(b.first + ".stride.0", channels, constraints);
+                    interleaved.add_fact(b.first + ".stride.2", 1, constraints);
+                    interleaved.add_fact(b.first + ".extent.2", channels, constraints);
+                } else {
+                    interleaved.add_fact(b.first + ".stride.0", 1, constraints);
+                }
+            }
+            versions.push_back(interleaved);
+        }
+
+        // The same number of channels, stored planar. This is the
+        // only multichannel layout buffers with the default stride
+        // constraint can have.
+        for (int channels = 3; channels <= 4; channels++) {
+            Version planar;
+            planar.name = "planar_" + std::to_string(channels);
+            for (std::pair<string, int> b : buffers) {
+                planar.add_fact(b.first + ".stride.0", 1, constraints);
+                if (b.second >= 3) {
+                    planar.add_fact(b.first + ".extent.2", channels, constraints);
+                }
+            }
+            versions.push_back(planar);
+        }
+    }
+
+    // Drop the versions that can't be taken, or that wouldn't know
+    // anything the generic version doesn't.
+    vector<Version> useful_versions;
+    for (const Version &v : versions) {
+        if (v.useful()) {
+            useful_versions.push_back(v);
+        }
+    }
+    versions.swap(useful_versions);
+
+    if (versions.empty()) {
+        debug(1) << "Nothing to auto-specialize " << pipeline_name << " on\n";
+        return s;
+    }
+
+    if (versions.size() > max_specialized_versions) {
+        versions.resize(max_specialized_versions);
+    }
+
+    // Each version reports itself at runtime before doing any work.
+    Stmt generic = Block::make(Evaluate::make(Call::make(Int(32), "halide_auto_specialization_hit",
+                                                         {pipeline_name, string("generic")},
+                                                         Call::Extern)), s);
+    Stmt result = generic;
+    for (size_t i = versions.size(); i > 0; i--) {
+        const Version &v = versions[i-1];
+        Expr hit = Call::make(Int(32), "halide_auto_specialization_hit",
+                              {pipeline_name, v.name}, Call::Extern);
+        Stmt then_case = Block::make(Evaluate::make(hit), substitute(v.replacements, s));
+        result = IfThenElse::make(v.condition, then_case, result);
+    }
+
+    debug(1) << "Auto-specialized " << pipeline_name << " into "
+             << versions.size() + 1 << " versions:\n";
+    for (const Version &v : versions) {
+        debug(1) << "  " << v.name << ": " << v.condition << "\n";
+    }
+    debug(1) << "  generic\n";
+
+    return result;
+}
+
+}
+}
@@ -0,0 +1,36 @@
+#ifndef HALIDE_AUTO_SPECIALIZE_H
+#define HALIDE_AUTO_SPECIALIZE_H
+
+/** \file
+ * Defines the lowering pass that automatically multiversions a
+ * pipeline on common runtime buffer shapes.
+ */
+
+#include "IR.h"
+#include "Function.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Wrap the pipeline in an if-then-else chain that dispatches at
+ * pipeline entry to copies of the body specialized for common
+ * runtime facts about the external buffers: a dense innermost
+ * stride, output extents that are a multiple of the natural vector
+ * width, and interleaved or planar layouts with a small constant
+ * number of channels. Facts already implied by the constraints on a
+ * buffer are left out, and versions that contradict them are not
+ * generated. Inside each specialized copy the facts are substituted
+ * into the body, so later simplification, vectorization, and loop
+ * partitioning can exploit them. The final else case is the
+ * unspecialized pipeline. Each version reports that it was taken
+ * via halide_auto_specialization_hit. Should be done after storage
+ * flattening, but before vectorization. Does nothing unless the
+ * target has Target::AutoSpecialize set. */
+Stmt auto_specialize(Stmt s, const std::vector<Function> &outputs,
+                     const std::string &pipeline_name, const Target &t);
+
+}
+}
+
+#endif
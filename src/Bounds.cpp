@@ -39,17 +39,79 @@ int static_sign(Expr x) {
 }
 }
 
+/** A memo table of the intervals computed for expressions, shared by
+ * the bounds queries made while walking a statement. Each state of
+ * the scope the queries are made in gets a version number, so an
+ * interval is only reused for the same node in the same scope. */
+class IntervalCache {
+    struct Entry {
+        // Holds a reference so that the node's address can't be reused.
+        Expr expr;
+        Interval interval;
+    };
+    map<pair<const IRNode *, int>, Entry> entries;
+    int next_version;
+
+public:
+    IntervalCache() : next_version(0) {}
+
+    /** Get a version number for a new state of the scope. Version
+     * zero is the scope the queries started in. */
+    int new_version() {
+        return ++next_version;
+    }
+
+    bool find(const Expr &e, int version, Interval &result) const {
+        auto iter = entries.find(make_pair(e.ptr, version));
+        if (iter == entries.end()) return false;
+        result = iter->second.interval;
+        return true;
+    }
+
+    void insert(const Expr &e, int version, const Interval &i) {
+        Entry &entry = entries[make_pair(e.ptr, version)];
+        entry.expr = e;
+        entry.interval = i;
+    }
+};
+
 class Bounds : public IRVisitor {
 public:
     Expr min, max;
     Scope<Interval> scope;
     const FuncValueBounds &func_bounds;
 
-    Bounds(const Scope<Interval> *s, const FuncValueBounds &fb) :
-        func_bounds(fb) {
+    Bounds(const Scope<Interval> *s, const FuncValueBounds &fb,
+           IntervalCache *c = NULL, int v = 0) :
+        func_bounds(fb), cache(c), version(v) {
         scope.set_containing_scope(s);
     }
+
+    // Compute the bounds of an expression into min and max, reusing
+    // the result of an earlier query if there is a cache.
+    void bounds_of(const Expr &e) {
+        if (!cache ||
+            e.as<Variable>() ||
+            e.as<IntImm>() ||
+            e.as<FloatImm>() ||
+            e.as<StringImm>()) {
+            e.accept(this);
+            return;
+        }
+
+        Interval result;
+        if (cache->find(e, version, result)) {
+            min = result.min;
+            max = result.max;
+        } else {
+            e.accept(this);
+            cache->insert(e, version, Interval(min, max));
+        }
+    }
+
 private:
+    IntervalCache *cache;
+    int version;
 
     // Compute the intrinsic bounds of a function.
     void bounds_of_func(Function f, int value_index) {
@@ -97,7 +159,7 @@ private:
 
     void visit(const Cast *op) {
 
-        op->value.accept(this);
+        bounds_of(op->value);
         Expr min_a = min, max_a = max;
 
         if (min_a.same_as(op->value) && max_a.same_as(op->value)) {
@@ -196,9 +258,9 @@ private:
     }
 
     void visit(const Add *op) {
-        op->a.accept(this);
+        bounds_of(op->a);
         Expr min_a = min, max_a = max;
-        op->b.accept(this);
+        bounds_of(op->b);
         Expr min_b = min, max_b = max;
 
         if (min_a.same_as(op->a) && max_a.same_as(op->a) &&
@@ -238,9 +300,9 @@ private:
     }
 
     void visit(const Sub *op) {
-        op->a.accept(this);
+        bounds_of(op->a);
         Expr min_a = min, max_a = max;
-        op->b.accept(this);
+        bounds_of(op->b);
         Expr min_b = min, max_b = max;
 
         if (min_a.same_as(op->a) && max_a.same_as(op->a) &&
@@ -289,13 +351,13 @@ private:
     }
 
     void visit(const Mul *op) {
-        op->a.accept(this);
+        bounds_of(op->a);
         Expr min_a = min, max_a = max;
         if (!min_a.defined() || !max_a.defined()) {
             min = Expr(); max = Expr(); return;
         }
 
-        op->b.accept(this);
+        bounds_of(op->b);
         Expr min_b = min, max_b = max;
         if (!min_b.defined() || !max_b.defined()) {
             min = Expr(); max = Expr(); return;
@@ -376,9 +438,9 @@ private:
     }
 
     void visit(const Div *op) {
-        op->a.accept(this);
+        bounds_of(op->a);
         Expr min_a = min, max_a = max;
-        op->b.accept(this);
+        bounds_of(op->b);
         Expr min_b = min, max_b = max;
         if (!min_b.defined() || !max_b.defined()) {
             min = Expr(); max = Expr(); return;
@@ -440,10 +502,10 @@ private:
     }
 
     void visit(const Mod *op) {
-        op->a.accept(this);
+        bounds_of(op->a);
         Expr min_a = min, max_a = max;
 
-        op->b.accept(this);
+        bounds_of(op->b);
         Expr min_b = min, max_b = max;
         if (!min_b.defined() || !max_b.defined()) {
             min = Expr(); max = Expr(); return;
@@ -481,9 +543,9 @@ private:
     }
 
     void visit(const Min *op) {
-        op->a.accept(this);
+        bounds_of(op->a);
         Expr min_a = min, max_a = max;
-        op->b.accept(this);
+        bounds_of(op->b);
         Expr min_b = min, max_b = max;
 
         debug(3) << "Bounds of " << Expr(op) << "\n";
@@ -518,9 +580,9 @@ private:
 
 
     void visit(const Max *op) {
-        op->a.accept(this);
+        bounds_of(op->a);
         Expr min_a = min, max_a = max;
-        op->b.accept(this);
+        bounds_of(op->b);
         Expr min_b = min, max_b = max;
 
         debug(3) << "Bounds of " << Expr(op) << "\n";
@@ -599,13 +661,13 @@ private:
     }
 
     void visit(const Select *op) {
-        op->true_value.accept(this);
+        bounds_of(op->true_value);
         Expr min_a = min, max_a = max;
         if (!min_a.defined() || !max_a.defined()) {
             min = Expr(); max = Expr(); return;
         }
 
-        op->false_value.accept(this);
+        bounds_of(op->false_value);
         Expr min_b = min, max_b = max;
         if (!min_b.defined() || !max_b.defined()) {
             min = Expr(); max = Expr(); return;
@@ -625,7 +687,7 @@ private:
     }
 
     void visit(const Load *op) {
-        op->index.accept(this);
+        bounds_of(op->index);
         if (min.defined() && min.same_as(max)) {
             // If the index is const we can return the load of that index
             min = max = Load::make(op->type, op->name, min, op->image, op->param);
@@ -643,6 +705,11 @@ private:
         internal_error << "Bounds of vector";
     }
 
+    void visit(const VectorReduce *op) {
+        // The value being reduced is a vector, which we can't bound.
+        bounds_of_type(op->type);
+    }
+
     void visit(const Call *op) {
         // If the args are const we can return the call of those args
         // for pure functions (extern and image). For other types of
@@ -652,7 +719,7 @@ private:
         std::vector<Expr> new_args(op->args.size());
         bool const_args = true;
         for (size_t i = 0; i < op->args.size() && const_args; i++) {
-            op->args[i].accept(this);
+            bounds_of(op->args[i]);
             if (min.defined() && min.same_as(max)) {
                 new_args[i] = min;
             } else {
@@ -690,10 +757,10 @@ private:
             }
         } else if (op->call_type == Call::Intrinsic && op->name == Call::likely) {
             assert(op->args.size() == 1);
-            op->args[0].accept(this);
+            bounds_of(op->args[0]);
         } else if (op->call_type == Call::Intrinsic && op->name == Call::return_second) {
             assert(op->args.size() == 2);
-            op->args[1].accept(this);
+            bounds_of(op->args[1]);
         } else if (op->call_type == Call::Intrinsic && op->name == Call::if_then_else) {
             assert(op->args.size() == 3);
             // Probably more conservative than necessary
@@ -739,11 +806,11 @@ private:
             max = Call::make(Int(32), Call::extract_buffer_max, op->args, Call::Intrinsic);
         } else if (op->call_type == Call::Intrinsic && op->name == Call::memoize_expr) {
             internal_assert(op->args.size() >= 1);
-            op->args[0].accept(this);
+            bounds_of(op->args[0]);
         } else if (op->call_type == Call::Intrinsic && op->name == Call::trace_expr) {
             // trace_expr returns argument 4
             internal_assert(op->args.size() >= 5);
-            op->args[4].accept(this);
+            bounds_of(op->args[4]);
         } else if (op->func.has_pure_definition()) {
             bounds_of_func(op->func, op->value_index);
         } else {
@@ -753,9 +820,14 @@ private:
     }
 
     void visit(const Let *op) {
-        op->value.accept(this);
+        bounds_of(op->value);
         scope.push(op->name, Interval(min, max));
-        op->body.accept(this);
+        int old_version = version;
+        if (cache) {
+            version = cache->new_version();
+        }
+        bounds_of(op->body);
+        version = old_version;
         scope.pop(op->name);
     }
 
@@ -1003,7 +1075,7 @@ class BoxesTouched : public IRGraphVisitor {
 
 public:
     BoxesTouched(bool calls, bool provides, string fn, const Scope<Interval> *s, const FuncValueBounds &fb) :
-        func(fn), consider_calls(calls), consider_provides(provides), func_bounds(fb) {
+        func(fn), consider_calls(calls), consider_provides(provides), func_bounds(fb), version(0) {
         scope.set_containing_scope(s);
     }
 
@@ -1016,16 +1088,43 @@ private:
     Scope<Interval> scope;
     const FuncValueBounds &func_bounds;
 
+    // The same subexpressions and let values turn up in many of the
+    // bounds queries made while walking a statement, so share the
+    // intervals computed between them. The version identifies the
+    // current state of the scope, and the stack holds the versions
+    // to restore as things are popped off it.
+    IntervalCache cache;
+    int version;
+    vector<int> old_versions;
+
+    Interval bounds_of_expr(Expr e) {
+        Bounds b(&scope, func_bounds, &cache, version);
+        b.bounds_of(e);
+        return Interval(b.min, b.max);
+    }
+
+    void push_scope(const string &name, const Interval &i) {
+        scope.push(name, i);
+        old_versions.push_back(version);
+        version = cache.new_version();
+    }
+
+    void pop_scope(const string &name) {
+        scope.pop(name);
+        version = old_versions.back();
+        old_versions.pop_back();
+    }
+
     using IRGraphVisitor::visit;
 
     void visit(const Let *op) {
         if (!consider_calls) return;
 
         op->value.accept(this);
-        Interval value_bounds = bounds_of_expr_in_scope(op->value, scope, func_bounds);
-        scope.push(op->name, value_bounds);
+        Interval value_bounds = bounds_of_expr(op->value);
+        push_scope(op->name, value_bounds);
         op->body.accept(this);
-        scope.pop(op->name);
+        pop_scope(op->name);
     }
 
     void visit(const Call *op) {
@@ -1062,8 +1161,7 @@ private:
         Box b(op->args.size());
         b.used = const_true();
         for (size_t i = 0; i < op->args.size(); i++) {
-            op->args[i].accept(this);
-            b[i] = bounds_of_expr_in_scope(op->args[i], scope, func_bounds);
+            b[i] = bounds_of_expr(op->args[i]);
         }
         merge_boxes(boxes[op->name], b);
     }
@@ -1097,23 +1195,23 @@ private:
         if (consider_calls) {
             op->value.accept(this);
         }
-        Interval value_bounds = bounds_of_expr_in_scope(op->value, scope, func_bounds);
+        Interval value_bounds = bounds_of_expr(op->value);
         value_bounds.min = simplify(value_bounds.min);
         value_bounds.max = simplify(value_bounds.max);
 
         if (is_small_enough_to_substitute(value_bounds.min) &&
             is_small_enough_to_substitute(value_bounds.max)) {
-            scope.push(op->name, value_bounds);
+            push_scope(op->name, value_bounds);
             op->body.accept(this);
-            scope.pop(op->name);
+            pop_scope(op->name);
         } else {
             string max_name = unique_name('t');
             string min_name = unique_name('t');
 
-            scope.push(op->name, Interval(Variable::make(op->value.type(), min_name),
-                                          Variable::make(op->value.type(), max_name)));
+            push_scope(op->name, Interval(Variable::make(op->value.type(), min_name),
+                                         Variable::make(op->value.type(), max_name)));
             op->body.accept(this);
-            scope.pop(op->name);
+            pop_scope(op->name);
 
             for (pair<const string, Box> &i : boxes) {
                 Box &box = i.second;
@@ -1201,20 +1299,20 @@ private:
         if (scope.contains(op->name + ".loop_min")) {
             min_val = scope.get(op->name + ".loop_min").min;
         } else {
-            min_val = bounds_of_expr_in_scope(op->min, scope, func_bounds).min;
+            min_val = bounds_of_expr(op->min).min;
         }
 
         if (scope.contains(op->name + ".loop_max")) {
             max_val = scope.get(op->name + ".loop_max").max;
         } else {
-            max_val = bounds_of_expr_in_scope(op->extent, scope, func_bounds).max;
-            max_val += bounds_of_expr_in_scope(op->min, scope, func_bounds).max;
+            max_val = bounds_of_expr(op->extent).max;
+            max_val += bounds_of_expr(op->min).max;
             max_val -= 1;
         }
 
-        scope.push(op->name, Interval(min_val, max_val));
+        push_scope(op->name, Interval(min_val, max_val));
         op->body.accept(this);
-        scope.pop(op->name);
+        pop_scope(op->name);
     }
 
     void visit(const Provide *op) {
@@ -1222,7 +1320,7 @@ private:
             if (op->name == func || func.empty()) {
                 Box b(op->args.size());
                 for (size_t i = 0; i < op->args.size(); i++) {
-                    b[i] = bounds_of_expr_in_scope(op->args[i], scope, func_bounds);
+                    b[i] = bounds_of_expr(op->args[i]);
                 }
                 merge_boxes(boxes[op->name], b);
             }
@@ -1457,6 +1555,17 @@ void bounds_test() {
     internal_assert(equal(simplify(r2[0].min), 4));
     internal_assert(equal(simplify(r2[0].max), 19));
 
+    // The same expression used in two loops over different ranges
+    // must get different bounds in each.
+    Expr site = 2*x;
+    Stmt loops = Block::make(For::make("x", 0, 10, ForType::Serial, DeviceAPI::Host,
+                                       Provide::make("output", {Call::make(in, {site})}, {x})),
+                             For::make("x", 20, 10, ForType::Serial, DeviceAPI::Host,
+                                       Provide::make("output", {Call::make(in, {site})}, {x})));
+    r = boxes_required(loops);
+    internal_assert(equal(simplify(r["input"][0].min), 0));
+    internal_assert(equal(simplify(r["input"][0].max), 58));
+
     std::cout << "Bounds test passed" << std::endl;
 }
 
@@ -1,4 +1,5 @@
 #include <map>
+#include <unordered_map>
 
 #include "CSE.h"
 #include "IRMutator.h"
@@ -72,7 +73,11 @@ public:
     };
     vector<Entry> entries;
 
-    typedef map<ExprWithCompareCache, int> CacheType;
+    // The entries, bucketed by structural hash. Each bucket almost
+    // always has a single entry, so finding an Expr takes one call
+    // to equal, instead of the log(n) deep comparisons a map of
+    // Exprs ordered by IRDeepCompare needs.
+    typedef std::unordered_map<uint64_t, vector<int>> CacheType;
     CacheType numbering;
 
     map<Expr, int, ExprCompare> shallow_numbering;
@@ -81,6 +86,7 @@ public:
     int number;
 
     IRCompareCache cache;
+    IRHasher hasher;
 
     GVN() : number(0), cache(8) {}
 
@@ -89,8 +95,17 @@ public:
         return Stmt();
     }
 
-    ExprWithCompareCache with_cache(Expr e) {
-        return ExprWithCompareCache(e, &cache);
+    // Find the number of an Expr equal to e by value, or return -1.
+    int find(const Expr &e, uint64_t h) {
+        CacheType::iterator iter = numbering.find(h);
+        if (iter != numbering.end()) {
+            for (int n : iter->second) {
+                if (equal(entries[n].expr, e, &cache)) {
+                    return n;
+                }
+            }
+        }
+        return -1;
     }
 
     Expr mutate(Expr e) {
@@ -114,9 +129,9 @@ public:
         }
 
         // If e already has an entry, return that.
-        CacheType::iterator iter = numbering.find(with_cache(e));
-        if (iter != numbering.end()) {
-            number = iter->second;
+        int n = find(e, hasher.hash(e));
+        if (n >= 0) {
+            number = n;
             shallow_numbering[e] = number;
             internal_assert(entries[number].expr.type() == e.type());
             return entries[number].expr;
@@ -128,9 +143,10 @@ public:
 
         // See if it's there in another form after being rebuilt
         // (e.g. because it was a let variable).
-        iter = numbering.find(with_cache(e));
-        if (iter != numbering.end()) {
-            number = iter->second;
+        uint64_t h = hasher.hash(e);
+        n = find(e, h);
+        if (n >= 0) {
+            number = n;
             shallow_numbering[old_e] = number;
             internal_assert(entries[number].expr.type() == old_e.type());
             return entries[number].expr;
@@ -139,7 +155,7 @@ public:
         // Add it to the numbering.
         Entry entry = {e, 0};
         number = (int)entries.size();
-        numbering[with_cache(e)] = number;
+        numbering[h].push_back(number);
         shallow_numbering[e] = number;
         entries.push_back(entry);
         internal_assert(e.type() == old_e.type());
@@ -679,6 +679,19 @@ void CodeGen_ARM::visit(const Div *op) {
 }
 
 void CodeGen_ARM::visit(const Add *op) {
+    // Adding a horizontal add to something can use vpadal, which
+    // accumulates the pairwise sums.
+    if (!neon_intrinsics_disabled() && op->type.is_vector()) {
+        const VectorReduce *ra = op->a.as<VectorReduce>();
+        const VectorReduce *rb = op->b.as<VectorReduce>();
+        if (rb && rb->op == VectorReduce::Add) {
+            codegen_vector_reduce(rb, op->a);
+            return;
+        } else if (ra && ra->op == VectorReduce::Add) {
+            codegen_vector_reduce(ra, op->b);
+            return;
+        }
+    }
     CodeGen_Posix::visit(op);
 }
 
@@ -1209,12 +1222,131 @@ void CodeGen_ARM::visit(const Call *op) {
                     return;
                 }
             }
+        } else if (op->name == Call::dynamic_shuffle && op->type.is_vector() &&
+                   !neon_intrinsics_disabled()) {
+            // vtbl on 32-bit ARM looks up bytes in a table of up to
+            // four 8-byte registers, and tbl on aarch64 in up to four
+            // 16-byte registers.
+            internal_assert(op->args.size() == 2);
+            Type table_type = op->args[0].type();
+            int reg_bytes = target.bits == 64 ? 16 : 8;
+            if (table_type.bytes() * table_type.width <= 4 * reg_bytes) {
+                vector<Value *> regs = split_table_bytes(codegen(op->args[0]), reg_bytes);
+                Value *byte_index = table_byte_indices(codegen(op->args[1]), op->type.bytes());
+                int byte_lanes = op->type.width * op->type.bytes();
+
+                ostringstream intrin;
+                if (target.bits == 64) {
+                    intrin << "llvm.aarch64.neon.tbl" << regs.size() << ".v16i8";
+                } else {
+                    intrin << "llvm.arm.neon.vtbl" << regs.size();
+                }
+
+                vector<Value *> results;
+                for (int i = 0; i < byte_lanes; i += reg_bytes) {
+                    vector<Value *> args = regs;
+                    args.push_back(slice_vector(byte_index, i, reg_bytes));
+                    results.push_back(call_intrin(regs[0]->getType(), reg_bytes, intrin.str(), args));
+                }
+                Value *bytes = slice_vector(concat_vectors(results), 0, byte_lanes);
+                value = builder->CreateBitCast(bytes, llvm_type_of(op->type));
+                return;
+            }
         }
     }
 
     CodeGen_Posix::visit(op);
 }
 
+void CodeGen_ARM::codegen_vector_reduce(const VectorReduce *op, Expr init) {
+    const int input_width = op->value.type().width;
+    const int factor = input_width / op->type.width;
+    const Mul *mul = op->value.as<Mul>();
+
+    // A sum of products of narrow vectors can do the multiply at
+    // twice the narrow width (vmull, or umull and smull on aarch64),
+    // and then add pairs of the products with vpaddl below.
+    if (!neon_intrinsics_disabled() && mul &&
+        op->op == VectorReduce::Add && factor % 2 == 0 && !op->type.is_float()) {
+        for (int bits = 8; bits <= 16 && op->type.bits >= bits * 4; bits *= 2) {
+            Expr ua = try_narrow(mul->a, UInt(bits, input_width));
+            Expr ub = try_narrow(mul->b, UInt(bits, input_width));
+            Expr sa = try_narrow(mul->a, Int(bits, input_width));
+            Expr sb = try_narrow(mul->b, Int(bits, input_width));
+            Expr a = ua.defined() ? ua : sa;
+            Expr b = ub.defined() ? ub : sb;
+            if (!a.defined() || !b.defined()) {
+                continue;
+            }
+            // The product of two unsigned values needs all of the
+            // bits. Otherwise it fits in the signed type.
+            Type product = ua.defined() && ub.defined() ? UInt(bits * 2, input_width) : Int(bits * 2, input_width);
+            Expr reduce = VectorReduce::make(op->op, cast(op->value.type(), cast(product, a) * cast(product, b)), op->type.width);
+            codegen_vector_reduce(reduce.as<VectorReduce>(), init);
+            return;
+        }
+    }
+
+    const Cast *cast = op->value.as<Cast>();
+
+    // vpaddl adds adjacent pairs of lanes into lanes of twice the
+    // width (uaddlp and saddlp on aarch64), so a sum of a widened
+    // vector can be done with it.
+    Type narrow = cast ? cast->value.type() : Type();
+    if (neon_intrinsics_disabled() ||
+        op->op != VectorReduce::Add || factor % 2 != 0 || !cast ||
+        op->type.is_float() || narrow.is_float() || narrow.is_bool() ||
+        narrow.bits > 32 || op->type.bits < narrow.bits * 2) {
+        CodeGen_Posix::codegen_vector_reduce(op, init);
+        return;
+    }
+
+    const int input_bits = narrow.bits * input_width;
+    const int reg_bits = input_bits % 128 == 0 ? 128 : 64;
+    if (input_bits % reg_bits != 0) {
+        CodeGen_Posix::codegen_vector_reduce(op, init);
+        return;
+    }
+    const int chunk = reg_bits / narrow.bits;
+
+    Type wide = narrow;
+    wide.bits *= 2;
+    wide.width = input_width / 2;
+
+    // On 32-bit arm, vpadal also accumulates the pairwise sums into
+    // another vector. On aarch64 llvm makes uadalp and sadalp from an
+    // add of uaddlp or saddlp.
+    const bool accumulate = (target.bits == 32 && init.defined() &&
+                             factor == 2 && op->type.bits == wide.bits);
+
+    ostringstream intrin;
+    if (target.bits == 64) {
+        intrin << "llvm.aarch64.neon." << (narrow.is_int() ? "saddlp" : "uaddlp");
+    } else {
+        intrin << "llvm.arm.neon." << (accumulate ? "vpadal" : "vpaddl") << (narrow.is_int() ? "s" : "u");
+    }
+    intrin << ".v" << chunk / 2 << "i" << wide.bits << ".v" << chunk << "i" << narrow.bits;
+
+    Value *v = codegen(cast->value);
+    Value *acc = accumulate ? codegen(init) : NULL;
+    llvm::Type *result_type = llvm_type_of(wide.element_of().vector_of(chunk / 2));
+    vector<Value *> sums;
+    for (int i = 0; i < input_width; i += chunk) {
+        vector<Value *> args;
+        if (accumulate) {
+            args.push_back(slice_vector(acc, i / 2, chunk / 2));
+        }
+        args.push_back(slice_vector(v, i, chunk));
+        sums.push_back(call_intrin(result_type, chunk / 2, intrin.str(), args));
+    }
+
+    if (accumulate) {
+        value = concat_vectors(sums);
+    } else {
+        finish_vector_reduce(op, wide, concat_vectors(sums), init);
+    }
+}
+
 string CodeGen_ARM::mcpu() const {
     if (target.bits == 32) {
         if (target.has_feature(Target::ARMv7s)) {
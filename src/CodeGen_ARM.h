@@ -34,6 +34,9 @@ protected:
     void visit(const Call *);
     // @}
 
+    /** Pairwise widening adds, which may accumulate */
+    void codegen_vector_reduce(const VectorReduce *, Expr init);
+
     /** Various patterns to peephole match against */
     struct Pattern {
         std::string intrin32; ///< Name of the intrinsic for 32-bit arm
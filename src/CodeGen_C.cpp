@@ -1058,6 +1058,8 @@ void CodeGen_C::visit(const Call *op) {
                    << "~" << struct_name << "() {" << call << "}"
                    << "} " << instance_name << "(" << arg << ");\n";
             rhs << print_expr(0);
+        } else if (op->name == Call::atomic_update) {
+            user_error << "Atomic updates aren't supported by the C backend\n";
         } else {
             // TODO: other intrinsics
             internal_error << "Unhandled intrinsic in C backend: " << op->name << '\n';
@@ -1384,6 +1386,10 @@ void CodeGen_C::visit(const Evaluate *op) {
     stream << "(void)" << id << ";\n";
 }
 
+void CodeGen_C::visit(const VectorReduce *op) {
+    user_error << "Vector reductions aren't supported by the C backend\n";
+}
+
 void CodeGen_C::test() {
     Argument buffer_arg("buf", Argument::OutputBuffer, Int(32), 3);
     Argument float_arg("alpha", Argument::InputScalar, Float(32), 0);
@@ -136,6 +136,7 @@ protected:
     void visit(const Realize *);
     void visit(const IfThenElse *);
     void visit(const Evaluate *);
+    void visit(const VectorReduce *);
 
     void visit_binop(Type t, Expr a, Expr b, const char *op);
 };
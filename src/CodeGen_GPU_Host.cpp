@@ -632,7 +632,9 @@ Value *CodeGen_GPU_Host<CodeGen_CPU>::get_module_state(const std::string &api_un
 template<typename CodeGen_CPU>
 void CodeGen_GPU_Host<CodeGen_CPU>::visit(const Call *op) {
     CodeGen_CPU::visit(op);
-    if (op->name == "halide_device_malloc" || op->name == "halide_copy_to_device") {
+    if (op->name == "halide_device_malloc" ||
+        op->name == "halide_copy_to_device" ||
+        op->name == "halide_copy_to_device_async") {
         // Register a destructor for this buffer if this is the first
         // device_malloc or copy_to_device for it.
         internal_assert(op->args.size() == 2);
@@ -253,15 +253,18 @@ bool function_takes_user_context(const std::string &name) {
     static const char *user_context_runtime_funcs[] = {
         "halide_copy_to_host",
         "halide_copy_to_device",
+        "halide_copy_to_device_async",
         "halide_current_time_ns",
         "halide_debug_to_file",
         "halide_device_free",
         "halide_device_malloc",
         "halide_device_sync",
+        "halide_device_wait_for_copies",
         "halide_do_par_for",
         "halide_do_task",
         "halide_error",
         "halide_free",
+        "halide_host_device_get_pointer",
         "halide_malloc",
         "halide_print",
         "halide_profiler_pipeline_start",
@@ -284,6 +287,7 @@ bool function_takes_user_context(const std::string &name) {
         "halide_openglcompute_initialize_kernels",
         "halide_renderscript_initialize_kernels",
         "halide_get_gpu_device",
+        "halide_auto_specialization_hit",
     };
     const int num_funcs = sizeof(user_context_runtime_funcs) /
         sizeof(user_context_runtime_funcs[0]);
@@ -10,6 +10,7 @@
 #include "Simplify.h"
 #include "JITModule.h"
 #include "CodeGen_Internal.h"
+#include "CompileProfiler.h"
 #include "Lerp.h"
 #include "Util.h"
 #include "LLVM_Runtime_Linker.h"
@@ -366,9 +367,11 @@ void CodeGen_LLVM::init_context() {
 void CodeGen_LLVM::init_module() {
     init_context();
 
-    // Start with a module containing the initial module for this target.
+    // Start with a module containing the initial module for this
+    // target. The runtime functions the pipeline uses are loaded once
+    // code generation is done.
     delete module;
-    module = get_initial_module_for_target(target, context);
+    module = get_lazy_initial_module_for_target(target, context);
 }
 
 CodeGen_LLVM::~CodeGen_LLVM() {
@@ -416,6 +419,8 @@ llvm::Module *CodeGen_LLVM::compile(const Module &input) {
     internal_assert(scalar_value_t_type) << "Did not find halide_scalar_value_t in initial module";
 
 
+    CompileProfiler profiler("llvm", input.name(), module);
+
     // Generate the code for this module.
     debug(1) << "Generating llvm bitcode...\n";
     for (size_t i = 0; i < input.buffers.size(); i++) {
@@ -424,15 +429,21 @@ llvm::Module *CodeGen_LLVM::compile(const Module &input) {
     for (size_t i = 0; i < input.functions.size(); i++) {
         compile_func(input.functions[i]);
     }
+    profiler.phase_done("codegen", module);
+
+    materialize_used_runtime_functions(module);
+    profiler.phase_done("load runtime", module);
 
     debug(2) << module << "\n";
 
     // Verify the module is ok
     verifyModule(*module);
     debug(2) << "Done generating llvm bitcode\n";
+    profiler.phase_done("verify", module);
 
     // Optimize
     CodeGen_LLVM::optimize_module();
+    profiler.phase_done("optimize", module);
 
     // Disown the module and return it.
     llvm::Module *m = module;
@@ -554,6 +565,9 @@ void CodeGen_LLVM::compile_func(const LoweredFunc &f) {
     // If the Func is externally visible, also create the argv wrapper
     // (useful for calling from JIT and other machine interfaces).
     if (f.linkage == LoweredFunc::External) {
+        if (target.has_feature(Target::PipelineStats)) {
+            function = add_pipeline_stats_wrapper(function, args);
+        }
         llvm::Function *wrapper = add_argv_wrapper(module, function, name + "_argv");
         llvm::Constant *metadata = embed_metadata(name + "_metadata", name, args);
         if (target.has_feature(Target::RegisterMetadata)) {
@@ -857,6 +871,85 @@ void CodeGen_LLVM::register_metadata(const std::string &name, llvm::Constant *me
     llvm::appendToGlobalCtors(*module, ctor, 0);
 }
 
+llvm::Function *CodeGen_LLVM::add_pipeline_stats_wrapper(llvm::Function *fn, const std::vector<Argument> &args) {
+    llvm::Function *stats_begin = module->getFunction("halide_pipeline_stats_begin");
+    internal_assert(stats_begin) << "Could not find halide_pipeline_stats_begin in initial module\n";
+    llvm::Function *stats_end = module->getFunction("halide_pipeline_stats_end");
+    internal_assert(stats_end) << "Could not find halide_pipeline_stats_end in initial module\n";
+
+    const std::string name = fn->getName();
+    fn->setName(name + ".uninstrumented");
+    fn->setLinkage(llvm::GlobalValue::InternalLinkage);
+
+    llvm::Function *wrapper = llvm::Function::Create(fn->getFunctionType(), llvm::GlobalValue::ExternalLinkage, name, module);
+    BasicBlock *block = BasicBlock::Create(*context, "entry", wrapper);
+    builder->SetInsertPoint(block);
+
+    vector<Value *> wrapper_args;
+    for (llvm::Function::arg_iterator iter = wrapper->arg_begin(); iter != wrapper->arg_end(); iter++) {
+        wrapper_args.push_back(iter);
+    }
+
+    llvm::PointerType *void_ptr = i8->getPointerTo();
+    Value *user_context = ConstantPointerNull::get(void_ptr);
+    for (size_t i = 0; i < args.size(); i++) {
+        if (args[i].name == "__user_context") {
+            user_context = builder->CreatePointerCast(wrapper_args[i], void_ptr);
+        }
+    }
+
+    // Each copy of the pipeline caches a pointer to its statistics,
+    // which the runtime fills in on the first call.
+    llvm::FunctionType *begin_t = stats_begin->getFunctionType();
+    llvm::Type *stats_ptr_t = begin_t->getParamType(1)->getPointerElementType();
+    GlobalVariable *stats = new GlobalVariable(*module, stats_ptr_t, false, GlobalValue::PrivateLinkage,
+                                               Constant::getNullValue(stats_ptr_t), name + ".pipeline_stats");
+
+    Value *begin_args[] = {
+        builder->CreatePointerCast(user_context, begin_t->getParamType(0)),
+        stats,
+        builder->CreatePointerCast(create_string_constant(name), begin_t->getParamType(2))
+    };
+    Value *start_time = builder->CreateCall(stats_begin, begin_args);
+
+    Value *result = builder->CreateCall(fn, wrapper_args);
+
+    // Pass the buffers to the runtime, with the outputs last, so that
+    // it can skip bounds queries and count the bytes output.
+    llvm::FunctionType *end_t = stats_end->getFunctionType();
+    llvm::Type *buffer_ptr_t = end_t->getParamType(4)->getPointerElementType();
+    vector<Value *> buffers;
+    int num_outputs = 0;
+    for (int outputs = 0; outputs < 2; outputs++) {
+        for (size_t i = 0; i < args.size(); i++) {
+            if (args[i].is_buffer() && args[i].is_output() == (outputs == 1)) {
+                buffers.push_back(wrapper_args[i]);
+                num_outputs += outputs;
+            }
+        }
+    }
+    Value *buffer_array = builder->CreateAlloca(buffer_ptr_t, ConstantInt::get(i32, std::max((size_t)1, buffers.size())));
+    for (size_t i = 0; i < buffers.size(); i++) {
+        builder->CreateStore(builder->CreatePointerCast(buffers[i], buffer_ptr_t),
+                             builder->CreateConstGEP1_32(buffer_array, i));
+    }
+
+    Value *end_args[] = {
+        builder->CreatePointerCast(user_context, end_t->getParamType(0)),
+        builder->CreateLoad(stats),
+        start_time,
+        result,
+        buffer_array,
+        ConstantInt::get(i32, buffers.size()),
+        ConstantInt::get(i32, num_outputs)
+    };
+    builder->CreateCall(stats_end, end_args);
+    builder->CreateRet(result);
+
+    internal_assert(!verifyFunction(*wrapper));
+    return wrapper;
+}
+
 llvm::Type *CodeGen_LLVM::llvm_type_of(Type t) {
     return Internal::llvm_type_of(context, t);
 }
@@ -2032,6 +2125,23 @@ void CodeGen_LLVM::visit(const Call *op) {
         } else if (op->name == Call::interleave_vectors) {
             internal_assert(0 < op->args.size());
             value = interleave_vectors(op->type, op->args);
+        } else if (op->name == Call::dynamic_shuffle) {
+            // Look up each lane of the index in the table. Targets
+            // with table lookup instructions do better.
+            internal_assert(op->args.size() == 2);
+            Value *table = codegen(op->args[0]);
+            Value *index = codegen(op->args[1]);
+            if (op->type.is_scalar()) {
+                value = builder->CreateExtractElement(table, index);
+            } else {
+                value = UndefValue::get(llvm_type_of(op->type));
+                for (int i = 0; i < op->type.width; i++) {
+                    Value *lane = ConstantInt::get(i32, i);
+                    Value *idx = builder->CreateExtractElement(index, lane);
+                    Value *v = builder->CreateExtractElement(table, idx);
+                    value = builder->CreateInsertElement(value, v, lane);
+                }
+            }
         } else if (op->name == Call::debug_to_file) {
             internal_assert(op->args.size() == 9);
             const StringImm *filename = op->args[0].as<StringImm>();
@@ -2579,6 +2689,8 @@ void CodeGen_LLVM::visit(const Call *op) {
             }
             register_destructor(f, codegen(arg), Always);
         } else {
+            internal_assert(op->name != Call::atomic_update)
+                << "atomic_update may only be the value of a Store\n";
             internal_error << "Unknown intrinsic: " << op->name << "\n";
         }
     } else if (op->call_type == Call::Extern && op->name == "pow_f32") {
@@ -3014,6 +3126,109 @@ void CodeGen_LLVM::visit(const For *op) {
     }
 }
 
+void CodeGen_LLVM::codegen_atomic_update(const string &name, const Call *update, Expr index) {
+    internal_assert(update->args.size() == 2);
+    const StringImm *op_name = update->args[0].as<StringImm>();
+    internal_assert(op_name) << "Malformed atomic_update node\n";
+    const string &op = op_name->value;
+
+    Halide::Type t = update->type;
+    internal_assert(t.is_scalar()) << "Can't do vector atomic updates\n";
+
+    Value *val = codegen(update->args[1]);
+    Value *ptr = codegen_buffer_pointer(name, t, index);
+
+    // Integer updates that have an atomicrmw operation.
+    if (!t.is_float()) {
+        bool found = true;
+        AtomicRMWInst::BinOp bin_op = AtomicRMWInst::Add;
+        if (op == "add") {
+            bin_op = AtomicRMWInst::Add;
+        } else if (op == "sub") {
+            bin_op = AtomicRMWInst::Sub;
+        } else if (op == "and") {
+            bin_op = AtomicRMWInst::And;
+        } else if (op == "or") {
+            bin_op = AtomicRMWInst::Or;
+        } else if (op == "xor") {
+            bin_op = AtomicRMWInst::Xor;
+        } else if (op == "min") {
+            bin_op = t.is_int() ? AtomicRMWInst::Min : AtomicRMWInst::UMin;
+        } else if (op == "max") {
+            bin_op = t.is_int() ? AtomicRMWInst::Max : AtomicRMWInst::UMax;
+        } else {
+            found = false;
+        }
+        if (found) {
+            builder->CreateAtomicRMW(bin_op, ptr, val, Monotonic);
+            return;
+        }
+    }
+
+    // Everything else uses a compare-and-swap loop on the bits of
+    // the element.
+    llvm::Type *bits_type = llvm::Type::getIntNTy(*context, t.bits);
+    ptr = builder->CreatePointerCast(ptr, bits_type->getPointerTo());
+
+    string old_name = unique_name('a'), arg_name = unique_name('b');
+    Expr a = Variable::make(t, old_name), b = Variable::make(t, arg_name);
+    Expr new_value;
+    if (op == "add") {
+        new_value = a + b;
+    } else if (op == "sub") {
+        new_value = a - b;
+    } else if (op == "mul") {
+        new_value = a * b;
+    } else if (op == "min") {
+        new_value = Min::make(a, b);
+    } else if (op == "max") {
+        new_value = Max::make(a, b);
+    } else if (op == "and") {
+        new_value = a & b;
+    } else if (op == "or") {
+        new_value = a | b;
+    } else if (op == "xor") {
+        new_value = a ^ b;
+    } else {
+        internal_error << "Unknown atomic update: " << op << "\n";
+    }
+
+    BasicBlock *entry_bb = builder->GetInsertBlock();
+    // Other threads may be storing to the element, so the load of
+    // the first guess at its value must be atomic too.
+    LoadInst *initial = builder->CreateAlignedLoad(ptr, t.bytes());
+    initial->setAtomic(Monotonic);
+    BasicBlock *loop_bb = BasicBlock::Create(*context, "atomic_update", function);
+    BasicBlock *after_bb = BasicBlock::Create(*context, "atomic_update_done", function);
+    builder->CreateBr(loop_bb);
+
+    builder->SetInsertPoint(loop_bb);
+    PHINode *old_bits = builder->CreatePHI(bits_type, 2);
+    old_bits->addIncoming(initial, entry_bb);
+
+    sym_push(old_name, builder->CreateBitCast(old_bits, llvm_type_of(t)));
+    sym_push(arg_name, val);
+    Value *new_bits = builder->CreateBitCast(codegen(new_value), bits_type);
+    sym_pop(old_name);
+    sym_pop(arg_name);
+
+    #if LLVM_VERSION >= 35
+    Value *result = builder->CreateAtomicCmpXchg(ptr, old_bits, new_bits, Monotonic, Monotonic);
+    Value *seen_bits = builder->CreateExtractValue(result, 0u);
+    Value *success = builder->CreateExtractValue(result, 1u);
+    #else
+    Value *seen_bits = builder->CreateAtomicCmpXchg(ptr, old_bits, new_bits, Monotonic);
+    Value *success = builder->CreateICmpEQ(seen_bits, old_bits);
+    #endif
+
+    // If another thread changed the element, try again with the value
+    // it stored.
+    old_bits->addIncoming(seen_bits, builder->GetInsertBlock());
+    builder->CreateCondBr(success, after_bb, loop_bb);
+
+    builder->SetInsertPoint(after_bb);
+}
+
 void CodeGen_LLVM::visit(const Store *op) {
     // Even on 32-bit systems, Handles are treated as 64-bit in
     // memory, so convert stores of handles to stores of uint64_ts.
@@ -3023,6 +3238,32 @@ void CodeGen_LLVM::visit(const Store *op) {
         return;
     }
 
+    // Common subexpression elimination may have wrapped the atomic
+    // update in lets of parts of its operand. Move them outside the
+    // store, so that the update is the value stored again.
+    Expr value = op->value;
+    vector<pair<string, Expr>> lets;
+    while (const Let *let = value.as<Let>()) {
+        lets.push_back(make_pair(let->name, let->value));
+        value = let->body;
+    }
+
+    if (const Call *update = value.as<Call>()) {
+        if (update->name == Call::atomic_update &&
+            update->call_type == Call::Intrinsic) {
+            if (lets.empty()) {
+                codegen_atomic_update(op->name, update, op->index);
+            } else {
+                Stmt s = Store::make(op->name, value, op->index);
+                for (size_t i = lets.size(); i > 0; i--) {
+                    s = LetStmt::make(lets[i-1].first, lets[i-1].second, s);
+                }
+                codegen(s);
+            }
+            return;
+        }
+    }
+
     Halide::Type value_type = op->value.type();
     Value *val = codegen(op->value);
     bool possibly_misaligned = (might_be_misaligned.find(op->name) != might_be_misaligned.end());
@@ -3148,6 +3389,102 @@ void CodeGen_LLVM::visit(const Evaluate *op) {
     value = NULL;
 }
 
+void CodeGen_LLVM::visit(const VectorReduce *op) {
+    codegen_vector_reduce(op, Expr());
+}
+
+namespace {
+Expr vector_reduce_shuffle(Expr v, const vector<int> &indices) {
+    vector<Expr> args;
+    args.push_back(v);
+    for (int i : indices) {
+        args.push_back(i);
+    }
+    return Call::make(v.type().element_of().vector_of((int)indices.size()),
+                      Call::shuffle_vector, args, Call::Intrinsic);
+}
+}
+
+void CodeGen_LLVM::codegen_vector_reduce(const VectorReduce *op, Expr init) {
+    const int output_width = op->type.width;
+    int factor = op->value.type().width / output_width;
+
+    // Each step is generated separately, and its result bound to a
+    // name, so that its input isn't generated once per use.
+    vector<string> names;
+    auto bind = [&](Expr e) {
+        string name = unique_name('t');
+        sym_push(name, codegen(e));
+        names.push_back(name);
+        return Variable::make(e.type(), name);
+    };
+
+    Expr val = bind(op->value);
+    while (factor % 2 == 0) {
+        // Combine pairs of lanes. When reducing to a scalar, the
+        // pairs can be any lanes, so combine the halves of the
+        // vector, which are cheaper to extract than the even and
+        // odd lanes.
+        const int w = val.type().width / 2;
+        vector<int> a(w), b(w);
+        for (int i = 0; i < w; i++) {
+            if (output_width == 1) {
+                a[i] = i;
+                b[i] = i + w;
+            } else {
+                a[i] = 2 * i;
+                b[i] = 2 * i + 1;
+            }
+        }
+        val = bind(vector_reduce_combine(op->op,
+                                         vector_reduce_shuffle(val, a),
+                                         vector_reduce_shuffle(val, b)));
+        factor /= 2;
+    }
+
+    Expr result;
+    if (factor == 1) {
+        result = val;
+    } else {
+        for (int j = 0; j < factor; j++) {
+            vector<int> indices(output_width);
+            for (int i = 0; i < output_width; i++) {
+                indices[i] = i * factor + j;
+            }
+            Expr slice = vector_reduce_shuffle(val, indices);
+            result = result.defined() ? vector_reduce_combine(op->op, result, slice) : slice;
+        }
+    }
+
+    if (init.defined()) {
+        result = vector_reduce_combine(op->op, init, result);
+    }
+
+    value = codegen(result);
+
+    for (const string &name : names) {
+        sym_pop(name);
+    }
+}
+
+void CodeGen_LLVM::finish_vector_reduce(const VectorReduce *op, Type partial_type, Value *partial, Expr init) {
+    string name = unique_name('t');
+    sym_push(name, partial);
+    Expr rest = Variable::make(partial_type, name);
+    Type t = op->type.element_of().vector_of(partial_type.width);
+    if (partial_type != t) {
+        rest = Cast::make(t, rest);
+    }
+    if (partial_type.width != op->type.width) {
+        rest = VectorReduce::make(op->op, rest, op->type.width);
+    }
+    if (init.defined()) {
+        rest = vector_reduce_combine(op->op, init, rest);
+    }
+    value = codegen(rest);
+    sym_pop(name);
+}
+
 Value *CodeGen_LLVM::create_alloca_at_entry(llvm::Type *t, int n, bool zero_initialize, const string &name) {
     IRBuilderBase::InsertPoint here = builder->saveIP();
     BasicBlock *entry = &builder->GetInsertBlock()->getParent()->getEntryBlock();
@@ -3313,6 +3650,39 @@ Value *CodeGen_LLVM::concat_vectors(const vector<Value *> &v) {
     return vecs[0];
 }
 
+vector<Value *> CodeGen_LLVM::split_table_bytes(Value *table, int reg_bytes) {
+    int bytes = table->getType()->getVectorNumElements() * table->getType()->getScalarSizeInBits() / 8;
+    Value *table_bytes = builder->CreateBitCast(table, VectorType::get(i8, bytes));
+    vector<Value *> regs;
+    for (int i = 0; i < bytes; i += reg_bytes) {
+        regs.push_back(slice_vector(table_bytes, i, reg_bytes));
+    }
+    return regs;
+}
+
+Value *CodeGen_LLVM::table_byte_indices(Value *index, int element_bytes) {
+    int lanes = index->getType()->getVectorNumElements();
+    // Tables are small, so the indices fit in 8 bits.
+    Value *idx = builder->CreateTrunc(index, VectorType::get(i8, lanes));
+    if (element_bytes == 1) {
+        return idx;
+    }
+
+    // Element i of the table is made of bytes i*element_bytes to
+    // (i+1)*element_bytes - 1.
+    int byte_lanes = lanes * element_bytes;
+    vector<Constant *> replicate(byte_lanes), offsets(byte_lanes);
+    for (int i = 0; i < lanes; i++) {
+        for (int b = 0; b < element_bytes; b++) {
+            replicate[i * element_bytes + b] = ConstantInt::get(i32, i);
+            offsets[i * element_bytes + b] = ConstantInt::get(i8, b);
+        }
+    }
+    idx = builder->CreateShuffleVector(idx, UndefValue::get(idx->getType()), ConstantVector::get(replicate));
+    idx = builder->CreateMul(idx, ConstantVector::getSplat(byte_lanes, ConstantInt::get(i8, element_bytes)));
+    return builder->CreateAdd(idx, ConstantVector::get(offsets));
+}
+
 std::pair<llvm::Function *, int> CodeGen_LLVM::find_vector_runtime_function(const std::string &name, int width) {
     // Check if a vector version of the function already
     // exists at some useful width. We use the naming
@@ -319,6 +319,7 @@ protected:
     virtual void visit(const Block *);
     virtual void visit(const IfThenElse *);
     virtual void visit(const Evaluate *);
+    virtual void visit(const VectorReduce *);
     // @}
 
     /** Generate code for an allocate node. It has no default
@@ -387,6 +388,37 @@ protected:
     /** Concatenate a bunch of llvm vectors. Must be of the same type. */
     llvm::Value *concat_vectors(const std::vector<llvm::Value *> &);
 
+    /** Helpers for implementing dynamic_shuffle with the byte table
+     * lookup instructions of a target. The first splits the table
+     * into vectors of reg_bytes bytes (the last one is padded with
+     * undefs). The second turns indices of elements of the given size
+     * into indices of their bytes, as a vector of 8-bit lanes with
+     * element_bytes times as many lanes. */
+    // @{
+    std::vector<llvm::Value *> split_table_bytes(llvm::Value *table, int reg_bytes);
+    llvm::Value *table_byte_indices(llvm::Value *index, int element_bytes);
+    // @}
+
+    /** Generate code for a store of an atomic_update intrinsic: an
+     * atomic read-modify-write of a buffer element. Integer updates
+     * that LLVM has an atomicrmw operation for use that, and the
+     * others use a compare-and-swap loop. */
+    void codegen_atomic_update(const std::string &name, const Call *update, Expr index);
+
+    /** Generate code for a horizontal reduction of a vector. If init
+     * is defined, it's combined with the result, which lets targets
+     * use accumulating instructions. The default implementation
+     * combines pairs of lanes until the reduction factor is odd, then
+     * combines slices of the vector. */
+    virtual void codegen_vector_reduce(const VectorReduce *op, Expr init);
+
+    /** Finish a horizontal reduction that a target has done part of
+     * with its own instructions. 'partial' is the result of that
+     * part, of type 'partial_type', which may have more lanes than
+     * the result. It's cast to the type of the result before the rest
+     * of the reduction, which is only correct for integer Adds. */
+    void finish_vector_reduce(const VectorReduce *op, Type partial_type, llvm::Value *partial, Expr init);
+
     /** Go looking for a vector version of a runtime function. Will
      * return the best match. Matches in the following order:
      *
@@ -434,6 +466,12 @@ private:
     llvm::Constant *embed_constant_expr(Expr e);
 
     void register_metadata(const std::string &name, llvm::Constant *metadata, llvm::Function *argv_wrapper);
+
+    /** Make fn private, and replace it with an entrypoint of the same
+     * name and type that counts the calls to it and records how long
+     * they took, for Target::PipelineStats. Returns the new
+     * entrypoint. */
+    llvm::Function *add_pipeline_stats_wrapper(llvm::Function *fn, const std::vector<Argument> &args);
 };
 
 }
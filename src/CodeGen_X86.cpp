@@ -143,6 +143,42 @@ bool should_use_pmaddwd(Expr a, Expr b, vector<Expr> &result) {
     return true;
 }
 
+// Find the narrow operands of a multiply of two widened integer
+// vectors, one of type ta and the other of type tb, in either order.
+bool match_widening_mul(const Mul *mul, Type ta, Type tb, Expr &a, Expr &b) {
+    if (!mul) {
+        return false;
+    }
+    a = lossless_cast(ta, mul->a);
+    b = lossless_cast(tb, mul->b);
+    if (a.defined() && b.defined()) {
+        return true;
+    }
+    a = lossless_cast(ta, mul->b);
+    b = lossless_cast(tb, mul->a);
+    return a.defined() && b.defined();
+}
+
+// The largest magnitude of the lanes of a narrowed vector, which is
+// smaller than the limit of its type if it's a constant.
+int max_magnitude(Expr e, int type_limit) {
+    if (const Broadcast *b = e.as<Broadcast>()) {
+        e = b->value;
+    }
+    while (const Cast *c = e.as<Cast>()) {
+        e = c->value;
+    }
+    const int *i = as_const_int(e);
+    return i ? std::abs(*i) : type_limit;
+}
+
+// pmaddubsw saturates the sums of pairs of 16-bit products, so it's
+// only exact if no pair of products can overflow. In practice that
+// needs one of the operands to be a small constant.
+bool pairs_of_products_fit_in_16_bits(Expr u8_arg, Expr i8_arg) {
+    return 2 * max_magnitude(u8_arg, 255) * max_magnitude(i8_arg, 128) <= 32767;
+}
+
 }
 
 
@@ -614,6 +650,193 @@ void CodeGen_X86::visit(const Max *op) {
     }
 }
 
+void CodeGen_X86::visit(const Load *op) {
+    // AVX2 can gather 32 and 64-bit elements using 32-bit indices.
+    int gather_lanes = op->type.bits == 32 ? 8 : 4;
+    if (!target.has_feature(Target::AVX2) ||
+        !op->type.is_vector() ||
+        op->type.is_handle() ||
+        (op->type.bits != 32 && op->type.bits != 64) ||
+        op->type.width % gather_lanes != 0 ||
+        op->index.as<Ramp>()) {
+        CodeGen_Posix::visit(op);
+        return;
+    }
+
+    Intrinsic::ID id;
+    if (op->type.bits == 32) {
+        id = op->type.is_float() ? Intrinsic::x86_avx2_gather_d_ps_256 : Intrinsic::x86_avx2_gather_d_d_256;
+    } else {
+        id = op->type.is_float() ? Intrinsic::x86_avx2_gather_d_pd_256 : Intrinsic::x86_avx2_gather_d_q_256;
+    }
+    llvm::Function *fn = Intrinsic::getDeclaration(module, id);
+
+    Value *base = codegen_buffer_pointer(op->name, op->type.element_of(), make_zero(Int(32)));
+    base = builder->CreatePointerCast(base, i8->getPointerTo());
+    Value *index = codegen(op->index);
+
+    llvm::Type *slice_type = VectorType::get(llvm_type_of(op->type.element_of()), gather_lanes);
+    // Gather every lane. The mask is the sign bit of each lane.
+    llvm::Type *mask_int_type = llvm_type_of(Int(op->type.bits, gather_lanes));
+    Value *mask = builder->CreateBitCast(Constant::getAllOnesValue(mask_int_type), slice_type);
+    Value *scale = ConstantInt::get(i8, op->type.bytes());
+
+    vector<Value *> slices;
+    for (int i = 0; i < op->type.width; i += gather_lanes) {
+        Value *idx = slice_vector(index, i, gather_lanes);
+        Value *args[] = {UndefValue::get(slice_type), base, idx, mask, scale};
+        slices.push_back(builder->CreateCall(fn, args));
+    }
+    value = concat_vectors(slices);
+}
+
+void CodeGen_X86::visit(const Call *op) {
+    if (op->call_type != Call::Intrinsic ||
+        op->name != Call::dynamic_shuffle ||
+        !op->type.is_vector() ||
+        !target.has_feature(Target::SSE41)) {
+        CodeGen_Posix::visit(op);
+        return;
+    }
+
+    internal_assert(op->args.size() == 2);
+    Type table_type = op->args[0].type();
+    int lanes = op->type.width;
+    bool use_vperm = (target.has_feature(Target::AVX2) &&
+                      op->type.bits == 32 && table_type.width <= 8);
+    bool use_pshufb = table_type.bytes() * table_type.width <= 32;
+    if (!use_vperm && !use_pshufb) {
+        CodeGen_Posix::visit(op);
+        return;
+    }
+
+    Value *table = codegen(op->args[0]);
+    Value *index = codegen(op->args[1]);
+
+    if (use_vperm) {
+        // vpermd and vpermps look up 32-bit elements in a table of
+        // eight.
+        table = slice_vector(table, 0, 8);
+        string intrin = op->type.is_float() ? "llvm.x86.avx2.permps" : "llvm.x86.avx2.permd";
+        vector<Value *> results;
+        for (int i = 0; i < lanes; i += 8) {
+            Value *idx = slice_vector(index, i, 8);
+            results.push_back(call_intrin(table->getType(), 8, intrin, {table, idx}));
+        }
+        value = slice_vector(concat_vectors(results), 0, lanes);
+    } else {
+        // pshufb looks up bytes in a table of sixteen, using the low
+        // four bits of each index. Do a lookup in each sixteen bytes
+        // of a larger table, and select between them.
+        vector<Value *> regs = split_table_bytes(table, 16);
+        Value *byte_index = table_byte_indices(index, op->type.bytes());
+        int byte_lanes = lanes * op->type.bytes();
+        vector<Value *> results;
+        for (int i = 0; i < byte_lanes; i += 16) {
+            Value *idx = slice_vector(byte_index, i, 16);
+            Value *result = NULL;
+            for (size_t r = 0; r < regs.size(); r++) {
+                Value *lookup = call_intrin(regs[r]->getType(), 16, "llvm.x86.ssse3.pshuf.b.128", {regs[r], idx});
+                if (result) {
+                    Value *reg_start = ConstantVector::getSplat(16, ConstantInt::get(i8, r * 16));
+                    result = builder->CreateSelect(builder->CreateICmpUGE(idx, reg_start), lookup, result);
+                } else {
+                    result = lookup;
+                }
+            }
+            results.push_back(result);
+        }
+        Value *bytes = slice_vector(concat_vectors(results), 0, byte_lanes);
+        value = builder->CreateBitCast(bytes, llvm_type_of(op->type));
+    }
+}
+
+void CodeGen_X86::codegen_vector_reduce(const VectorReduce *op, Expr init) {
+    const int input_width = op->value.type().width;
+    const int factor = input_width / op->type.width;
+    const Cast *cast = op->value.as<Cast>();
+    const Mul *mul = op->value.as<Mul>();
+
+    // The x86 instructions below do part of the reduction, and
+    // finish_vector_reduce does the rest.
+    Type partial_type;
+    Value *partial = NULL;
+
+    // pmaddwd and pmaddubsw multiply two vectors and add adjacent
+    // pairs of the products into lanes of twice the width. The lanes
+    // of a widening multiply are already in the order they need.
+    Expr a, b;
+    string madd;
+    int chunk = 0;
+    const bool avx2 = target.has_feature(Target::AVX2);
+    if (op->op == VectorReduce::Add && factor % 2 == 0 && input_width % 8 == 0 &&
+        op->type.element_of() == Int(32) &&
+        match_widening_mul(mul, Int(16, input_width), Int(16, input_width), a, b)) {
+        chunk = (avx2 && input_width % 16 == 0) ? 16 : 8;
+        madd = chunk == 16 ? "llvm.x86.avx2.pmadd.wd" : "llvm.x86.sse2.pmadd.wd";
+        partial_type = Int(32, input_width / 2);
+    } else if (op->op == VectorReduce::Add && factor % 2 == 0 && input_width % 16 == 0 &&
+               target.has_feature(Target::SSE41) && op->type.element_of() == Int(16) &&
+               match_widening_mul(mul, UInt(8, input_width), Int(8, input_width), a, b) &&
+               pairs_of_products_fit_in_16_bits(a, b)) {
+        chunk = (avx2 && input_width % 32 == 0) ? 32 : 16;
+        madd = chunk == 32 ? "llvm.x86.avx2.pmadd.ub.sw" : "llvm.x86.ssse3.pmadd.ub.sw.128";
+        partial_type = Int(16, input_width / 2);
+    }
+
+    if (!madd.empty()) {
+        Value *va = codegen(a), *vb = codegen(b);
+        llvm::Type *sum_type = llvm_type_of(partial_type.element_of().vector_of(chunk / 2));
+        vector<Value *> sums;
+        for (int i = 0; i < input_width; i += chunk) {
+            sums.push_back(call_intrin(sum_type, chunk / 2, madd,
+                                       {slice_vector(va, i, chunk), slice_vector(vb, i, chunk)}));
+        }
+        partial = concat_vectors(sums);
+    } else if (op->op == VectorReduce::Add && factor % 8 == 0 &&
+        cast && cast->value.type().is_uint() && cast->value.type().bits == 8 &&
+        !op->type.is_float() && op->type.bits >= 16 && input_width % 16 == 0) {
+        // psadbw sums the absolute differences of groups of eight
+        // bytes into 64-bit lanes. Against zero, that's a sum of
+        // each group of eight bytes.
+        const int chunk = (target.has_feature(Target::AVX2) && input_width % 32 == 0) ? 32 : 16;
+        const string intrin = chunk == 32 ? "llvm.x86.avx2.psad.bw" : "llvm.x86.sse2.psad.bw";
+        Value *bytes = codegen(cast->value);
+        Value *zero = Constant::getNullValue(VectorType::get(i8, chunk));
+        llvm::Type *sum_type = VectorType::get(i64, chunk / 8);
+        vector<Value *> sums;
+        for (int i = 0; i < input_width; i += chunk) {
+            sums.push_back(call_intrin(sum_type, chunk / 8, intrin, {slice_vector(bytes, i, chunk), zero}));
+        }
+        partial = concat_vectors(sums);
+        partial_type = UInt(64, input_width / 8);
+    } else if (op->op == VectorReduce::Add && factor % 2 == 0 &&
+               target.has_feature(Target::SSE41) &&
+               !op->type.is_float() && (op->type.bits == 16 || op->type.bits == 32) &&
+               (input_width * op->type.bits) % 256 == 0) {
+        // phaddw and phaddd add adjacent pairs of lanes of two
+        // vectors.
+        const int lanes = 128 / op->type.bits;
+        const string intrin = op->type.bits == 16 ? "llvm.x86.ssse3.phadd.w.128" : "llvm.x86.ssse3.phadd.d.128";
+        Value *v = codegen(op->value);
+        llvm::Type *result_type = llvm_type_of(op->type.element_of().vector_of(lanes));
+        vector<Value *> sums;
+        for (int i = 0; i < input_width; i += lanes * 2) {
+            sums.push_back(call_intrin(result_type, lanes, intrin,
+                                       {slice_vector(v, i, lanes), slice_vector(v, i + lanes, lanes)}));
+        }
+        partial = concat_vectors(sums);
+        partial_type = op->type.element_of().vector_of(input_width / 2);
+    }
+
+    if (!partial) {
+        CodeGen_Posix::codegen_vector_reduce(op, init);
+        return;
+    }
+
+    finish_vector_reduce(op, partial_type, partial, init);
+}
+
 string CodeGen_X86::mcpu() const {
     if (target.has_feature(Target::AVX)) return "corei7-avx";
     // We want SSE4.1 but not SSE4.2, hence "penryn" rather than "corei7"
@@ -625,6 +848,10 @@ string CodeGen_X86::mcpu() const {
 string CodeGen_X86::mattrs() const {
     std::string features;
     std::string separator;
+    if (target.has_feature(Target::AVX2)) {
+        features += "+avx2";
+        separator = ",";
+    }
     #if LLVM_VERSION >= 35
     // These attrs only exist in llvm 3.5+
     if (target.has_feature(Target::FMA)) {
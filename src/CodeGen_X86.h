@@ -46,7 +46,12 @@ protected:
     void visit(const EQ *);
     void visit(const NE *);
     void visit(const Select *);
+    void visit(const Load *);
+    void visit(const Call *);
     // @}
+
+    /** Horizontal adds that have sse/avx instructions */
+    void codegen_vector_reduce(const VectorReduce *, Expr init);
 };
 
 }}
@@ -0,0 +1,239 @@
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#include "CompileProfiler.h"
+#include "IRVisitor.h"
+#include "LLVM_Headers.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+
+namespace {
+
+enum ReportFormat {
+    NoReport,
+    TextReport,
+    JSONReport
+};
+
+string get_env(const char *name) {
+    #ifdef _WIN32
+    char buf[1024];
+    size_t read = 0;
+    getenv_s(&read, buf, name);
+    if (read) return string(buf);
+    #else
+    if (char *buf = getenv(name)) return string(buf);
+    #endif
+    return "";
+}
+
+ReportFormat report_format() {
+    static ReportFormat format = NoReport;
+    static bool initialized = false;
+    if (!initialized) {
+        string f = get_env("HL_COMPILE_PROFILE");
+        if (f == "json") {
+            format = JSONReport;
+        } else if (!f.empty() && f != "0") {
+            format = TextReport;
+        }
+        initialized = true;
+    }
+    return format;
+}
+
+// Count the distinct IR nodes in a Stmt.
+class CountNodes : public IRGraphVisitor {
+public:
+    int64_t count;
+    CountNodes() : count(0) {}
+
+protected:
+    using IRGraphVisitor::include;
+
+    void include(const Expr &e) {
+        if (!visited.count(e.ptr)) count++;
+        IRGraphVisitor::include(e);
+    }
+
+    void include(const Stmt &s) {
+        if (!visited.count(s.ptr)) count++;
+        IRGraphVisitor::include(s);
+    }
+};
+
+int64_t ir_size(Stmt s) {
+    if (!s.defined()) return 0;
+    CountNodes counter;
+    s.accept(&counter);
+    return counter.count;
+}
+
+int64_t ir_size(llvm::Module *m) {
+    if (!m) return 0;
+    int64_t count = 0;
+    for (llvm::Module::iterator f = m->begin(); f != m->end(); f++) {
+        for (llvm::Function::iterator b = f->begin(); b != f->end(); b++) {
+            count += b->size();
+        }
+    }
+    return count;
+}
+
+// The peak resident set size of the process in bytes, or -1 if it
+// isn't known.
+int64_t peak_memory() {
+    #ifdef _WIN32
+    return -1;
+    #else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+    #ifdef __APPLE__
+    return (int64_t)usage.ru_maxrss;
+    #else
+    return (int64_t)usage.ru_maxrss * 1024;
+    #endif
+    #endif
+}
+
+string json_string(const string &s) {
+    std::ostringstream out;
+    out << '"';
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if ((unsigned char)c < 0x20) {
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+    return out.str();
+}
+
+}
+
+bool CompileProfiler::enabled() {
+    return report_format() != NoReport;
+}
+
+CompileProfiler::CompileProfiler(const string &c, const string &n, Stmt s) :
+    category(c), name(n), last_size(0), active(enabled()) {
+    if (!active) return;
+    last_size = ir_size(s);
+    last = Clock::now();
+}
+
+CompileProfiler::CompileProfiler(const string &c, const string &n, llvm::Module *m) :
+    category(c), name(n), last_size(0), active(enabled()) {
+    if (!active) return;
+    last_size = ir_size(m);
+    last = Clock::now();
+}
+
+CompileProfiler::~CompileProfiler() {
+    if (active) report();
+}
+
+void CompileProfiler::phase_done(const string &phase, Stmt s) {
+    if (!active) return;
+    // Don't count the time spent counting the nodes.
+    auto now = Clock::now();
+    int64_t size = ir_size(s);
+    record(phase, now, size);
+}
+
+void CompileProfiler::phase_done(const string &phase, llvm::Module *m) {
+    if (!active) return;
+    auto now = Clock::now();
+    int64_t size = ir_size(m);
+    record(phase, now, size);
+}
+
+void CompileProfiler::phase_done(const string &phase) {
+    if (!active) return;
+    record(phase, Clock::now(), last_size);
+}
+
+void CompileProfiler::record(const string &phase, Clock::time_point now, int64_t size) {
+    Phase p;
+    p.name = phase;
+    p.seconds = std::chrono::duration<double>(now - last).count();
+    p.size_before = last_size;
+    p.size_after = size;
+    p.peak_memory = peak_memory();
+    phases.push_back(p);
+    last_size = size;
+    last = Clock::now();
+}
+
+void CompileProfiler::report() {
+    double total = 0;
+    for (const Phase &p : phases) {
+        total += p.seconds;
+    }
+
+    std::ostringstream out;
+    if (report_format() == JSONReport) {
+        out << "{\"category\": " << json_string(category)
+            << ", \"name\": " << json_string(name)
+            << ", \"seconds\": " << total
+            << ", \"phases\": [";
+        for (size_t i = 0; i < phases.size(); i++) {
+            const Phase &p = phases[i];
+            out << (i > 0 ? ", " : "")
+                << "{\"name\": " << json_string(p.name)
+                << ", \"seconds\": " << p.seconds
+                << ", \"ir_size_before\": " << p.size_before
+                << ", \"ir_size_after\": " << p.size_after
+                << ", \"peak_memory\": " << p.peak_memory << "}";
+        }
+        out << "]}\n";
+    } else {
+        out << "Compile profile for " << category << " " << name
+            << " (" << total * 1000 << " ms total):\n"
+            << std::setw(48) << std::left << "  phase"
+            << std::setw(12) << std::right << "ms"
+            << std::setw(8) << "%"
+            << std::setw(12) << "IR before"
+            << std::setw(12) << "IR after"
+            << std::setw(12) << "peak MB" << "\n";
+        for (const Phase &p : phases) {
+            out << "  " << std::setw(46) << std::left << p.name << std::right << std::fixed
+                << std::setw(12) << std::setprecision(3) << p.seconds * 1000
+                << std::setw(8) << std::setprecision(1) << (total > 0 ? 100 * p.seconds / total : 0)
+                << std::setw(12) << p.size_before
+                << std::setw(12) << p.size_after
+                << std::setw(12) << std::setprecision(1);
+            if (p.peak_memory >= 0) {
+                out << p.peak_memory / (1024.0 * 1024.0);
+            } else {
+                out << "n/a";
+            }
+            out << "\n";
+            out.unsetf(std::ios::fixed);
+        }
+    }
+
+    string filename = get_env("HL_COMPILE_PROFILE_FILE");
+    if (!filename.empty()) {
+        std::ofstream f(filename.c_str(), std::ios::app);
+        f << out.str();
+    } else {
+        std::cerr << out.str();
+    }
+}
+
+}
+}
@@ -0,0 +1,89 @@
+#ifndef HALIDE_COMPILE_PROFILER_H
+#define HALIDE_COMPILE_PROFILER_H
+
+/** \file
+ * Defines a class for reporting how long each phase of compilation
+ * takes, and how much memory it uses.
+ */
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "IR.h"
+
+namespace llvm {
+class Module;
+}
+
+namespace Halide {
+namespace Internal {
+
+/** Records the wall-clock time, IR size, and peak memory use of the
+ * phases of some part of compilation, and reports them when
+ * destroyed. Does nothing unless the environment variable
+ * HL_COMPILE_PROFILE is set to "text" (or "1") for a human-readable
+ * table, or "json" for one JSON object per line. The report goes to
+ * stderr, or is appended to the file named by HL_COMPILE_PROFILE_FILE
+ * if it is set.
+ *
+ * Use it by constructing one at the start of the work, and calling
+ * phase_done after each phase:
+ \code
+ CompileProfiler profiler("lower", pipeline_name, s);
+ s = simplify(s);
+ profiler.phase_done("simplify", s);
+ \endcode
+ *
+ * The time of each phase is measured from the previous call to
+ * phase_done, or from construction. The IR size of a Stmt is the
+ * number of distinct IR nodes in it, and the size of an llvm::Module
+ * is its number of instructions. The memory is the peak resident set
+ * size of the process so far, which only grows, so the phase that
+ * increased it is the one to look at.
+ */
+class CompileProfiler {
+public:
+    /** Start profiling. The category names the part of compilation
+     * being profiled (e.g. "lower"), and the name identifies what is
+     * being compiled. */
+    // @{
+    CompileProfiler(const std::string &category, const std::string &name, Stmt s = Stmt());
+    CompileProfiler(const std::string &category, const std::string &name, llvm::Module *m);
+    // @}
+
+    ~CompileProfiler();
+
+    /** Mark the end of a phase, recording the size of the IR it produced. */
+    // @{
+    void phase_done(const std::string &phase, Stmt s);
+    void phase_done(const std::string &phase, llvm::Module *m);
+    void phase_done(const std::string &phase);
+    // @}
+
+    /** Check if HL_COMPILE_PROFILE requests a report. */
+    static bool enabled();
+
+private:
+    struct Phase {
+        std::string name;
+        double seconds;
+        int64_t size_before, size_after;
+        int64_t peak_memory;
+    };
+
+    std::string category, name;
+    std::vector<Phase> phases;
+    typedef std::chrono::high_resolution_clock Clock;
+    Clock::time_point last;
+    int64_t last_size;
+    bool active;
+
+    void record(const std::string &phase, Clock::time_point now, int64_t size);
+    void report();
+};
+
+}
+}
+
+#endif
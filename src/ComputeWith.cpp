@@ -0,0 +1,388 @@
+#include "ComputeWith.h"
+#include "Debug.h"
+#include "FindCalls.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Scope.h"
+#include "Simplify.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace {
+
+typedef vector<pair<string, Expr>> LetList;
+
+Stmt wrap_lets(Stmt s, const LetList &lets) {
+    for (size_t i = lets.size(); i > 0; i--) {
+        s = LetStmt::make(lets[i-1].first, lets[i-1].second, s);
+    }
+    return s;
+}
+
+// Find the outermost loop of a stage in the produce side of its
+// pipeline, looking through the lets that define its bounds and any
+// calls (e.g. to the profiler) next to it. Records the loop and the
+// lets that enclose it, and returns the produce side with the loop
+// replaced by replacement, if it's defined.
+Stmt replace_loop_nest(Stmt s, const string &prefix, Stmt replacement,
+                       const For **loop, LetList *lets) {
+    if (const For *op = s.as<For>()) {
+        if (starts_with(op->name, prefix)) {
+            *loop = op;
+            return replacement.defined() ? replacement : s;
+        }
+    } else if (const LetStmt *op = s.as<LetStmt>()) {
+        lets->push_back(std::make_pair(op->name, op->value));
+        Stmt body = replace_loop_nest(op->body, prefix, replacement, loop, lets);
+        return LetStmt::make(op->name, op->value, body);
+    } else if (const Block *op = s.as<Block>()) {
+        if (op->first.as<Evaluate>()) {
+            Stmt rest = replace_loop_nest(op->rest, prefix, replacement, loop, lets);
+            return Block::make(op->first, rest);
+        } else if (op->rest.defined() && op->rest.as<Evaluate>()) {
+            Stmt first = replace_loop_nest(op->first, prefix, replacement, loop, lets);
+            return Block::make(first, op->rest);
+        }
+    }
+    return s;
+}
+
+// Walk down from the consume side of the pipeline of one of the fused
+// functions to the pipeline of the other, which must be at the same
+// loop level. The lets and realizations on the way are removed and
+// pushed onto lifted, so that they can be moved outside both
+// pipelines. The names of the functions produced on the way are pushed
+// onto between. The loop nest of the other function is removed from
+// its produce side, which keeps the lets that define the loop bounds.
+// Returns an undefined Stmt if the other pipeline can't be reached.
+Stmt extract_production(Stmt s, const string &name, vector<Stmt> *lifted,
+                        vector<string> *between, const For **loop, LetList *loop_lets) {
+    if (const LetStmt *op = s.as<LetStmt>()) {
+        lifted->push_back(s);
+        return extract_production(op->body, name, lifted, between, loop, loop_lets);
+    } else if (const Realize *op = s.as<Realize>()) {
+        lifted->push_back(s);
+        return extract_production(op->body, name, lifted, between, loop, loop_lets);
+    } else if (const ProducerConsumer *op = s.as<ProducerConsumer>()) {
+        if (op->name == name) {
+            Stmt produce = replace_loop_nest(op->produce, name + ".s0.", Evaluate::make(0),
+                                             loop, loop_lets);
+            if (!*loop) return Stmt();
+            return ProducerConsumer::make(op->name, produce, op->update, op->consume);
+        } else {
+            between->push_back(op->name);
+            Stmt consume = extract_production(op->consume, name, lifted, between, loop, loop_lets);
+            if (!consume.defined()) return Stmt();
+            return ProducerConsumer::make(op->name, op->produce, op->update, consume);
+        }
+    } else if (const Block *op = s.as<Block>()) {
+        if (op->first.as<Evaluate>()) {
+            Stmt rest = extract_production(op->rest, name, lifted, between, loop, loop_lets);
+            if (!rest.defined()) return Stmt();
+            return Block::make(op->first, rest);
+        } else if (op->rest.defined() && op->rest.as<Evaluate>()) {
+            Stmt first = extract_production(op->first, name, lifted, between, loop, loop_lets);
+            if (!first.defined()) return Stmt();
+            return Block::make(first, op->rest);
+        }
+    }
+    return Stmt();
+}
+
+// Replace the variables defined by bounds inference with their
+// values, so that the bounds of two loops can be compared.
+class ExpandBounds : public IRMutator {
+    const Scope<Expr> &lets;
+    map<string, Expr> cache;
+
+    using IRMutator::visit;
+
+    void visit(const Variable *op) {
+        if (!lets.contains(op->name) ||
+            !(ends_with(op->name, ".min") || ends_with(op->name, ".max") ||
+              ends_with(op->name, ".loop_min") || ends_with(op->name, ".loop_max") ||
+              ends_with(op->name, ".loop_extent"))) {
+            expr = op;
+            return;
+        }
+        map<string, Expr>::iterator iter = cache.find(op->name);
+        if (iter != cache.end()) {
+            expr = iter->second;
+        } else {
+            expr = mutate(lets.get(op->name));
+            cache[op->name] = expr;
+        }
+    }
+
+public:
+    ExpandBounds(const Scope<Expr> &l) : lets(l) {}
+};
+
+// Merges the pipelines of two functions computed at the same loop
+// level, so that the outer loops of the first one produced (the
+// host) also run the loops of the other one (the guest).
+class FuseLoopNests : public IRMutator {
+    const string &a, &b, &var;
+    const map<string, Function> &env;
+
+    // The lets that enclose the loops being fused.
+    Scope<Expr> lets;
+
+    using IRMutator::visit;
+
+    void push_lets(const LetList &l) {
+        for (const pair<string, Expr> &i : l) {
+            lets.push(i.first, i.second);
+        }
+    }
+
+    void pop_lets(const LetList &l) {
+        for (size_t i = l.size(); i > 0; i--) {
+            lets.pop(l[i-1].first);
+        }
+    }
+
+    // Do two loops run over the same range? Checked before fusing, so
+    // that no guards are needed in the common case.
+    bool same_bounds(const For *h, const For *g) {
+        ExpandBounds expand(lets);
+        Expr h_min = simplify(expand.mutate(h->min)), g_min = simplify(expand.mutate(g->min));
+        Expr h_extent = simplify(expand.mutate(h->extent)), g_extent = simplify(expand.mutate(g->extent));
+        return equal(h_min, g_min) && equal(h_extent, g_extent);
+    }
+
+    // Fuse two loops with the same variable, and the loops within
+    // them down to the loop over var. The fused loop runs over the
+    // union of the two loops, and each body is guarded by the
+    // conditions under which its original loops would have run.
+    Stmt fuse_loops(const For *h, const For *g, Expr h_cond, Expr g_cond) {
+        const string h_prefix = host + ".s0.", g_prefix = guest + ".s0.";
+        string h_var = h->name.substr(h_prefix.size());
+        string g_var = g->name.substr(g_prefix.size());
+        user_assert(h_var == g_var)
+            << "Can't compute " << a << " with " << b << " at " << var
+            << " because their loop nests differ: one has a loop over " << h_var
+            << " where the other has a loop over " << g_var << "\n";
+        user_assert(h->for_type == g->for_type)
+            << "Can't compute " << a << " with " << b << " at " << var
+            << " because their loops over " << h_var << " are of different types.\n";
+        user_assert(h->for_type != ForType::Vectorized && h->for_type != ForType::Unrolled)
+            << "Can't compute " << a << " with " << b << " at " << var
+            << " because the loops over " << h_var << " are vectorized or unrolled.\n";
+        user_assert(h->device_api == g->device_api &&
+                    (h->device_api == DeviceAPI::Host || h->device_api == DeviceAPI::Parent))
+            << "Can't compute " << a << " with " << b << " at " << var
+            << " because the loops over " << h_var << " aren't both on the host.\n";
+
+        Expr loop_var = Variable::make(Int(32), h->name);
+        Expr min = h->min, extent = h->extent;
+        if (!same_bounds(h, g)) {
+            Expr h_max = h->min + h->extent - 1;
+            Expr g_max = g->min + g->extent - 1;
+            h_cond = h_cond && loop_var >= h->min && loop_var <= h_max;
+            g_cond = g_cond && loop_var >= g->min && loop_var <= g_max;
+            min = Min::make(h->min, g->min);
+            extent = Max::make(h_max, g_max) + 1 - min;
+        }
+
+        Stmt body;
+        if (h_var == var) {
+            Stmt h_body = h->body;
+            Stmt g_body = LetStmt::make(g->name, loop_var, g->body);
+            if (!is_one(h_cond)) {
+                h_body = IfThenElse::make(h_cond, h_body);
+            }
+            if (!is_one(g_cond)) {
+                g_body = IfThenElse::make(g_cond, g_body);
+            }
+            body = Block::make(h_body, g_body);
+        } else {
+            LetList h_lets, g_lets;
+            Stmt h_inner = h->body, g_inner = g->body;
+            while (const LetStmt *l = h_inner.as<LetStmt>()) {
+                h_lets.push_back(std::make_pair(l->name, l->value));
+                h_inner = l->body;
+            }
+            while (const LetStmt *l = g_inner.as<LetStmt>()) {
+                g_lets.push_back(std::make_pair(l->name, l->value));
+                g_inner = l->body;
+            }
+            const For *h_loop = h_inner.as<For>(), *g_loop = g_inner.as<For>();
+            user_assert(h_loop && g_loop &&
+                        starts_with(h_loop->name, h_prefix) &&
+                        starts_with(g_loop->name, g_prefix))
+                << "Can't compute " << a << " with " << b << " at " << var
+                << " because there's no loop over " << var << " in both of their loop nests.\n";
+            push_lets(h_lets);
+            push_lets(g_lets);
+            body = fuse_loops(h_loop, g_loop, h_cond, g_cond);
+            pop_lets(g_lets);
+            pop_lets(h_lets);
+            body = wrap_lets(body, g_lets);
+            body = LetStmt::make(g->name, loop_var, body);
+            body = wrap_lets(body, h_lets);
+        }
+
+        return For::make(h->name, min, extent, h->for_type, h->device_api, body);
+    }
+
+    void visit(const LetStmt *op) {
+        lets.push(op->name, op->value);
+        IRMutator::visit(op);
+        lets.pop(op->name);
+    }
+
+    void visit(const ProducerConsumer *op) {
+        if (op->name != a && op->name != b) {
+            IRMutator::visit(op);
+            return;
+        }
+
+        host = op->name;
+        guest = (host == a) ? b : a;
+        debug(3) << "Fusing the loop nest of " << guest << " into that of " << host << "\n";
+
+        vector<Stmt> lifted;
+        vector<string> between;
+        const For *guest_loop = NULL;
+        LetList guest_lets;
+        Stmt consume = extract_production(op->consume, guest, &lifted, &between,
+                                          &guest_loop, &guest_lets);
+        user_assert(consume.defined())
+            << "Can't compute " << a << " with " << b
+            << " because they aren't computed at the same loop level.\n";
+
+        // The guest is about to be computed before everything
+        // realized or produced between the two, so it can't use any
+        // of it.
+        for (Stmt l : lifted) {
+            if (const Realize *r = l.as<Realize>()) {
+                between.push_back(r->name);
+            }
+        }
+        map<string, Function>::const_iterator guest_func = env.find(guest);
+        internal_assert(guest_func != env.end());
+        map<string, Function> guest_calls = find_transitive_calls(guest_func->second);
+        for (const string &name : between) {
+            user_assert(name == guest || !guest_calls.count(name))
+                << "Can't compute " << a << " with " << b
+                << " because " << guest << " uses " << name
+                << ", which is computed between them.\n";
+        }
+
+        const For *host_loop = NULL;
+        LetList host_lets;
+        replace_loop_nest(op->produce, host + ".s0.", Stmt(), &host_loop, &host_lets);
+        internal_assert(host_loop) << "Could not find the loop nest of " << host << "\n";
+
+        // The lets between the two pipelines end up outside both,
+        // and those defining the bounds of the guest's loops end up
+        // just outside the fused loop.
+        LetList lifted_lets;
+        for (Stmt l : lifted) {
+            if (const LetStmt *let = l.as<LetStmt>()) {
+                lifted_lets.push_back(std::make_pair(let->name, let->value));
+            }
+        }
+        push_lets(lifted_lets);
+        push_lets(host_lets);
+        push_lets(guest_lets);
+        Stmt fused = fuse_loops(host_loop, guest_loop, const_true(), const_true());
+        pop_lets(guest_lets);
+        pop_lets(host_lets);
+        pop_lets(lifted_lets);
+        fused = wrap_lets(fused, guest_lets);
+        host_lets.clear();
+        Stmt produce = replace_loop_nest(op->produce, host + ".s0.", fused, &host_loop, &host_lets);
+
+        stmt = ProducerConsumer::make(op->name, produce, op->update, consume);
+
+        // The realizations of the guest and anything else produced
+        // in between now need to enclose the host.
+        for (size_t i = lifted.size(); i > 0; i--) {
+            if (const LetStmt *l = lifted[i-1].as<LetStmt>()) {
+                stmt = LetStmt::make(l->name, l->value, stmt);
+            } else {
+                const Realize *r = lifted[i-1].as<Realize>();
+                internal_assert(r);
+                stmt = Realize::make(r->name, r->types, r->bounds, r->condition, stmt);
+            }
+        }
+        found = true;
+    }
+
+public:
+    string host, guest;
+    bool found;
+
+    FuseLoopNests(const string &a, const string &b, const string &var,
+                  const map<string, Function> &env) :
+        a(a), b(b), var(var), env(env), found(false) {}
+};
+
+void validate_fusion(Function f, Function g) {
+    for (Function h : {f, g}) {
+        const Schedule &s = h.schedule();
+        user_assert(!s.compute_level().is_inline())
+            << "Can't compute " << f.name() << " with " << g.name()
+            << " because " << h.name() << " is computed inline.\n";
+        user_assert(!h.has_update_definition() && !h.has_extern_definition())
+            << "Can't compute " << f.name() << " with " << g.name()
+            << " because " << h.name() << " has an update or extern definition.\n";
+        user_assert(s.specializations().empty() && !s.memoized())
+            << "Can't compute " << f.name() << " with " << g.name()
+            << " because " << h.name() << " is specialized or memoized.\n";
+    }
+    user_assert(f.schedule().compute_level() == g.schedule().compute_level())
+        << "Can't compute " << f.name() << " with " << g.name()
+        << " because they are computed at different loop levels.\n";
+    user_assert(!find_transitive_calls(f).count(g.name()) &&
+                !find_transitive_calls(g).count(f.name()))
+        << "Can't compute " << f.name() << " with " << g.name()
+        << " because one depends on the other.\n";
+}
+
+}
+
+Stmt fuse_compute_with(Stmt s, const map<string, Function> &env) {
+    // Functions whose loop nests have been moved into the loop nest
+    // of another function.
+    map<string, string> fused_into;
+
+    for (const auto &i : env) {
+        Function f = i.second;
+        const LoopLevel &level = f.schedule().compute_with_level();
+        if (level.is_inline()) continue;
+
+        map<string, Function>::const_iterator iter = env.find(level.func);
+        user_assert(iter != env.end())
+            << "Func " << f.name() << " is scheduled to be computed with "
+            << level.func << ", which isn't used by the same pipeline.\n";
+        Function g = iter->second;
+        validate_fusion(f, g);
+
+        string a = f.name(), b = g.name();
+        while (fused_into.count(a)) a = fused_into[a];
+        while (fused_into.count(b)) b = fused_into[b];
+        user_assert(a != b)
+            << "Can't compute " << f.name() << " with " << g.name()
+            << " because they are already in the same loop nest.\n";
+
+        FuseLoopNests fuser(a, b, level.var, env);
+        s = fuser.mutate(s);
+        internal_assert(fuser.found) << "Could not find the pipelines of " << a << " and " << b << "\n";
+        fused_into[fuser.guest] = fuser.host;
+    }
+
+    return s;
+}
+
+}
+}
@@ -0,0 +1,26 @@
+#ifndef HALIDE_COMPUTE_WITH_H
+#define HALIDE_COMPUTE_WITH_H
+
+/** \file
+ *
+ * Defines the lowering pass that fuses the loop nests of functions
+ * scheduled with compute_with.
+ */
+
+#include <map>
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Merge the loop nest of each function scheduled with
+ * Func::compute_with into the loop nest of the function it is fused
+ * with. Must be run after allocation bounds inference, and before
+ * storage flattening. */
+Stmt fuse_compute_with(Stmt s, const std::map<std::string, Function> &env);
+
+}
+}
+
+#endif
@@ -1,6 +1,9 @@
+#include <set>
+
 #include "Deinterleave.h"
 #include "BlockFlattening.h"
 #include "Debug.h"
+#include "ExprUsesVar.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "IREquality.h"
@@ -8,6 +11,7 @@
 #include "ModulusRemainder.h"
 #include "Scope.h"
 #include "Simplify.h"
+#include "Substitute.h"
 
 namespace Halide {
 namespace Internal {
@@ -275,6 +279,12 @@ private:
                 args.push_back(op->args[idx]);
             }
             expr = Call::make(t, Call::shuffle_vector, args, Call::Intrinsic);
+        } else if (op->name == Call::dynamic_shuffle &&
+                   op->call_type == Call::Intrinsic) {
+            // The table is shared by all the lanes. Just deinterleave
+            // the indices.
+            internal_assert(op->args.size() == 2);
+            expr = Call::make(t, Call::dynamic_shuffle, {op->args[0], mutate(op->args[1])}, Call::Intrinsic);
         } else if (op->name == Call::glsl_texture_load &&
                    op->call_type == Call::Intrinsic) {
             // glsl_texture_load returns a <uint x 4> result. Deinterleave by
@@ -291,8 +301,8 @@ private:
             // can just deinterleave the args.
 
             // Beware of other intrinsics for which this is not true!
-            // Currently there's only interleave_vectors and
-            // shuffle_vector.
+            // Currently there's only interleave_vectors,
+            // shuffle_vector, and dynamic_shuffle.
 
             std::vector<Expr> args(op->args.size());
             for (size_t i = 0; i < args.size(); i++) {
@@ -304,6 +314,28 @@ private:
         }
     }
 
+    void visit(const VectorReduce *op) {
+        if (op->type.is_scalar()) {
+            expr = op;
+        } else {
+            // Gather the groups of lanes that reduce to the lanes
+            // we want, and reduce those.
+            int factor = op->value.type().width / op->width;
+            std::vector<Expr> args;
+            args.push_back(op->value);
+            for (int i = 0; i < new_width; i++) {
+                int lane = starting_lane + lane_stride * i;
+                for (int j = 0; j < factor; j++) {
+                    args.push_back(lane * factor + j);
+                }
+            }
+            Type t = op->value.type();
+            t.width = new_width * factor;
+            Expr value = Call::make(t, Call::shuffle_vector, args, Call::Intrinsic);
+            expr = VectorReduce::make(op->op, value, new_width);
+        }
+    }
+
     void visit(const Let *op) {
         if (op->type.is_vector()) {
             Expr new_value = mutate(op->value);
@@ -377,6 +409,43 @@ Expr extract_lane(Expr e, int lane) {
     return simplify(e);
 }
 
+// Check if a loop body is a sequence of stores that interleave over
+// the loop variable, i.e. each store writes a vector with the same
+// stride as the loop extent, and the next iteration writes the
+// elements just after it. The stores of an unrolled loop like this
+// can be collapsed into dense interleaving stores.
+class StoresInterleaveOverLoop : public IRVisitor {
+    const std::string &loop_var;
+    const int extent;
+
+    using IRVisitor::visit;
+
+    void visit(const For *op) {result = false;}
+    void visit(const IfThenElse *op) {result = false;}
+    void visit(const ProducerConsumer *op) {result = false;}
+    void visit(const Allocate *op) {result = false;}
+
+    void visit(const Store *op) {
+        const Ramp *r = op->index.as<Ramp>();
+        if (!r || !is_const(r->stride, extent)) {
+            result = false;
+            return;
+        }
+        Expr next_base = substitute(loop_var, Variable::make(Int(32), loop_var) + 1, r->base);
+        if (!is_one(simplify(next_base - r->base))) {
+            result = false;
+            return;
+        }
+        stores++;
+    }
+
+public:
+    bool result;
+    int stores;
+    StoresInterleaveOverLoop(const std::string &v, int e) :
+        loop_var(v), extent(e), result(true), stores(0) {}
+};
+
 class Interleaver : public IRMutator {
     Scope<ModulusRemainder> alignment_info;
 
@@ -527,6 +596,29 @@ class Interleaver : public IRMutator {
         num_lanes = old_num_lanes;
     }
 
+    void visit(const For *op) {
+        // A short serial loop over the channels of an interleaved
+        // output (e.g. the c in f(x, y, c), with c innermost and x
+        // vectorized) would produce a strided store per channel. If
+        // the channel loop wasn't unrolled, unroll it here so that
+        // the stores can be collapsed into interleaving stores.
+        const int *extent = as_const_int(op->extent);
+        if (op->for_type == ForType::Serial && extent && *extent >= 2 && *extent <= 4) {
+            StoresInterleaveOverLoop check(op->name, *extent);
+            op->body.accept(&check);
+            if (check.result && check.stores > 0) {
+                Stmt body;
+                for (int i = *extent - 1; i >= 0; i--) {
+                    Stmt iter = substitute(op->name, simplify(op->min + i), op->body);
+                    body = body.defined() ? Block::make(iter, body) : iter;
+                }
+                stmt = mutate(flatten_blocks(body));
+                return;
+            }
+        }
+        IRMutator::visit(op);
+    }
+
     void visit(const Block *op) {
         const LetStmt *let = op->first.as<LetStmt>();
         const Store *store = op->first.as<Store>();
@@ -685,9 +777,425 @@ class Interleaver : public IRMutator {
     Interleaver() : should_deinterleave(false) {}
 };
 
+namespace {
+
+// A vector load or store of a ramp, which might be one column of a
+// tile that is transposed between memory and registers.
+struct TileAccess {
+    std::string name;
+    Type type;
+    const Ramp *ramp;
+};
+
+// Find sets of N accesses of width N (4, 8, or 16) to the same buffer
+// with the same non-unit stride, whose bases are consecutive, i.e. the
+// columns of an N x N tile. Each group found lists its members in
+// order of their bases.
+std::vector<std::vector<int>> find_tiles(const std::vector<TileAccess> &accesses) {
+    std::vector<std::vector<int>> tiles;
+    std::vector<bool> used(accesses.size(), false);
+    for (size_t i = 0; i < accesses.size(); i++) {
+        const TileAccess &a = accesses[i];
+        const int n = a.ramp->width;
+        if (used[i] || (n != 4 && n != 8 && n != 16) ||
+            (a.type.bits != 8 && a.type.bits != 16 && a.type.bits != 32) ||
+            is_one(a.ramp->stride)) {
+            continue;
+        }
+        std::vector<int> tile(n, -1);
+        tile[0] = (int)i;
+        int found = 1;
+        for (size_t j = 0; j < accesses.size() && found < n; j++) {
+            const TileAccess &b = accesses[j];
+            if (used[j] || j == i || b.name != a.name || b.type != a.type ||
+                b.ramp->width != n || !equal(b.ramp->stride, a.ramp->stride)) {
+                continue;
+            }
+            const int *offset = as_const_int(simplify(b.ramp->base - a.ramp->base));
+            if (offset && *offset > 0 && *offset < n && tile[*offset] < 0) {
+                tile[*offset] = (int)j;
+                found++;
+            }
+        }
+        if (found == n) {
+            for (int j : tile) {
+                used[j] = true;
+            }
+            tiles.push_back(tile);
+        }
+    }
+    return tiles;
+}
+
+// Interleaving N vectors of N lanes transposes them: lane j*N + i of
+// the result is lane j of the ith vector. Codegen implements
+// interleave_vectors as a log2(N) deep network of two-way shuffles,
+// which is the usual unpack-based register transpose.
+Expr transpose_tile(const std::vector<Expr> &vecs) {
+    Type t = vecs[0].type();
+    t.width *= vecs.size();
+    return Call::make(t, Call::interleave_vectors, vecs, Call::Intrinsic);
+}
+
+// Extract row i of a transposed N x N tile.
+Expr tile_row(Expr tile, int i, int n) {
+    std::vector<Expr> args;
+    args.push_back(tile);
+    for (int j = 0; j < n; j++) {
+        args.push_back(i*n + j);
+    }
+    return Call::make(tile.type().element_of().vector_of(n), Call::shuffle_vector, args, Call::Intrinsic);
+}
+
+// Collect the distinct strided vector loads in an expression whose
+// indices don't depend on any of the given lets, or on lets inside
+// the expression.
+class CollectStridedLoads : public IRVisitor {
+    Scope<int> inner_lets;
+    const Scope<int> &outer_lets;
+
+    using IRVisitor::visit;
+
+    void visit(const Let *op) {
+        op->value.accept(this);
+        inner_lets.push(op->name, 0);
+        op->body.accept(this);
+        inner_lets.pop(op->name);
+    }
+
+    void visit(const Load *op) {
+        IRVisitor::visit(op);
+        const Ramp *r = op->index.as<Ramp>();
+        if (!r || is_one(r->stride) ||
+            expr_uses_vars(op->index, inner_lets) ||
+            expr_uses_vars(op->index, outer_lets)) {
+            return;
+        }
+        for (Expr l : loads) {
+            if (equal(l, op)) {
+                return;
+            }
+        }
+        loads.push_back(op);
+    }
+
+public:
+    std::vector<Expr> loads;
+    CollectStridedLoads(const Scope<int> &lets) : outer_lets(lets) {}
+};
+
+// Check if an expression loads from any of a set of buffers.
+class LoadsFrom : public IRVisitor {
+    const std::set<std::string> &buffers;
+
+    using IRVisitor::visit;
+
+    void visit(const Load *op) {
+        IRVisitor::visit(op);
+        result = result || buffers.count(op->name);
+    }
+
+public:
+    bool result;
+    LoadsFrom(const std::set<std::string> &b) : buffers(b), result(false) {}
+};
+
+// Replace some loads with other expressions.
+class ReplaceLoads : public IRMutator {
+    const std::vector<pair<Expr, Expr>> &replacements;
+
+    using IRMutator::visit;
+
+    void visit(const Load *op) {
+        for (const pair<Expr, Expr> &r : replacements) {
+            if (equal(r.first, op)) {
+                expr = r.second;
+                return;
+            }
+        }
+        IRMutator::visit(op);
+    }
+
+public:
+    ReplaceLoads(const std::vector<pair<Expr, Expr>> &r) : replacements(r) {}
+};
+
+// Find tiles that are transposed between memory and registers in
+// straight-line sequences of vector stores (typically the unrolled
+// iterations of a tiled loop), and do the transpose in registers
+// instead. An N x N tile read with N strided loads of its columns is
+// read with N dense loads of its rows and transposed with
+// shuffles. Similarly, a tile written with N strided stores of its
+// columns is transposed with shuffles and written with N dense stores
+// of its rows.
+class TransposeTiles : public IRMutator {
+    using IRMutator::visit;
+
+    // A store in a sequence of stores, and the lets that wrap just it.
+    struct Element {
+        std::vector<pair<std::string, Expr>> lets;
+        std::string name;
+        Expr value, index;
+
+        // If set, the store has been replaced with this.
+        bool replaced;
+        Stmt replacement;
+    };
+
+    void visit(const For *op) {
+        // Leave loops that run on a GPU alone.
+        if (op->device_api != DeviceAPI::Parent &&
+            op->device_api != DeviceAPI::Host) {
+            stmt = op;
+            return;
+        }
+        IRMutator::visit(op);
+    }
+
+    // Transpose the tiles in a sequence of stores. Returns an
+    // undefined Stmt if there were none.
+    Stmt transpose_tiles(std::vector<Element> run) {
+        std::set<std::string> stored;
+        for (const Element &e : run) {
+            stored.insert(e.name);
+        }
+
+        // The transposed tiles. These are computed before all of the
+        // stores.
+        std::vector<pair<std::string, Expr>> tiles;
+
+        // Tiles read with strided loads. These can't be from a buffer
+        // that the stores write to.
+        {
+            std::vector<TileAccess> accesses;
+            std::vector<pair<Expr, Expr>> replacements;
+            for (const Element &e : run) {
+                Scope<int> lets;
+                for (const pair<std::string, Expr> &l : e.lets) {
+                    lets.push(l.first, 0);
+                }
+                CollectStridedLoads collect(lets);
+                e.value.accept(&collect);
+                for (Expr l : collect.loads) {
+                    const Load *load = l.as<Load>();
+                    if (!stored.count(load->name)) {
+                        accesses.push_back({load->name, load->type, load->index.as<Ramp>()});
+                        replacements.push_back(make_pair(l, Expr()));
+                    }
+                }
+            }
+
+            for (const std::vector<int> &tile : find_tiles(accesses)) {
+                const int n = (int)tile.size();
+                const Load *column = replacements[tile[0]].first.as<Load>();
+                const Ramp *r = column->index.as<Ramp>();
+                std::vector<Expr> rows;
+                for (int i = 0; i < n; i++) {
+                    Expr row_index = Ramp::make(simplify(r->base + i * r->stride), 1, n);
+                    rows.push_back(Load::make(column->type, column->name, row_index,
+                                              column->image, column->param));
+                }
+                debug(3) << "Transposing a " << n << "x" << n << " tile loaded from " << column->name << "\n";
+                Expr transposed = transpose_tile(rows);
+                std::string name = unique_name('t');
+                tiles.push_back(make_pair(name, transposed));
+                Expr var = Variable::make(transposed.type(), name);
+                for (int i = 0; i < n; i++) {
+                    replacements[tile[i]].second = tile_row(var, i, n);
+                }
+            }
+
+            // Drop the loads that aren't part of any tile.
+            std::vector<pair<Expr, Expr>> used;
+            for (const pair<Expr, Expr> &r : replacements) {
+                if (r.second.defined()) {
+                    used.push_back(r);
+                }
+            }
+            if (!used.empty()) {
+                ReplaceLoads replace(used);
+                for (Element &e : run) {
+                    e.value = replace.mutate(e.value);
+                }
+            }
+        }
+
+        // Tiles written with strided stores. The values stored are
+        // computed before any of the stores, so they can't depend on
+        // any of them, or on lets that wrap just one store.
+        {
+            std::vector<TileAccess> accesses;
+            std::vector<int> elements;
+            for (size_t i = 0; i < run.size(); i++) {
+                const Element &e = run[i];
+                const Ramp *r = e.index.as<Ramp>();
+                if (!r) continue;
+
+                Scope<int> lets;
+                for (const pair<std::string, Expr> &l : e.lets) {
+                    lets.push(l.first, 0);
+                }
+                LoadsFrom loads_stored(stored);
+                e.value.accept(&loads_stored);
+                if (loads_stored.result ||
+                    expr_uses_vars(e.value, lets) ||
+                    expr_uses_vars(e.index, lets)) {
+                    continue;
+                }
+                accesses.push_back({e.name, e.value.type(), r});
+                elements.push_back((int)i);
+            }
+
+            for (const std::vector<int> &tile : find_tiles(accesses)) {
+                const int n = (int)tile.size();
+                const TileAccess &column = accesses[tile[0]];
+
+                // The rows are all stored where the last of the
+                // columns was, so there can't be other stores to the
+                // same buffer in between, or other stores that load
+                // from it.
+                std::set<int> members;
+                for (int i : tile) {
+                    members.insert(elements[i]);
+                }
+                int first = *members.begin(), last = *members.rbegin();
+                std::set<std::string> tile_buffer;
+                tile_buffer.insert(column.name);
+                bool interleaved = false;
+                for (int i = first; i <= last && !interleaved; i++) {
+                    if (members.count(i)) continue;
+                    LoadsFrom loads_tile(tile_buffer);
+                    run[i].value.accept(&loads_tile);
+                    run[i].index.accept(&loads_tile);
+                    for (const pair<std::string, Expr> &l : run[i].lets) {
+                        l.second.accept(&loads_tile);
+                    }
+                    interleaved = run[i].name == column.name || loads_tile.result;
+                }
+                if (interleaved) continue;
+
+                std::vector<Expr> columns;
+                for (int i : tile) {
+                    columns.push_back(run[elements[i]].value);
+                }
+                debug(3) << "Transposing a " << n << "x" << n << " tile stored to " << column.name << "\n";
+                Expr transposed = transpose_tile(columns);
+                std::string name = unique_name('t');
+                tiles.push_back(make_pair(name, transposed));
+                Expr var = Variable::make(transposed.type(), name);
+
+                Stmt rows;
+                for (int i = n - 1; i >= 0; i--) {
+                    Expr row_index = Ramp::make(simplify(column.ramp->base + i * column.ramp->stride), 1, n);
+                    Stmt row = Store::make(column.name, tile_row(var, i, n), row_index);
+                    rows = rows.defined() ? Block::make(row, rows) : row;
+                }
+                for (int i : members) {
+                    run[i].replaced = true;
+                }
+                run[last].replacement = rows;
+            }
+        }
+
+        if (tiles.empty()) {
+            return Stmt();
+        }
+
+        Stmt result;
+        for (size_t i = run.size(); i > 0; i--) {
+            const Element &e = run[i-1];
+            Stmt s;
+            if (e.replaced) {
+                s = e.replacement;
+            } else {
+                s = Store::make(e.name, e.value, e.index);
+                for (size_t j = e.lets.size(); j > 0; j--) {
+                    s = LetStmt::make(e.lets[j-1].first, e.lets[j-1].second, s);
+                }
+            }
+            if (s.defined()) {
+                result = result.defined() ? Block::make(s, result) : s;
+            }
+        }
+        for (size_t i = tiles.size(); i > 0; i--) {
+            result = LetStmt::make(tiles[i-1].first, tiles[i-1].second, result);
+        }
+        return result;
+    }
+
+    void visit(const Block *op) {
+        std::vector<Stmt> stmts;
+        Stmt s = op;
+        while (const Block *b = s.as<Block>()) {
+            stmts.push_back(b->first);
+            s = b->rest;
+        }
+        if (s.defined()) {
+            stmts.push_back(s);
+        }
+
+        // Split the block into runs of (possibly let-wrapped) stores,
+        // and everything else.
+        std::vector<Stmt> new_stmts;
+        std::vector<Element> run;
+        std::vector<Stmt> run_stmts;
+        bool changed = false;
+        for (size_t i = 0; i <= stmts.size(); i++) {
+            Element e;
+            e.replaced = false;
+            const Store *store = NULL;
+            if (i < stmts.size()) {
+                Stmt inner = stmts[i];
+                while (const LetStmt *let = inner.as<LetStmt>()) {
+                    e.lets.push_back(make_pair(let->name, let->value));
+                    inner = let->body;
+                }
+                store = inner.as<Store>();
+            }
+            if (store && store->value.type().is_vector()) {
+                e.name = store->name;
+                e.value = store->value;
+                e.index = store->index;
+                run.push_back(e);
+                run_stmts.push_back(stmts[i]);
+                continue;
+            }
+
+            if (!run.empty()) {
+                Stmt transposed = transpose_tiles(run);
+                if (transposed.defined()) {
+                    new_stmts.push_back(transposed);
+                    changed = true;
+                } else {
+                    new_stmts.insert(new_stmts.end(), run_stmts.begin(), run_stmts.end());
+                }
+                run.clear();
+                run_stmts.clear();
+            }
+            if (i < stmts.size()) {
+                Stmt new_stmt = mutate(stmts[i]);
+                changed = changed || !new_stmt.same_as(stmts[i]);
+                new_stmts.push_back(new_stmt);
+            }
+        }
+
+        if (!changed) {
+            stmt = op;
+            return;
+        }
+        stmt = Stmt();
+        for (size_t i = new_stmts.size(); i > 0; i--) {
+            stmt = stmt.defined() ? Block::make(new_stmts[i-1], stmt) : new_stmts[i-1];
+        }
+    }
+};
+
+}
+
 Stmt rewrite_interleavings(Stmt s) {
     s = flatten_blocks(s);
-    return Interleaver().mutate(s);
+    s = Interleaver().mutate(s);
+    return TransposeTiles().mutate(s);
 }
 
 namespace {
@@ -721,6 +1229,67 @@ void deinterleave_vector_test() {
           Load::make(ramp_a.type(), "buf", ramp_a, Buffer(), Parameter()),
           Load::make(ramp_b.type(), "buf", ramp_b, Buffer(), Parameter()));
 
+    // A loop over the channels of an interleaved store should become
+    // a single interleaving store.
+    {
+        Expr c = Variable::make(Int(32), "c");
+        Expr src = Load::make(Int(32, 8), "src", Ramp::make(x + c*100, 1, 8), Buffer(), Parameter());
+        Stmt loop = For::make("c", 0, 3, ForType::Serial, DeviceAPI::Host,
+                              Store::make("dst", src, Ramp::make(x*3 + c, 3, 8)));
+        Stmt result = rewrite_interleavings(loop);
+        const Block *block = result.as<Block>();
+        const Store *store = block ? block->first.as<Store>() : NULL;
+        const Call *value = store ? store->value.as<Call>() : NULL;
+        if (!value || value->name != Call::interleave_vectors || value->args.size() != 3) {
+            internal_error << "Channel loop was not rewritten to an interleaving store:\n"
+                           << result << "\n";
+        }
+    }
+
+    // Strided loads of the columns of a tile should become dense
+    // loads of its rows, transposed in registers.
+    {
+        Expr y = Variable::make(Int(32), "y");
+        Expr s = Variable::make(Int(32), "s");
+        Stmt block;
+        for (int i = 3; i >= 0; i--) {
+            Expr column = Load::make(Int(16, 4), "src", Ramp::make(x + i, s, 4), Buffer(), Parameter());
+            Stmt store = Store::make("dst", column, Ramp::make(y + i*100, 1, 4));
+            block = block.defined() ? Block::make(store, block) : store;
+        }
+        Stmt result = rewrite_interleavings(block);
+        const LetStmt *let = result.as<LetStmt>();
+        const Call *tile = let ? let->value.as<Call>() : NULL;
+        if (!tile || tile->name != Call::interleave_vectors || tile->args.size() != 4 ||
+            !equal(tile->args[1], Load::make(Int(16, 4), "src", Ramp::make(x + s, 1, 4), Buffer(), Parameter()))) {
+            internal_error << "Tile was not transposed in registers:\n"
+                           << result << "\n";
+        }
+    }
+
+    // Strided stores of the columns of a tile can't become dense
+    // stores of its rows if something between them reads the tile.
+    {
+        Expr y = Variable::make(Int(32), "y");
+        Expr s = Variable::make(Int(32), "s");
+        Stmt block;
+        for (int i = 3; i >= 0; i--) {
+            Expr row = Load::make(Int(16, 4), "src", Ramp::make(y + i*100, 1, 4), Buffer(), Parameter());
+            Stmt store = Store::make("dst", row, Ramp::make(x + i, s, 4));
+            if (i == 2) {
+                Expr read = Load::make(Int(16, 4), "dst", Ramp::make(x, 1, 4), Buffer(), Parameter());
+                store = Block::make(Store::make("other", read, Ramp::make(y, 1, 4)), store);
+            }
+            block = block.defined() ? Block::make(store, block) : store;
+        }
+        block = flatten_blocks(block);
+        Stmt result = rewrite_interleavings(block);
+        if (!equal(result, block)) {
+            internal_error << "Tile read between its stores was transposed in registers:\n"
+                           << result << "\n";
+        }
+    }
+
     std::cout << "deinterleave_vector test passed" << std::endl;
 }
 
@@ -24,7 +24,11 @@ EXPORT Expr extract_lane(Expr vec, int lane);
 
 /** Look through a statement for expressions of the form select(ramp %
  * 2 == 0, a, b) and replace them with calls to an interleave
- * intrinsic */
+ * intrinsic. Also finds 4x4, 8x8, and 16x16 tiles of 8, 16, or 32-bit
+ * values that are read or written with strided vector accesses of
+ * their columns (e.g. an unrolled and vectorized transpose or
+ * rotation), and instead accesses their rows densely and transposes
+ * them with shuffles. */
 Stmt rewrite_interleavings(Stmt s);
 
 EXPORT void deinterleave_vector_test();
@@ -3,6 +3,7 @@
 
 #include "runtime/HalideRuntime.h"
 #include "runtime/HalideRuntimeCuda.h"
+#include "runtime/HalideRuntimeHostDevice.h"
 #include "runtime/HalideRuntimeOpenCL.h"
 #include "runtime/HalideRuntimeOpenGL.h"
 #include "runtime/HalideRuntimeOpenGLCompute.h"
@@ -111,6 +112,37 @@ int halide_device_free(void *user_context, struct buffer_t *buf) {
     }
 }
 
+/** Free the pooled device allocations of a device API, until at most
+ * max_bytes of them are left. */
+int halide_device_pool_trim(void *user_context, const halide_device_interface *interface, size_t max_bytes) {
+    user_assert(user_context == NULL) << "Cannot provide user_context to libHalide.a halide_device_pool_trim\n";
+    Target target(get_host_target());
+    int (*fn)(void *user_context, const halide_device_interface *interface, size_t max_bytes);
+    if (lookup_runtime_routine("halide_device_pool_trim", target, fn)) {
+        return (*fn)(user_context, interface, max_bytes);
+    }
+    return -1;
+}
+
+void halide_device_pool_set_limit(size_t max_bytes) {
+    Target target(get_host_target());
+    void (*fn)(size_t max_bytes);
+    if (lookup_runtime_routine("halide_device_pool_set_limit", target, fn)) {
+        (*fn)(max_bytes);
+    }
+}
+
+int halide_device_pool_get_stats(void *user_context, const halide_device_interface *interface,
+                                 struct halide_device_pool_stats *stats) {
+    user_assert(user_context == NULL) << "Cannot provide user_context to libHalide.a halide_device_pool_get_stats\n";
+    Target target(get_host_target());
+    int (*fn)(void *user_context, const halide_device_interface *interface, struct halide_device_pool_stats *stats);
+    if (lookup_runtime_routine("halide_device_pool_get_stats", target, fn)) {
+        return (*fn)(user_context, interface, stats);
+    }
+    return -1;
+}
+
 const struct halide_device_interface *halide_cuda_device_interface() {
     Target target(get_host_target());
     target.set_feature(Target::CUDA);
@@ -151,6 +183,45 @@ const struct halide_device_interface *halide_openglcompute_device_interface() {
     return NULL;
 }
 
+const struct halide_device_interface *halide_host_device_interface() {
+    Target target(get_host_target());
+    target.set_feature(Target::HostDevice);
+    struct halide_device_interface *(*fn)();
+    if (lookup_runtime_routine("halide_host_device_interface", target, fn)) {
+        return (*fn)();
+    }
+    return NULL;
+}
+
+/** These can only be called once a pipeline that uses the host device
+ * has been jit-compiled, which loads its runtime. */
+void halide_host_device_set_transfer_cost(int64_t latency_ns, int64_t bytes_per_second) {
+    Target target(get_host_target());
+    target.set_feature(Target::HostDevice);
+    void (*fn)(int64_t latency_ns, int64_t bytes_per_second);
+    if (lookup_runtime_routine("halide_host_device_set_transfer_cost", target, fn)) {
+        (*fn)(latency_ns, bytes_per_second);
+    }
+}
+
+void halide_host_device_get_stats(struct halide_host_device_stats *stats) {
+    Target target(get_host_target());
+    target.set_feature(Target::HostDevice);
+    void (*fn)(struct halide_host_device_stats *stats);
+    if (lookup_runtime_routine("halide_host_device_get_stats", target, fn)) {
+        (*fn)(stats);
+    }
+}
+
+void halide_host_device_reset_stats() {
+    Target target(get_host_target());
+    target.set_feature(Target::HostDevice);
+    void (*fn)();
+    if (lookup_runtime_routine("halide_host_device_reset_stats", target, fn)) {
+        (*fn)();
+    }
+}
+
 const struct halide_device_interface *halide_renderscript_device_interface() {
     Target target(get_host_target());
     target.set_feature(Target::Renderscript);
@@ -225,7 +225,8 @@ enum class DeviceAPI {
     OpenCL,
     GLSL,
     Renderscript,
-    OpenGLCompute
+    OpenGLCompute,
+    HostDevice /// A mock device whose memory is host memory. See Target::HostDevice.
 };
 
 namespace Internal {
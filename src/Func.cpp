@@ -260,13 +260,16 @@ void Stage::set_dim_type(VarOrRVar var, ForType t) {
             // If it's an rvar and the for type is parallel, we need to
             // validate that this doesn't introduce a race condition.
             if (!dims[i].pure && var.is_rvar && (t == ForType::Vectorized || t == ForType::Parallel)) {
-                user_assert(schedule.allow_race_conditions())
+                user_assert(schedule.allow_race_conditions() ||
+                            schedule.atomic())
                     << "In schedule for " << stage_name
                     << ", marking var " << var.name()
                     << " as parallel or vectorized may introduce a race"
                     << " condition resulting in incorrect output."
                     << " It is possible to override this error using"
-                    << " the allow_race_conditions() method. Use this"
+                    << " the allow_race_conditions() method, or for"
+                    << " updates like histograms and sums, by making the"
+                    << " update atomic with atomic(). Use allow_race_conditions()"
                     << " with great caution, and only when you are willing"
                     << " to accept non-deterministic output, or you can prove"
                     << " that any race conditions in this code do not change"
@@ -545,6 +548,11 @@ Stage &Stage::allow_race_conditions() {
     return *this;
 }
 
+Stage &Stage::atomic() {
+    schedule.atomic() = true;
+    return *this;
+}
+
 Stage &Stage::serial(VarOrRVar var) {
     set_dim_type(var, ForType::Serial);
     return *this;
@@ -1119,6 +1127,14 @@ Func &Func::compute_root() {
     return *this;
 }
 
+Func &Func::compute_with(Func f, Var var) {
+    invalidate_cache();
+    user_assert(!f.function().same_as(func))
+        << "Func " << name() << " can't be computed with itself.\n";
+    func.schedule().compute_with_level() = LoopLevel(f.name(), var.name());
+    return *this;
+}
+
 Func &Func::store_at(Func f, RVar var) {
     return store_at(f, Var(var.name()));
 }
@@ -1693,6 +1709,10 @@ const Internal::JITHandlers &Func::jit_handlers() {
     return pipeline().jit_handlers();
 }
 
+void Func::set_jit_call_wrapper(void *(*enter)(), void (*exit)(void *)) {
+    pipeline().set_jit_call_wrapper(enter, exit);
+}
+
 void Func::realize(Buffer b, const Target &target) {
     pipeline().realize(b, target);
 }
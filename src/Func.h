@@ -117,6 +117,21 @@ public:
     EXPORT Stage &allow_race_conditions();
     // @}
 
+    /** Do the updates of this stage atomically, so that it can be
+     * parallelized over RVars even when different values of them
+     * update the same site (e.g. a histogram, or a splat). The update
+     * must be of the form f(args) = f(args) op e, where op is +, -,
+     * *, min, max, &, |, or ^, and e doesn't depend on f. Integer
+     * updates become atomic read-modify-write instructions, and the
+     * others compare-and-swap loops. Note that floating point updates
+     * may be done in any order, so the result may vary slightly from
+     * run to run. Call this before marking RVars parallel or
+     * vectorized. Vectorizing across an RVar that all update the same
+     * site (e.g. a dot product) sums (or mins, etc.) the vector of
+     * updates with a horizontal reduction, and then does one
+     * update. */
+    EXPORT Stage &atomic();
+
     // These calls are for legacy compatibility only.
     EXPORT Stage &cuda_threads(VarOrRVar thread_x) {
         return gpu_threads(thread_x);
@@ -642,6 +657,11 @@ public:
      * used by JIT. */
     EXPORT const Internal::JITHandlers &jit_handlers();
 
+    /** Set a pair of functions to be called immediately around the
+     * compiled code when realizing. See
+     * Pipeline::set_jit_call_wrapper. */
+    EXPORT void set_jit_call_wrapper(void *(*enter)(), void (*exit)(void *));
+
     /** Add a custom pass to be used during lowering. It is run after
      * all other lowering passes. Can be used to verify properties of
      * the lowered Stmt, instrument it with extra code, or otherwise
@@ -1341,6 +1361,48 @@ public:
      */
     EXPORT Func &compute_root();
 
+    /** Compute this function in the same loop nest as f, down to and
+     * including the loop over var. Useful for functions that read the
+     * same inputs over similar regions, so that the inputs are only
+     * streamed through the cache once. For example:
+     *
+     \code
+     Func gx, gy, out;
+     Var x, y;
+     gx(x, y) = in(x+1, y) - in(x-1, y);
+     gy(x, y) = in(x, y+1) - in(x, y-1);
+     out(x, y) = gx(x, y) * gx(x, y) + gy(x, y) * gy(x, y);
+
+     gx.compute_root();
+     gy.compute_root().compute_with(gx, y);
+     \endcode
+     *
+     * is equivalent to
+     *
+     \code
+     for (int y = 0; y < height; y++) {
+         for (int x = 0; x < width; x++) {
+             gx[y][x] = in[y][x+1] - in[y][x-1];
+         }
+         for (int x = 0; x < width; x++) {
+             gy[y][x] = in[y+1][x] - in[y-1][x];
+         }
+     }
+     ...
+     \endcode
+     *
+     * The fused loops run over the union of the regions required of
+     * the two functions, and each body only runs for the iterations
+     * that its function needs. The two functions must be computed at
+     * the same loop level, and must not depend on each other. Their
+     * loop nests must have the same variables, in the same order, from
+     * the outermost loop down to var, and none of those loops may be
+     * vectorized or unrolled. Functions with update definitions,
+     * specializations, extern definitions, or memoization can't be
+     * fused.
+     */
+    EXPORT Func &compute_with(Func f, Var var);
+
     /** Use the halide_memoization_cache_... interface to store a
      *  computed version of this function across invocations of the
      *  Func.
@@ -1,4 +1,5 @@
 #include "Generator.h"
+#include "MultiTarget.h"
 #include "Output.h"
 
 namespace {
@@ -45,11 +46,46 @@ const std::map<std::string, Halide::Type> &get_halide_type_enum_map() {
     return halide_type_enum_map;
 }
 
+namespace {
+
+// The object, assembly, and bitcode files to emit for a filter.
+Outputs get_compiled_outputs(const std::string &base_path, const Target &target,
+                             const GeneratorBase::EmitOptions &options) {
+    Outputs output_files;
+    if (options.emit_o) {
+        // If the target arch is pnacl, then the output "object" file is
+        // actually a pnacl bitcode file.
+        if (target.arch == Target::PNaCl) {
+            output_files.object_name = base_path + ".bc";
+        } else if (target.os == Target::Windows) {
+            // If it's windows, then we're emitting a COFF file
+            output_files.object_name = base_path + ".obj";
+        } else {
+            // Otherwise it is an ELF or Mach-o
+            output_files.object_name = base_path + ".o";
+        }
+    }
+    if (options.emit_assembly) {
+        output_files.assembly_name = base_path + ".s";
+    }
+    if (options.emit_bitcode) {
+        // In this case, bitcode refers to the LLVM IR generated by Halide
+        // and passed to LLVM, for both the pnacl and ordinary archs
+        output_files.bitcode_name = base_path + ".bc";
+    }
+    return output_files;
+}
+
+}
+
 int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
     const char kUsage[] = "gengen [-g GENERATOR_NAME] [-f FUNCTION_NAME] [-o OUTPUT_DIR] [-r RUNTIME_NAME] [-e EMIT_OPTIONS] "
-                          "target=target-string [generator_arg=value [...]]\n\n"
+                          "target=target-string[,target-string...] [generator_arg=value [...]]\n\n"
                           "  -e  A comma separated list of optional files to emit. Accepted values are "
-                          "[assembly, bitcode, stmt, html]\n";
+                          "[assembly, bitcode, stmt, html]\n\n"
+                          "  If several targets are given, the object file contains a variant of the filter for\n"
+                          "  each, and calls the first one the host cpu supports. The last target is the fallback,\n"
+                          "  and is used for everything else (the header, the runtime, and so on).\n";
 
     std::map<std::string, std::string> flags_info = { { "-f", "" },
                                                       { "-g", "" },
@@ -138,6 +174,9 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
         }
     }
 
+    std::vector<std::string> target_strings = split_string(generator_args["target"], ",");
+    generator_args["target"] = target_strings.back();
+
     if (!runtime_name.empty()) {
         compile_standalone_runtime(output_dir + "/" + runtime_name,
                                    parse_target_string(generator_args["target"]));
@@ -153,7 +192,30 @@ int generate_filter_main(int argc, char **argv, std::ostream &cerr) {
         cerr << kUsage;
         return 1;
     }
-    gen->emit_filter(output_dir, function_name, function_name, emit_options);
+    if (target_strings.size() > 1) {
+        std::vector<Target> targets;
+        for (const std::string &t : target_strings) {
+            targets.push_back(parse_target_string(t));
+        }
+
+        GeneratorBase::EmitOptions fallback_options = emit_options;
+        fallback_options.emit_o = false;
+        fallback_options.emit_assembly = false;
+        fallback_options.emit_bitcode = false;
+        gen->emit_filter(output_dir, function_name, function_name, fallback_options);
+
+        // The target can change what build() does, so build a fresh
+        // Generator for each variant.
+        Outputs output_files = get_compiled_outputs(output_dir + "/" + function_name, targets.back(), emit_options);
+        compile_multitarget(function_name, output_files, targets,
+                            [&](const std::string &name, const Target &t) {
+                                GeneratorParamValues variant_args = generator_args;
+                                variant_args["target"] = t.to_string();
+                                return GeneratorRegistry::create(generator_name, variant_args)->build_module(name);
+                            });
+    } else {
+        gen->emit_filter(output_dir, function_name, function_name, emit_options);
+    }
     return 0;
 }
 
@@ -305,28 +367,7 @@ void GeneratorBase::emit_filter(const std::string &output_dir,
     std::vector<Halide::Argument> inputs = get_filter_arguments();
     std::string base_path = output_dir + "/" + (file_base_name.empty() ? function_name : file_base_name);
     if (options.emit_o || options.emit_assembly || options.emit_bitcode) {
-        Outputs output_files;
-        if (options.emit_o) {
-            // If the target arch is pnacl, then the output "object" file is
-            // actually a pnacl bitcode file.
-            if (Target(target).arch == Target::PNaCl) {
-                output_files.object_name = base_path + ".bc";
-            } else if (Target(target).os == Target::Windows) {
-                // If it's windows, then we're emitting a COFF file
-                output_files.object_name = base_path + ".obj";
-            } else {
-                // Otherwise it is an ELF or Mach-o
-                output_files.object_name = base_path + ".o";
-            }
-        }
-        if (options.emit_assembly) {
-            output_files.assembly_name = base_path + ".s";
-        }
-        if (options.emit_bitcode) {
-            // In this case, bitcode refers to the LLVM IR generated by Halide
-            // and passed to LLVM, for both the pnacl and ordinary archs
-            output_files.bitcode_name = base_path + ".bc";
-        }
+        Outputs output_files = get_compiled_outputs(base_path, target, options);
         pipeline.compile_to(output_files, inputs, function_name, target);
     }
     if (options.emit_h) {
@@ -343,6 +384,12 @@ void GeneratorBase::emit_filter(const std::string &output_dir,
     }
 }
 
+Module GeneratorBase::build_module(const std::string &function_name) {
+    build_params();
+    Pipeline pipeline = build_pipeline();
+    return pipeline.compile_to_module(get_filter_arguments(), function_name, target);
+}
+
 Func GeneratorBase::call_extern(std::initializer_list<ExternFuncArgument> function_arguments,
                                 std::string function_name){
     Pipeline p = build_pipeline();
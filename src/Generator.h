@@ -433,6 +433,10 @@ public:
     EXPORT void emit_filter(const std::string &output_dir, const std::string &function_name = "",
                             const std::string &file_base_name = "", const EmitOptions &options = EmitOptions());
 
+    // Call build() and compile the result to a Module for the
+    // Generator's target, with the given function name.
+    EXPORT Module build_module(const std::string &function_name = "");
+
 protected:
     EXPORT GeneratorBase(size_t size, const void *introspection_helper);
 
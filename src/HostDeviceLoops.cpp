@@ -0,0 +1,111 @@
+#include "HostDeviceLoops.h"
+#include "CodeGen_GPU_Dev.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Debug.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::set;
+using std::string;
+
+namespace {
+
+// Find the buffers used by a kernel that don't live inside it.
+class FindKernelBuffers : public IRVisitor {
+    set<string> used, allocated;
+
+    using IRVisitor::visit;
+
+    void visit(const Load *op) {
+        used.insert(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Store *op) {
+        used.insert(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Allocate *op) {
+        allocated.insert(op->name);
+        IRVisitor::visit(op);
+    }
+
+public:
+    set<string> buffers() const {
+        set<string> result;
+        for (const string &b : used) {
+            if (!allocated.count(b)) {
+                result.insert(b);
+            }
+        }
+        return result;
+    }
+};
+
+class LowerHostDeviceLoops : public IRMutator {
+    bool in_kernel;
+
+    using IRMutator::visit;
+
+    void visit(const For *op) {
+        bool kernel_loop = (op->device_api == DeviceAPI::HostDevice ||
+                            (in_kernel && op->device_api == DeviceAPI::Parent));
+        if (!kernel_loop) {
+            IRMutator::visit(op);
+            return;
+        }
+
+        bool outermost = !in_kernel;
+        in_kernel = true;
+        Stmt body = mutate(op->body);
+        in_kernel = !outermost;
+
+        // The threads of a block are run one after the other by the
+        // thread running the block.
+        ForType for_type = op->for_type;
+        if (CodeGen_GPU_Dev::is_gpu_thread_var(op->name) && for_type == ForType::Parallel) {
+            for_type = ForType::Serial;
+        }
+
+        Stmt s = For::make(op->name, op->min, op->extent, for_type, DeviceAPI::Host, body);
+
+        if (outermost) {
+            // Point the kernel at the device allocations of its
+            // buffers, instead of their host memory.
+            FindKernelBuffers f;
+            s.accept(&f);
+            for (const string &b : f.buffers()) {
+                debug(3) << "Kernel " << op->name << " uses the device allocation of " << b << "\n";
+                Expr buf = Variable::make(Handle(), b + ".buffer");
+                Expr dev = Call::make(Handle(), "halide_host_device_get_pointer", {buf}, Call::Extern);
+                s = LetStmt::make(b + ".host", dev, s);
+            }
+        }
+
+        stmt = s;
+    }
+
+    void visit(const Call *op) {
+        // The thread loops of each stage in a block run to completion
+        // before the next stage starts, so host device kernels need no
+        // barriers. Lower skips fuse_gpu_thread_loops for them.
+        internal_assert(!(in_kernel && op->name == "halide_gpu_thread_barrier"))
+            << "Host device kernels can't contain thread barriers\n";
+        IRMutator::visit(op);
+    }
+
+public:
+    LowerHostDeviceLoops() : in_kernel(false) {}
+};
+
+}
+
+Stmt lower_host_device_loops(Stmt s) {
+    return LowerHostDeviceLoops().mutate(s);
+}
+
+}
+}
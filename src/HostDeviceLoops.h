@@ -0,0 +1,26 @@
+#ifndef HALIDE_HOST_DEVICE_LOOPS_H
+#define HALIDE_HOST_DEVICE_LOOPS_H
+
+/** \file
+ * Defines the lowering pass that turns loops on the mock host device
+ * into host loops.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Turn kernels scheduled on DeviceAPI::HostDevice into ordinary
+ * host loops. The loops over gpu blocks stay parallel, and the loops
+ * over gpu threads become serial. Each kernel works on the device
+ * allocations of the buffers it uses, which it gets from
+ * halide_host_device_get_pointer. Must be run after the last
+ * simplification, which would otherwise remove the lets that shadow
+ * the host pointers of the buffers. */
+Stmt lower_host_device_loops(Stmt s);
+
+}
+}
+
+#endif
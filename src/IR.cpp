@@ -299,6 +299,21 @@ Expr Broadcast::make(Expr value, int width) {
     return node;
 }
 
+Expr VectorReduce::make(VectorReduce::Operator op, Expr value, int width) {
+    internal_assert(value.defined()) << "VectorReduce of undefined\n";
+    internal_assert(width > 0 && value.type().width % width == 0)
+        << "VectorReduce of " << value.type().width << " lanes to " << width << " lanes\n";
+    internal_assert(op < And || !value.type().is_float())
+        << "Bitwise VectorReduce of a float vector\n";
+
+    VectorReduce *node = new VectorReduce;
+    node->type = value.type().element_of().vector_of(width);
+    node->op = op;
+    node->value = value;
+    node->width = width;
+    return node;
+}
+
 Expr Let::make(std::string name, Expr value, Expr body) {
     internal_assert(value.defined()) << "Let of undefined\n";
     internal_assert(body.defined()) << "Let of undefined\n";
@@ -551,6 +566,7 @@ template<> void StmtNode<Realize>::accept(IRVisitor *v) const { v->visit((const
 template<> void StmtNode<Block>::accept(IRVisitor *v) const { v->visit((const Block *)this); }
 template<> void StmtNode<IfThenElse>::accept(IRVisitor *v) const { v->visit((const IfThenElse *)this); }
 template<> void StmtNode<Evaluate>::accept(IRVisitor *v) const { v->visit((const Evaluate *)this); }
+template<> void ExprNode<VectorReduce>::accept(IRVisitor *v) const { v->visit((const VectorReduce *)this); }
 
 template<> IRNodeType ExprNode<IntImm>::_type_info = {};
 template<> IRNodeType ExprNode<FloatImm>::_type_info = {};
@@ -591,10 +607,13 @@ template<> IRNodeType StmtNode<Realize>::_type_info = {};
 template<> IRNodeType StmtNode<Block>::_type_info = {};
 template<> IRNodeType StmtNode<IfThenElse>::_type_info = {};
 template<> IRNodeType StmtNode<Evaluate>::_type_info = {};
+template<> IRNodeType ExprNode<VectorReduce>::_type_info = {};
 
 Call::ConstString Call::debug_to_file = "debug_to_file";
 Call::ConstString Call::shuffle_vector = "shuffle_vector";
 Call::ConstString Call::interleave_vectors = "interleave_vectors";
+Call::ConstString Call::dynamic_shuffle = "dynamic_shuffle";
+Call::ConstString Call::atomic_update = "atomic_update";
 Call::ConstString Call::reinterpret = "reinterpret";
 Call::ConstString Call::bitwise_and = "bitwise_and";
 Call::ConstString Call::bitwise_not = "bitwise_not";
@@ -368,6 +368,8 @@ struct Call : public ExprNode<Call> {
     EXPORT static ConstString debug_to_file,
         shuffle_vector,
         interleave_vectors,
+        dynamic_shuffle,
+        atomic_update,
         reinterpret,
         bitwise_and,
         bitwise_not,
@@ -510,6 +512,22 @@ struct For : public StmtNode<For> {
     EXPORT static Stmt make(std::string name, Expr min, Expr extent, ForType for_type, DeviceAPI device_api, Stmt body);
 };
 
+/** Horizontally reduce a vector to a vector of fewer lanes, using
+ * some associative and commutative binary operator. Lane i of the
+ * result is the reduction of the 'value.type().width / width'
+ * adjacent lanes of 'value' starting at lane i * that factor. A
+ * width of one reduces the whole vector to a scalar. And, Or, and
+ * Xor are bitwise (or logical, for booleans). */
+struct VectorReduce : public ExprNode<VectorReduce> {
+    typedef enum {Add, Mul, Min, Max, And, Or, Xor} Operator;
+
+    Expr value;
+    Operator op;
+    int width;
+
+    EXPORT static Expr make(Operator op, Expr value, int width);
+};
+
 }
 }
 
@@ -1,3 +1,5 @@
+#include <string.h>
+
 #include "IREquality.h"
 #include "IRVisitor.h"
 #include "IROperator.h"
@@ -87,6 +89,7 @@ private:
     void visit(const Block *);
     void visit(const IfThenElse *);
     void visit(const Evaluate *);
+    void visit(const VectorReduce *);
 };
 
 template<typename T>
@@ -430,14 +433,144 @@ void IRComparer::visit(const Evaluate *op) {
     compare_expr(s->value, op->value);
 }
 
+void IRComparer::visit(const VectorReduce *op) {
+    const VectorReduce *e = expr.as<VectorReduce>();
+
+    compare_scalar(e->op, op->op);
+    compare_expr(e->value, op->value);
+}
+
+/** Computes the hash of a single node, given the hashes of its
+ * children. Must hash exactly the things IRComparer compares. */
+class NodeHasher : public IRVisitor {
+    IRHasher *hasher;
+
+    void mix(uint64_t x) {
+        // Boost's hash_combine, widened to 64 bits.
+        h ^= x + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    }
+
+    void mix(const Expr &e) {
+        mix(e.defined() ? hasher->hash(e) : 0);
+    }
+
+    void mix(const string &str) {
+        mix((uint64_t)std::hash<string>()(str));
+    }
+
+    template<typename T>
+    void mix_binary_operator(const T *op) {
+        mix(op->a);
+        mix(op->b);
+    }
+
+    using IRVisitor::visit;
+
+    void visit(const IntImm *op) {
+        mix((uint64_t)(int64_t)op->value);
+    }
+
+    void visit(const FloatImm *op) {
+        // IRComparer considers 0.0 and -0.0 equal.
+        double value = op->value == 0 ? 0.0 : op->value;
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        mix(bits);
+    }
+
+    void visit(const StringImm *op) {mix(op->value);}
+    void visit(const Cast *op) {mix(op->value);}
+    void visit(const Variable *op) {mix(op->name);}
+    void visit(const Add *op) {mix_binary_operator(op);}
+    void visit(const Sub *op) {mix_binary_operator(op);}
+    void visit(const Mul *op) {mix_binary_operator(op);}
+    void visit(const Div *op) {mix_binary_operator(op);}
+    void visit(const Mod *op) {mix_binary_operator(op);}
+    void visit(const Min *op) {mix_binary_operator(op);}
+    void visit(const Max *op) {mix_binary_operator(op);}
+    void visit(const EQ *op) {mix_binary_operator(op);}
+    void visit(const NE *op) {mix_binary_operator(op);}
+    void visit(const LT *op) {mix_binary_operator(op);}
+    void visit(const LE *op) {mix_binary_operator(op);}
+    void visit(const GT *op) {mix_binary_operator(op);}
+    void visit(const GE *op) {mix_binary_operator(op);}
+    void visit(const And *op) {mix_binary_operator(op);}
+    void visit(const Or *op) {mix_binary_operator(op);}
+    void visit(const Not *op) {mix(op->a);}
+
+    void visit(const Select *op) {
+        mix(op->condition);
+        mix(op->true_value);
+        mix(op->false_value);
+    }
+
+    void visit(const Load *op) {
+        mix(op->name);
+        mix(op->index);
+    }
+
+    void visit(const Ramp *op) {
+        mix(op->base);
+        mix(op->stride);
+    }
+
+    void visit(const Broadcast *op) {mix(op->value);}
+
+    void visit(const VectorReduce *op) {
+        mix((uint64_t)op->op);
+        mix(op->value);
+    }
+
+    void visit(const Call *op) {
+        mix(op->name);
+        mix((uint64_t)op->call_type);
+        mix((uint64_t)op->value_index);
+        mix((uint64_t)op->args.size());
+        for (size_t i = 0; i < op->args.size(); i++) {
+            mix(op->args[i]);
+        }
+    }
+
+    void visit(const Let *op) {
+        mix(op->name);
+        mix(op->value);
+        mix(op->body);
+    }
+
+public:
+    uint64_t h;
+
+    NodeHasher(IRHasher *hasher, const Expr &e) : hasher(hasher), h(0) {
+        mix((uint64_t)(uintptr_t)e.ptr->type_info());
+        Type t = e.type();
+        mix(((uint64_t)t.code << 48) | ((uint64_t)t.bits << 32) | (uint64_t)t.width);
+    }
+};
+
 } // namespace
 
+uint64_t IRHasher::hash(const Expr &e) {
+    internal_assert(e.defined());
+    std::unordered_map<const IRNode *, uint64_t>::iterator iter = known.find(e.ptr);
+    if (iter != known.end()) {
+        return iter->second;
+    }
+    NodeHasher node_hasher(this, e);
+    e.accept(&node_hasher);
+    known[e.ptr] = node_hasher.h;
+    nodes.push_back(e);
+    return node_hasher.h;
+}
 
 // Now the methods exposed in the header.
 bool equal(Expr a, Expr b) {
     return IRComparer().compare_expr(a, b) == IRComparer::Equal;
 }
 
+bool equal(Expr a, Expr b, IRCompareCache *cache) {
+    return IRComparer(cache).compare_expr(a, b) == IRComparer::Equal;
+}
+
 bool equal(Stmt a, Stmt b) {
     return IRComparer().compare_stmt(a, b) == IRComparer::Equal;
 }
@@ -518,6 +651,20 @@ void ir_equality_test() {
     e2 = e2*e2 + e2;
     check_not_equal(e1, e2);
 
+    // Exprs that are equal by value must hash the same, and this
+    // also shouldn't hang on graphs with lots of sharing.
+    IRHasher hasher;
+    e2 = x;
+    for (int i = 0; i < 100; i++) {
+        e2 = e2*e2 + e2;
+    }
+    internal_assert(hasher.hash(e1) == hasher.hash(e2));
+    internal_assert(hasher.hash(Ramp::make(x, 4, 3)) == hasher.hash(Ramp::make(x, 4, 3)));
+    internal_assert(hasher.hash(Ramp::make(x, 2, 3)) != hasher.hash(Ramp::make(x, 4, 3)));
+    internal_assert(hasher.hash(x + 1) != hasher.hash(x - 1));
+    internal_assert(hasher.hash(cast<float>(x)) != hasher.hash(cast<int64_t>(x)));
+    internal_assert(hasher.hash(make_const(Float(32), 0.0)) == hasher.hash(make_const(Float(32), -0.0)));
+
     debug(0) << "ir_equality_test passed\n";
 }
 
@@ -5,6 +5,8 @@
  * Methods to test Exprs and Stmts for equality of value
  */
 
+#include <unordered_map>
+
 #include "IR.h"
 
 namespace Halide {
@@ -101,6 +103,27 @@ struct ExprWithCompareCache {
     EXPORT bool operator<(const ExprWithCompareCache &other) const;
 };
 
+/** Computes structural hashes of Exprs, such that Exprs that are
+ * equal by value (as determined by equal, below) have equal
+ * hashes. The hash of every node seen is remembered, so hashing many
+ * Exprs that share subexpressions, or an Expr that is a graph with
+ * lots of sharing, takes time linear in the number of distinct
+ * nodes. Useful for finding Exprs in a hash table, with a call to
+ * equal only when the hashes match.
+ *
+ * The hashes are not stable across runs, so they shouldn't be
+ * persisted.
+ */
+class IRHasher {
+    std::unordered_map<const IRNode *, uint64_t> known;
+    // Holds references to the nodes in known, so their addresses
+    // can't be reused.
+    std::vector<Expr> nodes;
+
+public:
+    EXPORT uint64_t hash(const Expr &e);
+};
+
 /** Compare IR nodes for equality of value. Traverses entire IR
  * tree. For equality of reference, use Expr::same_as */
 // @{
@@ -108,6 +131,10 @@ EXPORT bool equal(Expr a, Expr b);
 EXPORT bool equal(Stmt a, Stmt b);
 // @}
 
+/** Compare Exprs for equality of value, using and updating a cache
+ * of pairs of subexpressions known to be equal. */
+EXPORT bool equal(Expr a, Expr b, IRCompareCache *cache);
+
 EXPORT void ir_equality_test();
 
 }
@@ -230,6 +230,16 @@ public:
             result = false;
         }
     }
+
+    void visit(const VectorReduce *op) {
+        const VectorReduce *e = expr.as<VectorReduce>();
+        if (result && e && types_match(op->type, e->type) && e->op == op->op) {
+            expr = e->value;
+            op->value.accept(this);
+        } else {
+            result = false;
+        }
+    }
 };
 
 bool expr_match(Expr pattern, Expr expr, vector<Expr> &matches) {
@@ -318,5 +318,11 @@ void IRMutator::visit(const Evaluate *op) {
     }
 }
 
+void IRMutator::visit(const VectorReduce *op) {
+    Expr value = mutate(op->value);
+    if (value.same_as(op->value)) expr = op;
+    else expr = VectorReduce::make(op->op, value, op->width);
+}
+
 }
 }
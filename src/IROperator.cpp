@@ -248,6 +248,53 @@ Expr const_false(int w) {
     return make_zero(UInt(1, w));
 }
 
+Expr vector_reduce_combine(VectorReduce::Operator op, Expr a, Expr b) {
+    switch (op) {
+    case VectorReduce::Add:
+        return Add::make(a, b);
+    case VectorReduce::Mul:
+        return Mul::make(a, b);
+    case VectorReduce::Min:
+        return Min::make(a, b);
+    case VectorReduce::Max:
+        return Max::make(a, b);
+    case VectorReduce::And:
+        return a.type().is_bool() ? And::make(a, b) : (a & b);
+    case VectorReduce::Or:
+        return a.type().is_bool() ? Or::make(a, b) : (a | b);
+    case VectorReduce::Xor:
+        return a.type().is_bool() ? NE::make(a, b) : (a ^ b);
+    }
+    return Expr();
+}
+
+Expr vector_reduce_identity(VectorReduce::Operator op, Type t) {
+    // The identities of min and max of floats are infinities.
+    auto float_const = [&](float value) {
+        Expr e = FloatImm::make(value);
+        if (t.bits != 32) {
+            e = Cast::make(t.element_of(), e);
+        }
+        return t.is_vector() ? Broadcast::make(e, t.width) : e;
+    };
+
+    switch (op) {
+    case VectorReduce::Add:
+    case VectorReduce::Or:
+    case VectorReduce::Xor:
+        return make_zero(t);
+    case VectorReduce::Mul:
+        return make_one(t);
+    case VectorReduce::Min:
+        return t.is_float() ? float_const(INFINITY) : t.max();
+    case VectorReduce::Max:
+        return t.is_float() ? float_const(-INFINITY) : t.min();
+    case VectorReduce::And:
+        return t.is_bool() ? const_true(t.width) : make_const(t, -1);
+    }
+    return Expr();
+}
+
 
 void check_representable(Type t, int x) {
     int result = int_cast_constant(t, x);
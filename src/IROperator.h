@@ -106,6 +106,14 @@ EXPORT Expr const_true(int width = 1);
  * falses, if a width argument is given. */
 EXPORT Expr const_false(int width = 1);
 
+/** Combine two values of the same type with the operator of a
+ * VectorReduce node. */
+EXPORT Expr vector_reduce_combine(VectorReduce::Operator op, Expr a, Expr b);
+
+/** Construct the identity of the operator of a VectorReduce node in
+ * the given type. */
+EXPORT Expr vector_reduce_identity(VectorReduce::Operator op, Type t);
+
 /** Coerce the two expressions to have the same type, using C-style
  * casting rules. For the purposes of casting, a boolean type is
  * UInt(1). We use the following procedure:
@@ -81,7 +81,11 @@ ostream &operator<<(ostream &out, const DeviceAPI &api) {
         break;
     case DeviceAPI::Renderscript:
         out << "<Renderscript>";
-        break;    }
+        break;
+    case DeviceAPI::HostDevice:
+        out << "<HostDevice>";
+        break;
+    }
     return out;
 }
 
@@ -636,4 +640,34 @@ void IRPrinter::visit(const Evaluate *op) {
     stream << "\n";
 }
 
+void IRPrinter::visit(const VectorReduce *op) {
+    stream << "vector_reduce_";
+    switch (op->op) {
+    case VectorReduce::Add:
+        stream << "add";
+        break;
+    case VectorReduce::Mul:
+        stream << "mul";
+        break;
+    case VectorReduce::Min:
+        stream << "min";
+        break;
+    case VectorReduce::Max:
+        stream << "max";
+        break;
+    case VectorReduce::And:
+        stream << "and";
+        break;
+    case VectorReduce::Or:
+        stream << "or";
+        break;
+    case VectorReduce::Xor:
+        stream << "xor";
+        break;
+    }
+    stream << "<" << op->width << ">(";
+    print(op->value);
+    stream << ")";
+}
+
 }}
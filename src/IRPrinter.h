@@ -114,6 +114,7 @@ protected:
     void visit(const Block *);
     void visit(const IfThenElse *);
     void visit(const Evaluate *);
+    void visit(const VectorReduce *);
 };
 }
 }
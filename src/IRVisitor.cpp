@@ -220,6 +220,10 @@ void IRVisitor::visit(const Evaluate *op) {
     op->value.accept(this);
 }
 
+void IRVisitor::visit(const VectorReduce *op) {
+    op->value.accept(this);
+}
+
 void IRGraphVisitor::include(const Expr &e) {
     if (visited.count(e.ptr)) {
         return;
@@ -441,5 +445,9 @@ void IRGraphVisitor::visit(const Evaluate *op) {
     include(op->value);
 }
 
+void IRGraphVisitor::visit(const VectorReduce *op) {
+    include(op->value);
+}
+
 }
 }
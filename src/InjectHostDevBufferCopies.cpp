@@ -4,6 +4,9 @@
 #include "IRPrinter.h"
 #include "CodeGen_GPU_Dev.h"
 #include "IROperator.h"
+#include "ExprUsesVar.h"
+#include "Simplify.h"
+#include "Substitute.h"
 #include <map>
 
 namespace Halide {
@@ -23,8 +26,10 @@ DeviceAPI fixup_device_api(DeviceAPI device_api, const Target &target) {
             return DeviceAPI::CUDA;
         } else if (target.has_feature(Target::OpenGLCompute)) {
             return DeviceAPI::OpenGLCompute;
+        } else if (target.has_feature(Target::HostDevice)) {
+            return DeviceAPI::HostDevice;
         } else {
-            user_error << "Schedule uses Default_GPU without a valid GPU (OpenCL or CUDA) specified in target.\n";
+            user_error << "Schedule uses Default_GPU without a valid GPU (OpenCL, CUDA, or host_device) specified in target.\n";
         }
     }
     return device_api;
@@ -170,6 +175,9 @@ class InjectBufferCopies : public IRMutator {
           case DeviceAPI::Renderscript:
             interface_name = "halide_renderscript_device_interface";
             break;
+          case DeviceAPI::HostDevice:
+            interface_name = "halide_host_device_interface";
+            break;
           default:
             internal_error << "Bad DeviceAPI " << static_cast<int>(device_api) << "\n";
             break;
@@ -194,8 +202,9 @@ class InjectBufferCopies : public IRMutator {
       ToDevice
     };
 
-    Stmt make_buffer_copy(CopyDirection direction, string buf_name, DeviceAPI target_device_api) {
+    Stmt make_buffer_copy(CopyDirection direction, string buf_name, DeviceAPI target_device_api, bool async = false) {
         internal_assert(direction == ToHost || direction == ToDevice) << "make_buffer_copy caller logic error.\n";
+        internal_assert(!async || direction == ToDevice) << "Only copies to the device can be asynchronous.\n";
         std::vector<Expr> args;
         Expr buffer = Variable::make(Handle(), buf_name + ".buffer");
         args.push_back(buffer);
@@ -204,7 +213,8 @@ class InjectBufferCopies : public IRMutator {
         }
 
         std::string suffix = (direction == ToDevice) ? "device" : "host";
-        Expr call = Call::make(Int(32), "halide_copy_to_" + suffix, args, Call::Extern);
+        std::string fn = "halide_copy_to_" + suffix + (async ? "_async" : "");
+        Expr call = Call::make(Int(32), fn, args, Call::Extern);
         string call_result_name = unique_name("copy_to_" + suffix + "_result");
         Expr call_result_var = Variable::make(Int(32), call_result_name);
         return LetStmt::make(call_result_name, call,
@@ -331,7 +341,14 @@ class InjectBufferCopies : public IRMutator {
             buf.devices_writing.clear();
 
             if (direction != NoCopy && touching_device != DeviceAPI::Host) {
-                s = Block::make(make_buffer_copy(direction, i.first, touching_device), s);
+                // Copies to the device can run in the background until
+                // the host next writes or frees the buffer. See
+                // InjectCopyWaits.
+                bool async = direction == ToDevice && target.has_feature(Target::AsyncDeviceCopies);
+                if (async) {
+                    async_copies.insert(i.first);
+                }
+                s = Block::make(make_buffer_copy(direction, i.first, touching_device, async), s);
             }
 
             // Inject a dev_malloc if needed.
@@ -627,6 +644,371 @@ class InjectBufferCopies : public IRMutator {
 public:
     InjectBufferCopies(const set<string> &i, const Target &t) : loop_level(""), buffers_to_track(i), target(t), device_api(DeviceAPI::Host) {}
 
+    // The buffers copied to the device asynchronously.
+    set<string> async_copies;
+};
+
+static Stmt make_wait_for_copies(const string &buf_name) {
+    Expr buffer = Variable::make(Handle(), buf_name + ".buffer");
+    Expr call = Call::make(Int(32), "halide_device_wait_for_copies", {buffer}, Call::Extern);
+    string call_result_name = unique_name("wait_for_copies_result");
+    Expr call_result_var = Variable::make(Int(32), call_result_name);
+    return LetStmt::make(call_result_name, call,
+                         AssertStmt::make(call_result_var == 0, call_result_var));
+}
+
+// Find the buffers stored to by host code in a statement.
+class FindHostStores : public IRVisitor {
+    const Target &target;
+
+    using IRVisitor::visit;
+
+    void visit(const For *op) {
+        if (!different_device_api(DeviceAPI::Host, op->device_api, target)) {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const Store *op) {
+        stores.insert(op->name);
+        IRVisitor::visit(op);
+    }
+
+public:
+    set<string> stores;
+    FindHostStores(const Target &t) : target(t) {}
+};
+
+// Check that the buffer_t of a buffer is only passed to the runtime
+// functions that allocate it on the device and copy it there. Other
+// uses might care which iteration of a loop the buffer_t belongs to.
+class OnlyCopiedToDevice : public IRVisitor {
+    const string &buf_var;
+
+    using IRVisitor::visit;
+
+    void visit(const Call *op) {
+        const Variable *buf = op->args.empty() ? NULL : op->args[0].as<Variable>();
+        if (buf && buf->name == buf_var &&
+            ((op->call_type == Call::Extern &&
+              (op->name == "halide_device_malloc" ||
+               op->name == "halide_copy_to_device" ||
+               op->name == "halide_copy_to_device_async" ||
+               op->name == "halide_device_wait_for_copies")) ||
+             (op->call_type == Call::Intrinsic && op->name == Call::set_host_dirty))) {
+            for (size_t i = 1; i < op->args.size(); i++) {
+                op->args[i].accept(this);
+            }
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const Variable *op) {
+        if (op->name == buf_var) {
+            result = false;
+        }
+    }
+
+public:
+    bool result;
+    OnlyCopiedToDevice(const string &b) : buf_var(b), result(true) {}
+};
+
+// Move the loads and stores of a buffer done by host code.
+class OffsetHostAccesses : public IRMutator {
+    const string &buf_name;
+    Expr offset;
+    const Target &target;
+
+    using IRMutator::visit;
+
+    Expr offset_index(Expr index) {
+        if (index.type().is_vector()) {
+            return index + Broadcast::make(offset, index.type().width);
+        } else {
+            return index + offset;
+        }
+    }
+
+    void visit(const For *op) {
+        if (different_device_api(DeviceAPI::Host, op->device_api, target)) {
+            stmt = op;
+        } else {
+            IRMutator::visit(op);
+        }
+    }
+
+    void visit(const Load *op) {
+        IRMutator::visit(op);
+        if (op->name == buf_name) {
+            op = expr.as<Load>();
+            internal_assert(op);
+            expr = Load::make(op->type, op->name, offset_index(op->index), op->image, op->param);
+        }
+    }
+
+    void visit(const Store *op) {
+        IRMutator::visit(op);
+        if (op->name == buf_name) {
+            op = stmt.as<Store>();
+            internal_assert(op);
+            stmt = Store::make(op->name, op->value, offset_index(op->index));
+        }
+    }
+
+public:
+    OffsetHostAccesses(const string &b, Expr o, const Target &t) : buf_name(b), offset(o), target(t) {}
+};
+
+// A buffer allocated in each iteration of a serial loop, computed on
+// the host, and copied to the device asynchronously, can't be
+// written by the next iteration until its copy is done. Double
+// buffer it instead: hoist the allocation out of the loop with room
+// for two iterations, each with a buffer_t that keeps its device
+// allocation for the whole loop. The host then computes iteration
+// i + 1 while iteration i is being copied, and the wait before it
+// writes a slot is for the copy made two iterations earlier.
+class DoubleBufferAsyncCopies : public IRMutator {
+    const set<string> &async_copies;
+    const Target &target;
+    DeviceAPI device_api;
+
+    using IRMutator::visit;
+
+    // Substitute in the lets at the top of a loop body, and return
+    // the result if it's the same in every iteration of the loop.
+    Expr loop_invariant(Expr e, const For *loop, const vector<pair<string, Expr>> &lets) {
+        for (size_t i = lets.size(); i > 0; i--) {
+            e = substitute(lets[i-1].first, lets[i-1].second, e);
+        }
+        e = simplify(e);
+        if (expr_uses_var(e, loop->name)) {
+            return Expr();
+        }
+        return e;
+    }
+
+    Stmt make_device_free(Expr buffer) {
+        Expr call = Call::make(Int(32), "halide_device_free", {buffer}, Call::Extern);
+        string call_result_name = unique_name("device_free_result");
+        Expr call_result_var = Variable::make(Int(32), call_result_name);
+        return LetStmt::make(call_result_name, call,
+                             AssertStmt::make(call_result_var == 0, call_result_var));
+    }
+
+    // Double buffer the allocation at the top of a loop body, if
+    // there is one that can be. Returns an undefined Stmt otherwise.
+    Stmt double_buffer(const For *loop) {
+        vector<pair<string, Expr>> lets;
+        Stmt body = loop->body;
+        while (const LetStmt *let = body.as<LetStmt>()) {
+            lets.push_back(make_pair(let->name, let->value));
+            body = let->body;
+        }
+
+        const Allocate *alloc = body.as<Allocate>();
+        if (!alloc || !async_copies.count(alloc->name) ||
+            alloc->new_expr.defined() || !alloc->free_function.empty()) {
+            return Stmt();
+        }
+        const string &name = alloc->name;
+        const LetStmt *buffer_let = alloc->body.as<LetStmt>();
+        const Call *create = buffer_let ? buffer_let->value.as<Call>() : NULL;
+        if (!create || buffer_let->name != name + ".buffer" ||
+            create->name != Call::create_buffer_t) {
+            return Stmt();
+        }
+
+        OnlyCopiedToDevice only_copied(buffer_let->name);
+        buffer_let->body.accept(&only_copied);
+        if (!only_copied.result) {
+            return Stmt();
+        }
+
+        // The size of the allocation, and the shape of its buffer_t,
+        // must not change from one iteration to the next.
+        vector<Expr> extents;
+        Expr slot_size = 1;
+        for (Expr extent : alloc->extents) {
+            extent = loop_invariant(extent, loop, lets);
+            if (!extent.defined()) {
+                return Stmt();
+            }
+            extents.push_back(extent);
+            slot_size = slot_size * extent;
+        }
+        slot_size = simplify(slot_size);
+        Expr condition = loop_invariant(alloc->condition, loop, lets);
+        if (!condition.defined()) {
+            return Stmt();
+        }
+        // The args after the host pointer are the element size, then
+        // the min, extent, and stride of each dimension. The runtime
+        // functions the slots are passed to don't use the mins.
+        vector<Expr> args = create->args;
+        for (size_t i = 1; i < args.size(); i++) {
+            if (i % 3 == 2) {
+                args[i] = 0;
+            } else {
+                args[i] = loop_invariant(args[i], loop, lets);
+                if (!args[i].defined()) {
+                    return Stmt();
+                }
+            }
+        }
+
+        debug(3) << "Double buffering " << name << " in loop " << loop->name << "\n";
+
+        Expr slot = Variable::make(Int(32), name + ".slot");
+        string slot_names[] = {name + ".slot0", name + ".slot1"};
+        Expr slot_buffers[] = {Variable::make(Handle(), slot_names[0] + ".buffer"),
+                               Variable::make(Handle(), slot_names[1] + ".buffer")};
+
+        Stmt inner = OffsetHostAccesses(name, slot * slot_size, target).mutate(buffer_let->body);
+        inner = LetStmt::make(buffer_let->name, select(slot == 0, slot_buffers[0], slot_buffers[1]), inner);
+        inner = LetStmt::make(name + ".slot", Variable::make(Int(32), loop->name) % 2, inner);
+        for (size_t i = lets.size(); i > 0; i--) {
+            inner = LetStmt::make(lets[i-1].first, lets[i-1].second, inner);
+        }
+        Stmt s = For::make(loop->name, loop->min, loop->extent, loop->for_type, loop->device_api, inner);
+
+        // There may be more allocations to double buffer.
+        Stmt rest = double_buffer(s.as<For>());
+        if (rest.defined()) {
+            s = rest;
+        }
+
+        // Wait for the last copies, and free the device allocations.
+        // They are also freed if the pipeline fails.
+        for (int i = 0; i < 2; i++) {
+            s = Block::make(s, make_wait_for_copies(slot_names[i]));
+        }
+        for (int i = 0; i < 2; i++) {
+            s = Block::make(s, make_device_free(slot_buffers[i]));
+        }
+        for (int i = 1; i >= 0; i--) {
+            Expr destructor = Call::make(Int(32), Call::register_destructor,
+                                         {Expr("halide_device_free_as_destructor"), slot_buffers[i]},
+                                         Call::Intrinsic);
+            s = Block::make(Evaluate::make(destructor), s);
+            Expr host = Load::make(alloc->type, name, i == 0 ? Expr(0) : slot_size, Buffer(), Parameter());
+            args[0] = Call::make(Handle(), Call::address_of, {host}, Call::Intrinsic);
+            Expr buffer = Call::make(Handle(), Call::create_buffer_t, args, Call::Intrinsic);
+            s = LetStmt::make(slot_names[i] + ".buffer", buffer, s);
+        }
+
+        extents.push_back(2);
+        double_buffered.insert(name);
+        return Allocate::make(name, alloc->type, extents, condition, s);
+    }
+
+    void visit(const For *op) {
+        DeviceAPI old_device_api = device_api;
+        if (different_device_api(device_api, op->device_api, target)) {
+            device_api = fixup_device_api(op->device_api, target);
+            if (device_api == DeviceAPI::Parent) {
+                device_api = old_device_api;
+            }
+        }
+        IRMutator::visit(op);
+        if (device_api == DeviceAPI::Host && op->for_type == ForType::Serial) {
+            op = stmt.as<For>();
+            internal_assert(op);
+            Stmt s = double_buffer(op);
+            if (s.defined()) {
+                stmt = s;
+            }
+        }
+        device_api = old_device_api;
+    }
+
+public:
+    DoubleBufferAsyncCopies(const set<string> &a, const Target &t) : async_copies(a), target(t), device_api(DeviceAPI::Host) {}
+
+    // The buffers that were double buffered.
+    set<string> double_buffered;
+};
+
+// An asynchronous copy to the device may still be reading the host
+// memory of a buffer after halide_copy_to_device_async returns. Wait
+// for it before the host writes the buffer again (which may be in a
+// later iteration of a loop, so this doesn't try to work out whether
+// a copy is actually pending), before the host allocation is freed,
+// and before returning from the pipeline. Copies back to the host
+// wait in the runtime. Double buffered allocations already wait for
+// their slots before they are freed.
+class InjectCopyWaits : public IRMutator {
+    const set<string> &async_copies;
+    const set<string> &double_buffered;
+    const Target &target;
+    DeviceAPI device_api;
+
+    using IRMutator::visit;
+
+    // Wait for copies of the buffers of a function before the host
+    // code that computes it.
+    Stmt wait_before_host_stores(const string &func, Stmt s) {
+        if (!s.defined()) {
+            return s;
+        }
+        FindHostStores f(target);
+        s.accept(&f);
+        for (const string &buf_name : f.stores) {
+            if ((buf_name == func || starts_with(buf_name, func + ".")) &&
+                async_copies.count(buf_name)) {
+                s = Block::make(make_wait_for_copies(buf_name), s);
+            }
+        }
+        return s;
+    }
+
+    void visit(const ProducerConsumer *op) {
+        if (device_api != DeviceAPI::Host) {
+            IRMutator::visit(op);
+            return;
+        }
+
+        Stmt produce = wait_before_host_stores(op->name, mutate(op->produce));
+        Stmt update = wait_before_host_stores(op->name, mutate(op->update));
+        Stmt consume = mutate(op->consume);
+        stmt = ProducerConsumer::make(op->name, produce, update, consume);
+    }
+
+    void visit(const Allocate *op) {
+        IRMutator::visit(op);
+        if (device_api != DeviceAPI::Host || !async_copies.count(op->name)) {
+            return;
+        }
+        allocated.insert(op->name);
+        if (double_buffered.count(op->name)) {
+            return;
+        }
+        op = stmt.as<Allocate>();
+        internal_assert(op);
+        Stmt body = Block::make(op->body, make_wait_for_copies(op->name));
+        stmt = Allocate::make(op->name, op->type, op->extents, op->condition, body, op->new_expr, op->free_function);
+    }
+
+    void visit(const For *op) {
+        DeviceAPI old_device_api = device_api;
+        if (different_device_api(device_api, op->device_api, target)) {
+            device_api = fixup_device_api(op->device_api, target);
+            if (device_api == DeviceAPI::Parent) {
+                device_api = old_device_api;
+            }
+        }
+        IRMutator::visit(op);
+        device_api = old_device_api;
+    }
+
+public:
+    InjectCopyWaits(const set<string> &a, const set<string> &d, const Target &t) :
+        async_copies(a), double_buffered(d), target(t), device_api(DeviceAPI::Host) {}
+
+    // The buffers with an Allocate node. The rest are inputs and
+    // outputs.
+    set<string> allocated;
 };
 
 Stmt inject_host_dev_buffer_copies(Stmt s, const Target &t) {
@@ -638,7 +1020,23 @@ Stmt inject_host_dev_buffer_copies(Stmt s, const Target &t) {
         debug(4) << i << "\n";
     }
 
-    return InjectBufferCopies(f.buffers_to_track, t).mutate(s);
+    InjectBufferCopies injector(f.buffers_to_track, t);
+    s = injector.mutate(s);
+
+    if (!injector.async_copies.empty()) {
+        DoubleBufferAsyncCopies double_buffer(injector.async_copies, t);
+        s = double_buffer.mutate(s);
+        InjectCopyWaits waits(injector.async_copies, double_buffer.double_buffered, t);
+        s = waits.mutate(s);
+        for (const string &buf_name : injector.async_copies) {
+            if (!waits.allocated.count(buf_name)) {
+                // The caller owns the host memory of inputs and outputs.
+                s = Block::make(s, make_wait_for_copies(buf_name));
+            }
+        }
+    }
+
+    return s;
 }
 
 }
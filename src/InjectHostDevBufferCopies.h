@@ -12,7 +12,13 @@ namespace Halide {
 namespace Internal {
 
 /** Inject calls to halide_device_malloc, halide_copy_to_device, and
- * halide_copy_to_host as needed. */
+ * halide_copy_to_host as needed. If the target has the
+ * AsyncDeviceCopies feature, copies to the device use
+ * halide_copy_to_device_async instead, and calls to
+ * halide_device_wait_for_copies are injected before the host memory
+ * is next written or freed. Functions computed on the host inside a
+ * serial loop are double buffered, so that the host can compute one
+ * iteration while the previous one is copied. */
 Stmt inject_host_dev_buffer_copies(Stmt s, const Target &t);
 
 /** Inject calls to halide_dev_free as needed. */
@@ -4,12 +4,15 @@
 #include "IROperator.h"
 #include "IRMutator.h"
 #include "Debug.h"
+#include "Simplify.h"
+#include "Substitute.h"
 
 namespace Halide {
 
 using std::string;
 using std::vector;
 using std::ostringstream;
+using std::pair;
 
 namespace Internal {
 
@@ -100,6 +103,169 @@ private:
 };
 }
 
+namespace {
+
+// A compare-exchange of two positions of a sorting network. Afterwards
+// position a holds the min, and position b the max.
+struct Comparator {
+    int a, b;
+};
+
+// Batcher's odd-even merge sort, which sorts any number of
+// values. The network for the next power of two works for fewer
+// values if the missing ones are infinite, because then all
+// comparators involving them do nothing. Those are just left out.
+vector<Comparator> odd_even_merge_sort(int n) {
+    vector<Comparator> network;
+    for (int p = 1; p < n; p *= 2) {
+        for (int k = p; k >= 1; k /= 2) {
+            for (int j = k % p; j <= n - 1 - k; j += 2*k) {
+                for (int i = 0; i <= std::min(k - 1, n - j - k - 1); i++) {
+                    if ((i + j) / (2*p) == (i + j + k) / (2*p)) {
+                        network.push_back({i + j, i + j + k});
+                    }
+                }
+            }
+        }
+    }
+    return network;
+}
+
+// The value of the expression at every point of a reduction domain
+// with constant bounds, with the first dimension innermost.
+vector<Expr> values_over_domain(RDom r, Expr e, const string &name) {
+    vector<Expr> values;
+    values.push_back(e);
+    for (int d = 0; d < r.dimensions(); d++) {
+        const Internal::ReductionVariable &rv = r.domain().domain()[d];
+        Expr min = Internal::simplify(rv.min);
+        Expr extent = Internal::simplify(rv.extent);
+        const int *min_val = Internal::as_const_int(min);
+        const int *extent_val = Internal::as_const_int(extent);
+        user_assert(min_val && extent_val)
+            << "The reduction domain passed to " << name
+            << " must have constant bounds, but the bounds of "
+            << rv.var << " are " << min << ", " << extent << "\n";
+
+        vector<Expr> next;
+        for (int i = 0; i < *extent_val; i++) {
+            for (Expr v : values) {
+                next.push_back(Internal::substitute(rv.var, *min_val + i, v));
+            }
+        }
+        values.swap(next);
+    }
+    user_assert(!values.empty())
+        << "The reduction domain passed to " << name << " is empty\n";
+    return values;
+}
+
+// Compute the values of the given ranks of the values with a sorting
+// network. The network is pruned to the comparisons the ranks asked
+// for depend on, and each value computed is put in a let, so the
+// result doesn't grow exponentially with the depth of the network.
+vector<Expr> sorting_network(const vector<Expr> &values, const vector<int> &ranks) {
+    using namespace Internal;
+
+    const int n = (int)values.size();
+    vector<Comparator> network = odd_even_merge_sort(n);
+
+    // Work backwards from the ranks asked for to find which outputs
+    // of each comparator are needed.
+    vector<bool> needed(n, false);
+    for (int k : ranks) {
+        needed[k] = true;
+    }
+    vector<bool> need_min(network.size()), need_max(network.size());
+    for (size_t i = network.size(); i > 0; i--) {
+        const Comparator &c = network[i-1];
+        need_min[i-1] = needed[c.a];
+        need_max[i-1] = needed[c.b];
+        if (needed[c.a] || needed[c.b]) {
+            needed[c.a] = needed[c.b] = true;
+        }
+    }
+
+    // Then run the network forwards.
+    vector<pair<string, Expr>> lets;
+    vector<Expr> current(n);
+    for (int i = 0; i < n; i++) {
+        if (needed[i]) {
+            string name = unique_name('s');
+            lets.push_back({name, values[i]});
+            current[i] = Variable::make(values[i].type(), name);
+        }
+    }
+    for (size_t i = 0; i < network.size(); i++) {
+        const Comparator &c = network[i];
+        Expr a = current[c.a], b = current[c.b];
+        if (need_min[i]) {
+            string name = unique_name('s');
+            lets.push_back({name, min(a, b)});
+            current[c.a] = Variable::make(a.type(), name);
+        }
+        if (need_max[i]) {
+            string name = unique_name('s');
+            lets.push_back({name, max(a, b)});
+            current[c.b] = Variable::make(b.type(), name);
+        }
+    }
+
+    vector<Expr> result;
+    for (int k : ranks) {
+        Expr e = current[k];
+        for (size_t i = lets.size(); i > 0; i--) {
+            e = Let::make(lets[i-1].first, lets[i-1].second, e);
+        }
+        result.push_back(e);
+    }
+    return result;
+}
+
+RDom find_rdom(Expr e, const string &name) {
+    Internal::FindFreeVars v(RDom(), name);
+    v.mutate(e);
+    user_assert(v.rdom.defined())
+        << "Expression passed to " << name << " must reference a reduction domain";
+    return v.rdom;
+}
+
+}
+
+Tuple sorted(Expr e) {
+    return sorted(find_rdom(e, "sorted"), e);
+}
+
+Tuple sorted(RDom r, Expr e) {
+    vector<Expr> values = values_over_domain(r, e, "sorted");
+    vector<int> ranks(values.size());
+    for (size_t i = 0; i < ranks.size(); i++) {
+        ranks[i] = (int)i;
+    }
+    return Tuple(sorting_network(values, ranks));
+}
+
+Expr kth_smallest(Expr e, int k) {
+    return kth_smallest(find_rdom(e, "kth_smallest"), e, k);
+}
+
+Expr kth_smallest(RDom r, Expr e, int k) {
+    vector<Expr> values = values_over_domain(r, e, "kth_smallest");
+    user_assert(k >= 0 && k < (int)values.size())
+        << "Can't take the value of rank " << k << " of "
+        << values.size() << " values\n";
+    return sorting_network(values, {k})[0];
+}
+
+Expr median(Expr e) {
+    return median(find_rdom(e, "median"), e);
+}
+
+Expr median(RDom r, Expr e) {
+    vector<Expr> values = values_over_domain(r, e, "median");
+    return sorting_network(values, {((int)values.size() - 1)/2})[0];
+}
+
 Expr sum(Expr e, const std::string &name) {
     return sum(RDom(), e, name);
 }
@@ -6,7 +6,8 @@
 #include "Tuple.h"
 
 /** \file
- * Defines some inline reductions: sum, product, minimum, maximum.
+ * Defines some inline reductions: sum, product, minimum, maximum,
+ * and order statistics computed with sorting networks.
  */
 namespace Halide {
 
@@ -67,6 +68,42 @@ EXPORT Tuple argmax(RDom, Expr, const std::string &s = "argmax");
 EXPORT Tuple argmin(RDom, Expr, const std::string &s = "argmin");
 // @}
 
+/** Order statistics of an expression over a reduction domain of
+ * constant size, such as the values in a small window of an image,
+ * computed with a sorting network of min and max operations. As with
+ * the inline reductions, the expression may contain free variables,
+ * and the RDom may be given explicitly or found in the
+ * expression. Unlike them, no reduction function is made: the result
+ * is an expression of the values at each point of the domain, so it
+ * vectorizes across the free variables and is computed in
+ * registers. The network only has the comparisons needed for the
+ * values asked for, so a median does less work than a full sort.
+ *
+ * A 3x3 median filter:
+ \code
+ Func in, out;
+ Var x, y;
+ RDom r(-1, 3, -1, 3);
+ out(x, y) = median(in(x + r.x, y + r.y));
+ \endcode
+ */
+// @{
+
+/** All of the values, in ascending order. */
+EXPORT Tuple sorted(Expr);
+EXPORT Tuple sorted(RDom, Expr);
+
+/** The value of rank k: the smallest if k is zero, and the largest
+ * if k is one less than the size of the domain. */
+EXPORT Expr kth_smallest(Expr, int k);
+EXPORT Expr kth_smallest(RDom, Expr, int k);
+
+/** The median value. For domains of even size, this is the lower of
+ * the two middle values. */
+EXPORT Expr median(Expr);
+EXPORT Expr median(RDom, Expr);
+// @}
+
 }
 
 #endif
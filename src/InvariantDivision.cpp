@@ -0,0 +1,293 @@
+#include <set>
+
+#include "InvariantDivision.h"
+#include "Debug.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::pair;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Find all the names defined inside a statement.
+class FindDefinitions : public IRGraphVisitor {
+public:
+    set<string> names;
+
+    using IRGraphVisitor::visit;
+
+    void visit(const Let *op) {
+        names.insert(op->name);
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const LetStmt *op) {
+        names.insert(op->name);
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const For *op) {
+        names.insert(op->name);
+        IRGraphVisitor::visit(op);
+    }
+};
+
+// Check if an expression can be evaluated outside of a loop. Loads
+// and calls might depend on side-effects within the loop, so we
+// reject them.
+class IsInvariant : public IRGraphVisitor {
+    const set<string> &inner;
+public:
+    bool result;
+
+    IsInvariant(const set<string> &i) : inner(i), result(true) {}
+
+    using IRGraphVisitor::visit;
+
+    void visit(const Variable *op) {
+        if (inner.count(op->name)) {
+            result = false;
+        }
+    }
+
+    void visit(const Load *op) {
+        result = false;
+    }
+
+    void visit(const Call *op) {
+        result = false;
+    }
+};
+
+// A denominator hoisted out of a loop, and the lets that compute the
+// values needed to divide by it using multiplies and shifts. The
+// method is the round-up method also used by the IntegerDivisionTable:
+// with l = ceil(log2(d)), and m = 2^N * (2^l - d) / d + 1,
+// n / d == (mulhi(m, n) + ((n - mulhi(m, n)) >> min(l, 1))) >> max(l - 1, 0)
+// for all N-bit unsigned n.
+struct InvariantDivisor {
+    Expr denominator;
+    vector<pair<string, Expr> > lets;
+    Expr multiplier, shift1, shift2, sign;
+
+    InvariantDivisor(Expr d) : denominator(d) {
+        Type t = d.type();
+        Type ut = UInt(t.bits);
+        Type wide = UInt(t.bits * 2);
+        string prefix = unique_name('d');
+
+        // Signed division is done by dividing the magnitudes, so we
+        // need the sign and magnitude of the denominator.
+        Expr abs_d = d;
+        if (t.is_int()) {
+            sign = define(prefix + ".sign", d >> (t.bits - 1));
+            abs_d = select(d < 0, make_zero(ut) - cast(ut, d), cast(ut, d));
+        }
+
+        // Division by zero is undefined, but the division may be
+        // guarded by a condition inside the loop, so we must not fault
+        // when computing the multiplier.
+        abs_d = define(prefix + ".abs", max(abs_d, make_one(ut)));
+
+        // Compute ceil(log2(abs_d)) as the number of bits in abs_d - 1,
+        // using a binary search.
+        Expr x = define(prefix + ".log2.rem.0", abs_d - make_one(ut));
+        Expr log2 = make_zero(ut);
+        for (int s = t.bits / 2, i = 1; s > 0; s /= 2, i++) {
+            Expr big = x >= make_const(ut, 1 << s);
+            log2 = define(prefix + ".log2.bits." + std::to_string(i),
+                          log2 + select(big, make_const(ut, s), make_zero(ut)));
+            x = define(prefix + ".log2.rem." + std::to_string(i),
+                       select(big, x / make_const(ut, 1 << s), x));
+        }
+        log2 = define(prefix + ".log2", log2 + x);
+
+        Expr two_to_the_log2 = make_one(wide) << cast(wide, log2);
+        Expr m = ((two_to_the_log2 - cast(wide, abs_d)) << make_const(wide, t.bits)) / cast(wide, abs_d);
+        multiplier = define(prefix + ".multiplier", cast(ut, m + make_one(wide)));
+        shift1 = define(prefix + ".shift1", min(log2, make_one(ut)));
+        shift2 = define(prefix + ".shift2", log2 - shift1);
+    }
+
+    Expr define(const string &name, Expr value) {
+        lets.push_back(std::make_pair(name, value));
+        return Variable::make(value.type(), name);
+    }
+
+    Expr broadcast(Expr e, int width) const {
+        return width > 1 ? Broadcast::make(e, width) : e;
+    }
+
+    // Unsigned division of x, which is of the unsigned type the
+    // multipliers were computed for.
+    Expr unsigned_divide(Expr x) const {
+        Type t = x.type();
+        Type wide = t;
+        wide.bits *= 2;
+
+        // Multiply-keep-high-half
+        Expr q = cast(wide, broadcast(multiplier, t.width)) * cast(wide, x);
+        if (t.bits < 32) q = q / (1 << t.bits);
+        else q = q >> t.bits;
+        q = cast(t, q);
+
+        // Add half the difference between input and output so far,
+        // then do the final shift.
+        q = (q + ((x - q) >> broadcast(shift1, t.width))) >> broadcast(shift2, t.width);
+        return q;
+    }
+
+    Expr divide(Expr a) const {
+        Type t = a.type();
+        if (t.is_uint()) {
+            return unsigned_divide(a);
+        }
+
+        // Round towards negative infinity by flipping the bits of
+        // negative numerators before and after an unsigned division
+        // by the magnitude of the denominator.
+        Type ut = UInt(t.bits, t.width);
+        Expr xsign = a >> (t.bits - 1);
+        Expr q = cast(t, unsigned_divide(cast(ut, xsign ^ a))) ^ xsign;
+
+        // Negate the result for negative denominators, to get
+        // Euclidean division.
+        Expr s = broadcast(sign, t.width);
+        return (q ^ s) - s;
+    }
+};
+
+// Replace divisions and mods by denominators that are invariant in a
+// loop, given the names defined inside that loop.
+class ReplaceInvariantDivision : public IRMutator {
+    const set<string> &inner;
+
+    using IRMutator::visit;
+
+    // Returns the index of the divisor in the divisors vector, or -1
+    // if the denominator isn't invariant.
+    int invariant_divisor(const Expr &num, const Expr &den) {
+        Type t = num.type();
+        if (!(t.is_int() || t.is_uint()) || t.bits > 32) {
+            return -1;
+        }
+        Expr d = den;
+        if (const Broadcast *b = d.as<Broadcast>()) {
+            d = b->value;
+        }
+        if (!d.type().is_scalar()) {
+            // A vector of different denominators, e.g. a ramp that
+            // is invariant in an outer loop. Each lane would need
+            // its own multiplier.
+            return -1;
+        }
+        if (is_const(d)) {
+            // These get handled during codegen.
+            return -1;
+        }
+        IsInvariant check(inner);
+        d.accept(&check);
+        if (!check.result) {
+            return -1;
+        }
+        for (size_t i = 0; i < divisors.size(); i++) {
+            if (equal(divisors[i].denominator, d)) {
+                return (int)i;
+            }
+        }
+        debug(3) << "Hoisting multiplier for division by " << d << "\n";
+        divisors.push_back(InvariantDivisor(d));
+        return (int)divisors.size() - 1;
+    }
+
+    void visit(const Div *op) {
+        int idx = invariant_divisor(op->a, op->b);
+        if (idx >= 0) {
+            Expr a = mutate(op->a);
+            expr = divisors[idx].divide(a);
+        } else {
+            IRMutator::visit(op);
+        }
+    }
+
+    void visit(const Mod *op) {
+        int idx = invariant_divisor(op->a, op->b);
+        if (idx >= 0) {
+            Expr a = mutate(op->a);
+            Expr b = mutate(op->b);
+            expr = a - divisors[idx].divide(a) * b;
+        } else {
+            IRMutator::visit(op);
+        }
+    }
+
+    void visit(const For *op) {
+        if (op->device_api != DeviceAPI::Parent &&
+            op->device_api != DeviceAPI::Host) {
+            // The hoisted multipliers live on the host, so leave
+            // loops that run on a device alone.
+            stmt = op;
+            return;
+        }
+        IRMutator::visit(op);
+    }
+
+public:
+    vector<InvariantDivisor> divisors;
+
+    ReplaceInvariantDivision(const set<string> &i) : inner(i) {}
+};
+
+class LowerInvariantDivision : public IRMutator {
+    using IRMutator::visit;
+
+    void visit(const For *op) {
+        if (op->device_api != DeviceAPI::Parent &&
+            op->device_api != DeviceAPI::Host) {
+            // Leave loops that run on a device alone.
+            stmt = op;
+            return;
+        }
+
+        FindDefinitions defs;
+        op->body.accept(&defs);
+        defs.names.insert(op->name);
+
+        // Handle the denominators invariant in this loop, and then
+        // the ones invariant in loops further in.
+        ReplaceInvariantDivision replacer(defs.names);
+        Stmt body = replacer.mutate(op->body);
+        body = mutate(body);
+
+        if (body.same_as(op->body)) {
+            stmt = op;
+            return;
+        }
+
+        stmt = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+
+        for (size_t i = replacer.divisors.size(); i > 0; i--) {
+            const InvariantDivisor &div = replacer.divisors[i-1];
+            for (size_t j = div.lets.size(); j > 0; j--) {
+                stmt = LetStmt::make(div.lets[j-1].first, div.lets[j-1].second, stmt);
+            }
+        }
+    }
+};
+
+}
+
+Stmt lower_invariant_division(Stmt s) {
+    return LowerInvariantDivision().mutate(s);
+}
+
+}
+}
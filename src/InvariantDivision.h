@@ -0,0 +1,27 @@
+#ifndef HALIDE_INVARIANT_DIVISION_H
+#define HALIDE_INVARIANT_DIVISION_H
+
+/** \file
+ * Defines the lowering pass that replaces integer division by
+ * loop-invariant values with multiplies and shifts.
+ */
+
+#include "IR.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Find integer divisions and mods inside loops whose denominators
+ * are not constant, but are invariant in some enclosing loop (e.g. a
+ * Param). Compute a multiplier and shifts for each such denominator
+ * just outside the outermost loop in which it is invariant, and
+ * replace the division inside the loop with a multiply-keep-high-half
+ * and shifts, which vectorizes, unlike hardware division. Handles 8,
+ * 16, and 32-bit signed and unsigned types. Loops that run on a GPU
+ * are left alone. */
+Stmt lower_invariant_division(Stmt s);
+
+}
+}
+
+#endif
@@ -4,6 +4,7 @@
 #include <set>
 
 #include "CodeGen_Internal.h"
+#include "CompileProfiler.h"
 #include "JITModule.h"
 #include "LLVM_Headers.h"
 #include "LLVM_Runtime_Linker.h"
@@ -219,6 +220,8 @@ void JITModule::compile_module(llvm::Module *m, const string &function_name, con
                                const std::vector<JITModule> &dependencies,
                                const std::vector<std::string> &requested_exports) {
 
+    CompileProfiler profiler("jit", function_name.empty() ? "runtime" : function_name, m);
+
     // Make the execution engine
     debug(2) << "Creating new execution engine\n";
     debug(2) << "Target triple: " << m->getTargetTriple() << "\n";
@@ -315,6 +318,7 @@ void JITModule::compile_module(llvm::Module *m, const string &function_name, con
 
     debug(2) << "Finalizing object\n";
     ee->finalizeObject();
+    profiler.phase_done("jit compile");
 
     // Do any target-specific post-compilation module meddling
     for (size_t i = 0; i < listeners.size(); i++) {
@@ -462,6 +466,10 @@ JITHandlers runtime_internal_handlers;
 JITHandlers default_handlers;
 JITHandlers active_handlers;
 int64_t default_cache_size;
+// Whether the main shared runtime was built with the shared memory
+// memoization cache. It holds the cache for every JIT compiled
+// pipeline, so this is fixed by the first one.
+bool main_shared_uses_shared_cache;
 
 void merge_handlers(JITHandlers &base, const JITHandlers &addins) {
     if (addins.custom_print) {
@@ -591,6 +599,7 @@ enum RuntimeKind {
     CUDA,
     OpenGL,
     OpenGLCompute,
+    HostDevice,
     MaxRuntimeKind
 };
 
@@ -622,6 +631,7 @@ JITModule &make_module(llvm::Module *for_module, Target target,
         one_gpu.set_feature(Target::CUDA, false);
         one_gpu.set_feature(Target::OpenGL, false);
         one_gpu.set_feature(Target::OpenGLCompute, false);
+        one_gpu.set_feature(Target::HostDevice, false);
         string module_name;
         switch (runtime_kind) {
         case OpenCL:
@@ -642,6 +652,10 @@ JITModule &make_module(llvm::Module *for_module, Target target,
             module_name = "openglcompute";
             load_opengl();
             break;
+        case HostDevice:
+            one_gpu.set_feature(Target::HostDevice);
+            module_name = "host_device";
+            break;
         default:
             module_name = "shared runtime";
             break;
@@ -696,6 +710,8 @@ JITModule &make_module(llvm::Module *for_module, Target target,
                 shared_runtimes(MainShared).memoization_cache_set_size(default_cache_size);
             }
 
+            main_shared_uses_shared_cache = target.has_feature(Target::SharedMemoizationCache);
+
             runtime.jit_module.ptr->name = "MainShared";
         } else {
             runtime.jit_module.ptr->name = "GPU";
@@ -730,8 +746,17 @@ std::vector<JITModule> JITSharedRuntime::get(llvm::Module *for_module, const Tar
     std::vector<JITModule> result;
 
     JITModule m = make_module(for_module, target, MainShared, result, create);
-    if (m.compiled())
+    if (m.compiled()) {
         result.push_back(m);
+        if (target.has_feature(Target::SharedMemoizationCache) != main_shared_uses_shared_cache) {
+            user_warning << "The JIT runtime of this process was created "
+                         << (main_shared_uses_shared_cache ? "with" : "without")
+                         << " the shared_memoization_cache feature, so target "
+                         << target.to_string() << " uses that cache too. "
+                         << "Use the same setting for every JIT compilation, "
+                         << "or call JITSharedRuntime::release_all first.\n";
+        }
+    }
 
     // Add all requested GPU modules, each only depending on the main shared runtime.
     std::vector<JITModule> gpu_modules;
@@ -755,6 +780,11 @@ std::vector<JITModule> JITSharedRuntime::get(llvm::Module *for_module, const Tar
         if (m.compiled())
             result.push_back(m);
     }
+    if (target.has_feature(Target::HostDevice)) {
+        JITModule m = make_module(for_module, target, HostDevice, result, create);
+        if (m.compiled())
+            result.push_back(m);
+    }
 
     return result;
 }
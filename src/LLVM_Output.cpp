@@ -2,6 +2,7 @@
 #include "LLVM_Output.h"
 #include "CodeGen_LLVM.h"
 #include "CodeGen_C.h"
+#include "CompileProfiler.h"
 
 #include <iostream>
 #include <fstream>
@@ -252,11 +253,15 @@ llvm::Module *compile_module_to_llvm_module(const Module &module, llvm::LLVMCont
 }
 
 void compile_llvm_module_to_object(llvm::Module *module, const std::string &filename) {
+    Internal::CompileProfiler profiler("llvm", filename, module);
     emit_file(module, filename, llvm::TargetMachine::CGFT_ObjectFile);
+    profiler.phase_done("emit object");
 }
 
 void compile_llvm_module_to_assembly(llvm::Module *module, const std::string &filename) {
+    Internal::CompileProfiler profiler("llvm", filename, module);
     emit_file(module, filename, llvm::TargetMachine::CGFT_AssemblyFile);
+    profiler.phase_done("emit assembly");
 }
 
 void compile_llvm_module_to_native(llvm::Module *module,
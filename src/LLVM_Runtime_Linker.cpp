@@ -1,5 +1,10 @@
+#include <map>
+#include <mutex>
+#include <set>
+
 #include "LLVM_Runtime_Linker.h"
 #include "LLVM_Headers.h"
+#include "Debug.h"
 
 namespace Halide {
 
@@ -77,12 +82,14 @@ DECLARE_CPP_INITMOD(android_clock)
 DECLARE_CPP_INITMOD(android_host_cpu_count)
 DECLARE_CPP_INITMOD(android_io)
 DECLARE_CPP_INITMOD(android_opengl_context)
+DECLARE_CPP_INITMOD(auto_specialize)
 DECLARE_CPP_INITMOD(ios_io)
 DECLARE_CPP_INITMOD(cuda)
 DECLARE_CPP_INITMOD(destructors)
 DECLARE_CPP_INITMOD(windows_cuda)
 DECLARE_CPP_INITMOD(fake_thread_pool)
 DECLARE_CPP_INITMOD(gcd_thread_pool)
+DECLARE_CPP_INITMOD(host_device)
 DECLARE_CPP_INITMOD(linux_clock)
 DECLARE_CPP_INITMOD(linux_host_cpu_count)
 DECLARE_CPP_INITMOD(linux_opengl_context)
@@ -105,9 +112,12 @@ DECLARE_CPP_INITMOD(posix_thread_pool)
 DECLARE_CPP_INITMOD(windows_thread_pool)
 DECLARE_CPP_INITMOD(tracing)
 DECLARE_CPP_INITMOD(write_debug_image)
+DECLARE_CPP_INITMOD(x86_cpu_features)
 DECLARE_CPP_INITMOD(posix_print)
 DECLARE_CPP_INITMOD(gpu_device_selection)
 DECLARE_CPP_INITMOD(cache)
+DECLARE_CPP_INITMOD(shared_cache)
+DECLARE_CPP_INITMOD(osx_shared_cache)
 DECLARE_CPP_INITMOD(nacl_host_cpu_count)
 DECLARE_CPP_INITMOD(to_string)
 DECLARE_CPP_INITMOD(module_jit_ref_count)
@@ -119,6 +129,7 @@ DECLARE_CPP_INITMOD(posix_get_symbol)
 DECLARE_CPP_INITMOD(osx_get_symbol)
 DECLARE_CPP_INITMOD(windows_get_symbol)
 DECLARE_CPP_INITMOD(renderscript)
+DECLARE_CPP_INITMOD(pipeline_stats)
 DECLARE_CPP_INITMOD(profiler)
 DECLARE_CPP_INITMOD(profiler_inlined)
 DECLARE_CPP_INITMOD(runtime_api)
@@ -519,8 +530,10 @@ void add_underscores_to_posix_calls_on_windows(llvm::Module *m) {
     }
 }
 
-/** Create an llvm module containing the support code for a given target. */
-llvm::Module *get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
+namespace {
+
+/** Parse and link the runtime modules for a given target. */
+llvm::Module *link_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
     enum InitialModuleType {
         ModuleAOT,
         ModuleAOTNoRuntime,
@@ -616,11 +629,19 @@ llvm::Module *get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool
             modules.push_back(get_initmod_posix_allocator(c, bits_64, debug));
             modules.push_back(get_initmod_posix_error_handler(c, bits_64, debug));
             modules.push_back(get_initmod_posix_print(c, bits_64, debug));
-            modules.push_back(get_initmod_cache(c, bits_64, debug));
+            if (t.has_feature(Target::SharedMemoizationCache) && t.os == Target::Linux) {
+                modules.push_back(get_initmod_shared_cache(c, bits_64, debug));
+            } else if (t.has_feature(Target::SharedMemoizationCache) && t.os == Target::OSX) {
+                modules.push_back(get_initmod_osx_shared_cache(c, bits_64, debug));
+            } else {
+                modules.push_back(get_initmod_cache(c, bits_64, debug));
+            }
             modules.push_back(get_initmod_to_string(c, bits_64, debug));
             modules.push_back(get_initmod_device_interface(c, bits_64, debug));
             modules.push_back(get_initmod_metadata(c, bits_64, debug));
+            modules.push_back(get_initmod_pipeline_stats(c, bits_64, debug));
             modules.push_back(get_initmod_profiler(c, bits_64, debug));
+            modules.push_back(get_initmod_auto_specialize(c, bits_64, debug));
         }
 
         if (module_type != ModuleJITShared) {
@@ -699,6 +720,8 @@ llvm::Module *get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool
 
         } else if (t.has_feature(Target::Renderscript)) {
             modules.push_back(get_initmod_renderscript(c, bits_64, debug));
+        } else if (t.has_feature(Target::HostDevice)) {
+            modules.push_back(get_initmod_host_device(c, bits_64, debug));
         }
     }
 
@@ -706,6 +729,10 @@ llvm::Module *get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool
         modules.push_back(get_initmod_matlab(c, bits_64, debug));
     }
 
+    if (module_type == ModuleAOT && t.arch == Target::X86) {
+        modules.push_back(get_initmod_x86_cpu_features(c, bits_64, debug));
+    }
+
     if (module_type == ModuleAOTNoRuntime ||
         module_type == ModuleJITInlined) {
         modules.push_back(get_initmod_runtime_api(c, bits_64, debug));
@@ -726,6 +753,143 @@ llvm::Module *get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool
     return modules[0];
 }
 
+// Parsing and linking the dozens of runtime modules dominates the
+// compile time of small pipelines, so we do it once per kind of
+// initial module, and keep the result as bitcode. Modules belong to
+// an LLVMContext, and each compilation uses a fresh one, so we can't
+// just clone a cached llvm::Module. The bitcode is never freed, as
+// lazily-loaded modules refer to it.
+std::mutex initial_module_cache_mutex;
+std::map<string, string> initial_module_cache;
+
+const string &get_initial_module_bitcode(Target t, bool for_shared_jit_runtime, bool just_gpu) {
+    string key = t.to_string();
+    key += for_shared_jit_runtime ? "/shared" : "";
+    key += just_gpu ? "/gpu" : "";
+
+    std::lock_guard<std::mutex> lock(initial_module_cache_mutex);
+    std::map<string, string>::iterator iter = initial_module_cache.find(key);
+    if (iter != initial_module_cache.end()) {
+        return iter->second;
+    }
+
+    debug(2) << "Linking initial module for " << key << "\n";
+    llvm::LLVMContext context;
+    llvm::Module *module = link_initial_module_for_target(t, &context, for_shared_jit_runtime, just_gpu);
+    string &bitcode = initial_module_cache[key];
+    llvm::raw_string_ostream stream(bitcode);
+    llvm::WriteBitcodeToFile(module, stream);
+    stream.flush();
+    delete module;
+    return bitcode;
+}
+
+#if LLVM_VERSION >= 36 && !WITH_NATIVE_CLIENT
+// Only the function bodies that are materialized get deserialized,
+// so we can skip the bulk of the runtime a pipeline doesn't call.
+llvm::Module *parse_lazy_bitcode_file(llvm::StringRef buf, llvm::LLVMContext *context, const char *id) {
+    std::unique_ptr<llvm::MemoryBuffer> buffer = llvm::MemoryBuffer::getMemBuffer(buf, id, false);
+    #if LLVM_VERSION >= 37
+    llvm::Module *mod = llvm::getLazyBitcodeModule(std::move(buffer), *context).get().release();
+    #else
+    llvm::Module *mod = llvm::getLazyBitcodeModule(std::move(buffer), *context).get();
+    #endif
+    mod->setModuleIdentifier(id);
+    return mod;
+}
+
+// Add the functions referred to by a Constant to a worklist.
+void find_referenced_functions(llvm::Constant *c, std::set<llvm::Constant *> &seen, vector<llvm::Function *> &worklist) {
+    if (!seen.insert(c).second) return;
+    if (llvm::Function *f = llvm::dyn_cast<llvm::Function>(c)) {
+        worklist.push_back(f);
+    } else if (!llvm::isa<llvm::GlobalValue>(c)) {
+        for (size_t i = 0; i < c->getNumOperands(); i++) {
+            if (llvm::Constant *op = llvm::dyn_cast<llvm::Constant>(c->getOperand(i))) {
+                find_referenced_functions(op, seen, worklist);
+            }
+        }
+    }
+}
+#endif
+
+}
+
+/** Create an llvm module containing the support code for a given target. */
+llvm::Module *get_initial_module_for_target(Target t, llvm::LLVMContext *c, bool for_shared_jit_runtime, bool just_gpu) {
+    const string &bitcode = get_initial_module_bitcode(t, for_shared_jit_runtime, just_gpu);
+    return parse_bitcode_file(bitcode, c, "halide_runtime");
+}
+
+llvm::Module *get_lazy_initial_module_for_target(Target t, llvm::LLVMContext *c) {
+    const string &bitcode = get_initial_module_bitcode(t, false, false);
+    #if LLVM_VERSION >= 36 && !WITH_NATIVE_CLIENT
+    return parse_lazy_bitcode_file(bitcode, c, "halide_runtime");
+    #else
+    return parse_bitcode_file(bitcode, c, "halide_runtime");
+    #endif
+}
+
+void materialize_used_runtime_functions(llvm::Module *m) {
+    #if LLVM_VERSION >= 36 && !WITH_NATIVE_CLIENT
+    std::set<llvm::Constant *> seen;
+    vector<llvm::Function *> worklist;
+
+    // Functions that can't be discarded are needed regardless, and
+    // functions that are already materialized (including the code
+    // generated for the pipeline) may call others.
+    for (llvm::Module::iterator iter = m->begin(); iter != m->end(); iter++) {
+        llvm::Function *f = (llvm::Function *)(iter);
+        if (!f->isMaterializable() || !f->isDiscardableIfUnused()) {
+            find_referenced_functions(f, seen, worklist);
+        }
+    }
+    for (llvm::Module::global_iterator iter = m->global_begin(); iter != m->global_end(); iter++) {
+        if (iter->hasInitializer()) {
+            find_referenced_functions(iter->getInitializer(), seen, worklist);
+        }
+    }
+    for (llvm::Module::alias_iterator iter = m->alias_begin(); iter != m->alias_end(); iter++) {
+        find_referenced_functions(iter->getAliasee(), seen, worklist);
+    }
+
+    // Materialize everything reachable from those.
+    while (!worklist.empty()) {
+        llvm::Function *f = worklist.back();
+        worklist.pop_back();
+        if (f->isMaterializable()) {
+            std::error_code err = f->materialize();
+            internal_assert(!err) << "Failed to load runtime function " << f->getName().str() << "\n";
+        }
+        for (llvm::Function::iterator b = f->begin(); b != f->end(); b++) {
+            for (llvm::BasicBlock::iterator i = b->begin(); i != b->end(); i++) {
+                for (size_t j = 0; j < i->getNumOperands(); j++) {
+                    if (llvm::Constant *op = llvm::dyn_cast<llvm::Constant>(i->getOperand(j))) {
+                        find_referenced_functions(op, seen, worklist);
+                    }
+                }
+            }
+        }
+    }
+
+    // Drop the rest.
+    for (llvm::Module::iterator iter = m->begin(); iter != m->end(); ) {
+        llvm::Function *f = (llvm::Function *)(iter++);
+        if (f->isMaterializable()) {
+            f->removeDeadConstantUsers();
+            if (f->use_empty()) {
+                f->eraseFromParent();
+            } else {
+                f->materialize();
+            }
+        }
+    }
+
+    std::error_code err = m->materializeAllPermanently();
+    internal_assert(!err) << "Failed to load runtime module\n";
+    #endif
+}
+
 #ifdef WITH_PTX
 llvm::Module *get_initial_module_for_ptx_device(Target target, llvm::LLVMContext *c) {
     std::vector<llvm::Module *> modules;
@@ -19,6 +19,17 @@ namespace Internal {
 /** Create an llvm module containing the support code for a given target. */
 llvm::Module *get_initial_module_for_target(Target, llvm::LLVMContext *, bool for_shared_jit_runtime = false, bool just_gpu = false);
 
+/** Like get_initial_module_for_target, but the bodies of the runtime
+ * functions are not loaded until materialize_used_runtime_functions
+ * is called on the module, which must happen before it is used for
+ * anything but adding new code. */
+llvm::Module *get_lazy_initial_module_for_target(Target, llvm::LLVMContext *);
+
+/** Load the bodies of the runtime functions in a module made by
+ * get_lazy_initial_module_for_target that are reachable from the
+ * rest of the module, and delete the unused ones. */
+void materialize_used_runtime_functions(llvm::Module *);
+
 /** Create an llvm module containing the support code for ptx device. */
 llvm::Module *get_initial_module_for_ptx_device(Target, llvm::LLVMContext *c);
 
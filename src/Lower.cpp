@@ -8,9 +8,12 @@
 #include "AddImageChecks.h"
 #include "AddParameterChecks.h"
 #include "AllocationBoundsInference.h"
+#include "AutoSpecialize.h"
 #include "Bounds.h"
 #include "BoundsInference.h"
 #include "CSE.h"
+#include "CompileProfiler.h"
+#include "ComputeWith.h"
 #include "Debug.h"
 #include "DebugToFile.h"
 #include "Deinterleave.h"
@@ -18,14 +21,17 @@
 #include "FindCalls.h"
 #include "Function.h"
 #include "FuseGPUThreadLoops.h"
+#include "HostDeviceLoops.h"
 #include "InjectHostDevBufferCopies.h"
 #include "InjectImageIntrinsics.h"
 #include "InjectOpenGLIntrinsics.h"
 #include "Inline.h"
+#include "InvariantDivision.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "IRPrinter.h"
 #include "Memoization.h"
+#include "OptimizeShuffles.h"
 #include "PartitionLoops.h"
 #include "Profiling.h"
 #include "Qualify.h"
@@ -61,6 +67,8 @@ using std::make_pair;
 
 Stmt lower(const vector<Function> &outputs, const string &pipeline_name, const Target &t, const vector<IRMutator *> &custom_passes) {
 
+    CompileProfiler profiler("lower", pipeline_name);
+
     // Compute an environment
     map<string, Function> env;
     for (Function f : outputs) {
@@ -76,11 +84,13 @@ Stmt lower(const vector<Function> &outputs, const string &pipeline_name, const T
     debug(1) << "Creating initial loop nests...\n";
     Stmt s = schedule_functions(outputs, order, env, any_memoized, !t.has_feature(Target::NoAsserts));
     debug(2) << "Lowering after creating initial loop nests:\n" << s << '\n';
+    profiler.phase_done("schedule_functions", s);
 
     if (any_memoized) {
         debug(1) << "Injecting memoization...\n";
         s = inject_memoization(s, env, pipeline_name, outputs);
         debug(2) << "Lowering after injecting memoization:\n" << s << '\n';
+        profiler.phase_done("inject_memoization", s);
     } else {
         debug(1) << "Skipping injecting memoization...\n";
     }
@@ -88,27 +98,32 @@ Stmt lower(const vector<Function> &outputs, const string &pipeline_name, const T
     debug(1) << "Injecting tracing...\n";
     s = inject_tracing(s, env, outputs);
     debug(2) << "Lowering after injecting tracing:\n" << s << '\n';
+    profiler.phase_done("inject_tracing", s);
 
     if (t.has_feature(Target::Profile)) {
         debug(1) << "Injecting profiling...\n";
         s = inject_profiling(s, pipeline_name);
         debug(2) << "Lowering after injecting profiling:\n" << s << '\n';
+        profiler.phase_done("inject_profiling", s);
     }
 
     debug(1) << "Adding checks for parameters\n";
     s = add_parameter_checks(s, t);
     debug(2) << "Lowering after injecting parameter checks:\n" << s << '\n';
+    profiler.phase_done("add_parameter_checks", s);
 
     // Compute the maximum and minimum possible value of each
     // function. Used in later bounds inference passes.
     debug(1) << "Computing bounds of each function's value\n";
     FuncValueBounds func_bounds = compute_function_value_bounds(order, env);
+    profiler.phase_done("compute_function_value_bounds");
 
     // The checks will be in terms of the symbols defined by bounds
     // inference.
     debug(1) << "Adding checks for images\n";
     s = add_image_checks(s, outputs, t, order, env, func_bounds);
     debug(2) << "Lowering after injecting image checks:\n" << s << '\n';
+    profiler.phase_done("add_image_checks", s);
 
     // This pass injects nested definitions of variable names, so we
     // can't simplify statements from here until we fix them up. (We
@@ -116,18 +131,27 @@ Stmt lower(const vector<Function> &outputs, const string &pipeline_name, const T
     debug(1) << "Performing computation bounds inference...\n";
     s = bounds_inference(s, outputs, order, env, func_bounds);
     debug(2) << "Lowering after computation bounds inference:\n" << s << '\n';
+    profiler.phase_done("bounds_inference", s);
 
     debug(1) << "Performing sliding window optimization...\n";
     s = sliding_window(s, env);
     debug(2) << "Lowering after sliding window:\n" << s << '\n';
+    profiler.phase_done("sliding_window", s);
 
     debug(1) << "Performing allocation bounds inference...\n";
     s = allocation_bounds_inference(s, env, func_bounds);
     debug(2) << "Lowering after allocation bounds inference:\n" << s << '\n';
+    profiler.phase_done("allocation_bounds_inference", s);
+
+    debug(1) << "Fusing loop nests computed with each other...\n";
+    s = fuse_compute_with(s, env);
+    debug(2) << "Lowering after fusing loop nests:\n" << s << '\n';
+    profiler.phase_done("fuse_compute_with", s);
 
     debug(1) << "Removing code that depends on undef values...\n";
     s = remove_undef(s);
     debug(2) << "Lowering after removing code that depends on undef values:\n" << s << "\n\n";
+    profiler.phase_done("remove_undef", s);
 
     // This uniquifies the variable names, so we're good to simplify
     // after this point. This lets later passes assume syntactic
@@ -135,120 +159,189 @@ Stmt lower(const vector<Function> &outputs, const string &pipeline_name, const T
     debug(1) << "Uniquifying variable names...\n";
     s = uniquify_variable_names(s);
     debug(2) << "Lowering after uniquifying variable names:\n" << s << "\n\n";
+    profiler.phase_done("uniquify_variable_names", s);
 
     debug(1) << "Performing storage folding optimization...\n";
     s = storage_folding(s);
     debug(2) << "Lowering after storage folding:\n" << s << '\n';
+    profiler.phase_done("storage_folding", s);
 
     debug(1) << "Injecting debug_to_file calls...\n";
     s = debug_to_file(s, outputs, env);
     debug(2) << "Lowering after injecting debug_to_file calls:\n" << s << '\n';
+    profiler.phase_done("debug_to_file", s);
 
     debug(1) << "Simplifying...\n"; // without removing dead lets, because storage flattening needs the strides
     s = simplify(s, false);
     debug(2) << "Lowering after first simplification:\n" << s << "\n\n";
+    profiler.phase_done("simplify", s);
 
     debug(1) << "Dynamically skipping stages...\n";
     s = skip_stages(s, order);
     debug(2) << "Lowering after dynamically skipping stages:\n" << s << "\n\n";
+    profiler.phase_done("skip_stages", s);
 
     if (t.has_feature(Target::OpenGL) || t.has_feature(Target::Renderscript)) {
         debug(1) << "Injecting image intrinsics...\n";
         s = inject_image_intrinsics(s);
         debug(2) << "Lowering after image intrinsics:\n" << s << "\n\n";
+        profiler.phase_done("inject_image_intrinsics", s);
     }
 
     debug(1) << "Performing storage flattening...\n";
     s = storage_flattening(s, outputs, env);
     debug(2) << "Lowering after storage flattening:\n" << s << "\n\n";
+    profiler.phase_done("storage_flattening", s);
 
     if (any_memoized) {
         debug(1) << "Rewriting memoized allocations...\n";
         s = rewrite_memoized_allocations(s, env);
         debug(2) << "Lowering after rewriting memoized allocations:\n" << s << "\n\n";
+        profiler.phase_done("rewrite_memoized_allocations", s);
     } else {
         debug(1) << "Skipping rewriting memoized allocations...\n";
     }
 
+    if (t.has_feature(Target::AutoSpecialize)) {
+        debug(1) << "Auto-specializing on common buffer shapes...\n";
+        s = auto_specialize(s, outputs, pipeline_name, t);
+        debug(2) << "Lowering after auto-specializing:\n" << s << "\n\n";
+        profiler.phase_done("auto_specialize", s);
+    } else {
+        debug(1) << "Skipping auto-specializing...\n";
+    }
+
+    if (t.has_feature(Target::HostDevice) &&
+        (t.has_gpu_feature() ||
+         t.has_feature(Target::OpenGLCompute) ||
+         t.has_feature(Target::OpenGL) ||
+         t.has_feature(Target::Renderscript))) {
+        user_error << "The host_device target feature can't be combined with a real gpu: " << t.to_string() << "\n";
+    }
+
     if (t.has_gpu_feature() ||
         t.has_feature(Target::OpenGLCompute) ||
         t.has_feature(Target::OpenGL) ||
-        t.has_feature(Target::Renderscript)) {
+        t.has_feature(Target::Renderscript) ||
+        t.has_feature(Target::HostDevice)) {
         debug(1) << "Selecting a GPU API for GPU loops...\n";
         s = select_gpu_api(s, t);
         debug(2) << "Lowering after selecting a GPU API:\n" << s << "\n\n";
+        profiler.phase_done("select_gpu_api", s);
 
         debug(1) << "Injecting host <-> dev buffer copies...\n";
         s = inject_host_dev_buffer_copies(s, t);
         debug(2) << "Lowering after injecting host <-> dev buffer copies:\n" << s << "\n\n";
+        profiler.phase_done("inject_host_dev_buffer_copies", s);
     }
 
     if (t.has_feature(Target::OpenGL)) {
         debug(1) << "Injecting OpenGL texture intrinsics...\n";
         s = inject_opengl_intrinsics(s);
         debug(2) << "Lowering after OpenGL intrinsics:\n" << s << "\n\n";
+        profiler.phase_done("inject_opengl_intrinsics", s);
     }
 
+    // Not for HostDevice: its thread loops are run serially, stage
+    // by stage, so they are left unfused and need no barriers.
     if (t.has_gpu_feature() ||
         t.has_feature(Target::OpenGLCompute) ||
         t.has_feature(Target::Renderscript)) {
         debug(1) << "Injecting per-block gpu synchronization...\n";
         s = fuse_gpu_thread_loops(s);
         debug(2) << "Lowering after injecting per-block gpu synchronization:\n" << s << "\n\n";
+        profiler.phase_done("fuse_gpu_thread_loops", s);
     }
 
     debug(1) << "Simplifying...\n";
     s = simplify(s);
+    profiler.phase_done("simplify", s);
     s = unify_duplicate_lets(s);
+    profiler.phase_done("unify_duplicate_lets", s);
     s = remove_trivial_for_loops(s);
     debug(2) << "Lowering after second simplifcation:\n" << s << "\n\n";
+    profiler.phase_done("remove_trivial_for_loops", s);
 
     debug(1) << "Unrolling...\n";
     s = unroll_loops(s);
+    profiler.phase_done("unroll_loops", s);
     s = simplify(s);
     debug(2) << "Lowering after unrolling:\n" << s << "\n\n";
+    profiler.phase_done("simplify", s);
 
     debug(1) << "Vectorizing...\n";
     s = vectorize_loops(s);
+    profiler.phase_done("vectorize_loops", s);
     s = simplify(s);
     debug(2) << "Lowering after vectorizing:\n" << s << "\n\n";
+    profiler.phase_done("simplify", s);
 
     debug(1) << "Detecting vector interleavings...\n";
     s = rewrite_interleavings(s);
+    profiler.phase_done("rewrite_interleavings", s);
     s = simplify(s);
     debug(2) << "Lowering after rewriting vector interleavings:\n" << s << "\n\n";
+    profiler.phase_done("simplify", s);
 
     debug(1) << "Partitioning loops to simplify boundary conditions...\n";
     s = partition_loops(s);
+    profiler.phase_done("partition_loops", s);
     s = simplify(s);
     debug(2) << "Lowering after partitioning loops:\n" << s << "\n\n";
+    profiler.phase_done("simplify", s);
+
+    debug(1) << "Lowering division by loop-invariant denominators...\n";
+    s = lower_invariant_division(s);
+    profiler.phase_done("lower_invariant_division", s);
+    s = simplify(s);
+    debug(2) << "Lowering after lowering division by loop-invariant denominators:\n" << s << "\n\n";
+    profiler.phase_done("simplify", s);
+
+    debug(1) << "Turning lookups in small tables into shuffles...\n";
+    s = optimize_shuffles(s, t);
+    debug(2) << "Lowering after turning lookups in small tables into shuffles:\n" << s << "\n\n";
+    profiler.phase_done("optimize_shuffles", s);
 
     debug(1) << "Injecting early frees...\n";
     s = inject_early_frees(s);
     debug(2) << "Lowering after injecting early frees:\n" << s << "\n\n";
+    profiler.phase_done("inject_early_frees", s);
 
     debug(1) << "Simplifying...\n";
     s = common_subexpression_elimination(s);
+    profiler.phase_done("common_subexpression_elimination", s);
 
     if (t.has_feature(Target::OpenGL)) {
         debug(1) << "Detecting varying attributes...\n";
         s = find_linear_expressions(s);
         debug(2) << "Lowering after detecting varying attributes:\n" << s << "\n\n";
+        profiler.phase_done("find_linear_expressions", s);
 
         debug(1) << "Moving varying attribute expressions out of the shader...\n";
         s = setup_gpu_vertex_buffer(s);
         debug(2) << "Lowering after removing varying attributes:\n" << s << "\n\n";
+        profiler.phase_done("setup_gpu_vertex_buffer", s);
     }
 
     s = remove_trivial_for_loops(s);
+    profiler.phase_done("remove_trivial_for_loops", s);
     s = simplify(s);
     debug(1) << "Lowering after final simplification:\n" << s << "\n\n";
+    profiler.phase_done("simplify", s);
+
+    if (t.has_feature(Target::HostDevice)) {
+        debug(1) << "Lowering host device loops...\n";
+        s = lower_host_device_loops(s);
+        debug(2) << "Lowering after lowering host device loops:\n" << s << "\n\n";
+        profiler.phase_done("lower_host_device_loops", s);
+    }
 
     if (!custom_passes.empty()) {
         for (size_t i = 0; i < custom_passes.size(); i++) {
             debug(1) << "Running custom lowering pass " << i << "...\n";
             s = custom_passes[i]->mutate(s);
             debug(1) << "Lowering after custom pass " << i << ":\n" << s << "\n\n";
+            profiler.phase_done("custom pass " + std::to_string(i), s);
         }
     }
 
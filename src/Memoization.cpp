@@ -2,12 +2,14 @@
 #include "Error.h"
 #include "IRMutator.h"
 #include "IROperator.h"
+#include "IRPrinter.h"
 #include "Param.h"
 #include "Scope.h"
 #include "Util.h"
 #include "Var.h"
 
 #include <map>
+#include <sstream>
 
 namespace Halide {
 namespace Internal {
@@ -145,6 +147,7 @@ class KeyInfo {
     Expr key_size_expr;
     const std::string &top_level_name;
     const std::string &function_name;
+    std::string definition_hash;
 
     size_t parameters_alignment() {
         int32_t max_alignment = 0;
@@ -175,6 +178,10 @@ class KeyInfo {
 // There is a plan to change the hash function used in the cache and
 // after that happens, we'll measure performance again and maybe decide
 // to choose one path or the other here and remove the #ifdef.
+//
+// Note that the shared memory cache (runtime/shared_cache.cpp) relies
+// on the key starting with a pointer to a null-terminated name when
+// this is off, as the address of the name differs between processes.
 #define USE_FULL_NAMES_IN_KEY 0
 #if USE_FULL_NAMES_IN_KEY
     Stmt call_copy_memory(const std::string &key_name, const std::string &value, Expr index) {
@@ -190,8 +197,8 @@ class KeyInfo {
 #endif
 
 public:
-  KeyInfo(const Function &function, const std::string &name)
-        : top_level_name(name), function_name(function.name())
+  KeyInfo(const Function &function, const std::string &name, const std::string &hash)
+        : top_level_name(name), function_name(function.name()), definition_hash(hash)
     {
         dependencies.visit_function(function);
         size_t size_so_far = 0;
@@ -259,10 +266,14 @@ public:
         // mechanism can also break in those conditions. For JIT, a
         // counter is needed as the address may be reused. This isn't
         // a problem when using full names as the function names
-        // already are uniquefied by a counter.
+        // already are uniquefied by a counter. The string ends with a
+        // hash of the lowered definition, so that caches shared
+        // between processes (runtime/shared_cache.cpp) don't confuse
+        // different Funcs that happen to have the same names.
         writes.push_back(Store::make(key_name,
                                      StringImm::make(std::to_string(top_level_name.size()) + ":" + top_level_name +
-                                                     std::to_string(function_name.size()) + ":" + function_name),
+                                                     std::to_string(function_name.size()) + ":" + function_name +
+                                                     "#" + definition_hash),
                                      (index / Handle().bytes())));
         size_t alignment = Handle().bytes();
         index += Handle().bytes();
@@ -350,6 +361,24 @@ public:
     }
 };
 
+// A hash of the text of the lowered definition of a memoized Func,
+// to identify it across compilations and processes.
+std::string hash_definition(const ProducerConsumer *op) {
+    std::ostringstream text;
+    text << op->produce;
+    if (op->update.defined()) {
+        text << op->update;
+    }
+    // 64-bit FNV-1a
+    uint64_t h = 14695981039346656037ULL;
+    for (char c : text.str()) {
+        h = (h ^ (uint8_t)c) * 1099511628211ULL;
+    }
+    std::ostringstream result;
+    result << std::hex << h;
+    return result.str();
+}
+
 }
 
 // Inject caching structure around memoized realizations.
@@ -395,7 +424,7 @@ private:
             Stmt update = mutate(op->update);
             Stmt consume = mutate(op->consume);
 
-            KeyInfo key_info(f, top_level_name);
+            KeyInfo key_info(f, top_level_name, hash_definition(op));
 
             std::string cache_key_name = op->name + ".cache_key";
             std::string cache_result_name = op->name + ".cache_result";
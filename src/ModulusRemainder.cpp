@@ -58,6 +58,7 @@ public:
     void visit(const IfThenElse *);
     void visit(const Free *);
     void visit(const Evaluate *);
+    void visit(const VectorReduce *);
 };
 
 ModulusRemainder modulus_remainder(Expr e) {
@@ -346,6 +347,11 @@ void ComputeModulusRemainder::visit(const Call *) {
     remainder = 0;
 }
 
+void ComputeModulusRemainder::visit(const VectorReduce *) {
+    modulus = 1;
+    remainder = 0;
+}
+
 void ComputeModulusRemainder::visit(const Let *op) {
     bool value_interesting = op->value.type().is_int();
 
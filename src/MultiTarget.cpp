@@ -0,0 +1,274 @@
+#include "MultiTarget.h"
+#include "Debug.h"
+#include "Error.h"
+#include "LLVM_Headers.h"
+#include "LLVM_Output.h"
+#include "runtime/HalideRuntime.h"
+
+namespace Halide {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+// The cpu features of a target that the host must have to run it, as
+// halide_cpu_feature_t flags.
+uint64_t cpu_features(const Target &t) {
+    uint64_t features = 0;
+    if (t.has_feature(Target::SSE41)) features |= halide_cpu_feature_sse41;
+    if (t.has_feature(Target::AVX))   features |= halide_cpu_feature_avx;
+    if (t.has_feature(Target::AVX2))  features |= halide_cpu_feature_avx2;
+    if (t.has_feature(Target::FMA))   features |= halide_cpu_feature_fma;
+    if (t.has_feature(Target::FMA4))  features |= halide_cpu_feature_fma4;
+    if (t.has_feature(Target::F16C))  features |= halide_cpu_feature_f16c;
+    return features;
+}
+
+// The name of the entrypoint of the variant for a target.
+string variant_name(const string &fn_name, const Target &t) {
+    const struct {
+        Target::Feature feature;
+        const char *name;
+    } names[] = {{Target::SSE41, "sse41"},
+                 {Target::AVX, "avx"},
+                 {Target::AVX2, "avx2"},
+                 {Target::FMA, "fma"},
+                 {Target::FMA4, "fma4"},
+                 {Target::F16C, "f16c"}};
+    string suffix;
+    for (auto n : names) {
+        if (t.has_feature(n.feature)) {
+            suffix += string("_") + n.name;
+        }
+    }
+    if (suffix.empty()) {
+        suffix = "_generic";
+    }
+    return fn_name + suffix;
+}
+
+void emit_llvm_module(llvm::Module *llvm_module, const Outputs &output_files, const Target &target) {
+    if (!output_files.object_name.empty()) {
+        if (target.arch == Target::PNaCl) {
+            compile_llvm_module_to_llvm_bitcode(llvm_module, output_files.object_name);
+        } else {
+            compile_llvm_module_to_object(llvm_module, output_files.object_name);
+        }
+    }
+    if (!output_files.assembly_name.empty()) {
+        if (target.arch == Target::PNaCl) {
+            compile_llvm_module_to_llvm_assembly(llvm_module, output_files.assembly_name);
+        } else {
+            compile_llvm_module_to_assembly(llvm_module, output_files.assembly_name);
+        }
+    }
+    if (!output_files.bitcode_name.empty()) {
+        compile_llvm_module_to_llvm_bitcode(llvm_module, output_files.bitcode_name);
+    }
+}
+
+#if LLVM_VERSION >= 37
+
+// Get a variant ready to be linked into the module containing the
+// fallback: hide its copies of any helpers from the other variants,
+// and tell llvm which target to compile its functions for, as the
+// target machine will be set up for the fallback.
+void prepare_variant(llvm::Module *m) {
+    llvm::TargetOptions options;
+    string mcpu, mattrs;
+    get_target_options(m, options, mcpu, mattrs);
+
+    for (llvm::Module::iterator iter = m->begin(); iter != m->end(); iter++) {
+        llvm::Function *f = (llvm::Function *)(iter);
+        if (f->isDeclaration()) continue;
+        if (f->isWeakForLinker()) {
+            f->setLinkage(llvm::GlobalValue::InternalLinkage);
+        }
+        f->addFnAttr("target-cpu", mcpu);
+        f->addFnAttr("target-features", mattrs);
+    }
+    for (llvm::Module::global_iterator iter = m->global_begin(); iter != m->global_end(); iter++) {
+        if (!iter->isDeclaration() && iter->isWeakForLinker()) {
+            iter->setLinkage(llvm::GlobalValue::InternalLinkage);
+        }
+    }
+
+    // The module flags record the target options of the variant, and
+    // would conflict with those of the fallback.
+    if (llvm::NamedMDNode *flags = m->getModuleFlagsMetadata()) {
+        flags->eraseFromParent();
+    }
+}
+
+// Define a function that calls the first of the given variants whose
+// cpu features the host has, or the last one if it has none of them.
+void define_dispatcher(llvm::Function *dispatcher,
+                       const vector<llvm::Function *> &variants,
+                       const vector<uint64_t> &features,
+                       llvm::Constant *can_use_cpu_features) {
+    llvm::LLVMContext &context = dispatcher->getContext();
+    llvm::IRBuilder<> builder(context);
+    llvm::Type *i64 = llvm::Type::getInt64Ty(context);
+
+    vector<llvm::Value *> args;
+    for (llvm::Function::arg_iterator iter = dispatcher->arg_begin(); iter != dispatcher->arg_end(); iter++) {
+        args.push_back(iter);
+    }
+
+    llvm::BasicBlock *block = llvm::BasicBlock::Create(context, "entry", dispatcher);
+    builder.SetInsertPoint(block);
+    for (size_t i = 0; i < variants.size(); i++) {
+        // The variants have the same signature as the dispatcher, but
+        // their types may have been renamed while linking.
+        llvm::Constant *callee = llvm::ConstantExpr::getBitCast(variants[i], dispatcher->getType());
+
+        if (i + 1 < variants.size()) {
+            vector<llvm::Value *> check_args(1, llvm::ConstantInt::get(i64, features[i]));
+            llvm::Value *supported = builder.CreateCall(can_use_cpu_features, check_args);
+            llvm::BasicBlock *use_variant =
+                llvm::BasicBlock::Create(context, variants[i]->getName(), dispatcher);
+            llvm::BasicBlock *next = llvm::BasicBlock::Create(context, "next", dispatcher);
+            builder.CreateCondBr(builder.CreateIsNotNull(supported), use_variant, next);
+            builder.SetInsertPoint(use_variant);
+            builder.CreateRet(builder.CreateCall(callee, args));
+            builder.SetInsertPoint(next);
+        } else {
+            builder.CreateRet(builder.CreateCall(callee, args));
+        }
+    }
+
+    internal_assert(!llvm::verifyFunction(*dispatcher));
+}
+
+// Make the metadata for the dispatcher: a copy of the metadata of the
+// fallback with the name changed.
+void define_metadata(llvm::Module *m, const string &metadata_name,
+                     llvm::GlobalVariable *fallback_metadata, const string &fn_name) {
+    llvm::LLVMContext &context = m->getContext();
+    llvm::ConstantStruct *fields = llvm::cast<llvm::ConstantStruct>(fallback_metadata->getInitializer());
+
+    llvm::Constant *name_data = llvm::ConstantDataArray::getString(context, fn_name);
+    llvm::GlobalVariable *name_storage =
+        new llvm::GlobalVariable(*m, name_data->getType(), /*isConstant*/ true,
+                                 llvm::GlobalValue::PrivateLinkage, name_data, "str");
+    llvm::Constant *zero = llvm::ConstantInt::get(llvm::Type::getInt32Ty(context), 0);
+    llvm::Constant *zeros[] = {zero, zero};
+    llvm::Constant *name = llvm::ConstantExpr::getInBoundsGetElementPtr(name_data->getType(), name_storage, zeros);
+
+    // The name is the last field of halide_filter_metadata_t.
+    vector<llvm::Constant *> new_fields;
+    for (unsigned i = 0; i < fields->getNumOperands(); i++) {
+        new_fields.push_back(fields->getOperand(i));
+    }
+    internal_assert(new_fields.back()->getType() == name->getType());
+    new_fields.back() = name;
+
+    new llvm::GlobalVariable(*m, fields->getType(), /*isConstant*/ true,
+                             llvm::GlobalValue::ExternalLinkage,
+                             llvm::ConstantStruct::get(fields->getType(), new_fields),
+                             metadata_name);
+}
+
+#endif
+
+}
+
+void compile_multitarget(const string &fn_name,
+                         const Outputs &output_files,
+                         const vector<Target> &targets,
+                         ModuleProducer module_producer) {
+    user_assert(!targets.empty()) << "compile_multitarget requires at least one target.\n";
+
+    const Target &fallback = targets.back();
+
+    if (targets.size() == 1) {
+        Module m = module_producer(fn_name, fallback);
+        llvm::LLVMContext context;
+        llvm::Module *llvm_module = compile_module_to_llvm_module(m, context);
+        emit_llvm_module(llvm_module, output_files, fallback);
+        delete llvm_module;
+        return;
+    }
+
+    #if LLVM_VERSION < 37
+    user_error << "compile_multitarget with more than one target requires llvm 3.7 or later.\n";
+    #else
+
+    vector<string> names;
+    vector<uint64_t> features;
+    for (const Target &t : targets) {
+        user_assert(t.arch == Target::X86 && t.os == fallback.os && t.bits == fallback.bits)
+            << "compile_multitarget requires x86 targets that all have the same os and bit width, "
+            << "but was given " << t.to_string() << " and " << fallback.to_string() << "\n";
+        user_assert(!t.has_feature(Target::JIT) && !t.has_feature(Target::Matlab))
+            << "compile_multitarget can't be used with the jit or matlab target features.\n";
+        user_assert(t.has_feature(Target::UserContext) == fallback.has_feature(Target::UserContext))
+            << "All targets given to compile_multitarget must agree on the user_context feature.\n";
+
+        string name = variant_name(fn_name, t);
+        for (const string &n : names) {
+            user_assert(n != name)
+                << "The targets given to compile_multitarget must all have different cpu features, "
+                << "but there are two targets with entrypoint " << name << "\n";
+        }
+        names.push_back(name);
+        features.push_back(cpu_features(t));
+    }
+
+    // Compile the fallback first, as the others get linked into it.
+    llvm::LLVMContext context;
+    llvm::Module *result = compile_module_to_llvm_module(module_producer(names.back(), fallback), context);
+
+    for (size_t i = 0; i + 1 < targets.size(); i++) {
+        // Only the fallback contains the runtime, and registers its
+        // metadata.
+        Target t = targets[i].with_feature(Target::NoRuntime).without_feature(Target::RegisterMetadata);
+        Internal::debug(1) << "Compiling variant " << names[i] << " of " << fn_name << " for target " << t.to_string() << "\n";
+        llvm::Module *variant = compile_module_to_llvm_module(module_producer(names[i], t), context);
+        prepare_variant(variant);
+        bool failed = llvm::Linker::LinkModules(result, variant);
+        internal_assert(!failed) << "Failure linking variant " << names[i] << " of " << fn_name << "\n";
+        delete variant;
+    }
+
+    vector<llvm::Function *> entrypoints, argv_entrypoints;
+    for (const string &name : names) {
+        llvm::Function *f = result->getFunction(name);
+        llvm::Function *argv_f = result->getFunction(name + "_argv");
+        internal_assert(f && argv_f) << "Could not find variant " << name << " after linking\n";
+        entrypoints.push_back(f);
+        argv_entrypoints.push_back(argv_f);
+    }
+
+    // The fallback target may not have a runtime, in which case
+    // halide_can_use_cpu_features comes from the one linked in later.
+    llvm::Type *i32 = llvm::Type::getInt32Ty(context);
+    llvm::Type *i64 = llvm::Type::getInt64Ty(context);
+    vector<llvm::Type *> arg_types(1, i64);
+    llvm::Constant *can_use_cpu_features =
+        result->getOrInsertFunction("halide_can_use_cpu_features",
+                                    llvm::FunctionType::get(i32, arg_types, false));
+
+    llvm::Function *dispatcher =
+        llvm::Function::Create(entrypoints.back()->getFunctionType(),
+                               llvm::GlobalValue::ExternalLinkage, fn_name, result);
+    define_dispatcher(dispatcher, entrypoints, features, can_use_cpu_features);
+
+    llvm::Function *argv_dispatcher =
+        llvm::Function::Create(argv_entrypoints.back()->getFunctionType(),
+                               llvm::GlobalValue::ExternalLinkage, fn_name + "_argv", result);
+    define_dispatcher(argv_dispatcher, argv_entrypoints, features, can_use_cpu_features);
+
+    llvm::GlobalVariable *fallback_metadata = result->getNamedGlobal(names.back() + "_metadata");
+    internal_assert(fallback_metadata) << "Could not find metadata for " << names.back() << "\n";
+    define_metadata(result, fn_name + "_metadata", fallback_metadata, fn_name);
+
+    llvm::verifyModule(*result);
+
+    emit_llvm_module(result, output_files, fallback);
+    delete result;
+    #endif
+}
+
+}
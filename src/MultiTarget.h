@@ -0,0 +1,51 @@
+#ifndef HALIDE_MULTI_TARGET_H
+#define HALIDE_MULTI_TARGET_H
+
+/** \file
+ * Defines a method for compiling a pipeline for several targets into
+ * one object file, which picks the best variant for the host cpu at
+ * run time.
+ */
+
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "Module.h"
+#include "Pipeline.h"
+#include "Target.h"
+
+namespace Halide {
+
+/** A function that produces a Module containing a pipeline compiled
+ * for the given target, with an entrypoint of the given name. */
+typedef std::function<Module(const std::string &fn_name, const Target &target)> ModuleProducer;
+
+/** Compile a variant of a pipeline for each of the given targets, and
+ * emit them together as the given outputs. The entrypoint fn_name
+ * calls the first variant in the list whose cpu features (sse41, avx,
+ * avx2, fma, fma4, f16c) the host has. The host is only queried on
+ * the first call. The last target is the fallback, which is used if
+ * the host supports none of the others, so it should be the least
+ * capable target in the list. The copy of the runtime in the outputs
+ * (if any) is compiled for the fallback target.
+ *
+ * The variants are also callable directly, as fn_name followed by
+ * their features (e.g. f_avx_avx2_fma, or f_generic for a target
+ * without any). fn_name_argv and fn_name_metadata are emitted as
+ * usual; the metadata describes the fallback variant. The C header
+ * for the entrypoint is the same as for any single variant, so make
+ * it with compile_to_header and the fallback target.
+ *
+ * All the targets must be x86, for the same os and bit width. Needs
+ * llvm 3.7 or later, which can compile each function in a module for
+ * a different target.
+ */
+EXPORT void compile_multitarget(const std::string &fn_name,
+                                const Outputs &output_files,
+                                const std::vector<Target> &targets,
+                                ModuleProducer module_producer);
+
+}
+
+#endif
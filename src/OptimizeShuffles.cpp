@@ -0,0 +1,186 @@
+#include "OptimizeShuffles.h"
+#include "Bounds.h"
+#include "Debug.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Scope.h"
+#include "Simplify.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+// Rewrite a vector expression as a scalar expression of a variable
+// that stands for any one of its lanes, so that the bounds of all of
+// its lanes can be computed at once.
+class ScalarizeLanes : public IRMutator {
+    Expr lane;
+
+    using IRMutator::visit;
+
+    void visit(const Ramp *op) {
+        Expr base = mutate(op->base);
+        Expr stride = mutate(op->stride);
+        expr = base + stride * Cast::make(base.type(), lane);
+    }
+
+    void visit(const Broadcast *op) {
+        expr = mutate(op->value);
+    }
+
+    void visit(const Variable *op) {
+        if (op->type.is_vector()) {
+            expr = Variable::make(op->type.element_of(), op->name);
+        } else {
+            expr = op;
+        }
+    }
+
+    void visit(const Cast *op) {
+        expr = Cast::make(op->type.element_of(), mutate(op->value));
+    }
+
+    void visit(const Load *op) {
+        expr = Load::make(op->type.element_of(), op->name, mutate(op->index), op->image, op->param);
+    }
+
+    void visit(const Call *op) {
+        if (op->name == Call::shuffle_vector ||
+            op->name == Call::interleave_vectors ||
+            op->name == Call::dynamic_shuffle) {
+            // These move values between lanes.
+            failed = true;
+            expr = op;
+            return;
+        }
+        vector<Expr> args(op->args.size());
+        for (size_t i = 0; i < op->args.size(); i++) {
+            args[i] = mutate(op->args[i]);
+        }
+        expr = Call::make(op->type.element_of(), op->name, args, op->call_type,
+                          op->func, op->value_index, op->image, op->param);
+    }
+
+public:
+    bool failed;
+    ScalarizeLanes(Expr l) : lane(l), failed(false) {}
+};
+
+class OptimizeShuffles : public IRMutator {
+    int lut_bytes;
+    Scope<Interval> bounds;
+    const string lane_name;
+
+    using IRMutator::visit;
+
+    // The bounds of the values of all the lanes of a vector.
+    Interval lane_bounds(Expr e) {
+        ScalarizeLanes scalarize(Variable::make(Int(32), lane_name));
+        Expr scalar = scalarize.mutate(e);
+        if (scalarize.failed) {
+            return Interval();
+        }
+        bounds.push(lane_name, Interval(0, e.type().width - 1));
+        Interval result = bounds_of_expr_in_scope(scalar, bounds);
+        bounds.pop(lane_name);
+        return result;
+    }
+
+    void visit(const For *op) {
+        if (op->device_api != DeviceAPI::Parent &&
+            op->device_api != DeviceAPI::Host) {
+            stmt = op;
+            return;
+        }
+        IRMutator::visit(op);
+    }
+
+    // Only the bounds of vector lets are tracked. Scalars are left
+    // symbolic, so that a range that depends on them still has a
+    // constant size.
+    void visit(const Let *op) {
+        bool vector = op->value.type().is_vector();
+        if (vector) {
+            bounds.push(op->name, lane_bounds(op->value));
+        }
+        IRMutator::visit(op);
+        if (vector) {
+            bounds.pop(op->name);
+        }
+    }
+
+    void visit(const LetStmt *op) {
+        bool vector = op->value.type().is_vector();
+        if (vector) {
+            bounds.push(op->name, lane_bounds(op->value));
+        }
+        IRMutator::visit(op);
+        if (vector) {
+            bounds.pop(op->name);
+        }
+    }
+
+    void visit(const Load *op) {
+        if (!op->type.is_vector() ||
+            op->type.is_handle() ||
+            op->type.bits < 8 ||
+            op->index.as<Ramp>()) {
+            IRMutator::visit(op);
+            return;
+        }
+
+        Expr index = mutate(op->index);
+        Interval range = lane_bounds(index);
+        if (range.min.defined() && range.max.defined()) {
+            Expr base = simplify(range.min);
+            const IntImm *extent = simplify(range.max - base + 1).as<IntImm>();
+            if (extent && extent->value > 1 &&
+                extent->value * op->type.bytes() <= lut_bytes) {
+                debug(3) << "Replacing gather from " << op->name << " with a shuffle of "
+                         << extent->value << " elements\n";
+                Type lut_type = op->type.element_of().vector_of(extent->value);
+                Expr lut = Load::make(lut_type, op->name, Ramp::make(base, 1, extent->value),
+                                      op->image, op->param);
+                Expr lut_index = simplify(index - Broadcast::make(base, op->type.width));
+                expr = Call::make(op->type, Call::dynamic_shuffle, {lut, lut_index}, Call::Intrinsic);
+                return;
+            }
+        }
+
+        if (index.same_as(op->index)) {
+            expr = op;
+        } else {
+            expr = Load::make(op->type, op->name, index, op->image, op->param);
+        }
+    }
+
+public:
+    OptimizeShuffles(int lut_bytes) : lut_bytes(lut_bytes), lane_name(unique_name('t')) {}
+};
+
+}
+
+Stmt optimize_shuffles(Stmt s, const Target &t) {
+    // The largest table, in bytes, that the target can look up in
+    // registers.
+    int lut_bytes = 0;
+    if (t.arch == Target::X86 && t.has_feature(Target::SSE41)) {
+        // Two pshufbs and a blend.
+        lut_bytes = 32;
+    } else if (t.arch == Target::ARM && !t.has_feature(Target::NoNEON)) {
+        // vtbl4 on 32-bit ARM, tbl4 on aarch64.
+        lut_bytes = (t.bits == 64) ? 64 : 32;
+    }
+
+    if (lut_bytes == 0) {
+        return s;
+    }
+    return OptimizeShuffles(lut_bytes).mutate(s);
+}
+
+}
+}
@@ -0,0 +1,28 @@
+#ifndef HALIDE_OPTIMIZE_SHUFFLES_H
+#define HALIDE_OPTIMIZE_SHUFFLES_H
+
+/** \file
+ * Defines the lowering pass that turns vector loads from small tables
+ * into shuffles.
+ */
+
+#include "IR.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Find vector loads with arbitrary indices (gathers) whose indices
+ * are proven to lie in a range small enough for the table lookup
+ * instructions of the target (pshufb on x86, vtbl/tbl on ARM). Replace
+ * each with a dense load of that range, and a dynamic_shuffle of the
+ * loaded vector. The base of the range need not be constant, so the
+ * dense load can usually be lifted out of the inner loop. Does nothing
+ * for targets without a suitable instruction, and leaves loops that
+ * run on a GPU alone. */
+Stmt optimize_shuffles(Stmt s, const Target &t);
+
+}
+}
+
+#endif
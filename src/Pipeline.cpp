@@ -7,6 +7,7 @@
 #include "LLVM_Headers.h"
 #include "LLVM_Output.h"
 #include "Lower.h"
+#include "MultiTarget.h"
 #include "Output.h"
 #include "PrintLoopNest.h"
 
@@ -80,8 +81,12 @@ struct PipelineContents {
      * define_extern calls. */
     std::map<std::string, JITExtern> jit_externs;
 
+    /** Called around the call to the compiled code in realize. */
+    void *(*jit_call_enter)();
+    void (*jit_call_exit)(void *);
+
     PipelineContents() :
-        module("", Target()) {
+        module("", Target()), jit_call_enter(NULL), jit_call_exit(NULL) {
         user_context_arg.arg = Argument("__user_context", Argument::InputScalar, Handle(), 0);
         user_context_arg.param = Parameter(Handle(), false, 0, "__user_context",
                                            /*is_explicit_name*/ true, /*register_instance*/ false);
@@ -180,6 +185,22 @@ void Pipeline::compile_to(const Outputs &output_files,
     delete llvm_module;
 }
 
+void Pipeline::compile_to_multitarget(const Outputs &output_files,
+                                      const vector<Argument> &args,
+                                      const string &fn_name,
+                                      const vector<Target> &targets) {
+    user_assert(defined()) << "Can't compile undefined Pipeline.\n";
+
+    for (Function f : contents.ptr->outputs) {
+        user_assert(f.has_pure_definition() || f.has_extern_definition())
+            << "Can't compile undefined Func.\n";
+    }
+
+    compile_multitarget(fn_name, output_files, targets,
+                        [&](const string &name, const Target &t) {
+                            return compile_to_module(args, name, t);
+                        });
+}
 
 void Pipeline::compile_to_bitcode(const string &filename,
                                   const vector<Argument> &args,
@@ -695,6 +716,14 @@ const JITHandlers &Pipeline::jit_handlers() {
     return contents.ptr->jit_handlers;
 }
 
+void Pipeline::set_jit_call_wrapper(void *(*enter)(), void (*exit)(void *)) {
+    user_assert(defined()) << "Pipeline is undefined\n";
+    user_assert((enter == NULL) == (exit == NULL))
+        << "set_jit_call_wrapper needs both an enter and an exit function, or neither\n";
+    contents.ptr->jit_call_enter = enter;
+    contents.ptr->jit_call_exit = exit;
+}
+
 void Pipeline::realize(Buffer b, const Target &target) {
     realize(Realization({b}), target);
 }
@@ -999,7 +1028,20 @@ void Pipeline::realize(Realization dst, const Target &t) {
     JITFuncCallContext jit_context(jit_handlers(), contents.ptr->user_context_arg.param);
 
     debug(2) << "Calling jitted function\n";
+    // Read both hooks before calling either of them. The enter hook
+    // may let other threads run (e.g. by releasing Python's GIL),
+    // and they may change the hooks on this pipeline before we call
+    // the exit hook.
+    void *(*call_enter)() = contents.ptr->jit_call_enter;
+    void (*call_exit)(void *) = contents.ptr->jit_call_exit;
+    void *wrapper_state = NULL;
+    if (call_enter) {
+        wrapper_state = call_enter();
+    }
     int exit_status = contents.ptr->jit_module.argv_function()(&(args[0]));
+    if (call_exit) {
+        call_exit(wrapper_state);
+    }
     debug(2) << "Back from jitted function. Exit status was " << exit_status << "\n";
 
     // If we're profiling, report runtimes and reset profiler stats.
@@ -127,6 +127,16 @@ public:
                            const std::string &fn_name,
                            const Target &target);
 
+    /** Compile a variant of the pipeline for each of the given
+     * targets into one set of outputs, with an entrypoint that runs
+     * the best variant the host cpu supports. The last target is the
+     * fallback, and should be the least capable. See
+     * compile_multitarget in MultiTarget.h for the details. */
+    EXPORT void compile_to_multitarget(const Outputs &output_files,
+                                       const std::vector<Argument> &args,
+                                       const std::string &fn_name,
+                                       const std::vector<Target> &targets);
+
     /** Statically compile a pipeline to llvm bitcode, with the given
      * filename (which should probably end in .bc), type signature,
      * and C function name. If you're compiling a pipeline with a
@@ -322,6 +332,16 @@ public:
      * used by JIT. */
     EXPORT const Internal::JITHandlers &jit_handlers();
 
+    /** Set a pair of functions to be called immediately before and
+     * after the compiled code runs during realize. Compilation and
+     * argument marshalling happen outside of the pair. The value
+     * returned by enter is passed to exit. Intended for language
+     * bindings, e.g. to release an interpreter lock only while the
+     * pipeline itself runs. Each realize calls the pair that was set
+     * when it started running the compiled code, even if the hooks
+     * are changed while it runs. Pass NULLs to clear them. */
+    EXPORT void set_jit_call_wrapper(void *(*enter)(), void (*exit)(void *));
+
     /** Add a custom pass to be used during lowering. It is run after
      * all other lowering passes. Can be used to verify properties of
      * the lowered Stmt, instrument it with extra code, or otherwise
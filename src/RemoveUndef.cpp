@@ -145,6 +145,13 @@ private:
         else expr = Broadcast::make(value, op->width);
     }
 
+    void visit(const VectorReduce *op) {
+        Expr value = mutate(op->value);
+        if (!expr.defined()) return;
+        if (value.same_as(op->value)) expr = op;
+        else expr = VectorReduce::make(op->op, value, op->width);
+    }
+
     void visit(const Call *op) {
         if (op->name == Call::undef &&
             op->call_type == Call::Intrinsic) {
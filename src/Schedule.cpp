@@ -11,7 +11,7 @@ namespace Internal {
 struct ScheduleContents {
     mutable RefCount ref_count;
 
-    LoopLevel store_level, compute_level;
+    LoopLevel store_level, compute_level, compute_with_level;
     std::vector<Split> splits;
     std::vector<Dim> dims;
     std::vector<std::string> storage_dims;
@@ -21,8 +21,9 @@ struct ScheduleContents {
     bool memoized;
     bool touched;
     bool allow_race_conditions;
+    bool atomic;
 
-    ScheduleContents() : memoized(false), touched(false), allow_race_conditions(false) {};
+    ScheduleContents() : memoized(false), touched(false), allow_race_conditions(false), atomic(false) {};
 };
 
 
@@ -118,6 +119,14 @@ const LoopLevel &Schedule::compute_level() const {
     return contents.ptr->compute_level;
 }
 
+LoopLevel &Schedule::compute_with_level() {
+    return contents.ptr->compute_with_level;
+}
+
+const LoopLevel &Schedule::compute_with_level() const {
+    return contents.ptr->compute_with_level;
+}
+
 
 const ReductionDomain &Schedule::reduction_domain() const {
     return contents.ptr->reduction_domain;
@@ -135,6 +144,14 @@ bool Schedule::allow_race_conditions() const {
     return contents.ptr->allow_race_conditions;
 }
 
+bool &Schedule::atomic() {
+    return contents.ptr->atomic;
+}
+
+bool Schedule::atomic() const {
+    return contents.ptr->atomic;
+}
+
 void Schedule::accept(IRVisitor *visitor) const {
     for (const Split &s : splits()) {
         if (s.factor.defined()) {
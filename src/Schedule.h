@@ -192,12 +192,27 @@ public:
     LoopLevel &compute_level();
     // @}
 
+    /** The loop level of another function that this function's loop
+     * nest is fused with, if any. Inline (the default) means it gets
+     * its own loop nest. See \ref Func::compute_with */
+    // @{
+    const LoopLevel &compute_with_level() const;
+    LoopLevel &compute_with_level();
+    // @}
+
     /** Are race conditions permitted? */
     // @{
     bool allow_race_conditions() const;
     bool &allow_race_conditions();
     // @}
 
+    /** Is this an update stage whose updates are done atomically?
+     * See \ref Stage::atomic */
+    // @{
+    bool atomic() const;
+    bool &atomic();
+    // @}
+
     /** Pass an IRVisitor through to all Exprs referenced in the
      * Schedule. */
     void accept(IRVisitor *) const;
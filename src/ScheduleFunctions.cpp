@@ -8,6 +8,7 @@
 #include "IRMutator.h"
 #include "Target.h"
 #include "Inline.h"
+#include "IREquality.h"
 
 namespace Halide {
 namespace Internal {
@@ -468,6 +469,119 @@ Stmt build_produce(Function f) {
     }
 }
 
+bool function_is_used_in_stmt(Function f, Stmt s);
+
+namespace {
+
+// Is an expression a call to the function at the given site?
+bool is_self_call(Function f, const vector<Expr> &site, Expr e) {
+    const Call *c = e.as<Call>();
+    if (!c || c->call_type != Call::Halide || c->name != f.name() ||
+        c->args.size() != site.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < site.size(); i++) {
+        if (!equal(c->args[i], site[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Rewrite the value of an atomic update of the form f(site) op e to
+// atomic_update(op, e). Storage flattening turns this into a store
+// of the marker, which the backends do as an atomic read-modify-write
+// of the site.
+Expr make_atomic_update(Function f, const string &stage,
+                        const vector<Expr> &site, Expr value) {
+    // The definition has been through CSE, which may have pulled the
+    // self-call or parts of the site out into lets.
+    while (const Let *let = value.as<Let>()) {
+        value = substitute(let->name, let->value, let->body);
+    }
+
+    Expr self, other;
+    string op;
+    if (const Add *a = value.as<Add>()) {
+        op = "add";
+        if (is_self_call(f, site, a->a)) {
+            self = a->a;
+            other = a->b;
+        } else {
+            self = a->b;
+            other = a->a;
+        }
+    } else if (const Sub *s = value.as<Sub>()) {
+        op = "sub";
+        self = s->a;
+        other = s->b;
+    } else if (const Mul *m = value.as<Mul>()) {
+        op = "mul";
+        if (is_self_call(f, site, m->a)) {
+            self = m->a;
+            other = m->b;
+        } else {
+            self = m->b;
+            other = m->a;
+        }
+    } else if (const Min *m = value.as<Min>()) {
+        op = "min";
+        if (is_self_call(f, site, m->a)) {
+            self = m->a;
+            other = m->b;
+        } else {
+            self = m->b;
+            other = m->a;
+        }
+    } else if (const Max *m = value.as<Max>()) {
+        op = "max";
+        if (is_self_call(f, site, m->a)) {
+            self = m->a;
+            other = m->b;
+        } else {
+            self = m->b;
+            other = m->a;
+        }
+    } else if (const Call *c = value.as<Call>()) {
+        if (c->call_type == Call::Intrinsic && c->name == Call::bitwise_and) {
+            op = "and";
+        } else if (c->call_type == Call::Intrinsic && c->name == Call::bitwise_or) {
+            op = "or";
+        } else if (c->call_type == Call::Intrinsic && c->name == Call::bitwise_xor) {
+            op = "xor";
+        }
+        if (!op.empty()) {
+            if (is_self_call(f, site, c->args[0])) {
+                self = c->args[0];
+                other = c->args[1];
+            } else {
+                self = c->args[1];
+                other = c->args[0];
+            }
+        }
+    }
+
+    bool ok = (!op.empty() && is_self_call(f, site, self) &&
+               !function_is_used_in_stmt(f, Evaluate::make(other)));
+    for (Expr s : site) {
+        ok = ok && !function_is_used_in_stmt(f, Evaluate::make(s));
+    }
+    user_assert(ok)
+        << "In schedule for " << stage << ", can't make the update "
+        << f.name() << "(...) = " << value << " atomic. Atomic updates "
+        << "must be of the form f(args) = f(args) op e, where op is "
+        << "+, -, *, min, max, &, |, or ^, and neither e nor args "
+        << "depend on f.\n";
+    user_assert(value.type().bits >= 8)
+        << "In schedule for " << stage << ", can't make an update of type "
+        << value.type() << " atomic\n";
+
+    return Call::make(value.type(), Call::atomic_update,
+                      {op, other}, Call::Intrinsic);
+}
+
+}
+
 // Build the loop nests that update a function (assuming it's a reduction).
 vector<Stmt> build_update(Function f) {
 
@@ -493,6 +607,14 @@ vector<Stmt> build_update(Function f) {
             debug(2) << "Update site " << i << " = " << s << "\n";
         }
 
+        if (r.schedule.atomic()) {
+            string stage = f.name() + ".update(" + std::to_string(i) + ")";
+            user_assert(values.size() == 1)
+                << "In schedule for " << stage
+                << ", can't make an update of a Tuple atomic\n";
+            values[0] = make_atomic_update(f, stage, site, values[0]);
+        }
+
         Stmt loop = build_provide_loop_nest(f, prefix, site, values, r.schedule, true);
 
         // Now define the bounds on the reduction domain
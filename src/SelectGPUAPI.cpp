@@ -45,6 +45,8 @@ public:
             default_api = DeviceAPI::CUDA;
         } else if (target.has_feature(Target::OpenCL)) {
             default_api = DeviceAPI::OpenCL;
+        } else if (target.has_feature(Target::HostDevice)) {
+            default_api = DeviceAPI::HostDevice;
         } else {
             default_api = DeviceAPI::Host;
         }
@@ -2008,6 +2008,40 @@ private:
         }
     }
 
+    void visit(const VectorReduce *op) {
+        Expr value = mutate(op->value);
+        const Broadcast *b = value.as<Broadcast>();
+        int factor = value.type().width / op->width;
+        Expr reduced;
+        if (b) {
+            // A reduction of a broadcast is the reduction of some
+            // copies of its value.
+            switch (op->op) {
+            case VectorReduce::Add:
+                reduced = mutate(b->value * factor);
+                break;
+            case VectorReduce::Min:
+            case VectorReduce::Max:
+            case VectorReduce::And:
+            case VectorReduce::Or:
+                reduced = b->value;
+                break;
+            default:
+                break;
+            }
+        }
+
+        if (reduced.defined()) {
+            expr = op->width == 1 ? reduced : Broadcast::make(reduced, op->width);
+        } else if (factor == 1) {
+            expr = value;
+        } else if (value.same_as(op->value)) {
+            expr = op;
+        } else {
+            expr = VectorReduce::make(op->op, value, op->width);
+        }
+    }
+
     void visit(const Call *op) {
         // Calls implicitly depend on mins and strides of the buffer referenced
         if (op->call_type == Call::Image || op->call_type == Call::Halide) {
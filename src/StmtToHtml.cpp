@@ -269,6 +269,16 @@ private:
         stream << matched(")");
         stream << close_span();
     }
+    void visit(const VectorReduce *op) {
+        static const char *names[] = {"add", "mul", "min", "max", "and", "or", "xor"};
+        stream << open_span("VectorReduce");
+        stream << open_span("Matched");
+        stream << symbol(std::string("vector_reduce_") + names[op->op]) << "<" << op->width << ">(";
+        stream << close_span();
+        print(op->value);
+        stream << matched(")");
+        stream << close_span();
+    }
     void visit(const Call *op) {
         stream << open_span("Call");
         if (op->call_type == Call::Intrinsic) {
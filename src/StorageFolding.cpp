@@ -51,6 +51,22 @@ public:
         func(f), dim(d), factor(e) {}
 };
 
+// Does a statement store to a particular function?
+class ProvidesFunction : public IRVisitor {
+    const string &func;
+
+    using IRVisitor::visit;
+
+    void visit(const Provide *op) {
+        IRVisitor::visit(op);
+        if (op->name == func) result = true;
+    }
+
+public:
+    bool result;
+    ProvidesFunction(const string &f) : func(f), result(false) {}
+};
+
 // Attempt to fold the storage of a particular function in a statement
 class AttemptStorageFoldingOfFunction : public IRMutator {
     string func;
@@ -58,8 +74,12 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
     using IRMutator::visit;
 
     void visit(const ProducerConsumer *op) {
-        if (op->name == func) {
-            // Can't proceed into the pipeline for this func
+        ProvidesFunction provides(func);
+        op->produce.accept(&provides);
+        if (op->name == func || provides.result) {
+            // Can't proceed into the pipeline for this func, or for
+            // a func whose loops also compute it (see
+            // Func::compute_with)
             stmt = op;
         } else {
             IRMutator::visit(op);
@@ -0,0 +1,268 @@
+#include <algorithm>
+#include <string.h>
+
+#include "StripStreamer.h"
+#include "Debug.h"
+#include "Error.h"
+#include "Func.h"
+
+namespace Halide {
+
+using std::vector;
+
+StripStreamer::Stage::Stage(Pipeline p, ImageParam in, int out_x_min, int width,
+                            int out_c_min, int output_channels, int h) :
+    pipeline(p), input(in), strip_height(h),
+    halo_top(0), halo_bottom(0), x_min(0), x_extent(0), c_min(0), c_extent(1),
+    history_first(0), row_bytes(0), rows_in(0), next_y(0), input_done(false) {
+
+    user_assert(pipeline.defined()) << "Can't stream an undefined Pipeline.\n";
+    user_assert(width > 0 && strip_height > 0)
+        << "StripStreamer requires a positive width and strip height.\n";
+    user_assert(input.dimensions() == 2 || input.dimensions() == 3)
+        << "StripStreamer requires an input indexed as (x, y) or (x, y, c). "
+        << "ImageParam " << input.name() << " has "
+        << input.dimensions() << " dimensions.\n";
+
+    vector<Func> outputs = pipeline.outputs();
+    user_assert(outputs.size() == 1 && outputs[0].outputs() == 1)
+        << "StripStreamer requires a Pipeline with a single single-valued output.\n";
+    Func f = outputs[0];
+    user_assert(f.dimensions() == (output_channels > 0 ? 3 : 2))
+        << "The output of the Pipeline streamed by StripStreamer has "
+        << f.dimensions() << " dimensions, but it was given "
+        << output_channels << " output channels.\n";
+
+    output = Buffer(f.output_types()[0], width, strip_height, output_channels, 0,
+                    NULL, f.name() + "_strip");
+    output.set_min(out_x_min, 0, out_c_min, 0);
+
+    // Ask the pipeline which rows of input the first two strips
+    // read. Streaming only works if the window of input rows moves
+    // down in lock-step with the output.
+    Buffer first = query_input_bounds(0);
+    Buffer second = query_input_bounds(strip_height);
+
+    halo_top = -first.min(1);
+    halo_bottom = first.min(1) + first.extent(1) - strip_height;
+    user_assert(halo_top >= 0 && halo_bottom >= 0 &&
+                second.min(1) == first.min(1) + strip_height &&
+                second.extent(1) == first.extent(1))
+        << "StripStreamer requires the rows of " << input.name()
+        << " read by a strip of output to be a fixed window around it. "
+        << "The first strip reads rows [" << first.min(1) << ", "
+        << first.min(1) + first.extent(1) << ") and the second reads rows ["
+        << second.min(1) << ", " << second.min(1) + second.extent(1) << ").\n";
+
+    x_min = first.min(0);
+    x_extent = first.extent(0);
+    if (input.dimensions() == 3) {
+        c_min = first.min(2);
+        c_extent = first.extent(2);
+    }
+    row_bytes = (size_t)x_extent * c_extent * input.type().bytes();
+
+    // The buffer allocated by the bounds query is exactly the size of
+    // the window, so reuse it for every strip.
+    window = second;
+
+    Internal::debug(1) << "Streaming " << f.name() << " in strips of "
+                       << strip_height << " rows, reading "
+                       << halo_top << " rows above and "
+                       << halo_bottom << " rows below each strip\n";
+}
+
+StripStreamer::StripStreamer(Pipeline p, ImageParam input, int width, int strip_height,
+                             int output_channels) {
+    stages.push_back(Stage(p, input, 0, width, 0, output_channels, strip_height));
+}
+
+StripStreamer::StripStreamer(const vector<Pipeline> &pipelines, const vector<ImageParam> &inputs,
+                             int width, int strip_height, int output_channels) {
+    user_assert(!pipelines.empty() && pipelines.size() == inputs.size())
+        << "StripStreamer requires one input ImageParam for each Pipeline in a chain.\n";
+
+    // Work backwards from the output. Each stage produces the region
+    // of x and c that the next stage reads.
+    vector<Stage> reversed;
+    reversed.push_back(Stage(pipelines.back(), inputs.back(), 0, width, 0, output_channels, strip_height));
+    for (size_t i = pipelines.size() - 1; i > 0; i--) {
+        const Stage &next = reversed.back();
+        Pipeline producer = pipelines[i-1];
+        Type t = producer.outputs()[0].output_types()[0];
+        user_assert(t == next.input.type())
+            << "Stage " << i - 1 << " of a StripStreamer chain produces " << t
+            << ", but stage " << i << " reads " << next.input.type() << "\n";
+        int channels = next.input.dimensions() == 3 ? next.c_extent : 0;
+        reversed.push_back(Stage(producer, inputs[i-1], next.x_min, next.x_extent,
+                                 next.c_min, channels, strip_height));
+    }
+    stages.assign(reversed.rbegin(), reversed.rend());
+}
+
+int StripStreamer::rows_above() const {
+    int rows = 0;
+    for (const Stage &s : stages) {
+        rows += s.halo_top;
+    }
+    return rows;
+}
+
+int StripStreamer::rows_below() const {
+    int rows = 0;
+    for (const Stage &s : stages) {
+        rows += s.halo_bottom;
+    }
+    return rows;
+}
+
+void StripStreamer::push_rows(Buffer rows) {
+    stages[0].push_rows(rows);
+}
+
+void StripStreamer::end_of_input() {
+    stages[0].input_done = true;
+}
+
+Buffer StripStreamer::next_strip() {
+    return next_strip(stages.size() - 1);
+}
+
+Buffer StripStreamer::next_strip(size_t i) {
+    Stage &s = stages[i];
+    while (true) {
+        Buffer strip = s.next_strip();
+        if (strip.defined() || i == 0 || s.done()) {
+            return strip;
+        }
+        // Feed this stage the next strip of the stage before it.
+        Buffer rows = next_strip(i - 1);
+        if (rows.defined()) {
+            s.push_rows(rows);
+        } else if (stages[i-1].done()) {
+            s.input_done = true;
+        } else {
+            // The first stage needs more input.
+            return Buffer();
+        }
+    }
+}
+
+Buffer StripStreamer::Stage::query_input_bounds(int y) {
+    input.set(Buffer());
+    output.set_min(output.min(0), y, output.min(2), 0);
+    pipeline.infer_input_bounds(output);
+    Buffer b = input.get();
+    internal_assert(b.defined());
+    return b;
+}
+
+const uint8_t *StripStreamer::Stage::history_row(int y) const {
+    // Repeat the edge rows beyond the top and the bottom of the image.
+    y = std::max(0, std::min(y, rows_in - 1));
+    internal_assert(y >= history_first && y < rows_in);
+    return &history[(y - history_first) * row_bytes];
+}
+
+void StripStreamer::Stage::push_rows(Buffer rows) {
+    user_assert(!input_done) << "Can't push rows to a StripStreamer after end_of_input().\n";
+    user_assert(rows.defined() && rows.type() == input.type())
+        << "Rows pushed to a StripStreamer must be a Buffer of type " << input.type() << "\n";
+    user_assert(rows.min(0) <= x_min && rows.min(0) + rows.extent(0) >= x_min + x_extent)
+        << "Rows pushed to a StripStreamer must cover [" << x_min << ", "
+        << x_min + x_extent << ") in x.\n";
+    if (input.dimensions() == 3) {
+        user_assert(rows.min(2) <= c_min && rows.min(2) + rows.extent(2) >= c_min + c_extent)
+            << "Rows pushed to a StripStreamer must cover [" << c_min << ", "
+            << c_min + c_extent << ") in c.\n";
+    }
+
+    rows.copy_to_host();
+
+    const int elem_size = input.type().bytes();
+    const int num_rows = std::max(rows.extent(1), 1);
+    const uint8_t *src = (const uint8_t *)rows.host_ptr();
+
+    size_t old_size = history.size();
+    history.resize(old_size + num_rows * row_bytes);
+    uint8_t *dst = &history[old_size];
+
+    for (int r = 0; r < num_rows; r++) {
+        for (int c = 0; c < c_extent; c++) {
+            const uint8_t *src_row = src + ((x_min - rows.min(0)) * rows.stride(0) +
+                                            r * rows.stride(1) +
+                                            (c + c_min - rows.min(2)) * rows.stride(2)) * elem_size;
+            if (rows.stride(0) == 1) {
+                memcpy(dst, src_row, x_extent * elem_size);
+                dst += x_extent * elem_size;
+            } else {
+                for (int x = 0; x < x_extent; x++) {
+                    memcpy(dst, src_row + x * rows.stride(0) * elem_size, elem_size);
+                    dst += elem_size;
+                }
+            }
+        }
+    }
+
+    rows_in += num_rows;
+}
+
+Buffer StripStreamer::Stage::next_strip() {
+    if (input_done && next_y >= rows_in) {
+        // The output is complete.
+        return Buffer();
+    }
+
+    int first_needed = next_y - halo_top;
+    int last_needed = next_y + strip_height + halo_bottom - 1;
+    if (!input_done && last_needed >= rows_in) {
+        // Need more input.
+        return Buffer();
+    }
+
+    // Assemble the window of input rows for this strip.
+    buffer_t *w = window.raw_buffer();
+    const int elem_size = input.type().bytes();
+    window.set_min(x_min, first_needed, c_min, 0);
+    for (int r = 0; r < w->extent[1]; r++) {
+        const uint8_t *src = history_row(first_needed + r);
+        for (int c = 0; c < c_extent; c++) {
+            uint8_t *dst = w->host + (r * w->stride[1] + c * w->stride[2]) * elem_size;
+            if (w->stride[0] == 1) {
+                memcpy(dst, src, x_extent * elem_size);
+            } else {
+                for (int x = 0; x < x_extent; x++) {
+                    memcpy(dst + x * w->stride[0] * elem_size, src + x * elem_size, elem_size);
+                }
+            }
+            src += x_extent * elem_size;
+        }
+    }
+    window.set_host_dirty();
+
+    // Compute the strip.
+    output.raw_buffer()->extent[1] = strip_height;
+    output.set_min(output.min(0), next_y, output.min(2), 0);
+    input.set(window);
+    pipeline.realize(output);
+    output.copy_to_host();
+
+    if (input_done) {
+        // The last strip may be shorter.
+        output.raw_buffer()->extent[1] = std::min(strip_height, rows_in - next_y);
+    }
+    next_y += strip_height;
+
+    // Drop the rows of input no future strip will read. Always
+    // retain the last row, in case it needs to be repeated.
+    int keep_from = std::min(next_y - halo_top, rows_in - 1);
+    if (keep_from > history_first) {
+        size_t drop = (keep_from - history_first) * row_bytes;
+        history.erase(history.begin(), history.begin() + drop);
+        history_first = keep_from;
+    }
+
+    return output;
+}
+
+}
@@ -0,0 +1,158 @@
+#ifndef HALIDE_STRIP_STREAMER_H
+#define HALIDE_STRIP_STREAMER_H
+
+/** \file
+ *
+ * Defines a helper for running a pipeline over an image of unbounded
+ * height, one strip of rows at a time.
+ */
+
+#include <vector>
+
+#include "Buffer.h"
+#include "Param.h"
+#include "Pipeline.h"
+
+namespace Halide {
+
+/** Runs a JIT-compiled Pipeline over an input that arrives as
+ * successive strips of rows (e.g. from a camera or a scanner), and
+ * produces the output as successive strips of rows. Only the input
+ * rows needed by the next strip of output are retained between calls,
+ * so memory use is independent of the image height, and the first
+ * rows of output are available as soon as enough input for them has
+ * arrived.
+ *
+ * The pipeline must read a fixed window of input rows relative to
+ * each output strip (as any stencil pipeline does). Above the first
+ * row and below the last row of input, the edge rows are repeated,
+ * so the pipeline only needs boundary conditions in x. Within a
+ * strip, producers scheduled with store_at/compute_at an output row
+ * still benefit from the sliding window and storage folding
+ * optimizations, but the rows of a producer that overlap the
+ * previous strip are recomputed.
+ *
+ * To avoid recomputing them, split the pipeline at the expensive
+ * producer and stream a chain of pipelines, each of which reads the
+ * output of the one before it through an ImageParam. Each row of
+ * each stage's output is then computed exactly once: the rows that
+ * the next stage still needs are kept between calls, and each call
+ * only computes new ones. The edge rows of each stage's output
+ * are repeated above and below the image, just as the input's are.
+ *
+ * Use it like this:
+ \code
+ StripStreamer streamer(pipeline, input, width, 32);
+ while (more_rows()) {
+     streamer.push_rows(get_rows());
+     for (Buffer strip = streamer.next_strip(); strip.defined();
+          strip = streamer.next_strip()) {
+         consume(strip);
+     }
+ }
+ streamer.end_of_input();
+ for (Buffer strip = streamer.next_strip(); strip.defined();
+      strip = streamer.next_strip()) {
+     consume(strip);
+ }
+ \endcode
+ */
+class StripStreamer {
+    /** One pipeline of the chain. It retains the rows of its input
+     * still needed, and produces its output a strip at a time. */
+    struct Stage {
+        Pipeline pipeline;
+        ImageParam input;
+        int strip_height;
+
+        /** The region of input read by one strip of output, and one
+         * strip of output. Both are reused across strips. */
+        Buffer window, output;
+
+        /** The number of rows of input needed above and below each strip. */
+        int halo_top, halo_bottom;
+
+        /** The range of the non-row dimensions of the input needed. */
+        int x_min, x_extent, c_min, c_extent;
+
+        /** The input rows retained, packed as channel-major rows, and
+         * the index of the first retained row. */
+        std::vector<uint8_t> history;
+        int history_first;
+        size_t row_bytes;
+
+        int rows_in, next_y;
+        bool input_done;
+
+        /** Prepare to produce strips of the given region of the
+         * output in x and c. Zero channels means the output is
+         * two-dimensional. */
+        Stage(Pipeline p, ImageParam input, int x_min, int width,
+              int c_min, int channels, int strip_height);
+
+        Buffer query_input_bounds(int y);
+        const uint8_t *history_row(int y) const;
+        void push_rows(Buffer rows);
+        Buffer next_strip();
+
+        bool done() const {
+            return input_done && next_y >= rows_in;
+        }
+    };
+
+    std::vector<Stage> stages;
+
+    Buffer next_strip(size_t stage);
+
+public:
+    /** Prepare to stream the output of a pipeline with one
+     * single-valued output Func of the given width (and number of
+     * channels, if the output is three-dimensional) in strips of
+     * strip_height rows. The input ImageParam is rebound for each
+     * strip, and must be indexed as (x, y) or (x, y, c). */
+    EXPORT StripStreamer(Pipeline p, ImageParam input, int width, int strip_height,
+                         int output_channels = 0);
+
+    /** Prepare to stream a chain of pipelines. The first reads the
+     * rows pushed through inputs[0], and each later one reads the
+     * output of the one before it through inputs[i]. The last one
+     * produces the output, as above. Each stage computes each row of
+     * its output once. */
+    EXPORT StripStreamer(const std::vector<Pipeline> &stages,
+                         const std::vector<ImageParam> &inputs,
+                         int width, int strip_height, int output_channels = 0);
+
+    /** Append rows of input. The buffer must cover the region of x
+     * (and c) read by the pipeline. Its min in y is ignored; rows are
+     * numbered in the order they are pushed. */
+    EXPORT void push_rows(Buffer rows);
+
+    /** Signal that no more rows of input will be pushed. The
+     * remaining strips of output can then be produced, with the last
+     * row of input repeated downwards as needed. */
+    EXPORT void end_of_input();
+
+    /** Compute the next strip of output if enough input has arrived,
+     * and return it. The min of the returned Buffer in y is the index
+     * of the first row of the strip. The last strip may have fewer
+     * rows than the strip height. The buffer is reused by the next
+     * call. Returns an undefined Buffer if more input is needed or
+     * the output is complete. */
+    EXPORT Buffer next_strip();
+
+    /** The number of rows of output produced so far. */
+    int rows_produced() const {
+        return stages.back().next_y;
+    }
+
+    /** The number of input rows read above and below each strip of
+     * output, through all of the stages. */
+    // @{
+    EXPORT int rows_above() const;
+    EXPORT int rows_below() const;
+    // @}
+};
+
+}
+
+#endif
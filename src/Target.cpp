@@ -308,6 +308,16 @@ bool Target::merge_string(const std::string &target) {
             set_feature(Target::Profile);
         } else if (tok == "no_runtime") {
             set_feature(Target::NoRuntime);
+        } else if (tok == "auto_specialize") {
+            set_feature(Target::AutoSpecialize);
+        } else if (tok == "shared_memoization_cache") {
+            set_feature(Target::SharedMemoizationCache);
+        } else if (tok == "async_device_copies") {
+            set_feature(Target::AsyncDeviceCopies);
+        } else if (tok == "host_device") {
+            set_feature(Target::HostDevice);
+        } else if (tok == "pipeline_stats") {
+            set_feature(Target::PipelineStats);
         } else {
             return false;
         }
@@ -370,7 +380,12 @@ std::string Target::to_string() const {
       "register_metadata",
       "matlab",
       "profile",
-      "no_runtime"
+      "no_runtime",
+      "auto_specialize",
+      "shared_memoization_cache",
+      "async_device_copies",
+      "host_device",
+      "pipeline_stats"
   };
   internal_assert(sizeof(feature_names) / sizeof(feature_names[0]) == FeatureEnd);
   string result = string(arch_names[arch])
@@ -69,6 +69,12 @@ struct Target {
         Profile, ///< Launch a sampling profiler alongside the Halide pipeline that monitors and reports the runtime used by each Func
         NoRuntime, ///< Do not include a copy of the Halide runtime in any generated object file or assembly
 
+        AutoSpecialize, ///< Automatically emit versions of the pipeline specialized for common buffer shapes, dispatched at pipeline entry
+        SharedMemoizationCache, ///< Keep memoized Funcs in a cache in shared memory, shared by all processes on the machine. Linux and OS X only. When jitting, the first compilation in the process decides which cache is used.
+        AsyncDeviceCopies, ///< Don't wait for copies from host to device memory to finish until the host memory is about to be overwritten or freed. Double buffers functions computed on the host per loop iteration.
+        HostDevice, ///< Run gpu schedules on a mock device whose memory is host memory. For testing device offload without a gpu. See HalideRuntimeHostDevice.h.
+        PipelineStats, ///< Count the calls to each entrypoint, and record how long they took. See halide_enumerate_pipeline_stats.
+
         FeatureEnd
         // NOTE: Changes to this enum must be reflected in the definition of
         // to_string()!
@@ -119,14 +119,30 @@ private:
             vector<Expr> traces(op->values.size());
 
             for (size_t i = 0; i < values.size(); i++) {
+                // An atomic update must stay the outermost call, so
+                // trace the value it combines with the site instead.
+                Expr value = values[i];
+                const Call *atomic = value.as<Call>();
+                if (atomic && atomic->name == Call::atomic_update &&
+                    atomic->call_type == Call::Intrinsic) {
+                    value = atomic->args[1];
+                } else {
+                    atomic = NULL;
+                }
+
                 vector<Expr> args;
                 args.push_back(f.name());
                 args.push_back(halide_trace_store);
                 args.push_back(Variable::make(Int(32), op->name + ".trace_id"));
                 args.push_back((int)i);
-                args.push_back(values[i]);
+                args.push_back(value);
                 args.insert(args.end(), op->args.begin(), op->args.end());
-                traces[i] = Call::make(values[i].type(), Call::trace_expr, args, Call::Intrinsic);
+                traces[i] = Call::make(value.type(), Call::trace_expr, args, Call::Intrinsic);
+
+                if (atomic) {
+                    traces[i] = Call::make(atomic->type, Call::atomic_update,
+                                           {atomic->args[0], traces[i]}, Call::Intrinsic);
+                }
             }
 
             stmt = Provide::make(op->name, traces, op->args);
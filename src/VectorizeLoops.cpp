@@ -373,6 +373,49 @@ class VectorizeLoops : public IRMutator {
         }
 
         void visit(const Store *op) {
+            const Call *update = op->value.as<Call>();
+            if (update && update->call_type == Call::Intrinsic &&
+                update->name == Call::atomic_update && !scalarized) {
+                Expr index = mutate(op->index);
+                Expr other = mutate(update->args[1]);
+                if (index.type().is_vector() || internal_allocations.contains(op->name)) {
+                    // The lanes may update the same site, so do them
+                    // one at a time.
+                    stmt = scalarize(op);
+                    return;
+                } else {
+                    // All the lanes update the same site. Reduce
+                    // them first, and do one update. Each lane
+                    // contributes to it, even if they all contribute
+                    // the same value.
+                    const StringImm *update_op = update->args[0].as<StringImm>();
+                    internal_assert(update_op);
+                    VectorReduce::Operator reduce_op = VectorReduce::Add;
+                    if (update_op->value == "mul") {
+                        reduce_op = VectorReduce::Mul;
+                    } else if (update_op->value == "min") {
+                        reduce_op = VectorReduce::Min;
+                    } else if (update_op->value == "max") {
+                        reduce_op = VectorReduce::Max;
+                    } else if (update_op->value == "and") {
+                        reduce_op = VectorReduce::And;
+                    } else if (update_op->value == "or") {
+                        reduce_op = VectorReduce::Or;
+                    } else if (update_op->value == "xor") {
+                        reduce_op = VectorReduce::Xor;
+                    } else {
+                        // The terms of a sum, or of a difference
+                        // (f - a - b = f - (a + b)), are added.
+                        internal_assert(update_op->value == "add" || update_op->value == "sub");
+                    }
+                    other = VectorReduce::make(reduce_op, widen(other, replacement.type().width), 1);
+                    Expr value = Call::make(update->type, Call::atomic_update,
+                                            {update->args[0], other}, Call::Intrinsic);
+                    stmt = Store::make(op->name, value, index);
+                    return;
+                }
+            }
+
             Expr value = mutate(op->value);
             Expr index = mutate(op->index);
             // Internal allocations always get vectorized.
@@ -636,8 +679,113 @@ class VectorizeLoops : public IRMutator {
 
 };
 
+class LoadsFromBuffer : public IRVisitor {
+    const string &buffer;
+
+    using IRVisitor::visit;
+
+    void visit(const Load *op) {
+        result = result || op->name == buffer;
+        IRVisitor::visit(op);
+    }
+public:
+    bool result;
+    LoadsFromBuffer(const string &b) : buffer(b), result(false) {}
+};
+
+// Vectorizing an atomic update to a single site makes an update by a
+// VectorReduce to one lane, once per iteration of the loops around
+// it. If the innermost of those loops does nothing else, accumulate
+// a vector across the loop instead, and reduce and update the site
+// once after it.
+class LiftVectorReductions : public IRMutator {
+    using IRMutator::visit;
+
+    void visit(const For *op) {
+        IRMutator::visit(op);
+        const For *loop = stmt.as<For>();
+        if (!loop || loop->for_type != ForType::Serial) return;
+
+        Scope<int> loop_vars;
+        loop_vars.push(loop->name, 0);
+        vector<const LetStmt *> lets;
+        Stmt body = loop->body;
+        while (const LetStmt *let = body.as<LetStmt>()) {
+            lets.push_back(let);
+            loop_vars.push(let->name, 0);
+            body = let->body;
+        }
+
+        const Store *store = body.as<Store>();
+        const Call *update = store ? store->value.as<Call>() : NULL;
+        if (!update || update->call_type != Call::Intrinsic ||
+            update->name != Call::atomic_update) {
+            return;
+        }
+        const VectorReduce *reduce = update->args[1].as<VectorReduce>();
+        if (!reduce || reduce->width != 1 || expr_uses_vars(store->index, loop_vars)) {
+            return;
+        }
+
+        // The updates within the loop are unordered, but they can't
+        // be moved past loads of the site.
+        LoadsFromBuffer loads(store->name);
+        loop->body.accept(&loads);
+        if (loads.result) {
+            return;
+        }
+
+        // A widening sum can accumulate in fewer lanes, as the
+        // narrow lanes are first added in pairs (or fours...) into
+        // wide ones. A sum of products of widened values accumulates
+        // in half the lanes, as pairs of products are added by
+        // multiply-add instructions.
+        Expr value = reduce->value;
+        int factor = 1;
+        if (reduce->op == VectorReduce::Add && !value.type().is_float()) {
+            if (const Cast *cast = value.as<Cast>()) {
+                if (!cast->value.type().is_float() && cast->value.type().bits < value.type().bits) {
+                    factor = value.type().bits / cast->value.type().bits;
+                }
+            } else if (const Mul *mul = value.as<Mul>()) {
+                // One side may be a constant weight.
+                const Cast *ca = mul->a.as<Cast>(), *cb = mul->b.as<Cast>();
+                bool narrow_a = ca && !ca->value.type().is_float() && ca->value.type().bits < value.type().bits;
+                bool narrow_b = cb && !cb->value.type().is_float() && cb->value.type().bits < value.type().bits;
+                if ((narrow_a || mul->a.as<Broadcast>()) && (narrow_b || mul->b.as<Broadcast>()) &&
+                    (narrow_a || narrow_b)) {
+                    factor = 2;
+                }
+            }
+        }
+        int width = value.type().width / factor;
+        if (factor > 1 && width > 1 && width * factor == value.type().width) {
+            value = VectorReduce::make(VectorReduce::Add, value, width);
+        }
+
+        Type t = value.type();
+        string acc_name = unique_name('t');
+        Expr acc_index = Ramp::make(0, 1, t.width);
+        Expr acc = Load::make(t, acc_name, acc_index, Buffer(), Parameter());
+
+        Stmt new_body = Store::make(acc_name, vector_reduce_combine(reduce->op, acc, value), acc_index);
+        for (size_t i = lets.size(); i > 0; i--) {
+            new_body = LetStmt::make(lets[i-1]->name, lets[i-1]->value, new_body);
+        }
+        new_body = For::make(loop->name, loop->min, loop->extent, loop->for_type, loop->device_api, new_body);
+
+        Expr result = VectorReduce::make(reduce->op, acc, 1);
+        result = Call::make(update->type, Call::atomic_update, {update->args[0], result}, Call::Intrinsic);
+
+        Stmt s = Store::make(acc_name, vector_reduce_identity(reduce->op, t), acc_index);
+        s = Block::make(s, Block::make(new_body, Store::make(store->name, result, store->index)));
+        stmt = Allocate::make(acc_name, t.element_of(), {t.width}, const_true(), s);
+    }
+};
+
 Stmt vectorize_loops(Stmt s) {
-    return VectorizeLoops().mutate(s);
+    s = VectorizeLoops().mutate(s);
+    return LiftVectorReductions().mutate(s);
 }
 
 }
@@ -228,6 +228,22 @@ extern int halide_copy_to_host(void *user_context, struct buffer_t *buf);
 extern int halide_copy_to_device(void *user_context, struct buffer_t *buf,
                                  const halide_device_interface *interface);
 
+/** Start copying image data from host memory to device memory, and
+ * return without waiting for the copy to finish if the device
+ * supports it. Device code run afterwards sees the copied data, but
+ * the host memory must not be overwritten or freed until
+ * halide_device_wait_for_copies has been called on the buffer. Used
+ * by pipelines compiled with the async_device_copies target
+ * feature. Devices that can't copy asynchronously do a blocking
+ * copy. */
+extern int halide_copy_to_device_async(void *user_context, struct buffer_t *buf,
+                                       const halide_device_interface *interface);
+
+/** Wait for any copies of the buffer started by
+ * halide_copy_to_device_async to finish reading the host memory. Does
+ * not wait for any other device work. */
+extern int halide_device_wait_for_copies(void *user_context, struct buffer_t *buf);
+
 /** Wait for current GPU operations to complete. Calling this explicitly
  * should rarely be necessary, except maybe for profiling. */
 extern int halide_device_sync(void *user_context, struct buffer_t *buf);
@@ -237,6 +253,37 @@ extern int halide_device_malloc(void *user_context, struct buffer_t *buf, const
 
 extern int halide_device_free(void *user_context, struct buffer_t *buf);
 
+/** The CUDA, OpenCL, and host device runtimes don't free the device
+ * memory of a buffer in halide_device_free. They keep it in a pool,
+ * and reuse it for later allocations of a similar size in the same
+ * device context. This frees the least recently used pooled
+ * allocations of a device, until at most max_bytes of them are
+ * left. halide_device_release empties the pool. Does nothing for
+ * devices without a pool. */
+extern int halide_device_pool_trim(void *user_context, const halide_device_interface *interface,
+                                   size_t max_bytes);
+
+/** Set the most memory, in bytes, that the device memory pool of each
+ * device context keeps for reuse. Allocations freed beyond that are
+ * really freed, least recently freed first. The default is no
+ * limit. Regardless of the limit, if a device allocation fails, the
+ * pool of its context is emptied and the allocation retried. */
+extern void halide_device_pool_set_limit(size_t max_bytes);
+
+/** Statistics of the device memory pool of a device. */
+struct halide_device_pool_stats {
+    /** The number of device allocations reused from the pool, and the
+     * number that had to be made by the device. */
+    uint64_t hits, misses;
+    /** The number and total size of the allocations in the pool. */
+    uint64_t pooled_allocations, pooled_bytes;
+};
+
+/** Get the statistics of the device memory pool of a device. Zeroes
+ * them for devices without a pool. */
+extern int halide_device_pool_get_stats(void *user_context, const halide_device_interface *interface,
+                                        struct halide_device_pool_stats *stats);
+
 /** Selects which gpu device to use. 0 is usually the display
  * device. If never called, Halide uses the environment variable
  * HL_GPU_DEVICE. If that variable is unset, Halide uses the last
@@ -255,6 +302,11 @@ extern int halide_get_gpu_device(void *user_context);
  *  maximum in that concurrency and simultaneous use of memoized
  *  reults larger than the cache size can both cause it to
  *  temporariliy be larger than the size specified here.
+ *
+ *  When targeting shared_memoization_cache, the cache lives in a
+ *  shared memory segment of fixed size, and this sets the size used
+ *  if the calling process is the one to create the segment. It must
+ *  be called before the first memoized Func runs to have any effect.
  */
 extern void halide_memoization_cache_set_size(int64_t size);
 
@@ -656,6 +708,94 @@ typedef int (*enumerate_func_t)(void* enumerate_context,
  */
 extern int halide_enumerate_registered_filters(void *user_context, void* enumerate_context, enumerate_func_t func);
 
+/** The functions below here are relevant for pipelines compiled with
+ * the -pipeline_stats target flag, which counts the calls to each
+ * entrypoint, and how long they took. Unlike the profiler, this is
+ * cheap enough to leave on in production: each call takes two
+ * timestamps and updates a few counters atomically. */
+
+/** The number of buckets in the latency histogram of a pipeline. */
+#define HALIDE_PIPELINE_STATS_BUCKETS 160
+
+/** The statistics gathered for a pipeline. */
+struct halide_pipeline_stats_t {
+    /** The name of the pipeline, the same as the name in its
+     * halide_filter_metadata_t. Pipelines with the same name share
+     * their statistics. */
+    const char *name;
+
+    /** The number of calls, not counting bounds queries. */
+    uint64_t calls;
+
+    /** The number of calls that returned an error. */
+    uint64_t errors;
+
+    /** The total and longest time taken by the calls (in
+     * nanoseconds). */
+    uint64_t total_time_ns;
+    uint64_t max_time_ns;
+
+    /** The total size of the output buffers of the calls that
+     * succeeded (in bytes). */
+    uint64_t output_bytes;
+
+    /** A histogram of the time taken by the calls. Each power of two
+     * number of nanoseconds is split into four buckets. See
+     * halide_pipeline_stats_bucket_time_ns. */
+    uint64_t histogram[HALIDE_PIPELINE_STATS_BUCKETS];
+
+    /** The next pipeline's statistics. It's a void * because types
+     * in the Halide runtime may not currently be recursive. */
+    void *next;
+};
+
+/** Called by the entrypoint of the pipeline before it runs. Finds the
+ * statistics for the named pipeline (caching them in *stats), and
+ * returns the time the call started. */
+extern int64_t halide_pipeline_stats_begin(void *user_context, halide_pipeline_stats_t **stats,
+                                           const char *pipeline_name);
+
+/** Called by the entrypoint of the pipeline after it runs, with its
+ * result, and its buffer arguments (the outputs last). */
+extern void halide_pipeline_stats_end(void *user_context, halide_pipeline_stats_t *stats,
+                                      int64_t start_time, int result,
+                                      buffer_t **buffers, int num_buffers, int num_outputs);
+
+/** halide_pipeline_stats_enumerate_func_t is a callback for
+ * halide_enumerate_pipeline_stats. Return 0 to continue the
+ * enumeration, or nonzero to terminate it. */
+typedef int (*halide_pipeline_stats_enumerate_func_t)(void *enumerate_context,
+                                                      const halide_pipeline_stats_t *stats);
+
+/** Call func with a snapshot of the statistics of each pipeline that
+ * has been called since it was loaded. Each counter in the snapshot is
+ * read atomically, but calls that finish while the snapshot is being
+ * taken may be only partly counted. If reset is true, each counter is
+ * set to zero as it is read, so that no calls are lost between
+ * successive snapshots. Returns the first nonzero result of func, or
+ * zero. */
+extern int halide_enumerate_pipeline_stats(void *user_context, void *enumerate_context,
+                                           halide_pipeline_stats_enumerate_func_t func,
+                                           bool reset);
+
+/** The shortest time (in nanoseconds) counted by a bucket of the
+ * histogram. The bucket counts the calls that took up to, but not
+ * including, the time of the next bucket. The last bucket also
+ * counts all longer calls. */
+extern uint64_t halide_pipeline_stats_bucket_time_ns(int bucket);
+
+/** Estimate a percentile (between 0 and 100) of the time taken by the
+ * calls from the histogram (in nanoseconds). The estimate errs long,
+ * by at most a quarter of the time. */
+extern uint64_t halide_pipeline_stats_percentile_ns(const halide_pipeline_stats_t *stats,
+                                                    float percentile);
+
+/** Print out the statistics of each pipeline. */
+extern void halide_pipeline_stats_report(void *user_context);
+
+/** Set all statistics to zero. */
+extern void halide_pipeline_stats_reset();
+
 
 /** The functions below here are relevant for pipelines compiled with
  * the -profile target flag, which runs a sampling profiler thread
@@ -745,6 +885,62 @@ extern void halide_profiler_reset();
  * reset. Also happens at process exit. */
 extern void halide_profiler_report(void *user_context);
 
+/** The functions below here are relevant for pipelines compiled with
+ * the -auto_specialize target flag, which emits several versions of
+ * the pipeline specialized for common buffer shapes and picks one at
+ * pipeline entry. */
+
+/** Per-version hit counts. These exist in a linked list. */
+struct halide_auto_specialization_stats {
+    /** The name of the pipeline. A global constant string. */
+    const char *pipeline_name;
+
+    /** The name of the version (e.g. "dense", "interleaved_3",
+     * "generic"). A global constant string. */
+    const char *version_name;
+
+    /** The number of runs of the pipeline that used this version. */
+    uint64_t hits;
+
+    /** The next stats pointer. It's a void * because types in the
+     * Halide runtime may not currently be recursive. */
+    void *next;
+};
+
+/** Called by the pipeline at entry with the version it selected. */
+extern int halide_auto_specialization_hit(void *user_context, const char *pipeline_name,
+                                          const char *version_name);
+
+/** Get the head of the list of hit counts for programmatic
+ * inspection. Not thread safe with respect to concurrently running
+ * pipelines. */
+extern halide_auto_specialization_stats *halide_auto_specialization_get_stats();
+
+/** Print out which versions have been used since the last
+ * reset. Also happens at process exit. */
+extern void halide_auto_specialization_report(void *user_context);
+
+/** Reset all hit counts. */
+extern void halide_auto_specialization_reset();
+
+/** The x86 instruction set extensions that
+ * halide_can_use_cpu_features can check for. */
+typedef enum halide_cpu_feature_t {
+    halide_cpu_feature_sse41 = 1 << 0,
+    halide_cpu_feature_avx = 1 << 1,
+    halide_cpu_feature_avx2 = 1 << 2,
+    halide_cpu_feature_fma = 1 << 3,
+    halide_cpu_feature_fma4 = 1 << 4,
+    halide_cpu_feature_f16c = 1 << 5
+} halide_cpu_feature_t;
+
+/** Check if the host cpu supports all of the given
+ * halide_cpu_feature_t flags. Objects containing several target
+ * variants of a pipeline (see Halide::compile_multitarget) call this
+ * to pick which variant to run. The cpu is only queried on the first
+ * call. Only present in the runtime for x86 targets. */
+extern int halide_can_use_cpu_features(uint64_t features);
+
 #ifdef __cplusplus
 } // End extern "C"
 #endif
@@ -0,0 +1,63 @@
+#ifndef HALIDE_HALIDERUNTIMEHOSTDEVICE_H
+#define HALIDE_HALIDERUNTIMEHOSTDEVICE_H
+
+#include "HalideRuntime.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \file
+ *  Routines specific to the Halide host device runtime. The host
+ *  device is a mock device whose allocations are ordinary host
+ *  memory, and whose kernels run on the cpu. Copies to and from it
+ *  are real copies, and can be given an artificial latency and
+ *  bandwidth, so that device-offload schedules can be tested and
+ *  benchmarked on machines without a gpu.
+ */
+
+extern const struct halide_device_interface *halide_host_device_interface();
+
+/** Set the simulated cost of a copy between the host and the host
+ * device. Each copy takes at least latency_ns nanoseconds, plus the
+ * time to move the data at bytes_per_second. A bytes_per_second of
+ * zero means the bandwidth is unlimited. Copies are simulated by
+ * spinning, and are serialized, as if there were a single copy
+ * engine. By default copies have no extra cost. */
+extern void halide_host_device_set_transfer_cost(int64_t latency_ns, int64_t bytes_per_second);
+
+/** Counts of the operations done on the host device since the last
+ * call to halide_host_device_reset_stats. */
+struct halide_host_device_stats {
+    /** The number of device allocations made and freed. Allocations
+     * reused from the device memory pool aren't counted. */
+    uint64_t device_mallocs, device_frees;
+    uint64_t copies_to_device, copies_to_host;
+    uint64_t bytes_to_device, bytes_to_host;
+    /** The number of times the host waited for a copy to finish,
+     * and the total time it waited. */
+    uint64_t waits, wait_ns;
+    /** The number of times the host asked to wait for asynchronous
+     * copies to the device, whether or not it had to wait. */
+    uint64_t copy_waits;
+};
+
+/** Get the counts of operations done on the host device. */
+extern void halide_host_device_get_stats(struct halide_host_device_stats *stats);
+
+/** Zero the counts of operations done on the host device. */
+extern void halide_host_device_reset_stats();
+
+/** These are forward declared here to allow clients to override the
+ *  Halide host device runtime. Do not call them. */
+// @{
+/** Get the memory of the device allocation of a buffer, waiting for
+ * any copies to it to finish. Called at the start of each kernel. */
+extern void *halide_host_device_get_pointer(void *user_context, struct buffer_t *buf);
+// @}
+
+#ifdef __cplusplus
+} // End extern "C"
+#endif
+
+#endif // HALIDE_HALIDERUNTIMEHOSTDEVICE_H
@@ -0,0 +1,85 @@
+#include "runtime_internal.h"
+#include "HalideRuntime.h"
+#include "scoped_mutex_lock.h"
+
+// Hit counters for pipelines compiled with Target::AutoSpecialize. The
+// generated code calls halide_auto_specialization_hit once per run
+// with the name of the version it dispatched to.
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+WEAK halide_mutex auto_specialization_lock = { { 0 } };
+WEAK halide_auto_specialization_stats *auto_specialization_stats = NULL;
+
+}}}
+
+extern "C" {
+
+WEAK int halide_auto_specialization_hit(void *user_context,
+                                        const char *pipeline_name,
+                                        const char *version_name) {
+    ScopedMutexLock lock(&auto_specialization_lock);
+
+    for (halide_auto_specialization_stats *s = auto_specialization_stats; s;
+         s = (halide_auto_specialization_stats *)(s->next)) {
+        // The same pipeline will deliver the same global constant
+        // strings, so they can be compared by pointer.
+        if (s->pipeline_name == pipeline_name &&
+            s->version_name == version_name) {
+            s->hits++;
+            return 0;
+        }
+    }
+
+    halide_auto_specialization_stats *s =
+        (halide_auto_specialization_stats *)halide_malloc(NULL, sizeof(halide_auto_specialization_stats));
+    if (!s) {
+        // Losing a hit count isn't worth failing the pipeline over.
+        return 0;
+    }
+    s->pipeline_name = pipeline_name;
+    s->version_name = version_name;
+    s->hits = 1;
+    s->next = auto_specialization_stats;
+    auto_specialization_stats = s;
+    return 0;
+}
+
+WEAK halide_auto_specialization_stats *halide_auto_specialization_get_stats() {
+    return auto_specialization_stats;
+}
+
+WEAK void halide_auto_specialization_report(void *user_context) {
+    ScopedMutexLock lock(&auto_specialization_lock);
+
+    char line_buf[160];
+    Printer<StringStreamPrinter, sizeof(line_buf)> sstr(user_context, line_buf);
+
+    for (halide_auto_specialization_stats *s = auto_specialization_stats; s;
+         s = (halide_auto_specialization_stats *)(s->next)) {
+        sstr.clear();
+        sstr << s->pipeline_name << ": version " << s->version_name
+             << " hit " << s->hits << " times\n";
+        halide_print(user_context, sstr.str());
+    }
+}
+
+WEAK void halide_auto_specialization_reset() {
+    ScopedMutexLock lock(&auto_specialization_lock);
+
+    while (auto_specialization_stats) {
+        halide_auto_specialization_stats *s = auto_specialization_stats;
+        auto_specialization_stats = (halide_auto_specialization_stats *)(s->next);
+        halide_free(NULL, s);
+    }
+}
+
+namespace {
+__attribute__((destructor))
+WEAK void halide_auto_specialization_shutdown() {
+    if (!auto_specialization_stats) return;
+    halide_auto_specialization_report(NULL);
+}
+}
+
+}
@@ -200,6 +200,14 @@ CL_FN(cl_int,
                        size_t       /* arg_size */,
                        const void * /* arg_value */));
 
+/* Event Object APIs */
+CL_FN(cl_int,
+      clWaitForEvents, (cl_uint          /* num_events */,
+                        const cl_event * /* event_list */));
+
+CL_FN(cl_int,
+      clReleaseEvent, (cl_event /* event */));
+
 /* Flush and Finish APIs */
 CL_FN(cl_int,
       clFlush, (cl_command_queue /* command_queue */));
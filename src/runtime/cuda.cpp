@@ -3,6 +3,7 @@
 #include "HalideRuntimeCuda.h"
 #include "mini_cuda.h"
 #include "cuda_opencl_shared.h"
+#include "device_pool.h"
 
 #define INLINE inline __attribute__((always_inline))
 
@@ -303,6 +304,29 @@ WEAK CUresult create_cuda_context(void *user_context, CUcontext *ctx) {
 }
 
 
+// Device allocations are pooled, per context.
+WEAK device_pool pool;
+
+// Free the pooled allocations of the current context, until at most
+// max_bytes of them are left.
+WEAK int trim_pool(void *user_context, CUcontext ctx, size_t max_bytes) {
+    int result = CUDA_SUCCESS;
+    pooled_allocation *a = pool_trim(&pool, ctx, max_bytes);
+    while (a) {
+        pooled_allocation *next = a->next;
+        debug(user_context) << "    cuMemFree " << (void *)(a->handle) << " (pooled)\n";
+        CUresult err = cuMemFree((CUdeviceptr)a->handle);
+        if (err != CUDA_SUCCESS && result == CUDA_SUCCESS) {
+            error(user_context) << "CUDA: cuMemFree failed: "
+                                << get_error_name(err);
+            result = err;
+        }
+        pool_delete(a);
+        a = next;
+    }
+    return result;
+}
+
 WEAK bool validate_device_pointer(void *user_context, buffer_t* buf, size_t size=0) {
 // The technique using cuPointerGetAttribute and CU_POINTER_ATTRIBUTE_CONTEXT
 // requires unified virtual addressing is enabled and that is not the case
@@ -407,6 +431,13 @@ WEAK int halide_cuda_device_free(void *user_context, buffer_t* buf) {
 
     halide_assert(user_context, validate_device_pointer(user_context, buf));
 
+    if (pool_put(&pool, (uint64_t)dev_ptr)) {
+        debug(user_context) << "    returned " << (void *)(dev_ptr) << " to the pool\n";
+        halide_delete_device_wrapper(buf->dev);
+        buf->dev = 0;
+        return trim_pool(user_context, ctx.context, halide_device_pool_get_limit());
+    }
+
     debug(user_context) <<  "    cuMemFree " << (void *)(dev_ptr) << "\n";
     CUresult err = cuMemFree(dev_ptr);
     // If cuMemFree fails, it isn't likely to succeed later, so just drop
@@ -445,6 +476,11 @@ WEAK int halide_cuda_device_release(void *user_context) {
         err = cuCtxSynchronize();
         halide_assert(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
 
+        // Free the pooled allocations, and forget about the ones in
+        // use, as they can't be reused in a new context.
+        trim_pool(user_context, ctx, 0);
+        pool_forget_in_use(&pool, ctx);
+
         // Unload the modules attached to this context. Note that the list
         // nodes themselves are not freed, only the module objects are
         // released. Subsequent calls to halide_init_kernels might re-create
@@ -512,16 +548,28 @@ WEAK int halide_cuda_device_malloc(void *user_context, buffer_t *buf) {
     uint64_t t_before = halide_current_time_ns(user_context);
     #endif
 
-    CUdeviceptr p;
-    debug(user_context) << "    cuMemAlloc " << (uint64_t)size << " -> ";
-    CUresult err = cuMemAlloc(&p, size);
-    if (err != CUDA_SUCCESS) {
-        debug(user_context) << get_error_name(err) << "\n";
-        error(user_context) << "CUDA: cuMemAlloc failed: "
-                            << get_error_name(err);
-        return err;
+    size = pool_bucket_size(size);
+    CUdeviceptr p = (CUdeviceptr)pool_take(&pool, ctx.context, size);
+    if (p) {
+        debug(user_context) << "    reusing pooled allocation " << (void *)p << "\n";
     } else {
-        debug(user_context) << (void *)p << "\n";
+        debug(user_context) << "    cuMemAlloc " << (uint64_t)size << " -> ";
+        CUresult err = cuMemAlloc(&p, size);
+        if (err != CUDA_SUCCESS) {
+            // Free the pooled allocations and try again.
+            debug(user_context) << get_error_name(err) << ", emptying the pool and retrying -> ";
+            trim_pool(user_context, ctx.context, 0);
+            err = cuMemAlloc(&p, size);
+        }
+        if (err != CUDA_SUCCESS) {
+            debug(user_context) << get_error_name(err) << "\n";
+            error(user_context) << "CUDA: cuMemAlloc failed: "
+                                << get_error_name(err);
+            return err;
+        } else {
+            debug(user_context) << (void *)p << "\n";
+        }
+        pool_add(&pool, ctx.context, (uint64_t)p, size);
     }
     halide_assert(user_context, p);
     buf->dev = halide_new_device_wrapper((uint64_t)p, &cuda_device_interface);
@@ -799,6 +847,7 @@ WEAK uintptr_t halide_cuda_detach_device_ptr(void *user_context, struct buffer_t
     }
     halide_assert(user_context, halide_get_device_interface(buf->dev) == &cuda_device_interface);
     uint64_t dev_ptr = halide_get_device_handle(buf->dev);
+    pool_detach(&pool, dev_ptr);
     halide_delete_device_wrapper(buf->dev);
     buf->dev = 0;
     return (uintptr_t)dev_ptr;
@@ -860,6 +909,19 @@ WEAK const char *get_error_name(CUresult error) {
     }
 }
 
+WEAK int device_pool_trim(void *user_context, size_t max_bytes) {
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return ctx.error;
+    }
+    return trim_pool(user_context, ctx.context, max_bytes);
+}
+
+WEAK int device_pool_get_stats(void *user_context, halide_device_pool_stats *stats) {
+    pool_get_stats(&pool, stats);
+    return 0;
+}
+
 WEAK halide_device_interface cuda_device_interface = {
     halide_use_jit_module,
     halide_release_jit_module,
@@ -869,6 +931,10 @@ WEAK halide_device_interface cuda_device_interface = {
     halide_cuda_device_release,
     halide_cuda_copy_to_host,
     halide_cuda_copy_to_device,
+    NULL,
+    NULL,
+    device_pool_trim,
+    device_pool_get_stats,
 };
 
 }}}} // namespace Halide::Runtime::Internal::Cuda
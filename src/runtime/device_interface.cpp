@@ -25,6 +25,10 @@ struct device_handle_wrapper {
 // a copy internaly as well.
 WEAK halide_mutex device_copy_mutex;
 
+// The most memory each device pool keeps for reuse (see
+// device_pool.h).
+WEAK size_t device_pool_limit = (size_t)-1;
+
 WEAK int copy_to_host_already_locked(void *user_context, struct buffer_t *buf) {
     int result = 0;
 
@@ -38,7 +42,14 @@ WEAK int copy_to_host_already_locked(void *user_context, struct buffer_t *buf) {
             debug(user_context) << "copy_to_host_already_locked " << buf << " interface is NULL\n";
             result = halide_error_code_no_device_interface;
         } else {
-            result = interface->copy_to_host(user_context, buf);
+            // Don't overwrite host memory that an asynchronous copy to
+            // the device may still be reading.
+            if (interface->wait_for_copies != NULL) {
+                result = interface->wait_for_copies(user_context, buf);
+            }
+            if (result == 0) {
+                result = interface->copy_to_host(user_context, buf);
+            }
             if (result == 0) {
                 buf->dev_dirty = false;
             } else {
@@ -51,6 +62,72 @@ WEAK int copy_to_host_already_locked(void *user_context, struct buffer_t *buf) {
     return result;
 }
 
+WEAK int copy_to_device_already_locked(void *user_context, struct buffer_t *buf,
+                                       const halide_device_interface *interface, bool async) {
+    int result = 0;
+
+    debug(user_context) << "halide_copy_to_device " << buf << ", host: " << buf->host << ", dev: " << buf->dev << ", host_dirty: " << buf->host_dirty << ", dev_dirty:" << buf->dev_dirty << "\n";
+    const halide_device_interface *buf_dev_interface = halide_get_device_interface(buf->dev);
+    if (interface == NULL) {
+        debug(user_context) << "halide_copy_to_device " << buf << " interface is NULL\n";
+        if (buf_dev_interface == NULL) {
+            debug(user_context) << "halide_copy_to_device " << buf << " no interface error\n";
+            return halide_error_code_no_device_interface;
+        }
+        interface = buf_dev_interface;
+    }
+
+    if (buf->dev && buf_dev_interface != interface) {
+        debug(user_context) << "halide_copy_to_device " << buf << " flipping buffer to new device\n";
+        if (buf_dev_interface != NULL && buf->dev_dirty) {
+            halide_assert(user_context, !buf->host_dirty);
+            result = copy_to_host_already_locked(user_context, buf);
+            if (result != 0) {
+                debug(user_context) << "halide_copy_to_device " << buf << " flipping buffer halide_copy_to_host failed\n";
+                return result;
+            }
+        }
+        result = halide_device_free(user_context, buf);
+        if (result != 0) {
+            debug(user_context) << "halide_copy_to_device " << buf << " flipping buffer halide_device_free failed\n";
+            return result;
+        }
+        buf->host_dirty = true; // force copy back to new device below.
+    }
+
+    if (buf->dev == 0) {
+        result = halide_device_malloc(user_context, buf, interface);
+        if (result != 0) {
+            debug(user_context) << "halide_copy_to_device " << buf
+                                << " halide_copy_to_device call to halide_device_malloc failed\n";
+            return result;
+        }
+    }
+
+    if (buf->host_dirty) {
+        debug(user_context) << "halide_copy_to_device " << buf << " host is dirty\n";
+        if (buf->dev_dirty) {
+            debug(user_context) << "halide_copy_to_device " << buf << " dev_dirty is true error\n";
+            result = halide_error_code_copy_to_device_failed;
+        } else {
+            if (async && interface->copy_to_device_async != NULL) {
+                result = interface->copy_to_device_async(user_context, buf);
+            } else {
+                result = interface->copy_to_device(user_context, buf);
+            }
+            if (result == 0) {
+                buf->host_dirty = 0;
+            } else {
+                debug(user_context) << "halide_copy_to_device "
+                                    << buf << "device copy_to_device returned an error\n";
+                return halide_error_code_copy_to_device_failed;
+            }
+        }
+    }
+
+    return 0;
+}
+
 }}} // namespace Halide::Runtime::Internal
 
 extern "C" {
@@ -116,66 +193,36 @@ WEAK int halide_copy_to_host(void *user_context, struct buffer_t *buf) {
 /** Copy image data from host memory to device memory. This should not be
  * called directly; Halide handles copying to the device automatically. */
 WEAK int halide_copy_to_device(void *user_context, struct buffer_t *buf, const halide_device_interface *interface) {
-    int result = 0;
+    ScopedMutexLock lock(&device_copy_mutex);
+
+    return copy_to_device_already_locked(user_context, buf, interface, false);
+}
 
+/** Start a copy of image data from host memory to device memory, without
+ * waiting for it to finish if the device supports that. */
+WEAK int halide_copy_to_device_async(void *user_context, struct buffer_t *buf, const halide_device_interface *interface) {
     ScopedMutexLock lock(&device_copy_mutex);
 
-    debug(user_context) << "halide_copy_to_device " << buf << ", host: " << buf->host << ", dev: " << buf->dev << ", host_dirty: " << buf->host_dirty << ", dev_dirty:" << buf->dev_dirty << "\n";
-    const halide_device_interface *buf_dev_interface = halide_get_device_interface(buf->dev);
-    if (interface == NULL) {
-        debug(user_context) << "halide_copy_to_device " << buf << " interface is NULL\n";
-        if (buf_dev_interface == NULL) {
-            debug(user_context) << "halide_copy_to_device " << buf << " no interface error\n";
-            return halide_error_code_no_device_interface;
-        }
-        interface = buf_dev_interface;
-    }
+    return copy_to_device_already_locked(user_context, buf, interface, true);
+}
 
-    if (buf->dev && buf_dev_interface != interface) {
-        debug(user_context) << "halide_copy_to_device " << buf << " flipping buffer to new device\n";
-        if (buf_dev_interface != NULL && buf->dev_dirty) {
-            halide_assert(user_context, !buf->host_dirty);
-            result = copy_to_host_already_locked(user_context, buf);
-            if (result != 0) {
-                debug(user_context) << "halide_copy_to_device " << buf << " flipping buffer halide_copy_to_host failed\n";
-                return result;
-            }
-        }
-        result = halide_device_free(user_context, buf);
-        if (result != 0) {
-            debug(user_context) << "halide_copy_to_device " << buf << " flipping buffer halide_device_free failed\n";
-            return result;
-        }
-        buf->host_dirty = true; // force copy back to new device below.
+/** Wait for any asynchronous copies of a buffer to the device to finish
+ * reading the host memory. */
+WEAK int halide_device_wait_for_copies(void *user_context, struct buffer_t *buf) {
+    const halide_device_interface *interface = NULL;
+    if (buf) {
+        interface = halide_get_device_interface(buf->dev);
     }
-
-    if (buf->dev == 0) {
-        result = halide_device_malloc(user_context, buf, interface);
-        if (result != 0) {
-            debug(user_context) << "halide_copy_to_device " << buf
-                                << " halide_copy_to_device call to halide_device_malloc failed\n";
-            return result;
-        }
+    if (interface == NULL || interface->wait_for_copies == NULL) {
+        // Nothing can have been copied asynchronously.
+        return 0;
     }
-
-    if (buf->host_dirty) {
-        debug(user_context) << "halide_copy_to_device " << buf << " host is dirty\n";
-        if (buf->dev_dirty) {
-            debug(user_context) << "halide_copy_to_device " << buf << " dev_dirty is true error\n";
-            result = halide_error_code_copy_to_device_failed;
-        } else {
-            result = interface->copy_to_device(user_context, buf);
-            if (result == 0) {
-                buf->host_dirty = 0;
-            } else {
-                debug(user_context) << "halide_copy_to_device "
-                                    << buf << "device copy_to_device returned an error\n";
-                return halide_error_code_copy_to_device_failed;
-            }
-        }
+    int result = interface->wait_for_copies(user_context, buf);
+    if (result) {
+        return halide_error_code_copy_to_device_failed;
+    } else {
+        return 0;
     }
-
-    return 0;
 }
 
 /** Wait for current GPU operations to complete. Calling this explicitly
@@ -263,4 +310,41 @@ WEAK void halide_device_free_as_destructor(void *user_context, void *obj) {
     halide_device_free(user_context, buf);
 }
 
+/** Free pooled device allocations until at most max_bytes of them are
+ * left. */
+WEAK int halide_device_pool_trim(void *user_context, const halide_device_interface *interface,
+                                 size_t max_bytes) {
+    if (interface == NULL || interface->pool_trim == NULL) {
+        return 0;
+    }
+    interface->use_module();
+    int result = interface->pool_trim(user_context, max_bytes);
+    interface->release_module();
+    if (result) {
+        return halide_error_code_device_free_failed;
+    } else {
+        return 0;
+    }
+}
+
+/** Set the most memory each device pool keeps for reuse. */
+WEAK void halide_device_pool_set_limit(size_t max_bytes) {
+    device_pool_limit = max_bytes;
+}
+
+/** Get the limit set by halide_device_pool_set_limit. */
+WEAK size_t halide_device_pool_get_limit() {
+    return device_pool_limit;
+}
+
+/** Get the statistics of the device memory pool of a device. */
+WEAK int halide_device_pool_get_stats(void *user_context, const halide_device_interface *interface,
+                                      struct halide_device_pool_stats *stats) {
+    if (interface == NULL || interface->pool_get_stats == NULL) {
+        memset(stats, 0, sizeof(*stats));
+        return 0;
+    }
+    return interface->pool_get_stats(user_context, stats);
+}
+
 } // extern "C" linkage
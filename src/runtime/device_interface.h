@@ -17,6 +17,19 @@ struct halide_device_interface {
     int (*device_release)(void *user_context);
     int (*copy_to_host)(void *user_context, struct buffer_t *buf);
     int (*copy_to_device)(void *user_context, struct buffer_t *buf);
+    // These next two methods are optional, and may be NULL. The first
+    // starts a copy to the device which may still be reading the host
+    // memory when it returns. Device code run after it must see the
+    // copied data. The second waits until any such copies of the
+    // buffer have finished reading the host memory. A device
+    // interface without them gets a blocking copy_to_device instead.
+    int (*copy_to_device_async)(void *user_context, struct buffer_t *buf);
+    int (*wait_for_copies)(void *user_context, struct buffer_t *buf);
+    // These are also optional. Devices that pool their allocations
+    // (see device_pool.h) use them to implement
+    // halide_device_pool_trim and halide_device_pool_get_stats.
+    int (*pool_trim)(void *user_context, size_t max_bytes);
+    int (*pool_get_stats)(void *user_context, struct halide_device_pool_stats *stats);
 };
 
 extern WEAK uint64_t halide_new_device_wrapper(uint64_t handle, const struct halide_device_interface *interface);
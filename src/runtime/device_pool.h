@@ -0,0 +1,178 @@
+#ifndef HALIDE_DEVICE_POOL_H
+#define HALIDE_DEVICE_POOL_H
+
+#include "HalideRuntime.h"
+#include "scoped_spin_lock.h"
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// Allocating and freeing device memory usually costs far more than
+// running a kernel on a small tile, and device_malloc and device_free
+// are called for every realization of a device-resident
+// Func. Instead of freeing the allocations they make, the device
+// runtimes return them to a pool, and reuse them for later allocations
+// in the same size bucket and device context. Pooled allocations are
+// freed by device_release, or by halide_device_pool_trim. After
+// returning an allocation to the pool, the device runtimes trim the
+// pool of its context to halide_device_pool_get_limit() bytes, and if
+// an allocation fails they empty it and try once more.
+
+struct pooled_allocation {
+    uint64_t handle;
+    void *context;
+    size_t size;
+    pooled_allocation *next;
+};
+
+struct device_pool {
+    // The allocations made through the pool that are in use, and the
+    // ones that are available to be reused, most recently freed
+    // first.
+    pooled_allocation *in_use, *available;
+    uint64_t hits, misses;
+    volatile int lock;
+};
+
+// Round a size up to the size of its bucket. There are four buckets
+// per power of two, so at most a fifth of a pooled allocation is
+// wasted.
+WEAK size_t pool_bucket_size(size_t size) {
+    const size_t min_size = 256;
+    if (size <= min_size) {
+        return min_size;
+    }
+    size_t p = min_size;
+    while (p <= size / 2) {
+        p *= 2;
+    }
+    size_t step = p / 4;
+    return ((size + step - 1) / step) * step;
+}
+
+// Take a free allocation of the given bucket size made in the given
+// context. Returns zero if there isn't one, in which case the caller
+// should make a new allocation and pass it to pool_add.
+WEAK uint64_t pool_take(device_pool *pool, void *context, size_t size) {
+    ScopedSpinLock lock(&pool->lock);
+    for (pooled_allocation **p = &pool->available; *p; p = &(*p)->next) {
+        pooled_allocation *a = *p;
+        if (a->context == context && a->size == size) {
+            *p = a->next;
+            a->next = pool->in_use;
+            pool->in_use = a;
+            pool->hits++;
+            return a->handle;
+        }
+    }
+    pool->misses++;
+    return 0;
+}
+
+// Record a new allocation, so that it is returned to the pool when it
+// is freed. If this fails, the allocation is just freed as usual.
+WEAK void pool_add(device_pool *pool, void *context, uint64_t handle, size_t size) {
+    pooled_allocation *a = (pooled_allocation *)malloc(sizeof(pooled_allocation));
+    if (!a) {
+        return;
+    }
+    a->handle = handle;
+    a->context = context;
+    a->size = size;
+
+    ScopedSpinLock lock(&pool->lock);
+    a->next = pool->in_use;
+    pool->in_use = a;
+}
+
+// Return an allocation to the pool. Returns false if it wasn't made
+// through the pool (e.g. because it was wrapped around memory from
+// elsewhere), in which case the caller should really free it.
+WEAK bool pool_put(device_pool *pool, uint64_t handle) {
+    ScopedSpinLock lock(&pool->lock);
+    for (pooled_allocation **p = &pool->in_use; *p; p = &(*p)->next) {
+        pooled_allocation *a = *p;
+        if (a->handle == handle) {
+            *p = a->next;
+            a->next = pool->available;
+            pool->available = a;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Remove the least recently freed allocations of a context from the
+// pool, until at most max_bytes of them are left. Returns the removed
+// allocations, which the caller should free, and then release with
+// pool_delete.
+WEAK pooled_allocation *pool_trim(device_pool *pool, void *context, size_t max_bytes) {
+    ScopedSpinLock lock(&pool->lock);
+    pooled_allocation *trimmed = NULL;
+    size_t kept = 0;
+    pooled_allocation **p = &pool->available;
+    while (*p) {
+        pooled_allocation *a = *p;
+        if (a->context != context) {
+            p = &a->next;
+        } else if (kept + a->size > max_bytes) {
+            *p = a->next;
+            a->next = trimmed;
+            trimmed = a;
+        } else {
+            kept += a->size;
+            p = &a->next;
+        }
+    }
+    return trimmed;
+}
+
+// Forget the allocations of a context that are in use, because the
+// context is being destroyed. Freeing them later won't return them
+// to the pool.
+WEAK void pool_forget_in_use(device_pool *pool, void *context) {
+    ScopedSpinLock lock(&pool->lock);
+    pooled_allocation **p = &pool->in_use;
+    while (*p) {
+        pooled_allocation *a = *p;
+        if (a->context == context) {
+            *p = a->next;
+            free(a);
+        } else {
+            p = &a->next;
+        }
+    }
+}
+
+// Forget an allocation that is in use, because it is being detached
+// from Halide, and is no longer ours to reuse.
+WEAK void pool_detach(device_pool *pool, uint64_t handle) {
+    ScopedSpinLock lock(&pool->lock);
+    for (pooled_allocation **p = &pool->in_use; *p; p = &(*p)->next) {
+        pooled_allocation *a = *p;
+        if (a->handle == handle) {
+            *p = a->next;
+            free(a);
+            return;
+        }
+    }
+}
+
+WEAK void pool_delete(pooled_allocation *a) {
+    free(a);
+}
+
+WEAK void pool_get_stats(device_pool *pool, halide_device_pool_stats *stats) {
+    ScopedSpinLock lock(&pool->lock);
+    stats->hits = pool->hits;
+    stats->misses = pool->misses;
+    stats->pooled_allocations = 0;
+    stats->pooled_bytes = 0;
+    for (pooled_allocation *a = pool->available; a; a = a->next) {
+        stats->pooled_allocations++;
+        stats->pooled_bytes += a->size;
+    }
+}
+
+}}} // namespace Halide::Runtime::Internal
+
+#endif // HALIDE_DEVICE_POOL_H
@@ -0,0 +1,317 @@
+#include "runtime_internal.h"
+#include "device_interface.h"
+#include "HalideRuntimeHostDevice.h"
+#include "cuda_opencl_shared.h"
+#include "device_pool.h"
+#include "scoped_spin_lock.h"
+
+namespace Halide { namespace Runtime { namespace Internal { namespace HostDevice {
+
+extern WEAK halide_device_interface host_device_interface;
+
+// A device allocation. The dev field of a buffer_t points to one of
+// these.
+struct allocation {
+    void *data;
+    size_t size;
+    // The simulated time at which the last copy to the allocation
+    // finishes.
+    int64_t copy_done_ns;
+};
+
+// The simulated cost of a copy.
+WEAK int64_t latency_ns = 0;
+WEAK int64_t bytes_per_second = 0;
+
+// Copies are done one at a time by a simulated copy engine. This is
+// the time at which it finishes the copies it has been given so far.
+WEAK int64_t copy_engine_busy_until = 0;
+WEAK volatile int copy_engine_lock = 0;
+
+WEAK halide_host_device_stats stats;
+
+WEAK void add_stat(uint64_t *stat, uint64_t value) {
+    __sync_fetch_and_add(stat, value);
+}
+
+WEAK int64_t now(void *user_context) {
+    halide_start_clock(user_context);
+    return halide_current_time_ns(user_context);
+}
+
+// Wait until the given simulated time has been reached.
+WEAK void wait_until(void *user_context, int64_t t) {
+    int64_t start = now(user_context);
+    if (start >= t) {
+        return;
+    }
+    while (now(user_context) < t) { }
+    add_stat(&stats.waits, 1);
+    add_stat(&stats.wait_ns, t - start);
+}
+
+// Give a copy of the given size to the copy engine, and return the
+// simulated time at which it will be done.
+WEAK int64_t schedule_copy(void *user_context, uint64_t bytes) {
+    int64_t cost = latency_ns;
+    if (bytes_per_second > 0) {
+        cost += (int64_t)((bytes * 1000000000) / bytes_per_second);
+    }
+    int64_t start = now(user_context);
+    ScopedSpinLock lock(&copy_engine_lock);
+    if (copy_engine_busy_until > start) {
+        start = copy_engine_busy_until;
+    }
+    copy_engine_busy_until = start + cost;
+    return copy_engine_busy_until;
+}
+
+// Do the copy described by a device_copy, and return the number of
+// bytes copied.
+WEAK uint64_t do_copy(const device_copy &c) {
+    uint64_t bytes = 0;
+    for (uint64_t w = 0; w < c.extent[3]; w++) {
+        for (uint64_t z = 0; z < c.extent[2]; z++) {
+            for (uint64_t y = 0; y < c.extent[1]; y++) {
+                for (uint64_t x = 0; x < c.extent[0]; x++) {
+                    uint64_t off = (x * c.stride_bytes[0] +
+                                    y * c.stride_bytes[1] +
+                                    z * c.stride_bytes[2] +
+                                    w * c.stride_bytes[3]);
+                    memcpy((void *)(c.dst + off), (void *)(c.src + off), c.chunk_size);
+                    bytes += c.chunk_size;
+                }
+            }
+        }
+    }
+    return bytes;
+}
+
+WEAK allocation *get_allocation(void *user_context, buffer_t *buf) {
+    halide_assert(user_context, buf->dev &&
+                  halide_get_device_interface(buf->dev) == &host_device_interface);
+    return (allocation *)halide_get_device_handle(buf->dev);
+}
+
+WEAK allocation *new_allocation(void *user_context, size_t size) {
+    allocation *alloc = (allocation *)halide_malloc(user_context, sizeof(allocation));
+    if (!alloc) {
+        return NULL;
+    }
+    alloc->data = halide_malloc(user_context, size);
+    if (!alloc->data) {
+        halide_free(user_context, alloc);
+        return NULL;
+    }
+    alloc->size = size;
+    alloc->copy_done_ns = 0;
+    add_stat(&stats.device_mallocs, 1);
+    return alloc;
+}
+
+WEAK void delete_allocation(void *user_context, allocation *alloc) {
+    // The device can't free memory that a copy is still writing to.
+    wait_until(user_context, alloc->copy_done_ns);
+    halide_free(user_context, alloc->data);
+    halide_free(user_context, alloc);
+    add_stat(&stats.device_frees, 1);
+}
+
+// Device allocations are pooled like those of a real device. There's
+// only one context.
+WEAK device_pool pool;
+
+WEAK int trim_pool(void *user_context, size_t max_bytes) {
+    pooled_allocation *a = pool_trim(&pool, NULL, max_bytes);
+    while (a) {
+        pooled_allocation *next = a->next;
+        delete_allocation(user_context, (allocation *)a->handle);
+        pool_delete(a);
+        a = next;
+    }
+    return 0;
+}
+
+// The copy to the device is done right away, so the host memory is
+// free to be reused as soon as this returns. An async copy just
+// doesn't wait for the simulated copy to finish.
+WEAK int copy_to_device(void *user_context, buffer_t *buf, bool async) {
+    allocation *alloc = get_allocation(user_context, buf);
+    debug(user_context) << "HostDevice: copy_to_device (user_context: " << user_context
+                        << ", buf: " << buf << ", async: " << (int)async << ")\n";
+
+    device_copy c = make_host_to_device_copy(buf);
+    c.dst = (uint64_t)alloc->data;
+    uint64_t bytes = do_copy(c);
+
+    alloc->copy_done_ns = schedule_copy(user_context, bytes);
+    add_stat(&stats.copies_to_device, 1);
+    add_stat(&stats.bytes_to_device, bytes);
+
+    if (!async) {
+        wait_until(user_context, alloc->copy_done_ns);
+    }
+    return 0;
+}
+
+}}}} // namespace Halide::Runtime::Internal::HostDevice
+
+using namespace Halide::Runtime::Internal;
+using namespace Halide::Runtime::Internal::HostDevice;
+
+extern "C" {
+
+WEAK void halide_host_device_set_transfer_cost(int64_t l, int64_t b) {
+    latency_ns = l;
+    bytes_per_second = b;
+}
+
+WEAK void halide_host_device_get_stats(halide_host_device_stats *s) {
+    *s = stats;
+}
+
+WEAK void halide_host_device_reset_stats() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+WEAK int halide_host_device_device_malloc(void *user_context, buffer_t *buf) {
+    debug(user_context) << "HostDevice: halide_host_device_device_malloc (user_context: "
+                        << user_context << ", buf: " << buf << ")\n";
+
+    if (buf->dev) {
+        // This buffer already has a device allocation
+        return 0;
+    }
+
+    halide_assert(user_context, buf->stride[0] >= 0 && buf->stride[1] >= 0 &&
+                                buf->stride[2] >= 0 && buf->stride[3] >= 0);
+
+    size_t size = pool_bucket_size(buf_size(user_context, buf));
+    allocation *alloc = (allocation *)pool_take(&pool, NULL, size);
+    if (!alloc) {
+        alloc = new_allocation(user_context, size);
+        if (!alloc) {
+            // Free the pooled allocations and try again.
+            trim_pool(user_context, 0);
+            alloc = new_allocation(user_context, size);
+        }
+        if (!alloc) {
+            return halide_error_code_out_of_memory;
+        }
+        pool_add(&pool, NULL, (uint64_t)alloc, size);
+    }
+
+    buf->dev = halide_new_device_wrapper((uint64_t)alloc, &host_device_interface);
+    if (!buf->dev) {
+        pool_put(&pool, (uint64_t)alloc);
+        return halide_error_code_out_of_memory;
+    }
+
+    debug(user_context) << "    using " << (uint64_t)size << " bytes at " << alloc->data << "\n";
+    return 0;
+}
+
+WEAK int halide_host_device_device_free(void *user_context, buffer_t *buf) {
+    if (buf->dev == 0) {
+        return 0;
+    }
+
+    allocation *alloc = get_allocation(user_context, buf);
+    debug(user_context) << "HostDevice: halide_host_device_device_free (user_context: "
+                        << user_context << ", buf: " << buf << ", data: " << alloc->data << ")\n";
+
+    if (pool_put(&pool, (uint64_t)alloc)) {
+        trim_pool(user_context, halide_device_pool_get_limit());
+    } else {
+        delete_allocation(user_context, alloc);
+    }
+    halide_delete_device_wrapper(buf->dev);
+    buf->dev = 0;
+    return 0;
+}
+
+WEAK int halide_host_device_device_sync(void *user_context, buffer_t *buf) {
+    // Kernels run synchronously on the host, so there's nothing to
+    // wait for.
+    return 0;
+}
+
+WEAK int halide_host_device_device_release(void *user_context) {
+    trim_pool(user_context, 0);
+    pool_forget_in_use(&pool, NULL);
+
+    ScopedSpinLock lock(&copy_engine_lock);
+    copy_engine_busy_until = 0;
+    return 0;
+}
+
+WEAK int halide_host_device_copy_to_device(void *user_context, buffer_t *buf) {
+    return HostDevice::copy_to_device(user_context, buf, false);
+}
+
+WEAK int halide_host_device_copy_to_device_async(void *user_context, buffer_t *buf) {
+    return HostDevice::copy_to_device(user_context, buf, true);
+}
+
+WEAK int halide_host_device_wait_for_copies(void *user_context, buffer_t *buf) {
+    add_stat(&stats.copy_waits, 1);
+    wait_until(user_context, get_allocation(user_context, buf)->copy_done_ns);
+    return 0;
+}
+
+WEAK int halide_host_device_copy_to_host(void *user_context, buffer_t *buf) {
+    allocation *alloc = get_allocation(user_context, buf);
+    debug(user_context) << "HostDevice: halide_host_device_copy_to_host (user_context: "
+                        << user_context << ", buf: " << buf << ")\n";
+
+    // Copies are done in order, so this one starts after any copy to
+    // the device has finished.
+    device_copy c = make_device_to_host_copy(buf);
+    c.src = (uint64_t)alloc->data;
+    uint64_t bytes = do_copy(c);
+    wait_until(user_context, schedule_copy(user_context, bytes));
+
+    add_stat(&stats.copies_to_host, 1);
+    add_stat(&stats.bytes_to_host, bytes);
+    return 0;
+}
+
+WEAK void *halide_host_device_get_pointer(void *user_context, buffer_t *buf) {
+    allocation *alloc = get_allocation(user_context, buf);
+    wait_until(user_context, alloc->copy_done_ns);
+    return alloc->data;
+}
+
+WEAK const struct halide_device_interface *halide_host_device_interface() {
+    return &host_device_interface;
+}
+
+} // extern "C"
+
+namespace Halide { namespace Runtime { namespace Internal { namespace HostDevice {
+
+WEAK int device_pool_trim(void *user_context, size_t max_bytes) {
+    return trim_pool(user_context, max_bytes);
+}
+
+WEAK int device_pool_get_stats(void *user_context, halide_device_pool_stats *stats) {
+    pool_get_stats(&pool, stats);
+    return 0;
+}
+
+WEAK halide_device_interface host_device_interface = {
+    halide_use_jit_module,
+    halide_release_jit_module,
+    halide_host_device_device_malloc,
+    halide_host_device_device_free,
+    halide_host_device_device_sync,
+    halide_host_device_device_release,
+    halide_host_device_copy_to_host,
+    halide_host_device_copy_to_device,
+    halide_host_device_copy_to_device_async,
+    halide_host_device_wait_for_copies,
+    device_pool_trim,
+    device_pool_get_stats,
+};
+
+}}}} // namespace Halide::Runtime::Internal::HostDevice
@@ -6,6 +6,7 @@
 #include "mini_cl.h"
 
 #include "cuda_opencl_shared.h"
+#include "device_pool.h"
 
 #define INLINE inline __attribute__((always_inline))
 
@@ -434,6 +435,90 @@ WEAK int create_opencl_context(void *user_context, cl_context *ctx, cl_command_q
     return err;
 }
 
+// Asynchronous copies to the device that may still be reading host
+// memory, each represented by the event of its last write. These are
+// only touched while holding the context.
+struct pending_copy {
+    cl_mem mem;
+    cl_event event;
+};
+const int max_pending_copies = 16;
+WEAK pending_copy pending_copies[max_pending_copies];
+WEAK int next_pending_copy = 0;
+
+WEAK int wait_for_pending_copy(void *user_context, pending_copy *p) {
+    debug(user_context) << "    clWaitForEvents " << (void *)p->event << "\n";
+    cl_int err = clWaitForEvents(1, &p->event);
+    clReleaseEvent(p->event);
+    p->mem = NULL;
+    p->event = NULL;
+    if (err != CL_SUCCESS) {
+        error(user_context) << "CL: clWaitForEvents failed: "
+                            << get_opencl_error_name(err);
+    }
+    return err;
+}
+
+// Wait for any asynchronous copy to the given device memory.
+WEAK int wait_for_copies_to(void *user_context, cl_mem mem) {
+    for (int i = 0; i < max_pending_copies; i++) {
+        if (pending_copies[i].mem == mem) {
+            return wait_for_pending_copy(user_context, &pending_copies[i]);
+        }
+    }
+    return CL_SUCCESS;
+}
+
+// Record an asynchronous copy to the given device memory. If there
+// are too many already, wait for one of them to finish.
+WEAK int add_pending_copy(void *user_context, cl_mem mem, cl_event event) {
+    // The command queue is in order, so this copy finishes after any
+    // earlier one to the same memory.
+    for (int i = 0; i < max_pending_copies; i++) {
+        if (pending_copies[i].mem == mem) {
+            clReleaseEvent(pending_copies[i].event);
+            pending_copies[i].event = event;
+            return CL_SUCCESS;
+        }
+    }
+    for (int i = 0; i < max_pending_copies; i++) {
+        if (pending_copies[i].mem == NULL) {
+            pending_copies[i].mem = mem;
+            pending_copies[i].event = event;
+            return CL_SUCCESS;
+        }
+    }
+    pending_copy *p = &pending_copies[next_pending_copy];
+    next_pending_copy = (next_pending_copy + 1) % max_pending_copies;
+    cl_int err = wait_for_pending_copy(user_context, p);
+    p->mem = mem;
+    p->event = event;
+    return err;
+}
+
+// Device allocations are pooled, per context.
+WEAK device_pool pool;
+
+// Release the pooled allocations of a context, until at most
+// max_bytes of them are left.
+WEAK int trim_pool(void *user_context, cl_context ctx, size_t max_bytes) {
+    cl_int result = CL_SUCCESS;
+    pooled_allocation *a = pool_trim(&pool, ctx, max_bytes);
+    while (a) {
+        pooled_allocation *next = a->next;
+        debug(user_context) << "    clReleaseMemObject " << (void *)a->handle << " (pooled)\n";
+        cl_int err = clReleaseMemObject((cl_mem)a->handle);
+        if (err != CL_SUCCESS && result == CL_SUCCESS) {
+            error(user_context) << "CL: clReleaseMemObject failed: "
+                                << get_opencl_error_name(err);
+            result = err;
+        }
+        pool_delete(a);
+        a = next;
+    }
+    return result;
+}
+
 }}}} // namespace Halide::Runtime::Internal::OpenCL
 
 extern "C" {
@@ -462,6 +547,15 @@ WEAK int halide_opencl_device_free(void *user_context, buffer_t* buf) {
     #endif
 
     halide_assert(user_context, validate_device_pointer(user_context, buf));
+    wait_for_copies_to(user_context, dev_ptr);
+
+    if (pool_put(&pool, (uint64_t)dev_ptr)) {
+        debug(user_context) << "    returned " << (void *)dev_ptr << " to the pool\n";
+        halide_delete_device_wrapper(buf->dev);
+        buf->dev = 0;
+        return trim_pool(user_context, ctx.context, halide_device_pool_get_limit());
+    }
+
     debug(user_context) << "    clReleaseMemObject " << (void *)dev_ptr << "\n";
     cl_int result = clReleaseMemObject((cl_mem)dev_ptr);
     // If clReleaseMemObject fails, it is unlikely to succeed in a later call, so
@@ -639,6 +733,19 @@ WEAK int halide_opencl_device_release(void *user_context) {
         err = clFinish(q);
         halide_assert(user_context, err == CL_SUCCESS);
 
+        for (int i = 0; i < max_pending_copies; i++) {
+            if (pending_copies[i].mem) {
+                clReleaseEvent(pending_copies[i].event);
+                pending_copies[i].mem = NULL;
+                pending_copies[i].event = NULL;
+            }
+        }
+
+        // Release the pooled allocations, and forget about the ones in
+        // use, as they can't be reused in a new context.
+        trim_pool(user_context, ctx, 0);
+        pool_forget_in_use(&pool, ctx);
+
         // Unload the modules attached to this context. Note that the list
         // nodes themselves are not freed, only the program objects are
         // released. Subsequent calls to halide_init_kernels might re-create
@@ -703,16 +810,29 @@ WEAK int halide_opencl_device_malloc(void *user_context, buffer_t* buf) {
     uint64_t t_before = halide_current_time_ns(user_context);
     #endif
 
-    cl_int err;
-    debug(user_context) << "    clCreateBuffer -> " << (int)size << " ";
-    cl_mem dev_ptr = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE, size, NULL, &err);
-    if (err != CL_SUCCESS || dev_ptr == 0) {
-        debug(user_context) << get_opencl_error_name(err) << "\n";
-        error(user_context) << "CL: clCreateBuffer failed: "
-                            << get_opencl_error_name(err);
-        return err;
+    size = pool_bucket_size(size);
+    cl_mem dev_ptr = (cl_mem)pool_take(&pool, ctx.context, size);
+    if (dev_ptr) {
+        debug(user_context) << "    reusing pooled allocation " << (void *)dev_ptr << "\n";
     } else {
-        debug(user_context) << (void *)dev_ptr << "\n";
+        cl_int err;
+        debug(user_context) << "    clCreateBuffer -> " << (int)size << " ";
+        dev_ptr = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE, size, NULL, &err);
+        if (err != CL_SUCCESS || dev_ptr == 0) {
+            // Free the pooled allocations and try again.
+            debug(user_context) << get_opencl_error_name(err) << ", emptying the pool and retrying -> ";
+            trim_pool(user_context, ctx.context, 0);
+            dev_ptr = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE, size, NULL, &err);
+        }
+        if (err != CL_SUCCESS || dev_ptr == 0) {
+            debug(user_context) << get_opencl_error_name(err) << "\n";
+            error(user_context) << "CL: clCreateBuffer failed: "
+                                << get_opencl_error_name(err);
+            return err;
+        } else {
+            debug(user_context) << (void *)dev_ptr << "\n";
+        }
+        pool_add(&pool, ctx.context, (uint64_t)dev_ptr, size);
     }
     buf->dev = halide_new_device_wrapper((uint64_t)dev_ptr, &opencl_device_interface);
     if (buf->dev == 0) {
@@ -733,7 +853,23 @@ WEAK int halide_opencl_device_malloc(void *user_context, buffer_t* buf) {
     return CL_SUCCESS;
 }
 
-WEAK int halide_opencl_copy_to_device(void *user_context, buffer_t* buf) {
+} // extern "C"
+
+namespace Halide { namespace Runtime { namespace Internal { namespace OpenCL {
+
+// Copy a buffer to the device. If async is true, don't wait for the
+// writes to finish, and record them as a pending copy instead.
+// Clean up after a write of a copy to the device fails. Earlier writes
+// may still be reading the host memory, so wait for them before
+// returning the error, and release the event of the last one.
+WEAK void abandon_copy_to_device(cl_command_queue cmd_queue, cl_event event) {
+    clFinish(cmd_queue);
+    if (event) {
+        clReleaseEvent(event);
+    }
+}
+
+WEAK int do_copy_to_device(void *user_context, buffer_t* buf, bool async) {
     int err = halide_opencl_device_malloc(user_context, buf);
     if (err) {
         return err;
@@ -741,7 +877,7 @@ WEAK int halide_opencl_copy_to_device(void *user_context, buffer_t* buf) {
 
     debug(user_context)
         << "CL: halide_opencl_copy_to_device (user_context: " << user_context
-        << ", buf: " << buf << ")\n";
+        << ", buf: " << buf << ", async: " << async << ")\n";
 
     // Acquire the context so we can use the command queue. This also avoids multiple
     // redundant calls to clEnqueueWriteBuffer when multiple threads are trying to copy
@@ -760,6 +896,12 @@ WEAK int halide_opencl_copy_to_device(void *user_context, buffer_t* buf) {
 
     device_copy c = make_host_to_device_copy(buf);
 
+    // The queue is in order, so the event of the last write tells us
+    // when they have all finished.
+    cl_event event = NULL;
+    cl_event write_event = NULL;
+    cl_event *event_ptr = async ? &write_event : NULL;
+
     for (int w = 0; w < c.extent[3]; w++) {
         for (int z = 0; z < c.extent[2]; z++) {
 #ifdef ENABLE_OPENCL_11
@@ -781,13 +923,18 @@ WEAK int halide_opencl_copy_to_device(void *user_context, buffer_t* buf) {
                                                   c.stride_bytes[0], c.stride_bytes[1],
                                                   c.stride_bytes[0], c.stride_bytes[1],
                                                   (void *)c.src,
-                                                  0, NULL, NULL);
+                                                  0, NULL, event_ptr);
 
             if (err != CL_SUCCESS) {
                 error(user_context) << "CL: clEnqueueWriteBufferRect failed: "
                                     << get_opencl_error_name(err);
+                abandon_copy_to_device(ctx.cmd_queue, event);
                 return err;
             }
+            if (event) {
+                clReleaseEvent(event);
+            }
+            event = write_event;
 #else
             for (int y = 0; y < c.extent[1]; y++) {
                 for (int x = 0; x < c.extent[0]; x++) {
@@ -804,21 +951,39 @@ WEAK int halide_opencl_copy_to_device(void *user_context, buffer_t* buf) {
                         << size << " bytes, " << src << " -> " << (void *)dst << ")\n";
 
                     cl_int err = clEnqueueWriteBuffer(ctx.cmd_queue, (cl_mem)c.dst,
-                                                      CL_FALSE, off, size, src, 0, NULL, NULL);
+                                                      CL_FALSE, off, size, src, 0, NULL, event_ptr);
                     if (err != CL_SUCCESS) {
                         error(user_context) << "CL: clEnqueueWriteBuffer failed: "
                                             << get_opencl_error_name(err);
+                        abandon_copy_to_device(ctx.cmd_queue, event);
                         return err;
                     }
+                    if (event) {
+                        clReleaseEvent(event);
+                    }
+                    event = write_event;
                 }
             }
 #endif
         }
     }
-    // The writes above are all non-blocking, so empty the command
-    // queue before we proceed so that other host code won't write
-    // to the buffer while the above writes are still running.
-    clFinish(ctx.cmd_queue);
+    if (async) {
+        // Start the writes, and leave it to wait_for_copies to stop
+        // host code from writing to the buffer while they are still
+        // running. Kernels enqueued later will see the data.
+        clFlush(ctx.cmd_queue);
+        if (event) {
+            cl_int err = add_pending_copy(user_context, (cl_mem)c.dst, event);
+            if (err != CL_SUCCESS) {
+                return err;
+            }
+        }
+    } else {
+        // The writes above are all non-blocking, so empty the command
+        // queue before we proceed so that other host code won't write
+        // to the buffer while the above writes are still running.
+        clFinish(ctx.cmd_queue);
+    }
 
     #ifdef DEBUG_RUNTIME
     uint64_t t_after = halide_current_time_ns(user_context);
@@ -828,6 +993,35 @@ WEAK int halide_opencl_copy_to_device(void *user_context, buffer_t* buf) {
     return 0;
 }
 
+}}}} // namespace Halide::Runtime::Internal::OpenCL
+
+extern "C" {
+
+WEAK int halide_opencl_copy_to_device(void *user_context, buffer_t* buf) {
+    return do_copy_to_device(user_context, buf, false);
+}
+
+WEAK int halide_opencl_copy_to_device_async(void *user_context, buffer_t* buf) {
+    return do_copy_to_device(user_context, buf, true);
+}
+
+WEAK int halide_opencl_wait_for_copies(void *user_context, buffer_t* buf) {
+    if (buf->dev == 0) {
+        return 0;
+    }
+
+    debug(user_context)
+        << "CL: halide_opencl_wait_for_copies (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    ClContext ctx(user_context);
+    if (ctx.error != CL_SUCCESS) {
+        return ctx.error;
+    }
+
+    return wait_for_copies_to(user_context, (cl_mem)halide_get_device_handle(buf->dev));
+}
+
 WEAK int halide_opencl_copy_to_host(void *user_context, buffer_t* buf) {
     debug(user_context)
         << "CL: halide_copy_to_host (user_context: " << user_context
@@ -1065,6 +1259,7 @@ WEAK uintptr_t halide_opencl_detach_cl_mem(void *user_context, struct buffer_t *
     }
     halide_assert(user_context, halide_get_device_interface(buf->dev) == &opencl_device_interface);
     uint64_t mem = halide_get_device_handle(buf->dev);
+    pool_detach(&pool, mem);
     halide_delete_device_wrapper(buf->dev);
     buf->dev = 0;
     return (uintptr_t)mem;
@@ -1146,6 +1341,19 @@ WEAK const char *get_opencl_error_name(cl_int err) {
     }
 }
 
+WEAK int device_pool_trim(void *user_context, size_t max_bytes) {
+    ClContext ctx(user_context);
+    if (ctx.error != CL_SUCCESS) {
+        return ctx.error;
+    }
+    return trim_pool(user_context, ctx.context, max_bytes);
+}
+
+WEAK int device_pool_get_stats(void *user_context, halide_device_pool_stats *stats) {
+    pool_get_stats(&pool, stats);
+    return 0;
+}
+
 WEAK halide_device_interface opencl_device_interface = {
     halide_use_jit_module,
     halide_release_jit_module,
@@ -1155,6 +1363,10 @@ WEAK halide_device_interface opencl_device_interface = {
     halide_opencl_device_release,
     halide_opencl_copy_to_host,
     halide_opencl_copy_to_device,
+    halide_opencl_copy_to_device_async,
+    halide_opencl_wait_for_copies,
+    device_pool_trim,
+    device_pool_get_stats,
 };
 
 }}}} // namespace Halide::Runtime::Internal::OpenCL
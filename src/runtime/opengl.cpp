@@ -2049,6 +2049,10 @@ WEAK halide_device_interface opengl_device_interface = {
     halide_opengl_device_release,
     halide_opengl_copy_to_host,
     halide_opengl_copy_to_device,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
 };
 
 }}}} // namespace Halide::Runtime::Internal::OpenGL
@@ -680,6 +680,10 @@ WEAK halide_device_interface openglcompute_device_interface = {
     halide_openglcompute_device_release,
     halide_openglcompute_copy_to_host,
     halide_openglcompute_copy_to_device,
+    NULL,
+    NULL,
+    NULL,
+    NULL,
 };
 
 }}}} // namespace Halide::Runtime::Internal::OpenGLCompute
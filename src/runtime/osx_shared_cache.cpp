@@ -0,0 +1,2 @@
+#define OSX
+#include "shared_cache.cpp"
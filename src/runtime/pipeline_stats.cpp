@@ -0,0 +1,220 @@
+#include "runtime_internal.h"
+#include "HalideRuntime.h"
+#include "scoped_mutex_lock.h"
+
+// Call counts and latencies for pipelines compiled with
+// Target::PipelineStats. The entrypoint of the pipeline is wrapped in
+// calls to halide_pipeline_stats_begin and halide_pipeline_stats_end.
+// Only the first call of each pipeline takes a lock. After that, the
+// statistics are updated with atomic adds.
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+WEAK halide_mutex pipeline_stats_lock = { { 0 } };
+WEAK halide_pipeline_stats_t *pipeline_stats = NULL;
+
+// The histogram has exact buckets for 0-3 ns. Above that, each power
+// of two is split into four buckets, by the two bits below the
+// leading one.
+WEAK int pipeline_stats_bucket(uint64_t t) {
+    if (t < 4) {
+        return (int)t;
+    }
+    int log2_t = 63 - __builtin_clzll(t);
+    int b = (log2_t - 1) * 4 + (int)((t >> (log2_t - 2)) & 3);
+    return b < HALIDE_PIPELINE_STATS_BUCKETS ? b : HALIDE_PIPELINE_STATS_BUCKETS - 1;
+}
+
+WEAK void pipeline_stats_max(uint64_t *stat, uint64_t value) {
+    uint64_t old = *stat;
+    while (old < value) {
+        uint64_t seen = __sync_val_compare_and_swap(stat, old, value);
+        if (seen == old) break;
+        old = seen;
+    }
+}
+
+WEAK uint64_t pipeline_stats_read(uint64_t *stat, bool reset) {
+    return reset ? __sync_fetch_and_and(stat, 0) : __sync_fetch_and_add(stat, 0);
+}
+
+}}}
+
+extern "C" {
+
+WEAK int64_t halide_pipeline_stats_begin(void *user_context, halide_pipeline_stats_t **stats,
+                                         const char *pipeline_name) {
+    if (!*stats) {
+        ScopedMutexLock lock(&pipeline_stats_lock);
+        // Pipelines with the same name share their statistics, so
+        // that a pipeline that's jit-compiled more than once is only
+        // listed once. The name is copied, as a jit-compiled
+        // pipeline may be freed.
+        halide_pipeline_stats_t *s = pipeline_stats;
+        while (s && strcmp(s->name, pipeline_name) != 0) {
+            s = (halide_pipeline_stats_t *)(s->next);
+        }
+        if (!s) {
+            size_t name_size = strlen(pipeline_name) + 1;
+            s = (halide_pipeline_stats_t *)halide_malloc(user_context, sizeof(halide_pipeline_stats_t) + name_size);
+            if (s) {
+                memset(s, 0, sizeof(halide_pipeline_stats_t));
+                char *name = (char *)(s + 1);
+                memcpy(name, pipeline_name, name_size);
+                s->name = name;
+                s->next = pipeline_stats;
+                __sync_synchronize();
+                pipeline_stats = s;
+            }
+        }
+        // Losing the statistics isn't worth failing the pipeline
+        // over. If the allocation failed, the call just isn't
+        // counted.
+        *stats = s;
+    }
+
+    halide_start_clock(user_context);
+    return halide_current_time_ns(user_context);
+}
+
+WEAK void halide_pipeline_stats_end(void *user_context, halide_pipeline_stats_t *stats,
+                                    int64_t start_time, int result,
+                                    buffer_t **buffers, int num_buffers, int num_outputs) {
+    if (!stats) return;
+
+    uint64_t t = (uint64_t)(halide_current_time_ns(user_context) - start_time);
+
+    // Bounds queries don't run the pipeline, so they aren't counted.
+    for (int i = 0; i < num_buffers; i++) {
+        if (buffers[i]->host == NULL && buffers[i]->dev == 0) {
+            return;
+        }
+    }
+
+    __sync_fetch_and_add(&stats->calls, 1);
+    __sync_fetch_and_add(&stats->total_time_ns, t);
+    __sync_fetch_and_add(&stats->histogram[pipeline_stats_bucket(t)], 1);
+    pipeline_stats_max(&stats->max_time_ns, t);
+
+    if (result != 0) {
+        __sync_fetch_and_add(&stats->errors, 1);
+        return;
+    }
+
+    uint64_t bytes = 0;
+    for (int i = num_buffers - num_outputs; i < num_buffers; i++) {
+        uint64_t size = buffers[i]->elem_size;
+        for (int d = 0; d < 4 && buffers[i]->extent[d]; d++) {
+            size *= buffers[i]->extent[d];
+        }
+        bytes += size;
+    }
+    __sync_fetch_and_add(&stats->output_bytes, bytes);
+}
+
+WEAK int halide_enumerate_pipeline_stats(void *user_context, void *enumerate_context,
+                                         halide_pipeline_stats_enumerate_func_t func,
+                                         bool reset) {
+    // New pipelines are added at the head of the list, so it can be
+    // walked without the lock.
+    __sync_synchronize();
+    for (halide_pipeline_stats_t *s = pipeline_stats; s;
+         s = (halide_pipeline_stats_t *)(s->next)) {
+        halide_pipeline_stats_t snapshot;
+        snapshot.name = s->name;
+        snapshot.calls = pipeline_stats_read(&s->calls, reset);
+        snapshot.errors = pipeline_stats_read(&s->errors, reset);
+        snapshot.total_time_ns = pipeline_stats_read(&s->total_time_ns, reset);
+        snapshot.max_time_ns = pipeline_stats_read(&s->max_time_ns, reset);
+        snapshot.output_bytes = pipeline_stats_read(&s->output_bytes, reset);
+        for (int i = 0; i < HALIDE_PIPELINE_STATS_BUCKETS; i++) {
+            snapshot.histogram[i] = pipeline_stats_read(&s->histogram[i], reset);
+        }
+        snapshot.next = NULL;
+        int r = (*func)(enumerate_context, &snapshot);
+        if (r != 0) return r;
+    }
+    return 0;
+}
+
+WEAK uint64_t halide_pipeline_stats_bucket_time_ns(int bucket) {
+    if (bucket < 4) {
+        return bucket;
+    }
+    return (uint64_t)(4 + (bucket & 3)) << (bucket / 4 - 1);
+}
+
+WEAK uint64_t halide_pipeline_stats_percentile_ns(const halide_pipeline_stats_t *stats,
+                                                  float percentile) {
+    uint64_t calls = 0;
+    for (int i = 0; i < HALIDE_PIPELINE_STATS_BUCKETS; i++) {
+        calls += stats->histogram[i];
+    }
+    if (calls == 0) return 0;
+
+    // The number of calls at or below the percentile, rounded up.
+    uint64_t rank = (uint64_t)(percentile * calls / 100.0f);
+    if (rank * 100.0f < percentile * calls) rank++;
+    if (rank < 1) rank = 1;
+    if (rank > calls) rank = calls;
+
+    uint64_t seen = 0;
+    int b = 0;
+    for (; b < HALIDE_PIPELINE_STATS_BUCKETS - 1; b++) {
+        seen += stats->histogram[b];
+        if (seen >= rank) break;
+    }
+
+    // The longest time the bucket could hold. No call took longer
+    // than the longest call.
+    uint64_t t = (b < HALIDE_PIPELINE_STATS_BUCKETS - 1) ?
+        halide_pipeline_stats_bucket_time_ns(b + 1) - 1 : stats->max_time_ns;
+    return t < stats->max_time_ns ? t : stats->max_time_ns;
+}
+
+}
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+WEAK int pipeline_stats_print(void *user_context, const halide_pipeline_stats_t *s) {
+    if (!s->calls) return 0;
+    char line_buf[256];
+    Printer<StringStreamPrinter, sizeof(line_buf)> sstr(user_context, line_buf);
+    sstr << s->name
+         << "  calls: " << s->calls
+         << "  errors: " << s->errors
+         << "  mean: " << (s->total_time_ns / s->calls) / 1000000.0f << " ms"
+         << "  p50: " << halide_pipeline_stats_percentile_ns(s, 50) / 1000000.0f << " ms"
+         << "  p99: " << halide_pipeline_stats_percentile_ns(s, 99) / 1000000.0f << " ms"
+         << "  max: " << s->max_time_ns / 1000000.0f << " ms"
+         << "  output: " << s->output_bytes << " bytes\n";
+    halide_print(user_context, sstr.str());
+    return 0;
+}
+
+}}}
+
+extern "C" {
+
+WEAK void halide_pipeline_stats_report(void *user_context) {
+    halide_enumerate_pipeline_stats(user_context, user_context, pipeline_stats_print, false);
+}
+
+WEAK void halide_pipeline_stats_reset() {
+    // Pipelines keep pointers to their statistics, so they are zeroed
+    // rather than freed.
+    ScopedMutexLock lock(&pipeline_stats_lock);
+    for (halide_pipeline_stats_t *s = pipeline_stats; s;
+         s = (halide_pipeline_stats_t *)(s->next)) {
+        pipeline_stats_read(&s->calls, true);
+        pipeline_stats_read(&s->errors, true);
+        pipeline_stats_read(&s->total_time_ns, true);
+        pipeline_stats_read(&s->max_time_ns, true);
+        pipeline_stats_read(&s->output_bytes, true);
+        for (int i = 0; i < HALIDE_PIPELINE_STATS_BUCKETS; i++) {
+            pipeline_stats_read(&s->histogram[i], true);
+        }
+    }
+}
+
+}
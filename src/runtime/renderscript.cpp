@@ -1186,6 +1186,8 @@ WEAK halide_device_interface renderscript_device_interface = {
     halide_renderscript_device_free,  halide_renderscript_device_sync,
     halide_renderscript_device_release,
     halide_renderscript_copy_to_host, halide_renderscript_copy_to_device,
+    NULL, NULL,
+    NULL, NULL,
 };
 }
 }
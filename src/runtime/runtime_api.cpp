@@ -32,6 +32,7 @@ __attribute__((used)) void *runtime_api_functions[] = {
     (void *)&halide_device_sync,
     (void *)&halide_do_par_for,
     (void *)&halide_double_to_string,
+    (void *)&halide_enumerate_pipeline_stats,
     (void *)&halide_enumerate_registered_filters,
     (void *)&halide_error,
     (void *)&halide_error_access_out_of_bounds,
@@ -91,6 +92,12 @@ __attribute__((used)) void *runtime_api_functions[] = {
     (void *)&halide_openglcompute_device_interface,
     (void *)&halide_openglcompute_initialize_kernels,
     (void *)&halide_openglcompute_run,
+    (void *)&halide_pipeline_stats_begin,
+    (void *)&halide_pipeline_stats_bucket_time_ns,
+    (void *)&halide_pipeline_stats_end,
+    (void *)&halide_pipeline_stats_percentile_ns,
+    (void *)&halide_pipeline_stats_report,
+    (void *)&halide_pipeline_stats_reset,
     (void *)&halide_pointer_to_string,
     (void *)&halide_print,
     (void *)&halide_profiler_pipeline_start,
@@ -101,6 +101,7 @@ WEAK int halide_start_clock(void *user_context);
 WEAK int64_t halide_current_time_ns(void *user_context);
 WEAK void halide_sleep_ms(void *user_context, int ms);
 WEAK void halide_device_free_as_destructor(void *user_context, void *obj);
+WEAK size_t halide_device_pool_get_limit();
 
 WEAK int halide_profiler_pipeline_start(void *user_context,
                                         const char *pipeline_name,
@@ -0,0 +1,648 @@
+#include "runtime_internal.h"
+#include "HalideRuntime.h"
+#include "scoped_mutex_lock.h"
+
+// A memoization cache that lives in a named POSIX shared memory
+// segment, so that all processes on a machine running the same
+// pipelines share memoized results. Selected with
+// Target::SharedMemoizationCache instead of cache.cpp.
+//
+// The segment holds a header with a process-shared mutex, a fixed
+// table of entries, and an arena from which the keys and data of the
+// entries are allocated. Entries are reference counted while a
+// pipeline is using them, and the least recently used unreferenced
+// entries are evicted when the arena is full. The arena size is fixed
+// when the segment is created, by halide_memoization_cache_set_size
+// in whichever process creates it. The segment persists until it is
+// unlinked (e.g. by removing it from /dev/shm on Linux).
+//
+// The segment name is taken from the HL_SHARED_CACHE_NAME environment
+// variable, and defaults to /halide_memoization_cache. If the segment
+// can't be created or mapped, every lookup misses, which is correct
+// but slow.
+//
+// When jitting, all pipelines in a process share one runtime, so the
+// first pipeline compiled decides whether this cache or the
+// in-process one is used (see JITSharedRuntime).
+
+extern "C" {
+
+#ifdef OSX
+#define SHM_O_CREAT 0x200
+#define SHM_O_EXCL 0x800
+int shm_open(const char *name, int oflag, ...);
+#else
+#define SHM_O_CREAT 0100
+#define SHM_O_EXCL 0200
+#endif
+#define SHM_O_RDWR 2
+#define SHM_PROT_READ 1
+#define SHM_PROT_WRITE 2
+#define SHM_MAP_SHARED 1
+#define SHM_SEEK_END 2
+#define SHM_PTHREAD_PROCESS_SHARED 1
+
+int ftruncate(int fd, long length);
+long lseek(int fd, long offset, int whence);
+void *mmap(void *addr, size_t length, int prot, int flags, int fd, long offset);
+int munmap(void *addr, size_t length);
+
+int pthread_mutexattr_init(void *attr);
+int pthread_mutexattr_setpshared(void *attr, int pshared);
+int pthread_mutexattr_destroy(void *attr);
+int pthread_mutex_init(void *mutex, const void *attr);
+int pthread_mutex_lock(void *mutex);
+int pthread_mutex_unlock(void *mutex);
+
+#ifndef OSX
+// Robust mutexes let us recover if a process dies holding the lock.
+#define SHM_PTHREAD_MUTEX_ROBUST 1
+#define SHM_EOWNERDEAD 130
+int pthread_mutexattr_setrobust(void *attr, int robust);
+int pthread_mutex_consistent(void *mutex);
+#endif
+
+}
+
+namespace Halide { namespace Runtime { namespace Internal { namespace SharedCache {
+
+const uint32_t kMagic = 0x484c5343; // 'HLSC'
+const uint32_t kVersion = 2;
+const int32_t kMaxEntries = 1024;
+const int32_t kMaxTuples = 4;
+const uint64_t kDefaultArenaSize = 64 << 20;
+
+// Each block of data handed out by the cache is preceded by this many
+// bytes. For data in the segment, it holds the index of the entry. For
+// data allocated privately on a miss, it holds the hash of the key.
+const size_t kPrefixBytes = 16;
+const uint32_t kPrivateTag = 0;
+const uint32_t kSharedTag = kMagic;
+
+struct Header {
+    uint32_t magic;
+    uint32_t version;
+    // Set once the creating process has initialized the segment.
+    volatile uint32_t initialized;
+    // Processes with different pointer sizes can't share buffer_t.
+    uint32_t buffer_t_size;
+    uint64_t segment_size;
+    uint64_t entries_offset;
+    uint64_t arena_offset;
+    uint64_t arena_size;
+    uint64_t clock;
+    uint64_t mutex[8];
+};
+
+struct Entry {
+    uint32_t valid;
+    uint32_t hash;
+    uint32_t key_size;
+    int32_t tuple_count;
+    uint32_t in_use_count;
+    uint32_t padding;
+    uint64_t last_used;
+    // Arena offsets of the block holding the key and data, and of the
+    // data of each tuple element.
+    uint64_t block;
+    uint64_t data[kMaxTuples];
+    buffer_t computed_bounds;
+    buffer_t buf[kMaxTuples];
+};
+
+// Arena blocks are a multiple of 16 bytes, and are preceded by this.
+struct BlockHeader {
+    uint64_t size;
+    uint64_t free;
+};
+
+WEAK int segment_fd = -1;
+// Only set once the segment is mapped, initialized and validated, and
+// never reset, so that threads that find it set can use it without
+// taking the attach lock.
+WEAK uint8_t *segment = NULL;
+WEAK uint64_t mapped_size = 0;
+WEAK bool attach_failed = false;
+WEAK uint64_t arena_size_for_creation = kDefaultArenaSize;
+WEAK halide_mutex attach_lock = { { 0 } };
+
+WEAK Header *header() {
+    return (Header *)segment;
+}
+
+WEAK Entry *entries() {
+    return (Entry *)(segment + header()->entries_offset);
+}
+
+WEAK uint8_t *arena() {
+    return segment + header()->arena_offset;
+}
+
+WEAK uint64_t round_up_16(uint64_t x) {
+    return (x + 15) & ~(uint64_t)15;
+}
+
+WEAK size_t full_extent(const buffer_t &buf) {
+    size_t result = 1;
+    for (int i = 0; i < 4; i++) {
+        int32_t stride = buf.stride[i];
+        if (stride < 0) stride = -stride;
+        if ((buf.extent[i] * stride) > result) {
+            result = buf.extent[i] * stride;
+        }
+    }
+    return result;
+}
+
+WEAK bool bounds_equal(const buffer_t &buf1, const buffer_t &buf2) {
+    if (buf1.elem_size != buf2.elem_size) {
+        return false;
+    }
+    for (int i = 0; i < 4; i++) {
+        if (buf1.min[i] != buf2.min[i] ||
+            buf1.extent[i] != buf2.extent[i] ||
+            buf1.stride[i] != buf2.stride[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// The first pointer-sized field of a key generated by the compiler
+// points to a string naming the Func being memoized and holding a hash
+// of its lowered definition (see Memoization.cpp). Its address differs
+// between processes, so we key on the string it points to. It is
+// followed by a 32-bit counter that only distinguishes compilations
+// within one process, which we skip, and then the rest of the key.
+const size_t kInstanceCounterBytes = 4;
+
+struct CanonicalKey {
+    const uint8_t *name;
+    size_t name_size;
+    const uint8_t *rest;
+    size_t rest_size;
+
+    bool init(const uint8_t *cache_key, int32_t size) {
+        if (size < (int32_t)(sizeof(const char *) + kInstanceCounterBytes)) {
+            return false;
+        }
+        const char *str = *(const char * const *)cache_key;
+        if (str == NULL) {
+            return false;
+        }
+        name = (const uint8_t *)str;
+        name_size = strlen(str) + 1;
+        rest = cache_key + sizeof(const char *) + kInstanceCounterBytes;
+        rest_size = size - sizeof(const char *) - kInstanceCounterBytes;
+        return true;
+    }
+
+    size_t size() const {
+        return name_size + rest_size;
+    }
+
+    uint32_t hash() const {
+        uint32_t h = 5381;
+        for (size_t i = 0; i < name_size; i++) {
+            h = (h << 5) + h + name[i];
+        }
+        for (size_t i = 0; i < rest_size; i++) {
+            h = (h << 5) + h + rest[i];
+        }
+        return h;
+    }
+
+    bool equals(const uint8_t *stored, size_t stored_size) const {
+        return (stored_size == size() &&
+                memcmp(stored, name, name_size) == 0 &&
+                memcmp(stored + name_size, rest, rest_size) == 0);
+    }
+
+    void copy_to(uint8_t *dst) const {
+        memcpy(dst, name, name_size);
+        memcpy(dst + name_size, rest, rest_size);
+    }
+};
+
+WEAK void lock_segment() {
+    void *mutex = &header()->mutex[0];
+#ifdef OSX
+    pthread_mutex_lock(mutex);
+#else
+    if (pthread_mutex_lock(mutex) == SHM_EOWNERDEAD) {
+        // A process died while holding the lock. The worst it can have
+        // left behind is a leaked reference count or arena block.
+        pthread_mutex_consistent(mutex);
+    }
+#endif
+}
+
+WEAK void unlock_segment() {
+    pthread_mutex_unlock(&header()->mutex[0]);
+}
+
+WEAK void initialize_segment(uint8_t *mem, uint64_t size, uint64_t entries_offset, uint64_t arena_offset) {
+    Header *h = (Header *)mem;
+    memset(mem, 0, arena_offset);
+    h->magic = kMagic;
+    h->version = kVersion;
+    h->buffer_t_size = sizeof(buffer_t);
+    h->segment_size = size;
+    h->entries_offset = entries_offset;
+    h->arena_offset = arena_offset;
+    h->arena_size = size - arena_offset;
+    h->clock = 0;
+
+    uint64_t attr[2];
+    pthread_mutexattr_init(attr);
+    pthread_mutexattr_setpshared(attr, SHM_PTHREAD_PROCESS_SHARED);
+#ifndef OSX
+    pthread_mutexattr_setrobust(attr, SHM_PTHREAD_MUTEX_ROBUST);
+#endif
+    pthread_mutex_init(&h->mutex[0], attr);
+    pthread_mutexattr_destroy(attr);
+
+    // The arena starts out as a single free block.
+    BlockHeader *block = (BlockHeader *)(mem + arena_offset);
+    block->size = h->arena_size;
+    block->free = 1;
+
+    __sync_synchronize();
+    h->initialized = 1;
+}
+
+// On Linux, shm_open lives in librt on older systems, which we may not
+// be linked against, so we open the file in /dev/shm directly, which is
+// all shm_open does there.
+WEAK int open_segment(const char *name, int flags) {
+#ifdef OSX
+    return shm_open(name, flags, 0600);
+#else
+    char path[256];
+    const char *prefix = "/dev/shm";
+    size_t prefix_len = strlen(prefix);
+    size_t name_len = strlen(name);
+    if (prefix_len + name_len + 1 > sizeof(path)) {
+        return -1;
+    }
+    memcpy(path, prefix, prefix_len);
+    memcpy(path + prefix_len, name, name_len + 1);
+    return open(path, flags, 0600);
+#endif
+}
+
+// Create or open the segment and map it. Returns false if the shared
+// cache isn't usable, in which case the caller should behave as if
+// the cache were always empty.
+WEAK bool attach(void *user_context) {
+    if (segment) {
+        // Pairs with the barrier before segment is set below.
+        __sync_synchronize();
+        return true;
+    }
+    if (attach_failed) return false;
+
+    ScopedMutexLock lock(&attach_lock);
+    if (segment) return true;
+    if (attach_failed) return false;
+
+    const char *name = getenv("HL_SHARED_CACHE_NAME");
+    if (!name || !name[0]) {
+        name = "/halide_memoization_cache";
+    }
+
+    uint64_t entries_offset = round_up_16(sizeof(Header));
+    uint64_t arena_offset = round_up_16(entries_offset + sizeof(Entry) * kMaxEntries);
+    uint64_t size = arena_offset + round_up_16(arena_size_for_creation);
+
+    bool created = true;
+    int fd = open_segment(name, SHM_O_RDWR | SHM_O_CREAT | SHM_O_EXCL);
+    if (fd < 0) {
+        created = false;
+        fd = open_segment(name, SHM_O_RDWR);
+    }
+    if (fd < 0) {
+        debug(user_context) << "Can't open shared memoization cache " << name << "\n";
+        attach_failed = true;
+        return false;
+    }
+
+    if (created) {
+        if (ftruncate(fd, (long)size) != 0) {
+            close(fd);
+            attach_failed = true;
+            return false;
+        }
+    } else {
+        // Wait for the creator to size the segment.
+        for (int i = 0; i < 1000; i++) {
+            long s = lseek(fd, 0, SHM_SEEK_END);
+            if (s > 0) {
+                size = (uint64_t)s;
+                break;
+            }
+            halide_sleep_ms(user_context, 1);
+        }
+    }
+
+    void *mem = mmap(NULL, size, SHM_PROT_READ | SHM_PROT_WRITE, SHM_MAP_SHARED, fd, 0);
+    if (mem == (void *)-1 || size < arena_offset) {
+        if (mem != (void *)-1) munmap(mem, size);
+        close(fd);
+        debug(user_context) << "Can't map shared memoization cache " << name << "\n";
+        attach_failed = true;
+        return false;
+    }
+
+    Header *h = (Header *)mem;
+    if (created) {
+        initialize_segment((uint8_t *)mem, size, entries_offset, arena_offset);
+    } else {
+        // Wait for the creator to initialize the segment.
+        for (int i = 0; i < 1000 && !h->initialized; i++) {
+            halide_sleep_ms(user_context, 1);
+        }
+        __sync_synchronize();
+        if (!h->initialized || h->magic != kMagic || h->version != kVersion ||
+            h->buffer_t_size != sizeof(buffer_t) || h->segment_size != size ||
+            h->entries_offset != entries_offset || h->arena_offset != arena_offset) {
+            debug(user_context) << "Shared memoization cache " << name << " is incompatible\n";
+            munmap(mem, size);
+            close(fd);
+            attach_failed = true;
+            return false;
+        }
+    }
+
+    segment_fd = fd;
+    mapped_size = size;
+    // Publish the segment last, once everything a thread that sees it
+    // might use is in place.
+    __sync_synchronize();
+    segment = (uint8_t *)mem;
+    return true;
+}
+
+WEAK bool in_segment(const void *p) {
+    return segment && (const uint8_t *)p >= segment && (const uint8_t *)p < segment + mapped_size;
+}
+
+// First-fit allocation from the arena. Adjacent free blocks are
+// coalesced as we walk past them. Returns the arena offset of the
+// usable memory, or 0 on failure. Must be called with the segment
+// locked.
+WEAK uint64_t arena_alloc(uint64_t bytes) {
+    uint64_t needed = round_up_16(bytes) + sizeof(BlockHeader);
+    uint64_t arena_size = header()->arena_size;
+    uint8_t *base = arena();
+    uint64_t offset = 0;
+    while (offset < arena_size) {
+        BlockHeader *block = (BlockHeader *)(base + offset);
+        if (block->free) {
+            uint64_t next = offset + block->size;
+            while (next < arena_size && ((BlockHeader *)(base + next))->free) {
+                block->size += ((BlockHeader *)(base + next))->size;
+                next = offset + block->size;
+            }
+            if (block->size >= needed) {
+                // Split off the remainder if it is worth keeping.
+                if (block->size - needed >= 4 * sizeof(BlockHeader)) {
+                    BlockHeader *rest = (BlockHeader *)(base + offset + needed);
+                    rest->size = block->size - needed;
+                    rest->free = 1;
+                    block->size = needed;
+                }
+                block->free = 0;
+                return offset + sizeof(BlockHeader);
+            }
+        }
+        offset += block->size;
+    }
+    return 0;
+}
+
+WEAK void arena_free(uint64_t offset) {
+    BlockHeader *block = (BlockHeader *)(arena() + offset - sizeof(BlockHeader));
+    block->free = 1;
+}
+
+// Evict the least recently used entry no one is using. Returns false
+// if there is no such entry. Must be called with the segment locked.
+WEAK bool evict_one() {
+    Entry *e = entries();
+    int32_t victim = -1;
+    for (int32_t i = 0; i < kMaxEntries; i++) {
+        if (e[i].valid && e[i].in_use_count == 0 &&
+            (victim < 0 || e[i].last_used < e[victim].last_used)) {
+            victim = i;
+        }
+    }
+    if (victim < 0) {
+        return false;
+    }
+    arena_free(e[victim].block);
+    e[victim].valid = 0;
+    return true;
+}
+
+WEAK int32_t find_entry(const CanonicalKey &key, uint32_t h, const buffer_t *computed_bounds,
+                        int32_t tuple_count, buffer_t **tuple_buffers) {
+    Entry *e = entries();
+    for (int32_t i = 0; i < kMaxEntries; i++) {
+        if (!e[i].valid || e[i].hash != h || e[i].tuple_count != tuple_count ||
+            !bounds_equal(e[i].computed_bounds, *computed_bounds) ||
+            !key.equals(arena() + e[i].block, e[i].key_size)) {
+            continue;
+        }
+        bool all_bounds_equal = true;
+        for (int32_t j = 0; all_bounds_equal && j < tuple_count; j++) {
+            all_bounds_equal = bounds_equal(e[i].buf[j], *tuple_buffers[j]);
+        }
+        if (all_bounds_equal) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+WEAK uint32_t *prefix(void *host) {
+    return (uint32_t *)((uint8_t *)host - kPrefixBytes);
+}
+
+}}}} // namespace Halide::Runtime::Internal::SharedCache
+
+using namespace Halide::Runtime::Internal::SharedCache;
+
+extern "C" {
+
+WEAK void halide_memoization_cache_set_size(int64_t size) {
+    // Only takes effect if this process ends up creating the segment.
+    arena_size_for_creation = size > 0 ? (uint64_t)size : kDefaultArenaSize;
+}
+
+WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cache_key, int32_t size,
+                                         buffer_t *computed_bounds, int32_t tuple_count, buffer_t **tuple_buffers) {
+    CanonicalKey key;
+    bool shareable = key.init(cache_key, size) && tuple_count <= kMaxTuples;
+    uint32_t h = shareable ? key.hash() : 0;
+
+    if (shareable && attach(user_context)) {
+        lock_segment();
+        int32_t i = find_entry(key, h, computed_bounds, tuple_count, tuple_buffers);
+        if (i >= 0) {
+            Entry &entry = entries()[i];
+            entry.last_used = ++header()->clock;
+            entry.in_use_count += tuple_count;
+            for (int32_t j = 0; j < tuple_count; j++) {
+                buffer_t *buf = tuple_buffers[j];
+                *buf = entry.buf[j];
+                buf->host = arena() + entry.data[j];
+                buf->dev = 0;
+                buf->host_dirty = true;
+                buf->dev_dirty = false;
+            }
+            unlock_segment();
+            return 0;
+        }
+        unlock_segment();
+    }
+
+    // Miss. Allocate private storage for the pipeline to compute
+    // into. halide_memoization_cache_store copies it into the segment.
+    for (int32_t i = 0; i < tuple_count; i++) {
+        buffer_t *buf = tuple_buffers[i];
+        size_t buffer_size = full_extent(*buf) * buf->elem_size;
+        uint8_t *mem = (uint8_t *)halide_malloc(user_context, buffer_size + kPrefixBytes);
+        if (mem == NULL) {
+            for (int32_t j = i; j > 0; j--) {
+                halide_free(user_context, tuple_buffers[j - 1]->host - kPrefixBytes);
+                tuple_buffers[j - 1]->host = NULL;
+            }
+            return -1;
+        }
+        buf->host = mem + kPrefixBytes;
+        prefix(buf->host)[0] = kPrivateTag;
+        prefix(buf->host)[1] = h;
+    }
+
+    return 1;
+}
+
+WEAK void halide_memoization_cache_store(void *user_context, const uint8_t *cache_key, int32_t size,
+                                        buffer_t *computed_bounds, int32_t tuple_count, buffer_t **tuple_buffers) {
+    CanonicalKey key;
+    if (!key.init(cache_key, size) || tuple_count > kMaxTuples || !attach(user_context)) {
+        return;
+    }
+    uint32_t h = prefix(tuple_buffers[0]->host)[1];
+
+    // Copy the data back from the device before taking the lock.
+    uint64_t block_size = round_up_16(key.size());
+    for (int32_t i = 0; i < tuple_count; i++) {
+        buffer_t *buf = tuple_buffers[i];
+        if (buf->dev_dirty) {
+            halide_copy_to_host(user_context, buf);
+        }
+        block_size += kPrefixBytes + round_up_16(full_extent(*buf) * buf->elem_size);
+    }
+
+    lock_segment();
+
+    // Another process may have stored the same result in the meantime.
+    if (find_entry(key, h, computed_bounds, tuple_count, tuple_buffers) >= 0) {
+        unlock_segment();
+        return;
+    }
+
+    Entry *e = entries();
+    int32_t slot = -1;
+    while (true) {
+        for (int32_t i = 0; i < kMaxEntries && slot < 0; i++) {
+            if (!e[i].valid) slot = i;
+        }
+        if (slot >= 0 || !evict_one()) break;
+    }
+
+    uint64_t block = 0;
+    if (slot >= 0) {
+        while ((block = arena_alloc(block_size)) == 0) {
+            if (!evict_one()) break;
+        }
+    }
+
+    if (block == 0) {
+        // Too big for the cache, or everything is in use.
+        unlock_segment();
+        return;
+    }
+
+    Entry &entry = e[slot];
+    entry.hash = h;
+    entry.key_size = key.size();
+    entry.tuple_count = tuple_count;
+    entry.in_use_count = 0;
+    entry.last_used = ++header()->clock;
+    entry.block = block;
+    entry.computed_bounds = *computed_bounds;
+    entry.computed_bounds.host = NULL;
+    entry.computed_bounds.dev = 0;
+
+    uint8_t *base = arena();
+    key.copy_to(base + block);
+    uint64_t offset = block + round_up_16(key.size());
+    for (int32_t i = 0; i < tuple_count; i++) {
+        buffer_t *buf = tuple_buffers[i];
+        uint32_t *p = (uint32_t *)(base + offset);
+        p[0] = kSharedTag;
+        p[1] = slot;
+        offset += kPrefixBytes;
+
+        size_t bytes = full_extent(*buf) * buf->elem_size;
+        memcpy(base + offset, buf->host, bytes);
+        entry.data[i] = offset;
+        entry.buf[i] = *buf;
+        entry.buf[i].host = NULL;
+        entry.buf[i].dev = 0;
+        offset += round_up_16(bytes);
+    }
+    entry.valid = 1;
+
+    unlock_segment();
+}
+
+WEAK void halide_memoization_cache_release(void *user_context, void *host) {
+    uint32_t *p = prefix(host);
+    if (in_segment(host) && p[0] == kSharedTag) {
+        lock_segment();
+        Entry &entry = entries()[p[1]];
+        halide_assert(user_context, entry.valid && entry.in_use_count > 0);
+        entry.in_use_count--;
+        unlock_segment();
+    } else {
+        halide_free(user_context, p);
+    }
+}
+
+WEAK void halide_memoization_cache_cleanup() {
+    // Leave the segment and its contents for other processes.
+    ScopedMutexLock lock(&attach_lock);
+    if (segment) {
+        munmap(segment, mapped_size);
+        close(segment_fd);
+        segment = NULL;
+        segment_fd = -1;
+        mapped_size = 0;
+    }
+    attach_failed = false;
+}
+
+namespace {
+
+__attribute__((destructor))
+WEAK void halide_shared_cache_cleanup() {
+    halide_memoization_cache_cleanup();
+}
+
+}
+
+}
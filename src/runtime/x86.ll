@@ -131,4 +131,30 @@ define weak_odr <2 x double> @max_f64x2(<2 x double> %a, <2 x double> %b) nounwi
   %c = fcmp olt <2 x double> %a, %b
   %result = select <2 x i1> %c, <2 x double> %b, <2 x double> %a
   ret <2 x double> %result
-}
\ No newline at end of file
+}
+; Query the host cpu. Returns register eax, ebx, ecx, or edx (reg = 0,
+; 1, 2, or 3) of the result of cpuid. Used by the runtime to pick a
+; target variant of a pipeline at run time.
+define weak_odr i32 @x86_cpuid_halide(i32 %leaf, i32 %subleaf, i32 %reg) nounwind {
+  %1 = tail call { i32, i32, i32, i32 } asm sideeffect "cpuid", "={ax},={bx},={cx},={dx},0,2,~{dirflag},~{fpsr},~{flags}"(i32 %leaf, i32 %subleaf) nounwind
+  %eax = extractvalue { i32, i32, i32, i32 } %1, 0
+  %ebx = extractvalue { i32, i32, i32, i32 } %1, 1
+  %ecx = extractvalue { i32, i32, i32, i32 } %1, 2
+  %edx = extractvalue { i32, i32, i32, i32 } %1, 3
+  %is_eax = icmp eq i32 %reg, 0
+  %is_ebx = icmp eq i32 %reg, 1
+  %is_ecx = icmp eq i32 %reg, 2
+  %2 = select i1 %is_ecx, i32 %ecx, i32 %edx
+  %3 = select i1 %is_ebx, i32 %ebx, i32 %2
+  %4 = select i1 %is_eax, i32 %eax, i32 %3
+  ret i32 %4
+}
+
+; Get the low half of the extended control register, which says which
+; register states the OS saves on context switches. Only call this if
+; cpuid reports OSXSAVE.
+define weak_odr i32 @x86_xgetbv_halide() nounwind {
+  %1 = tail call { i32, i32 } asm sideeffect "xgetbv", "={ax},={dx},{cx},~{dirflag},~{fpsr},~{flags}"(i32 0) nounwind
+  %2 = extractvalue { i32, i32 } %1, 0
+  ret i32 %2
+}
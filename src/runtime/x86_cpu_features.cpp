@@ -0,0 +1,81 @@
+#include "runtime_internal.h"
+#include "HalideRuntime.h"
+
+// Detection of the x86 instruction set extensions supported by the
+// host, for objects containing several target variants of a
+// pipeline. The cpuid and xgetbv instructions are wrapped in x86.ll.
+
+extern "C" int32_t x86_cpuid_halide(int32_t leaf, int32_t subleaf, int32_t reg);
+extern "C" int32_t x86_xgetbv_halide();
+
+namespace Halide { namespace Runtime { namespace Internal {
+
+// The features found, plus a bit to say they've been looked up. Kept
+// in one word, so that a racing thread sees either nothing or
+// everything.
+const uint32_t cpu_features_known = 1U << 31;
+WEAK volatile uint32_t cpu_features = 0;
+
+WEAK uint32_t get_cpu_features() {
+    const int32_t eax = 0, ebx = 1, ecx = 2;
+
+    uint32_t features = cpu_features_known;
+
+    int32_t max_leaf = x86_cpuid_halide(0, 0, eax);
+    if (max_leaf < 1) {
+        return features;
+    }
+
+    int32_t info_ecx = x86_cpuid_halide(1, 0, ecx);
+    if (info_ecx & (1 << 19)) {
+        features |= halide_cpu_feature_sse41;
+    }
+
+    // AVX and friends also need the OS to save the ymm registers on
+    // context switches.
+    bool have_osxsave = info_ecx & (1 << 27);
+    bool os_saves_ymm = have_osxsave && ((x86_xgetbv_halide() & 0x6) == 0x6);
+    if (os_saves_ymm) {
+        if (info_ecx & (1 << 28)) {
+            features |= halide_cpu_feature_avx;
+        }
+        if (info_ecx & (1 << 12)) {
+            features |= halide_cpu_feature_fma;
+        }
+        if (info_ecx & (1 << 29)) {
+            features |= halide_cpu_feature_f16c;
+        }
+        if (max_leaf >= 7) {
+            int32_t info7_ebx = x86_cpuid_halide(7, 0, ebx);
+            if (info7_ebx & (1 << 5)) {
+                features |= halide_cpu_feature_avx2;
+            }
+        }
+        int32_t max_extended_leaf = x86_cpuid_halide((int32_t)0x80000000, 0, eax);
+        if ((uint32_t)max_extended_leaf >= 0x80000001) {
+            int32_t extended_ecx = x86_cpuid_halide((int32_t)0x80000001, 0, ecx);
+            if (extended_ecx & (1 << 16)) {
+                features |= halide_cpu_feature_fma4;
+            }
+        }
+    }
+
+    return features;
+}
+
+}}}
+
+extern "C" {
+
+WEAK int halide_can_use_cpu_features(uint64_t features) {
+    // Racing threads will compute the same answer, so there's no need
+    // for a lock.
+    uint32_t found = cpu_features;
+    if (!(found & cpu_features_known)) {
+        found = get_cpu_features();
+        cpu_features = found;
+    }
+    return (features & ~(uint64_t)found) == 0;
+}
+
+}
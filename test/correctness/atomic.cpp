@@ -0,0 +1,125 @@
+#include <stdio.h>
+#include <math.h>
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 256, H = 256;
+
+    Image<uint8_t> in(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            in(x, y) = (uint8_t)(rand() & 0xff);
+        }
+    }
+
+    Var x;
+    RDom r(in);
+    Expr value = cast<int>(in(r.x, r.y));
+
+    // A histogram, with the rows of the input processed in parallel.
+    {
+        int reference[256] = {0};
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                reference[in(x, y)]++;
+            }
+        }
+
+        Func hist("hist");
+        hist(x) = 0;
+        hist(value) += 1;
+        hist.update().atomic().parallel(r.y);
+
+        Image<int> result = hist.realize(256);
+        for (int i = 0; i < 256; i++) {
+            if (result(i) != reference[i]) {
+                printf("hist(%d) = %d instead of %d\n", i, result(i), reference[i]);
+                return -1;
+            }
+        }
+    }
+
+    // A min and a max, which are atomicrmw operations too.
+    {
+        Func lo("lo"), hi("hi");
+        lo(x) = 255;
+        lo(value % 4) = min(lo(value % 4), value);
+        lo.update().atomic().parallel(r.y);
+        hi(x) = 0;
+        hi(value % 4) = max(value, hi(value % 4));
+        hi.update().atomic().parallel(r.y);
+
+        Image<int> lo_result = lo.realize(4);
+        Image<int> hi_result = hi.realize(4);
+        for (int i = 0; i < 4; i++) {
+            int lo_correct = 255, hi_correct = 0;
+            for (int y = 0; y < H; y++) {
+                for (int x = 0; x < W; x++) {
+                    if (in(x, y) % 4 == i) {
+                        lo_correct = std::min(lo_correct, (int)in(x, y));
+                        hi_correct = std::max(hi_correct, (int)in(x, y));
+                    }
+                }
+            }
+            if (lo_result(i) != lo_correct || hi_result(i) != hi_correct) {
+                printf("lo(%d), hi(%d) = %d, %d instead of %d, %d\n",
+                       i, i, lo_result(i), hi_result(i), lo_correct, hi_correct);
+                return -1;
+            }
+        }
+    }
+
+    // A floating point sum, which needs a compare-and-swap loop. The
+    // values are small integers, so the sum is exact in any order.
+    {
+        double reference[16] = {0};
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                reference[in(x, y) % 16] += in(x, y) * 0.5;
+            }
+        }
+
+        Func sum("sum");
+        sum(x) = 0.0f;
+        sum(value % 16) += cast<float>(value) * 0.5f;
+        sum.update().atomic().parallel(r.y);
+
+        Image<float> result = sum.realize(16);
+        for (int i = 0; i < 16; i++) {
+            if (fabs(result(i) - reference[i]) > 1e-6) {
+                printf("sum(%d) = %f instead of %f\n", i, result(i), reference[i]);
+                return -1;
+            }
+        }
+    }
+
+    // An operand with a repeated subexpression, which common
+    // subexpression elimination lifts into a let around the update.
+    {
+        int reference[16] = {0};
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                int v = in(x, y);
+                reference[v % 16] += (v + 3) * (v + 3);
+            }
+        }
+
+        Func squares("squares");
+        squares(x) = 0;
+        squares(value % 16) += (value + 3) * (value + 3);
+        squares.update().atomic().parallel(r.y);
+
+        Image<int> result = squares.realize(16);
+        for (int i = 0; i < 16; i++) {
+            if (result(i) != reference[i]) {
+                printf("squares(%d) = %d instead of %d\n", i, result(i), reference[i]);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
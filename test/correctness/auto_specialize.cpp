@@ -0,0 +1,224 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <string.h>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Custom lowering pass that records the names of the versions of the
+// pipeline that got generated.
+std::set<std::string> versions;
+class FindVersions : public IRMutator {
+    using IRMutator::visit;
+
+    void visit(const Call *op) {
+        if (op->name == "halide_auto_specialization_hit") {
+            const StringImm *version = op->args[1].as<StringImm>();
+            if (version) {
+                versions.insert(version->value);
+            }
+        }
+        IRMutator::visit(op);
+    }
+};
+
+// Find a function in the runtime shared by jit-compiled pipelines.
+template<typename T>
+T find_runtime_function(const Target &t, const char *name) {
+    for (JITModule m : JITSharedRuntime::get(NULL, t.with_feature(Target::JIT))) {
+        auto f = m.exports().find(name);
+        if (f != m.exports().end()) {
+            return reinterpret_bits<T>(f->second.address);
+        }
+    }
+    return NULL;
+}
+
+// Describe an interleaved or planar image over some storage.
+buffer_t make_buffer(uint8_t *storage, int width, int height, bool interleaved) {
+    buffer_t buf;
+    memset(&buf, 0, sizeof(buf));
+    buf.host = storage;
+    buf.extent[0] = width;
+    buf.extent[1] = height;
+    buf.extent[2] = 3;
+    if (interleaved) {
+        buf.stride[0] = 3;
+        buf.stride[1] = width * 3;
+        buf.stride[2] = 1;
+    } else {
+        buf.stride[0] = 1;
+        buf.stride[1] = width;
+        buf.stride[2] = width * height;
+    }
+    buf.elem_size = 1;
+    return buf;
+}
+
+int main(int argc, char **argv) {
+    ImageParam in(UInt(8), 3);
+    Func f;
+    Var x, y, c;
+
+    f(x, y, c) = in(x, y, c) * 2 + 1;
+
+    // Allow any layout of the input and output.
+    in.set_stride(0, Expr());
+    f.output_buffer().set_stride(0, Expr());
+
+    f.vectorize(x, 8);
+    f.add_custom_lowering_pass(new FindVersions);
+
+    Target t = get_jit_target_from_environment().with_feature(Target::AutoSpecialize);
+    f.compile_jit(t);
+
+    const char *expected[] = {"dense_vector_multiple", "dense",
+                              "interleaved_3", "interleaved_4", "generic"};
+    for (const char *v : expected) {
+        if (!versions.count(v)) {
+            printf("Version %s was not generated\n", v);
+            return -1;
+        }
+    }
+
+    auto get_stats = find_runtime_function<halide_auto_specialization_stats *(*)()>(
+        t, "halide_auto_specialization_get_stats");
+    auto reset_stats = find_runtime_function<void (*)()>(
+        t, "halide_auto_specialization_reset");
+    if (!get_stats || !reset_stats) {
+        printf("Could not find the auto-specialization hit counters\n");
+        return -1;
+    }
+    reset_stats();
+
+    // Exercise each version with a combination of layouts and sizes.
+    // One width is a multiple of the vector width, and one isn't.
+    const int vector_width = t.natural_vector_size(UInt(8));
+    for (int width = vector_width - 1; width <= vector_width; width++) {
+        for (int in_layout = 0; in_layout < 2; in_layout++) {
+            for (int out_layout = 0; out_layout < 2; out_layout++) {
+                const int height = 5;
+                std::vector<uint8_t> in_storage(width * height * 3);
+                std::vector<uint8_t> out_storage(width * height * 3);
+                buffer_t in_buf = make_buffer(&in_storage[0], width, height, in_layout == 1);
+                buffer_t out_buf = make_buffer(&out_storage[0], width, height, out_layout == 1);
+                Image<uint8_t> input(&in_buf, "input");
+                Image<uint8_t> output(&out_buf, "output");
+
+                for (int yi = 0; yi < height; yi++) {
+                    for (int xi = 0; xi < width; xi++) {
+                        for (int ci = 0; ci < 3; ci++) {
+                            input(xi, yi, ci) = (uint8_t)(xi * 7 + yi * 3 + ci);
+                        }
+                    }
+                }
+
+                in.set(input);
+                f.realize(output);
+
+                for (int yi = 0; yi < height; yi++) {
+                    for (int xi = 0; xi < width; xi++) {
+                        for (int ci = 0; ci < 3; ci++) {
+                            uint8_t correct = (uint8_t)(input(xi, yi, ci) * 2 + 1);
+                            if (output(xi, yi, ci) != correct) {
+                                printf("output(%d, %d, %d) = %d instead of %d "
+                                       "(width %d, input layout %d, output layout %d)\n",
+                                       xi, yi, ci, output(xi, yi, ci), correct,
+                                       width, in_layout, out_layout);
+                                return -1;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Both buffers are planar in two of the runs, with one width a
+    // multiple of the vector width, and interleaved in two. The other
+    // four runs mix the layouts, which only the generic version
+    // handles.
+    std::map<std::string, uint64_t> hits;
+    for (halide_auto_specialization_stats *s = get_stats(); s;
+         s = (halide_auto_specialization_stats *)(s->next)) {
+        hits[s->version_name] += s->hits;
+    }
+    std::map<std::string, uint64_t> expected_hits = {
+        {"dense_vector_multiple", 1}, {"dense", 1}, {"interleaved_3", 2}, {"generic", 4}};
+    if (hits != expected_hits) {
+        printf("Unexpected hit counts:\n");
+        for (auto h : hits) {
+            printf("  %s: %llu\n", h.first.c_str(), (unsigned long long)h.second);
+        }
+        return -1;
+    }
+
+    {
+        // With the default constraints, the input and output are dense
+        // in x already, so they can only be planar.
+        ImageParam planar_in(UInt(8), 3);
+        Func g;
+        g(x, y, c) = planar_in(x, y, c) * 3;
+        g.vectorize(x, 8);
+        versions.clear();
+        g.add_custom_lowering_pass(new FindVersions);
+        g.compile_jit(t);
+
+        std::set<std::string> expected_versions = {
+            "dense_vector_multiple", "planar_3", "planar_4", "generic"};
+        if (versions != expected_versions) {
+            printf("Unexpected versions for planar buffers:\n");
+            for (const std::string &v : versions) {
+                printf("  %s\n", v.c_str());
+            }
+            return -1;
+        }
+
+        reset_stats();
+        for (int width = vector_width - 1; width <= vector_width; width++) {
+            Image<uint8_t> input(width, 5, 3), output(width, 5, 3);
+            for (int yi = 0; yi < 5; yi++) {
+                for (int xi = 0; xi < width; xi++) {
+                    for (int ci = 0; ci < 3; ci++) {
+                        input(xi, yi, ci) = (uint8_t)(xi * 7 + yi * 3 + ci);
+                    }
+                }
+            }
+            planar_in.set(input);
+            g.realize(output);
+            for (int yi = 0; yi < 5; yi++) {
+                for (int xi = 0; xi < width; xi++) {
+                    for (int ci = 0; ci < 3; ci++) {
+                        uint8_t correct = (uint8_t)(input(xi, yi, ci) * 3);
+                        if (output(xi, yi, ci) != correct) {
+                            printf("output(%d, %d, %d) = %d instead of %d (width %d)\n",
+                                   xi, yi, ci, output(xi, yi, ci), correct, width);
+                            return -1;
+                        }
+                    }
+                }
+            }
+        }
+
+        hits.clear();
+        for (halide_auto_specialization_stats *s = get_stats(); s;
+             s = (halide_auto_specialization_stats *)(s->next)) {
+            hits[s->version_name] += s->hits;
+        }
+        expected_hits = {{"dense_vector_multiple", 1}, {"planar_3", 1}};
+        if (hits != expected_hits) {
+            printf("Unexpected hit counts for planar buffers:\n");
+            for (auto h : hits) {
+                printf("  %s: %llu\n", h.first.c_str(), (unsigned long long)h.second);
+            }
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
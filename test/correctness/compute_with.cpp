@@ -0,0 +1,148 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the loops over y and yo in the lowered code, to check that the
+// loop nests really were fused.
+int outer_loops = 0;
+class CountOuterLoops : public IRMutator {
+    using IRMutator::visit;
+
+    void visit(const For *op) {
+        if (ends_with(op->name, ".y") || ends_with(op->name, ".yo")) {
+            outer_loops++;
+        }
+        IRMutator::visit(op);
+    }
+};
+
+int check(const Image<int> &out, const Image<int> &in, int dy) {
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int gx = in(x+2, y+1) - in(x, y+1);
+            int gy = in(x+1, y+dy+2) - in(x+1, y+dy);
+            int correct = gx * gx + gy * gy;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Image<int> in(64, 64);
+    for (int y = 0; y < in.height(); y++) {
+        for (int x = 0; x < in.width(); x++) {
+            in(x, y) = (x * 17 + y * 31) % 23;
+        }
+    }
+
+    Var x("x"), y("y"), yo("yo"), yi("yi");
+
+    for (int dy = 0; dy <= 2; dy += 2) {
+        // Two stages that read the same input over the same region
+        // (or shifted regions when dy is 2).
+        Func gx("gx"), gy("gy"), out("out");
+        gx(x, y) = in(x+1, y) - in(x-1, y);
+        gy(x, y) = in(x, y+1) - in(x, y-1);
+        out(x, y) = gx(x+1, y+1) * gx(x+1, y+1) + gy(x+1, y+dy+1) * gy(x+1, y+dy+1);
+
+        // Fuse the loops over y. The inner loops can be scheduled
+        // independently.
+        gx.compute_root().vectorize(x, 4);
+        gy.compute_root().compute_with(gx, y);
+        out.add_custom_lowering_pass(new CountOuterLoops);
+
+        outer_loops = 0;
+        Image<int> result = out.realize(60, 40);
+        if (check(result, in, dy) != 0) {
+            return -1;
+        }
+        if (outer_loops != 2) {
+            printf("Expected two loops over y, found %d\n", outer_loops);
+            return -1;
+        }
+    }
+
+    {
+        // Fuse all the way down to x, and split and parallelize y.
+        Func gx("gx"), gy("gy"), out("out");
+        gx(x, y) = in(x+1, y) - in(x-1, y);
+        gy(x, y) = in(x, y+1) - in(x, y-1);
+        out(x, y) = gx(x+1, y+1) * gx(x+1, y+1) + gy(x+1, y+3) * gy(x+1, y+3);
+
+        gx.compute_root().split(y, yo, yi, 8).parallel(yo);
+        gy.compute_root().split(y, yo, yi, 8).parallel(yo).compute_with(gx, x);
+        out.add_custom_lowering_pass(new CountOuterLoops);
+
+        outer_loops = 0;
+        Image<int> result = out.realize(60, 40);
+        if (check(result, in, 2) != 0) {
+            return -1;
+        }
+        if (outer_loops != 2) {
+            printf("Expected two loops over yo, found %d\n", outer_loops);
+            return -1;
+        }
+    }
+
+    {
+        // Fuse the loop nests of two outputs of a pipeline.
+        Func gx("gx"), gy("gy");
+        gx(x, y) = in(x+2, y+1) - in(x, y+1);
+        gy(x, y) = in(x+1, y+2) - in(x+1, y);
+        gy.compute_with(gx, y);
+
+        Pipeline p({gx, gy});
+        Realization r = p.realize(60, 40);
+        Image<int> rx = r[0], ry = r[1];
+        for (int y = 0; y < 40; y++) {
+            for (int x = 0; x < 60; x++) {
+                if (rx(x, y) != in(x+2, y+1) - in(x, y+1) ||
+                    ry(x, y) != in(x+1, y+2) - in(x+1, y)) {
+                    printf("Wrong output of fused pipeline at %d, %d\n", x, y);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // The realization order is a, b, c. Fusing c into the loop
+        // nest of a moves it ahead of b, which is fine as long as c
+        // doesn't use b. (If it did, it would be a compile error.)
+        Func a("a"), b("b"), c("c"), out("out");
+        a(x, y) = in(x, y) + 1;
+        b(x, y) = in(x, y) * 2;
+        c(x, y) = in(x, y) + 3;
+        out(x, y) = a(x, y) + b(x, y) * c(x, y);
+
+        a.compute_root();
+        b.compute_root();
+        c.compute_root().compute_with(a, y);
+        out.add_custom_lowering_pass(new CountOuterLoops);
+
+        outer_loops = 0;
+        Image<int> result = out.realize(60, 40);
+        for (int y = 0; y < 40; y++) {
+            for (int x = 0; x < 60; x++) {
+                int correct = in(x, y) + 1 + in(x, y) * 2 * (in(x, y) + 3);
+                if (result(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+        if (outer_loops != 3) {
+            printf("Expected three loops over y, found %d\n", outer_loops);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
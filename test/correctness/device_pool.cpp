@@ -0,0 +1,88 @@
+#include "Halide.h"
+#include "HalideRuntimeHostDevice.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Func f("f"), g("g");
+    Var x("x"), y("y");
+
+    // f lives on the (mock) device, and is allocated and freed on each
+    // realization of g.
+    f(x, y) = x * 3 + y;
+    g(x, y) = f(x, y) + f(x + 1, y);
+
+    f.compute_root().gpu_tile(x, y, 16, 8);
+    g.gpu_tile(x, y, 16, 8);
+
+    Target target = get_host_target().with_feature(Target::HostDevice);
+    g.compile_jit(target);
+    const halide_device_interface *interface = halide_host_device_interface();
+
+    // The first realization fills the pool.
+    Image<int> output = g.realize(128, 64, target);
+    halide_device_pool_stats pool_stats;
+    halide_device_pool_get_stats(NULL, interface, &pool_stats);
+    if (pool_stats.pooled_allocations < 1) {
+        printf("Expected the allocation of f to be pooled\n");
+        return -1;
+    }
+
+    // The second one should reuse the allocation of f, instead of
+    // making a new one.
+    halide_host_device_stats stats;
+    halide_host_device_reset_stats();
+    uint64_t hits = pool_stats.hits;
+    output = g.realize(128, 64, target);
+    halide_host_device_get_stats(&stats);
+    halide_device_pool_get_stats(NULL, interface, &pool_stats);
+    if (pool_stats.hits <= hits) {
+        printf("Expected f to reuse a pooled allocation\n");
+        return -1;
+    }
+    if (stats.device_mallocs != 1) {
+        // The new output can't reuse the allocation of the previous
+        // one, which is still alive.
+        printf("Expected one real device allocation. There were %d\n",
+               (int)stats.device_mallocs);
+        return -1;
+    }
+
+    for (int y = 0; y < output.height(); y++) {
+        for (int x = 0; x < output.width(); x++) {
+            int correct = x * 3 + y + (x + 1) * 3 + y;
+            if (output(x, y) != correct) {
+                printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    // Trimming the pool to nothing frees everything in it.
+    uint64_t pooled = pool_stats.pooled_allocations;
+    halide_device_pool_trim(NULL, interface, 0);
+    halide_host_device_get_stats(&stats);
+    halide_device_pool_get_stats(NULL, interface, &pool_stats);
+    if (pool_stats.pooled_bytes != 0 || stats.device_frees != pooled) {
+        printf("Expected the pool to be empty after trimming. %d bytes are left, and %d of %d allocations were freed\n",
+               (int)pool_stats.pooled_bytes, (int)stats.device_frees, (int)pooled);
+        return -1;
+    }
+
+    // With a limit of zero bytes, freed allocations are really freed.
+    halide_device_pool_set_limit(0);
+    halide_host_device_reset_stats();
+    output = g.realize(128, 64, target);
+    halide_host_device_get_stats(&stats);
+    halide_device_pool_get_stats(NULL, interface, &pool_stats);
+    halide_device_pool_set_limit((size_t)-1);
+    if (pool_stats.pooled_bytes != 0 || stats.device_frees < 1) {
+        printf("Expected nothing to be pooled with a limit of zero. %d bytes are pooled, and %d allocations were freed\n",
+               (int)pool_stats.pooled_bytes, (int)stats.device_frees);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,86 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the calls in the lowered code that copy f to the device, or
+// wait for copies to finish.
+int sync_copies = 0, async_copies = 0, waits = 0;
+class CountCopies : public IRMutator {
+    using IRMutator::visit;
+
+    void visit(const Call *op) {
+        const Variable *buf = op->args.empty() ? NULL : op->args[0].as<Variable>();
+        if (buf && buf->name == "f.buffer") {
+            if (op->name == "halide_copy_to_device") {
+                sync_copies++;
+            } else if (op->name == "halide_copy_to_device_async") {
+                async_copies++;
+            } else if (op->name == "halide_device_wait_for_copies") {
+                waits++;
+            }
+        }
+        IRMutator::visit(op);
+    }
+};
+
+int main(int argc, char **argv) {
+    ImageParam in(Int(32), 2);
+    Func f("f"), g("g");
+    Var x("x"), y("y"), yo("yo");
+
+    // f is computed on the host a strip at a time, and copied to the
+    // device for g to use.
+    f(x, y) = in(x, y) * 2 + 1;
+    g(x, y) = f(x, y) + f(x + 1, y);
+
+    g.split(y, yo, y, 8).gpu_tile(x, y, 16, 8);
+    f.store_root().compute_at(g, yo);
+    g.add_custom_lowering_pass(new CountCopies);
+
+    // The copies can be checked without a gpu.
+    Target target = get_jit_target_from_environment();
+    Target lowering_target = target;
+    if (!lowering_target.has_gpu_feature()) {
+        lowering_target.set_feature(Target::OpenCL);
+    }
+    lowering_target.set_feature(Target::AsyncDeviceCopies);
+    g.compile_to_lowered_stmt("gpu_async_copies.stmt", g.infer_arguments(), Text, lowering_target);
+
+    // The copy of each strip shouldn't block, but the host has to wait
+    // for it before writing the next strip, and before freeing f.
+    if (sync_copies != 0 || async_copies != 1 || waits != 2) {
+        printf("Expected 0 blocking copies, 1 async copy, and 2 waits for f. "
+               "Found %d, %d, and %d\n", sync_copies, async_copies, waits);
+        return -1;
+    }
+
+    if (!target.has_gpu_feature()) {
+        printf("No gpu target enabled. Skipping the rest of the test.\n");
+        printf("Success!\n");
+        return 0;
+    }
+
+    Image<int> input(129, 64);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = x * 3 + y * 7;
+        }
+    }
+    in.set(input);
+
+    Image<int> output = g.realize(128, 64, target.with_feature(Target::AsyncDeviceCopies));
+    for (int y = 0; y < output.height(); y++) {
+        for (int x = 0; x < output.width(); x++) {
+            int correct = input(x, y) * 2 + 1 + input(x + 1, y) * 2 + 1;
+            if (output(x, y) != correct) {
+                printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
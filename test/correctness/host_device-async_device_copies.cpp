@@ -0,0 +1,78 @@
+#include "Halide.h"
+#include "HalideRuntimeHostDevice.h"
+#include <stdio.h>
+
+#ifdef _WIN32
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+using namespace Halide;
+
+const int strip_size = 8, strips = 8;
+
+// The host device stats when the host starts computing each strip of f.
+halide_host_device_stats strip_stats[strips];
+
+extern "C" DLLEXPORT int record_strip(int x, int y) {
+    if (x == 0 && y % strip_size == 0) {
+        halide_host_device_get_stats(&strip_stats[y / strip_size]);
+    }
+    return 0;
+}
+HalideExtern_2(int, record_strip, int, int);
+
+int main(int argc, char **argv) {
+    Image<int> input(129, strip_size * strips);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = x * 3 + y * 7;
+        }
+    }
+
+    Func f("f"), g("g");
+    Var x("x"), y("y"), yo("yo");
+
+    // f is computed on the host a strip at a time, and copied to the
+    // (mock) device for g to use.
+    f(x, y) = input(x, y) * 2 + 1 + record_strip(x, y);
+    g(x, y) = f(x, y) + f(x + 1, y);
+
+    g.split(y, yo, y, strip_size).gpu_tile(x, y, 16, 8);
+    f.compute_at(g, yo);
+
+    Target target = get_host_target()
+        .with_feature(Target::HostDevice)
+        .with_feature(Target::AsyncDeviceCopies);
+    g.compile_jit(target);
+    halide_host_device_reset_stats();
+
+    Image<int> output = g.realize(128, strip_size * strips, target);
+    for (int y = 0; y < output.height(); y++) {
+        for (int x = 0; x < output.width(); x++) {
+            int correct = input(x, y) * 2 + 1 + input(x + 1, y) * 2 + 1;
+            if (output(x, y) != correct) {
+                printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    // Each strip is copied while the next one is computed, so the
+    // host shouldn't have waited for the copy of the previous strip
+    // by the time it starts the next.
+    for (int i = 1; i < strips; i++) {
+        uint64_t copies = strip_stats[i].copies_to_device - strip_stats[0].copies_to_device;
+        uint64_t waits = strip_stats[i].copy_waits - strip_stats[0].copy_waits;
+        if (copies != (uint64_t)i || waits >= copies) {
+            printf("Before computing strip %d, %d strips had been copied to the device, "
+                   "and the host had waited for copies %d times\n",
+                   i, (int)copies, (int)waits);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
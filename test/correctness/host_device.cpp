@@ -0,0 +1,94 @@
+#include "Halide.h"
+#include "HalideRuntimeHostDevice.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    ImageParam in(Int(32), 2);
+    Func f("f"), g("g");
+    Var x("x"), y("y");
+
+    // f is computed on the host, and copied to the (mock) device for
+    // g to use.
+    f(x, y) = in(x, y) * 2 + 1;
+    g(x, y) = f(x, y) + f(x + 1, y);
+
+    g.gpu_tile(x, y, 16, 8);
+    f.compute_root();
+
+    Image<int> input(129, 64);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = x * 3 + y * 7;
+        }
+    }
+    in.set(input);
+
+    // The host device works on any machine.
+    Target target = get_host_target().with_feature(Target::HostDevice);
+    g.compile_jit(target);
+    halide_host_device_reset_stats();
+
+    Image<int> output = g.realize(128, 64, target);
+    for (int y = 0; y < output.height(); y++) {
+        for (int x = 0; x < output.width(); x++) {
+            int correct = input(x, y) * 2 + 1 + input(x + 1, y) * 2 + 1;
+            if (output(x, y) != correct) {
+                printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    halide_host_device_stats stats;
+    halide_host_device_get_stats(&stats);
+    uint64_t f_bytes = 129 * 64 * sizeof(int);
+    if (stats.copies_to_device < 1 || stats.bytes_to_device < f_bytes) {
+        printf("Expected f to be copied to the device. There were %d copies of %d bytes\n",
+               (int)stats.copies_to_device, (int)stats.bytes_to_device);
+        return -1;
+    }
+    if (stats.copies_to_host != 1) {
+        printf("Expected one copy of the output to the host. There were %d\n",
+               (int)stats.copies_to_host);
+        return -1;
+    }
+
+    // Make copies slow, and check the pipeline waits for them.
+    halide_host_device_set_transfer_cost(1000000, 0);
+    halide_host_device_reset_stats();
+    g.realize(128, 64, target);
+    halide_host_device_get_stats(&stats);
+    halide_host_device_set_transfer_cost(0, 0);
+    if (stats.waits < 1 || stats.wait_ns < 1000000) {
+        printf("Expected at least 1ms waiting for copies. Waited %d times for %d ns\n",
+               (int)stats.waits, (int)stats.wait_ns);
+        return -1;
+    }
+
+    {
+        // A producer computed per block, with its own thread loops.
+        // On a real gpu the thread loops of the two stages are fused,
+        // with a barrier between them.
+        Func p("p"), h("h");
+        p(x, y) = in(x, y) * 3;
+        h(x, y) = p(x, y) + p(x + 1, y);
+        h.gpu_tile(x, y, 16, 8);
+        p.compute_at(h, Var::gpu_blocks()).gpu_threads(x, y);
+
+        Image<int> out = h.realize(128, 64, target);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                int correct = input(x, y) * 3 + input(x + 1, y) * 3;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
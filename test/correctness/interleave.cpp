@@ -397,6 +397,49 @@ int main(int argc, char **argv) {
         check_interleave_count(trans2, 1);
     }
 
+    {
+        // Test that a bounded but not unrolled channel loop over an
+        // interleaved output becomes an interleaving store.
+        Func pixel("pixel"), rgb("rgb");
+        pixel(x, y) = Tuple(cast<uint8_t>(x), cast<uint8_t>(y), cast<uint8_t>(x + y));
+        rgb(x, y, c) = select(c == 0, pixel(x, y)[0],
+                              c == 1, pixel(x, y)[1],
+                                      pixel(x, y)[2]);
+        rgb.reorder(c, x, y).bound(c, 0, 3).vectorize(x, 16);
+        rgb.output_buffer()
+            .set_min(2, 0).set_extent(2, 3)
+            .set_stride(0, 3).set_stride(2, 1);
+
+        check_interleave_count(rgb, 1);
+
+        const int width = 32, height = 8;
+        std::vector<uint8_t> storage(width * height * 3);
+        buffer_t buf = {0};
+        buf.host = &storage[0];
+        buf.extent[0] = width;
+        buf.stride[0] = 3;
+        buf.extent[1] = height;
+        buf.stride[1] = width * 3;
+        buf.extent[2] = 3;
+        buf.stride[2] = 1;
+        buf.elem_size = 1;
+        Image<uint8_t> result(&buf, "result");
+        rgb.realize(result);
+
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                uint8_t correct[] = {(uint8_t)x, (uint8_t)y, (uint8_t)(x + y)};
+                for (int c = 0; c < 3; c++) {
+                    if (result(x, y, c) != correct[c]) {
+                        printf("rgb(%d, %d, %d) = %d instead of %d\n",
+                               x, y, c, result(x, y, c), correct[c]);
+                        return -1;
+                    }
+                }
+            }
+        }
+    }
+
     printf("Success!\n");
     return 0;
 }
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "Halide.h"
+
+using namespace Halide;
+
+// The linked runtime module is cached per target, and each pipeline
+// only keeps the bodies of the runtime functions it uses. Compile
+// pipelines that use different parts of the runtime, first with one
+// target and then with another, and check they all still work.
+
+std::vector<std::string> messages;
+
+extern "C" void my_print(void *user_context, const char *message) {
+    messages.push_back(message);
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    // A different target, which needs a different runtime module.
+    Target other = t.with_feature(Target::NoAsserts);
+    if (t.has_feature(Target::NoAsserts)) {
+        other = t.without_feature(Target::NoAsserts);
+    }
+
+    Var x, y;
+
+    // Uses almost none of the runtime.
+    Func f;
+    f(x, y) = x + y;
+
+    // Uses the print and memoization parts of the runtime.
+    Param<int> offset;
+    Func g_memoized, g;
+    g_memoized(x, y) = x * y + offset;
+    g(x, y) = print_when(x == 0 && y == 0, g_memoized(x, y), "at origin");
+    g_memoized.compute_root().memoize();
+    g.set_custom_print(my_print);
+    offset.set(3);
+
+    // Uses the thread pool and the float printing parts of the runtime.
+    Func h;
+    h(x, y) = print_when(x == 1 && y == 1, cast<float>(x - y) / 2, "at one");
+    h.parallel(y);
+    h.set_custom_print(my_print);
+
+    Image<int> f_out = f.realize(16, 16, t);
+    Image<int> g_out = g.realize(16, 16, t);
+    Image<float> h_out = h.realize(16, 16, other);
+    // Again with the first target, now that the second is cached too.
+    Image<int> f_out2 = f.realize(16, 16, t);
+
+    for (int y = 0; y < 16; y++) {
+        for (int x = 0; x < 16; x++) {
+            if (f_out(x, y) != x + y || f_out2(x, y) != x + y) {
+                printf("f(%d, %d) = %d, %d instead of %d\n",
+                       x, y, f_out(x, y), f_out2(x, y), x + y);
+                return -1;
+            }
+            if (g_out(x, y) != x * y + 3) {
+                printf("g(%d, %d) = %d instead of %d\n", x, y, g_out(x, y), x * y + 3);
+                return -1;
+            }
+            float correct = (x - y) / 2.0f;
+            if (h_out(x, y) != correct) {
+                printf("h(%d, %d) = %f instead of %f\n", x, y, h_out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    if (messages.size() != 2) {
+        printf("Got %d messages instead of 2\n", (int)messages.size());
+        return -1;
+    }
+    if (messages[0] != "3 at origin\n") {
+        printf("Unexpected message from g: %s", messages[0].c_str());
+        return -1;
+    }
+    float printed = 1;
+    if (sscanf(messages[1].c_str(), "%f at one", &printed) != 1 || printed != 0) {
+        printf("Unexpected message from h: %s", messages[1].c_str());
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
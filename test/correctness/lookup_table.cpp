@@ -0,0 +1,87 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// Lookups in tables small enough to be held in a few vector registers
+// are done with shuffles (pshufb, vpermd, vtbl and tbl), and larger
+// ones with gathers on AVX2. Check them against scalar lookups, for a
+// range of table sizes, element types and vector widths.
+
+Var x("x"), y("y");
+
+template<typename T>
+int test_lookup(int table_size, int vector_width, const Target &t) {
+    Image<uint8_t> input(256, 16);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = (uint8_t)(rand() & 0xff);
+        }
+    }
+
+    Func table("table"), vec("vec"), scalar("scalar");
+    table(x) = cast<T>(x * 7 - 20);
+    // The index is known to be in [0, table_size) when compiling.
+    vec(x, y) = table(cast<int>(input(x, y)) % table_size);
+    scalar(x, y) = table(cast<int>(input(x, y)) % table_size);
+
+    table.compute_root();
+    vec.vectorize(x, vector_width);
+
+    Image<T> correct = scalar.realize(input.width(), input.height(), t);
+    Image<T> result = vec.realize(input.width(), input.height(), t);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            if (result(x, y) != correct(x, y)) {
+                printf("Lookup in a table of %d elements of type %s, vectorized %d wide, for %s:\n"
+                       "result(%d, %d) = %f instead of %f\n",
+                       table_size, type_of<T>() == Float(32) ? "float" : "int",
+                       vector_width, t.to_string().c_str(),
+                       x, y, (double)result(x, y), (double)correct(x, y));
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int test_all(const Target &t) {
+    for (int table_size = 16; table_size <= 64; table_size *= 2) {
+        for (int w = 8; w <= 32; w *= 2) {
+            if (test_lookup<uint8_t>(table_size, w, t) ||
+                test_lookup<int8_t>(table_size, w, t) ||
+                test_lookup<uint16_t>(table_size, w, t) ||
+                test_lookup<int32_t>(table_size, w, t) ||
+                test_lookup<float>(table_size, w, t)) {
+                return -1;
+            }
+        }
+    }
+    // Tables of eight 32-bit elements, and tables too large for
+    // shuffles.
+    for (int table_size = 8; table_size <= 256; table_size *= 32) {
+        if (test_lookup<int32_t>(table_size, 8, t) ||
+            test_lookup<float>(table_size, 16, t)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (test_all(t)) {
+        return -1;
+    }
+
+    if (t.arch == Target::X86 && t.has_feature(Target::AVX2)) {
+        // Also check the SSE paths.
+        Target sse = t.without_feature(Target::AVX2).without_feature(Target::AVX);
+        if (test_all(sse)) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
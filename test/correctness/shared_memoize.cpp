@@ -0,0 +1,111 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "Halide.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+
+using namespace Halide;
+
+#ifdef _MSC_VER
+#define DLLEXPORT __declspec(dllexport)
+#else
+#define DLLEXPORT
+#endif
+
+int call_count = 0;
+
+extern "C" DLLEXPORT int count_calls(uint8_t val, buffer_t *out) {
+    if (out->host) {
+        call_count++;
+        for (int32_t i = 0; i < out->extent[0]; i++) {
+            for (int32_t j = 0; j < out->extent[1]; j++) {
+                out->host[i * out->stride[0] + j * out->stride[1]] = val;
+            }
+        }
+    }
+    return 0;
+}
+
+#if defined(__linux__) || defined(__APPLE__)
+void remove_segment(const char *name) {
+#ifdef __linux__
+    // The runtime opens the segment in /dev/shm directly.
+    char path[128];
+    snprintf(path, sizeof(path), "/dev/shm%s", name);
+    unlink(path);
+#else
+    shm_unlink(name);
+#endif
+}
+#endif
+
+// Realize a memoized Func, returning the number of times it was
+// actually computed, or -1 if the result is wrong.
+int run(uint8_t val) {
+    Target t = get_jit_target_from_environment().with_feature(Target::SharedMemoizationCache);
+
+    Param<uint8_t> p;
+    Func count_calls_fn;
+    count_calls_fn.define_extern("count_calls", {p}, UInt(8), 2);
+
+    Var x, y;
+    Func f;
+    f(x, y) = count_calls_fn(x, y) + count_calls_fn(x, y);
+    count_calls_fn.compute_root().memoize();
+
+    p.set(val);
+    call_count = 0;
+    for (int i = 0; i < 3; i++) {
+        Image<uint8_t> result = f.realize(10, 10, t);
+        for (int y = 0; y < 10; y++) {
+            for (int x = 0; x < 10; x++) {
+                if (result(x, y) != (uint8_t)(val * 2)) {
+                    printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), val * 2);
+                    return -1;
+                }
+            }
+        }
+    }
+    return call_count;
+}
+
+int main(int argc, char **argv) {
+#if defined(__linux__) || defined(__APPLE__)
+    // Use a segment private to this test.
+    char name[64];
+    snprintf(name, sizeof(name), "/halide_shared_memoize_test_%d", (int)getpid());
+    setenv("HL_SHARED_CACHE_NAME", name, 1);
+
+    // Compute the result in a child process, which leaves it in the
+    // shared cache when it exits.
+    pid_t child = fork();
+    if (child == 0) {
+        exit(run(17) == 1 ? 0 : 1);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        printf("Child process failed to compute memoized result\n");
+        remove_segment(name);
+        return -1;
+    }
+
+    // This process should find it there.
+    int calls = run(17);
+    remove_segment(name);
+    if (calls != 0) {
+        printf("Memoized Func was computed %d times in the second process instead of 0\n", calls);
+        return -1;
+    }
+#else
+    printf("The shared memoization cache is only supported on Linux and OS X\n");
+#endif
+
+    printf("Success!\n");
+    return 0;
+}
@@ -26,7 +26,9 @@ Target target;
 int num_processes = 16;
 int my_process_id = 0;
 
-void check(string op, int vector_width, Expr e) {
+// Make a name for a test of op, or return an empty string if this
+// process shouldn't run it.
+string test_name(string op) {
     static int counter = 0;
     counter++;
 
@@ -40,23 +42,15 @@ void check(string op, int vector_width, Expr e) {
     // Bail out after generating the unique_name, so that names are
     // unique across different processes and don't depend on filter
     // settings.
-    if ((!filter.empty()) && (op.find(filter) == string::npos)) return;
-    if (counter % num_processes != my_process_id) return;
-
-    const int W = 256*3, H = 100;
-
-    // Define a vectorized Func that uses the pattern.
-    Func f(name);
-    f(x, y) = e;
-    f.bound(x, 0, W).vectorize(x, vector_width);
-    f.compute_root();
-
-    // Include a scalar version
-    Func f_scalar("scalar_" + name);
-    f_scalar(x, y) = e;
-    f_scalar.bound(x, 0, W);
-    f_scalar.compute_root();
+    if ((!filter.empty()) && (op.find(filter) == string::npos)) return "";
+    if (counter % num_processes != my_process_id) return "";
+    return name;
+}
 
+// Check that the vectorized Func f uses op, and compile a pipeline
+// that measures how far it is from the scalar version over a W x H
+// domain.
+void check_funcs(string op, string name, Func f, Func f_scalar, int W, int H) {
     // The output to the pipeline is the maximum absolute difference as a double.
     RDom r(0, W, 0, H);
     Func error("error_" + name);
@@ -109,6 +103,56 @@ void check(string op, int vector_width, Expr e) {
 
 }
 
+void check(string op, int vector_width, Expr e) {
+    string name = test_name(op);
+    if (name.empty()) return;
+
+    const int W = 256*3, H = 100;
+
+    // Define a vectorized Func that uses the pattern.
+    Func f(name);
+    f(x, y) = e;
+    f.bound(x, 0, W).vectorize(x, vector_width);
+    f.compute_root();
+
+    // Include a scalar version
+    Func f_scalar("scalar_" + name);
+    f_scalar(x, y) = e;
+    f_scalar.bound(x, 0, W);
+    f_scalar.compute_root();
+
+    check_funcs(op, name, f, f_scalar, W, H);
+}
+
+// Check a sum of e over runs of consecutive values of x, vectorized
+// across the run. This is how horizontal ops like multiply-add get
+// used.
+void check_sum(string op, int vector_width, Expr e) {
+    string name = test_name(op);
+    if (name.empty()) return;
+
+    // The inputs are 4096 wide, so only a few sums fit.
+    const int W = 16, H = 100;
+    const int run = vector_width * 4;
+    RDom r(0, run);
+    Expr term = Internal::substitute(x.name(), x * run + r, e);
+
+    Func f(name);
+    f(x, y) = cast(e.type(), 0);
+    f(x, y) += term;
+    f.bound(x, 0, W);
+    f.update().atomic().vectorize(r, vector_width);
+    f.compute_root();
+
+    Func f_scalar("scalar_" + name);
+    f_scalar(x, y) = cast(e.type(), 0);
+    f_scalar(x, y) += term;
+    f_scalar.bound(x, 0, W);
+    f_scalar.compute_root();
+
+    check_funcs(op, name, f, f_scalar, W, H);
+}
+
 Expr i64(Expr e) {
     return cast(Int(64), e);
 }
@@ -347,6 +391,34 @@ void check_sse_all() {
         check("pmaddwd", 8, i32(i16_1) * 3 + i32(i16_2) * 4);
     }
 
+    // Dot products add pairs of products with pmaddwd, and with
+    // pmaddubsw if the 16-bit sums of pairs can't overflow.
+    for (int w = 2; w <= 4; w *= 2) {
+        check_sum("pmaddwd", 4*w, i32(i16_1) * i16_2);
+        check_sum("pmaddwd", 4*w, i32(u8_1) * u8_2);
+        check_sum("pmaddwd", 4*w, i32(i8_1) * 5);
+    }
+    if (use_ssse3) {
+        check_sum("pmaddubsw", 16, i16(u8_1) * 3);
+        check_sum("pmaddubsw", 16, i16(u8_1) * -7);
+    }
+    if (use_avx2) {
+        check_sum("vpmaddwd", 16, i32(i16_1) * i16_2);
+        check_sum("vpmaddubsw", 32, i16(u8_1) * 3);
+    }
+
+    // Sums of bytes widened by a factor of eight add groups of eight
+    // bytes with psadbw. Other widening sums add pairs of lanes with
+    // phaddw or phaddd.
+    check_sum("psadbw", 16, u64(u8_1));
+    if (use_sse41) {
+        check_sum("phaddw", 16, u16(u8_1));
+        check_sum("phaddd", 8, i32(i16_1));
+    }
+    if (use_avx2) {
+        check_sum("vpsadbw", 32, u64(u8_1));
+    }
+
     // llvm doesn't distinguish between signed and unsigned multiplies
     //check("pmuldq", 4, i64(i32_1) * i64(i32_2));
 
@@ -380,6 +452,20 @@ void check_sse_all() {
             check("pcmpeqq", w, select(i64_1 == i64_2, i64(1), i64(2)));
             check("packusdw", 4*w, u16(clamp(i32_1, 0, max_u16)));
         }
+
+        // Lookups in small tables are done with pshufb, one per
+        // sixteen bytes of table.
+        check("pshufb", 16, in_u8(i32(u8_1) % 16));
+        check("pshufb", 16, in_u8(i32(u8_1) % 32));
+        check("pshufb", 8, in_u16(i32(u8_1) % 16));
+    }
+
+    if (use_avx2) {
+        // Tables of eight 32-bit elements use vpermd, and larger
+        // ones gathers.
+        check("vpermd", 8, in_i32(i32(u8_1) % 8));
+        check("vpermps", 8, in_f32(i32(u8_1) % 8));
+        check("vpgatherdd", 8, in_i32(i32(u8_1)));
     }
 
     // SSE 4.2
@@ -943,11 +1029,31 @@ void check_neon_all() {
         // check("vorr", bool1 | bool2);
 
         // VPADAL   I       -       Pairwise Add and Accumulate Long
-        // VPADD    I, F    -       Pairwise Add
         // VPADDL   I       -       Pairwise Add Long
+        // Sums of widened vectors accumulate pairs of lanes.
+        check_sum(arm32 ? "vpadal.u8"  : "uadalp", 8*w, u16(u8_1));
+        check_sum(arm32 ? "vpadal.s8"  : "sadalp", 8*w, i16(i8_1));
+        check_sum(arm32 ? "vpadal.u16" : "uadalp", 4*w, u32(u16_1));
+        check_sum(arm32 ? "vpadal.s16" : "sadalp", 4*w, i32(i16_1));
+
+        // Sums that widen by more than a factor of two can't
+        // accumulate in the pairwise sums.
+        check_sum(arm32 ? "vpaddl.u8"  : "uaddlp", 8*w, u32(u8_1));
+        check_sum(arm32 ? "vpaddl.s8"  : "saddlp", 8*w, i32(i8_1));
+        check_sum(arm32 ? "vpaddl.u16" : "uaddlp", 4*w, u64(u16_1));
+
+        // So do sums of products of narrow vectors, after a widening
+        // multiply.
+        check_sum(arm32 ? "vmull.u8"   : "umull",  8*w, u32(u8_1) * u8_2);
+        check_sum(arm32 ? "vpadal.u16" : "uadalp", 8*w, u32(u8_1) * u8_2);
+        check_sum(arm32 ? "vmull.s8"   : "smull",  8*w, i32(i8_1) * i8_2);
+        check_sum(arm32 ? "vpadal.s16" : "sadalp", 8*w, i32(i8_1) * i8_2);
+        check_sum(arm32 ? "vpadal.s16" : "sadalp", 8*w, i32(u8_1) * i8_2);
+
+        // VPADD    I, F    -       Pairwise Add
         // VPMAX    I, F    -       Pairwise Maximum
         // VPMIN    I, F    -       Pairwise Minimum
-        // We don't do horizontal ops
+        // We don't do other horizontal ops
 
         // VPOP     X       F, D    Pop from Stack
         // VPUSH    X       F, D    Push to Stack
@@ -1265,7 +1371,17 @@ void check_neon_all() {
 
     // VTBL	X	-	Table Lookup
     // Arm's version of shufps. Allows for arbitrary permutations of a
-    // 64-bit vector. We typically use vrev variants instead.
+    // 64-bit vector. We typically use vrev variants instead, but use
+    // it for lookups in small tables. On aarch64, tbl looks up tables
+    // of up to four 128-bit registers.
+    for (int w = 1; w <= 2; w++) {
+        check(arm32 ? "vtbl" : "tbl", 8*w, in_u8(i32(u8_1) % 8));
+        check(arm32 ? "vtbl" : "tbl", 8*w, in_u8(i32(u8_1) % 32));
+        check(arm32 ? "vtbl" : "tbl", 4*w, in_u16(i32(u8_1) % 16));
+    }
+    if (!arm32) {
+        check("tbl", 16, in_u8(i32(u8_1) % 64));
+    }
 
     // VTBX	X	-	Table Extension
     // Like vtbl, but doesn't change any elements where the index was
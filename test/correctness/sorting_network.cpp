@@ -0,0 +1,73 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 64, H = 16;
+    Image<int> input(W + 8, H + 8);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = (rand() & 0xff) - 128;
+        }
+    }
+
+    Var x("x"), y("y");
+
+    // Check each statistic of windows of a variety of sizes, including
+    // ones that aren't powers of two, against std::sort.
+    const int sizes[][2] = {{1, 1}, {2, 1}, {3, 1}, {3, 3}, {5, 1}, {4, 3}, {5, 5}, {7, 2}};
+    for (const auto &size : sizes) {
+        const int w = size[0], h = size[1], n = w * h;
+        RDom r(0, w, 0, h);
+        Expr value = input(x + r.x, y + r.y);
+
+        Func sorted_f("sorted_f"), smallest("smallest"), largest("largest"), median_f("median_f");
+        sorted_f(x, y) = sorted(value);
+        smallest(x, y) = kth_smallest(value, 0);
+        largest(x, y) = kth_smallest(r, value, n - 1);
+        median_f(x, y) = median(value);
+        median_f.vectorize(x, 8);
+        smallest.vectorize(x, 8);
+
+        Realization all = sorted_f.realize(W, H);
+        Image<int> smallest_result = smallest.realize(W, H);
+        Image<int> largest_result = largest.realize(W, H);
+        Image<int> median_result = median_f.realize(W, H);
+
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                std::vector<int> window;
+                for (int j = 0; j < h; j++) {
+                    for (int i = 0; i < w; i++) {
+                        window.push_back(input(x + i, y + j));
+                    }
+                }
+                std::sort(window.begin(), window.end());
+
+                for (int k = 0; k < n; k++) {
+                    Image<int> im = all[k];
+                    if (im(x, y) != window[k]) {
+                        printf("%dx%d: sorted value %d at (%d, %d) = %d instead of %d\n",
+                               w, h, k, x, y, im(x, y), window[k]);
+                        return -1;
+                    }
+                }
+                if (smallest_result(x, y) != window[0] ||
+                    largest_result(x, y) != window[n - 1] ||
+                    median_result(x, y) != window[(n - 1) / 2]) {
+                    printf("%dx%d: smallest, largest, median at (%d, %d) = %d, %d, %d "
+                           "instead of %d, %d, %d\n", w, h, x, y,
+                           smallest_result(x, y), largest_result(x, y), median_result(x, y),
+                           window[0], window[n - 1], window[(n - 1) / 2]);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,176 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <algorithm>
+
+using namespace Halide;
+
+const int W = 37, H = 45;
+
+// A separable 3x3 blur with a boundary condition in x only.
+Func blur(Func in, Var x, Var y) {
+    Func clamped, blur_x, blur_y;
+    clamped(x, y) = in(clamp(x, 0, W - 1), y);
+    blur_x(x, y) = clamped(x - 1, y) + clamped(x, y) * 2 + clamped(x + 1, y);
+    blur_y(x, y) = blur_x(x, y - 1) + blur_x(x, y) * 2 + blur_x(x, y + 1);
+    blur_x.store_root().compute_at(blur_y, y);
+    return blur_y;
+}
+
+// Stream the input through a StripStreamer in chunks of a size
+// unrelated to the strip height, and check each strip of output.
+bool stream(StripStreamer &streamer, Image<uint16_t> input, Image<uint16_t> correct,
+            int strip_height) {
+    int rows_checked = 0;
+    int pushed = 0;
+    bool input_done = false;
+    while (true) {
+        if (pushed < H) {
+            int rows = std::min(5, H - pushed);
+            Buffer chunk(UInt(16), W, rows);
+            Image<uint16_t> c(chunk);
+            for (int yi = 0; yi < rows; yi++) {
+                for (int xi = 0; xi < W; xi++) {
+                    c(xi, yi) = input(xi, pushed + yi);
+                }
+            }
+            streamer.push_rows(chunk);
+            pushed += rows;
+        } else if (!input_done) {
+            streamer.end_of_input();
+            input_done = true;
+        } else {
+            break;
+        }
+
+        for (Buffer strip = streamer.next_strip(); strip.defined();
+             strip = streamer.next_strip()) {
+            if (strip.min(1) != rows_checked) {
+                printf("Strip starts at row %d instead of row %d\n",
+                       strip.min(1), rows_checked);
+                return false;
+            }
+            Image<uint16_t> s(strip);
+            for (int yi = strip.min(1); yi < strip.min(1) + strip.extent(1); yi++) {
+                for (int xi = 0; xi < W; xi++) {
+                    if (s(xi, yi) != correct(xi, yi)) {
+                        printf("output(%d, %d) = %d instead of %d\n",
+                               xi, yi, s(xi, yi), correct(xi, yi));
+                        return false;
+                    }
+                }
+            }
+            rows_checked += strip.extent(1);
+        }
+
+        // A strip can only be produced once the rows below it have arrived.
+        int max_rows = input_done ? H : ((pushed - streamer.rows_below()) / strip_height) * strip_height;
+        if (rows_checked > max_rows) {
+            printf("Produced %d rows of output from %d rows of input\n", rows_checked, pushed);
+            return false;
+        }
+    }
+
+    if (rows_checked != H) {
+        printf("Produced %d rows of output instead of %d\n", rows_checked, H);
+        return false;
+    }
+    return true;
+}
+
+// A vertical blur, which has a halo of a row above and below.
+Func blur_y(Func in, Var x, Var y) {
+    Func b;
+    b(x, y) = in(x, y - 1) + in(x, y) * 2 + in(x, y + 1);
+    return b;
+}
+
+// The number of values stored to the output of the first stage of a
+// chain.
+int first_stage_stores = 0;
+int count_stores(void *user_context, const halide_trace_event *e) {
+    if (e->event == halide_trace_store) {
+        first_stage_stores += e->vector_width;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Image<uint16_t> input(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            input(x, y) = (uint16_t)(rand() & 0xff);
+        }
+    }
+
+    Var x, y;
+    const int strip_height = 8;
+
+    {
+        // The reference computes the whole image at once, repeating the
+        // edge rows.
+        Func edge;
+        edge(x, y) = input(x, clamp(y, 0, H - 1));
+        Image<uint16_t> correct = blur(edge, x, y).realize(W, H);
+
+        ImageParam in(UInt(16), 2);
+        Func in_f;
+        in_f(x, y) = in(x, y);
+        Func streamed = blur(in_f, x, y);
+
+        StripStreamer streamer(Pipeline(streamed), in, W, strip_height);
+
+        if (streamer.rows_above() != 1 || streamer.rows_below() != 1) {
+            printf("Expected a halo of one row above and below, got %d and %d\n",
+                   streamer.rows_above(), streamer.rows_below());
+            return -1;
+        }
+
+        if (!stream(streamer, input, correct, strip_height)) {
+            return -1;
+        }
+    }
+
+    {
+        // Two vertical blurs, streamed as a chain so that the rows of
+        // the first are computed once. The edge rows of each stage's
+        // output are repeated.
+        Func edge1, edge2;
+        edge1(x, y) = input(x, clamp(y, 0, H - 1));
+        Image<uint16_t> first = blur_y(edge1, x, y).realize(W, H);
+        edge2(x, y) = first(x, clamp(y, 0, H - 1));
+        Image<uint16_t> correct = blur_y(edge2, x, y).realize(W, H);
+
+        ImageParam in1(UInt(16), 2), in2(UInt(16), 2);
+        Func in1_f, in2_f;
+        in1_f(x, y) = in1(x, y);
+        in2_f(x, y) = in2(x, y);
+        Func stage1 = blur_y(in1_f, x, y);
+        Func stage2 = blur_y(in2_f, x, y);
+        stage1.trace_stores();
+        Pipeline p1(stage1), p2(stage2);
+        p1.set_custom_trace(&count_stores);
+
+        StripStreamer streamer({p1, p2}, {in1, in2}, W, strip_height);
+        if (streamer.rows_above() != 2 || streamer.rows_below() != 2) {
+            printf("Expected a halo of two rows above and below, got %d and %d\n",
+                   streamer.rows_above(), streamer.rows_below());
+            return -1;
+        }
+
+        if (!stream(streamer, input, correct, strip_height)) {
+            return -1;
+        }
+
+        // Each strip of the first stage is computed once. Only the
+        // last one goes past the bottom of the image.
+        int strips = (H + strip_height - 1) / strip_height;
+        if (first_stage_stores != W * strips * strip_height) {
+            printf("The first stage stored %d values instead of %d\n",
+                   first_stage_stores, W * strips * strip_height);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
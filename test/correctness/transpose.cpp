@@ -0,0 +1,107 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the vector loads and stores that aren't dense.
+class CountStridedAccesses : public IRVisitor {
+public:
+    int result;
+    CountStridedAccesses() : result(0) {}
+
+    using IRVisitor::visit;
+
+    void check(Expr index) {
+        const Ramp *r = index.as<Ramp>();
+        if (index.type().is_vector() && !(r && is_one(r->stride))) {
+            result++;
+        }
+    }
+
+    void visit(const Load *op) {
+        check(op->index);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Store *op) {
+        check(op->index);
+        IRVisitor::visit(op);
+    }
+};
+
+enum Mode {
+    // out(x, y) = in(y, x), vectorized along x. The loads are strided.
+    TransposeLoads,
+    // The same, vectorized along y. The stores are strided.
+    TransposeStores,
+    // A rotation by 90 degrees, vectorized along x.
+    Rotate
+};
+
+template<typename T>
+bool test(Mode mode, int tile) {
+    const int W = 128, H = 96;
+    Image<T> in(H, W);
+    for (int y = 0; y < W; y++) {
+        for (int x = 0; x < H; x++) {
+            in(x, y) = (T)rand();
+        }
+    }
+
+    Func out("out");
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+    if (mode == Rotate) {
+        out(x, y) = in(y, W - 1 - x);
+    } else {
+        out(x, y) = in(y, x);
+    }
+    out.tile(x, y, xi, yi, tile, tile);
+    if (mode == TransposeStores) {
+        out.reorder(yi, xi).vectorize(yi).unroll(xi);
+    } else {
+        out.vectorize(xi).unroll(yi);
+    }
+
+    // Check the transpose happened in registers.
+    Target t = get_jit_target_from_environment();
+    t.set_feature(Target::NoAsserts);
+    t.set_feature(Target::NoBoundsQuery);
+    Stmt s = lower({out.function()}, out.name(), t);
+    CountStridedAccesses count;
+    s.accept(&count);
+    if (count.result != 0) {
+        printf("There were %d strided vector loads or stores for %d-bit %dx%d tiles (mode %d):\n",
+               count.result, (int)sizeof(T)*8, tile, tile, (int)mode);
+        std::cout << s << "\n";
+        return false;
+    }
+
+    Image<T> result = out.realize(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            T correct = mode == Rotate ? in(y, W - 1 - x) : in(y, x);
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %d instead of %d for %d-bit %dx%d tiles (mode %d)\n",
+                       x, y, (int)result(x, y), (int)correct, (int)sizeof(T)*8, tile, tile, (int)mode);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    for (Mode mode : {TransposeLoads, TransposeStores, Rotate}) {
+        for (int tile : {4, 8, 16}) {
+            if (!test<uint8_t>(mode, tile) ||
+                !test<uint16_t>(mode, tile) ||
+                !test<uint32_t>(mode, tile)) {
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,120 @@
+#include <stdio.h>
+#include <algorithm>
+#include "Halide.h"
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    const int W = 256, H = 64;
+
+    Image<uint8_t> a(W, H), b(W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            a(x, y) = (uint8_t)(rand() & 0xff);
+            b(x, y) = (uint8_t)(rand() & 0xff);
+        }
+    }
+
+    Var x, y;
+    RDom r(0, W);
+
+    // Dot products of the rows of a and b. Vectorizing the atomic
+    // update across r sums a vector of products at a time.
+    {
+        Func dot("dot");
+        dot(y) = 0;
+        dot(y) += cast<int>(a(r, y)) * cast<int>(b(r, y));
+        dot.update().atomic().vectorize(r, 16);
+
+        Image<int> result = dot.realize(H);
+        for (int j = 0; j < H; j++) {
+            int correct = 0;
+            for (int i = 0; i < W; i++) {
+                correct += a(i, j) * b(i, j);
+            }
+            if (result(j) != correct) {
+                printf("dot(%d) = %d instead of %d\n", j, result(j), correct);
+                return -1;
+            }
+        }
+    }
+
+    // Sums of the rows of a, which widen from 8 to 16 or 32 bits.
+    {
+        Func sum16("sum16"), sum32("sum32");
+        sum16(y) = cast<uint16_t>(0);
+        sum16(y) += cast<uint16_t>(a(r, y));
+        sum16.update().atomic().vectorize(r, 32);
+        sum32(y) = cast<uint32_t>(0);
+        sum32(y) += cast<uint32_t>(a(r, y));
+        sum32.update().atomic().vectorize(r, 16).parallel(y);
+
+        Image<uint16_t> result16 = sum16.realize(H);
+        Image<uint32_t> result32 = sum32.realize(H);
+        for (int j = 0; j < H; j++) {
+            uint32_t correct = 0;
+            for (int i = 0; i < W; i++) {
+                correct += a(i, j);
+            }
+            if (result16(j) != correct || result32(j) != correct) {
+                printf("sum(%d) = %d, %d instead of %d\n", j, result16(j), result32(j), correct);
+                return -1;
+            }
+        }
+    }
+
+    // The min and max of the whole of b, and a float sum of it, with
+    // the rows processed in parallel. The values are small integers,
+    // so the sum is exact in any order.
+    {
+        RDom r2(0, W, 0, H);
+        Func lo("lo"), hi("hi"), total("total");
+        lo(x) = cast<int16_t>(1000);
+        lo(x) = min(lo(x), cast<int16_t>(b(r2.x, r2.y)));
+        lo.update().atomic().vectorize(r2.x, 8).parallel(r2.y);
+        hi(x) = cast<int16_t>(-1000);
+        hi(x) = max(hi(x), cast<int16_t>(b(r2.x, r2.y)));
+        hi.update().atomic().vectorize(r2.x, 8).parallel(r2.y);
+        total(x) = 0.0f;
+        total(x) += cast<float>(b(r2.x, r2.y));
+        total.update().atomic().vectorize(r2.x, 8).parallel(r2.y);
+
+        Image<int16_t> lo_result = lo.realize(1);
+        Image<int16_t> hi_result = hi.realize(1);
+        Image<float> total_result = total.realize(1);
+        int lo_correct = 1000, hi_correct = -1000;
+        float total_correct = 0.0f;
+        for (int j = 0; j < H; j++) {
+            for (int i = 0; i < W; i++) {
+                lo_correct = std::min(lo_correct, (int)b(i, j));
+                hi_correct = std::max(hi_correct, (int)b(i, j));
+                total_correct += b(i, j);
+            }
+        }
+        if (lo_result(0) != lo_correct || hi_result(0) != hi_correct ||
+            total_result(0) != total_correct) {
+            printf("min, max, sum = %d, %d, %f instead of %d, %d, %f\n",
+                   lo_result(0), hi_result(0), total_result(0),
+                   lo_correct, hi_correct, total_correct);
+            return -1;
+        }
+    }
+
+    // An update whose value doesn't depend on the vectorized RVar
+    // (once simplified) still happens once per value of it.
+    {
+        Func count("count");
+        count(x) = 0;
+        count(x) += select(r >= 0, 1, 0);
+        count.update().atomic().vectorize(r, 8);
+
+        Image<int> result = count.realize(1);
+        if (result(0) != W) {
+            printf("count = %d instead of %d\n", result(0), W);
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
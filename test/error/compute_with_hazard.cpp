@@ -0,0 +1,26 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    ImageParam in(Int(32), 2);
+    Var x("x"), y("y");
+
+    // The realization order is a, b, c. Fusing c into the loop nest
+    // of a would compute c before b, which c uses.
+    Func a("a"), b("b"), c("c"), out("out");
+    a(x, y) = in(x, y) + 1;
+    b(x, y) = in(x, y) * 2;
+    c(x, y) = b(x, y) + 3;
+    out(x, y) = a(x, y) + b(x, y) + c(x, y);
+
+    a.compute_root();
+    b.compute_root();
+    c.compute_root().compute_with(a, y);
+
+    out.compile_jit();
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "HalideRuntime.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "multitarget.h"
+#include "static_image.h"
+
+// The variants compiled into multitarget.o, which can also be called
+// directly.
+extern "C" int multitarget_sse41_avx_avx2_fma_f16c(buffer_t *input, buffer_t *output);
+extern "C" int multitarget_sse41(buffer_t *input, buffer_t *output);
+extern "C" int multitarget_generic(buffer_t *input, buffer_t *output);
+
+const int kSize = 64;
+
+void verify(const Image<uint16_t> &input, const Image<uint16_t> &output) {
+    for (int y = 0; y < kSize; y++) {
+        for (int x = 0; x < kSize; x++) {
+            uint16_t expected = input(x, y) * 3 + 7;
+            if (output(x, y) != expected) {
+                printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), expected);
+                exit(-1);
+            }
+        }
+    }
+}
+
+void clear(Image<uint16_t> &output) {
+    for (int y = 0; y < kSize; y++) {
+        for (int x = 0; x < kSize; x++) {
+            output(x, y) = 0;
+        }
+    }
+}
+
+void check_result(int result) {
+    if (result != 0) {
+        fprintf(stderr, "Result: %d\n", result);
+        exit(-1);
+    }
+}
+
+int main(int argc, char **argv) {
+    Image<uint16_t> input(kSize, kSize), output(kSize, kSize);
+    for (int y = 0; y < kSize; y++) {
+        for (int x = 0; x < kSize; x++) {
+            input(x, y) = (uint16_t)(x * y + x);
+        }
+    }
+
+    // The dispatcher picks whichever variant this machine can run.
+    check_result(multitarget(input, output));
+    verify(input, output);
+
+    // So does the argv entrypoint.
+    buffer_t arg0 = *input, arg1 = *output;
+    void *args[2] = { &arg0, &arg1 };
+    check_result(multitarget_argv(args));
+    verify(input, output);
+
+    // Call each variant the host supports directly.
+    bool avx2 = halide_can_use_cpu_features(halide_cpu_feature_sse41 | halide_cpu_feature_avx |
+                                            halide_cpu_feature_avx2 | halide_cpu_feature_fma |
+                                            halide_cpu_feature_f16c);
+    bool sse41 = halide_can_use_cpu_features(halide_cpu_feature_sse41);
+    printf("avx2 variant usable: %d, sse41 variant usable: %d\n", avx2, sse41);
+    if (!halide_can_use_cpu_features(0)) {
+        printf("The generic variant should always be usable\n");
+        return -1;
+    }
+    if (avx2) {
+        clear(output);
+        check_result(multitarget_sse41_avx_avx2_fma_f16c(input, output));
+        verify(input, output);
+    }
+    if (sse41) {
+        clear(output);
+        check_result(multitarget_sse41(input, output));
+        verify(input, output);
+    }
+    clear(output);
+    check_result(multitarget_generic(input, output));
+    verify(input, output);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,22 @@
+#include "Halide.h"
+
+namespace {
+
+class MultiTarget : public Halide::Generator<MultiTarget> {
+public:
+    ImageParam input{ UInt(16), 2, "input" };
+
+    Func build() {
+        Var x, y;
+        Func f("f");
+
+        f(x, y) = input(x, y) * 3 + 7;
+        f.vectorize(x, natural_vector_size<uint16_t>());
+
+        return f;
+    }
+};
+
+Halide::RegisterGenerator<MultiTarget> register_multitarget{"multitarget"};
+
+}  // namespace
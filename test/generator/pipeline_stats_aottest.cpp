@@ -0,0 +1,93 @@
+#include "HalideRuntime.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pipeline_stats.h"
+#include "static_image.h"
+
+extern "C" void halide_error(void *user_context, const char *msg) {
+    // Silently drop the expected errors.
+}
+
+void check(bool condition, const char *msg) {
+    if (!condition) {
+        printf("%s\n", msg);
+        exit(-1);
+    }
+}
+
+int get_stats(void *enumerate_context, const halide_pipeline_stats_t *stats) {
+    if (strcmp(stats->name, "pipeline_stats") == 0) {
+        *(halide_pipeline_stats_t *)enumerate_context = *stats;
+    }
+    return 0;
+}
+
+halide_pipeline_stats_t snapshot(bool reset) {
+    halide_pipeline_stats_t stats;
+    memset(&stats, 0, sizeof(stats));
+    int result = halide_enumerate_pipeline_stats(NULL, &stats, get_stats, reset);
+    check(result == 0, "halide_enumerate_pipeline_stats failed");
+    return stats;
+}
+
+int main(int argc, char **argv) {
+    const int W = 64, H = 32;
+    Image<int32_t> in(W, H), out(W, H);
+
+    // Nothing has been called yet.
+    halide_pipeline_stats_t stats = snapshot(false);
+    check(stats.calls == 0, "Stats exist before the first call");
+
+    const int runs = 10;
+    for (int i = 0; i < runs; i++) {
+        check(pipeline_stats(in, W, out) == 0, "pipeline_stats failed");
+    }
+    // An error.
+    check(pipeline_stats(in, W / 2, out) != 0, "pipeline_stats should have failed");
+
+    // A bounds query isn't counted.
+    buffer_t query = {0};
+    query.elem_size = 4;
+    query.extent[0] = W;
+    query.extent[1] = H;
+    check(pipeline_stats(&query, W, out) == 0, "Bounds query failed");
+
+    stats = snapshot(false);
+    check(stats.calls == runs + 1, "Wrong number of calls");
+    check(stats.errors == 1, "Wrong number of errors");
+    check(stats.output_bytes == (uint64_t)runs * W * H * 4, "Wrong number of bytes output");
+    check(stats.max_time_ns > 0 && stats.total_time_ns >= stats.max_time_ns, "Bad times");
+
+    uint64_t histogram_calls = 0;
+    for (int i = 0; i < HALIDE_PIPELINE_STATS_BUCKETS; i++) {
+        histogram_calls += stats.histogram[i];
+        check(halide_pipeline_stats_bucket_time_ns(i) < halide_pipeline_stats_bucket_time_ns(i + 1),
+              "Histogram buckets aren't increasing");
+    }
+    check(histogram_calls == stats.calls, "Histogram doesn't add up");
+
+    uint64_t p50 = halide_pipeline_stats_percentile_ns(&stats, 50);
+    uint64_t p99 = halide_pipeline_stats_percentile_ns(&stats, 99);
+    check(p50 > 0 && p50 <= p99 && p99 <= stats.max_time_ns, "Bad percentiles");
+
+    // Taking a snapshot with reset zeroes the statistics, but the
+    // snapshot itself has them.
+    stats = snapshot(true);
+    check(stats.calls == runs + 1, "Reset lost the calls");
+    stats = snapshot(false);
+    check(stats.calls == 0 && stats.errors == 0 && stats.output_bytes == 0, "Reset didn't zero the stats");
+
+    check(pipeline_stats(in, W, out) == 0, "pipeline_stats failed");
+    stats = snapshot(false);
+    check(stats.calls == 1, "Calls weren't counted after a reset");
+
+    halide_pipeline_stats_reset();
+    stats = snapshot(false);
+    check(stats.calls == 0, "halide_pipeline_stats_reset didn't zero the stats");
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,24 @@
+#include "Halide.h"
+
+namespace {
+
+class PipelineStats : public Halide::Generator<PipelineStats> {
+public:
+    ImageParam input{ Int(32), 2, "input" };
+    Param<int> width{"width", 1, 0, 64};
+
+    Func build() {
+        Func f("f");
+        Var x, y;
+
+        f(x, y) = input(x, y) * 2;
+        // Calling with a width other than that of the output fails.
+        f.bound(x, 0, width);
+
+        return f;
+    }
+};
+
+Halide::RegisterGenerator<PipelineStats> register_my_gen{"pipeline_stats"};
+
+}  // namespace
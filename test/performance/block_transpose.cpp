@@ -8,7 +8,8 @@ using namespace Halide;
 enum {
     scalar_trans,
     vec_y_trans,
-    vec_x_trans
+    vec_x_trans,
+    direct_trans
 };
 
 void test_transpose(int mode) {
@@ -45,6 +46,15 @@ void test_transpose(int mode) {
             algorithm = "Transpose vectorized in x";
             output.compile_to_assembly("fast_transpose_x.s", std::vector<Argument>());
             break;
+        case direct_trans:
+            // No intermediate stages. The strided loads of the
+            // columns of each tile are turned into dense loads of its
+            // rows and an in-register transpose by the compiler.
+            block.compute_inline();
+            block_transpose.compute_inline();
+            algorithm = "Direct transpose";
+            output.compile_to_assembly("direct_transpose.s", std::vector<Argument>());
+            break;
     }
 
 
@@ -64,6 +74,7 @@ int main(int argc, char **argv) {
     test_transpose(scalar_trans);
     test_transpose(vec_y_trans);
     test_transpose(vec_x_trans);
+    test_transpose(direct_trans);
     printf("Success!\n");
     return 0;
 }
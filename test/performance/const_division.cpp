@@ -1,6 +1,7 @@
 #include "Halide.h"
 #include <cstdio>
 #include <cstdint>
+#include <limits>
 #include "benchmark.h"
 
 using namespace Halide;
@@ -83,6 +84,87 @@ bool test(int w) {
         }
     }
 
+    // Division by a runtime parameter. The multiplier and shifts get
+    // computed once outside the loop over x, and the division itself
+    // becomes multiplies and shifts.
+    Param<T> p;
+    Func k, l;
+    k(x, y) = input(x, y) / p;
+
+    // Reference version that divides each lane by a value loaded from
+    // memory, so it uses hardware division.
+    Image<T> denominators(input.width());
+    l(x, y) = input(x, y) / denominators(x);
+
+    k.bound(x, 0, input.width());
+    l.bound(x, 0, input.width());
+    if (w > 1) {
+        k.vectorize(x);
+        l.vectorize(x);
+    }
+
+    k.compile_jit();
+    l.compile_jit();
+
+    T denominator_vals[] = {1, 3, 7, 64, 100, std::numeric_limits<T>::max(),
+                            (T)(is_signed ? -3 : 5), (T)(is_signed ? -100 : 255)};
+    for (T d : denominator_vals) {
+        p.set(d);
+        for (int x = 0; x < input.width(); x++) {
+            denominators(x) = d;
+        }
+
+        Image<T> param_correct = l.realize(input.width(), num_vals);
+        Image<T> param_fast = k.realize(input.width(), num_vals);
+
+        if (d == 7) {
+            double t_param_correct = benchmark(1, 30, [&]() { l.realize(param_correct); });
+            double t_param_fast = benchmark(1, 30, [&]() { k.realize(param_fast); });
+            printf("loop-invariant divisor path is        %1.3f x faster \n", t_param_correct / t_param_fast);
+        }
+
+        for (int y = 0; y < num_vals; y++) {
+            for (int x = 0; x < input.width(); x++) {
+                if (param_fast(x, y) != param_correct(x, y)) {
+                    printf("param_fast(%d, %d) = %lld instead of %lld (%lld/%lld)\n",
+                           x, y,
+                           (long long int)param_fast(x, y),
+                           (long long int)param_correct(x, y),
+                           (long long int)input(x, y),
+                           (long long int)d);
+                    return false;
+                }
+            }
+        }
+    }
+
+    // Division by a vector of denominators that is invariant in the
+    // loop over y, but isn't a broadcast. This must be left alone.
+    if (w > 1) {
+        Func m;
+        m(x, y) = input(x, y) / (p + cast<T>(x));
+        m.bound(x, 0, input.width()).vectorize(x);
+
+        p.set(3);
+        for (int x = 0; x < input.width(); x++) {
+            denominators(x) = (T)(3 + x);
+        }
+
+        Image<T> ramp_correct = l.realize(input.width(), num_vals);
+        Image<T> ramp_result = m.realize(input.width(), num_vals);
+        for (int y = 0; y < num_vals; y++) {
+            for (int x = 0; x < input.width(); x++) {
+                if (ramp_result(x, y) != ramp_correct(x, y)) {
+                    printf("ramp_result(%d, %d) = %lld instead of %lld\n",
+                           x, y,
+                           (long long int)ramp_result(x, y),
+                           (long long int)ramp_correct(x, y));
+                    return false;
+                }
+            }
+        }
+    }
+
     return true;
 
 }
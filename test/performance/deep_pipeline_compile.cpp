@@ -0,0 +1,61 @@
+#include "Halide.h"
+
+#include <cstdio>
+#include "benchmark.h"
+
+using namespace Halide;
+
+// Measure how long it takes to compile a pipeline with 100 stages,
+// most of which are inlined into their consumers. Bounds inference
+// dominates the compile time for pipelines like this one.
+int main(int argc, char **argv) {
+    const int stages = 100;
+
+    ImageParam input(Float(32), 2);
+    Var x, y;
+
+    Func clamped;
+    clamped(x, y) = input(clamp(x, 0, input.width()-1), clamp(y, 0, input.height()-1));
+
+    Func f;
+    double t = benchmark(1, 1, [&]() {
+        std::vector<Func> funcs(stages);
+        funcs[0](x, y) = clamped(x, y);
+        for (int i = 1; i < stages; i++) {
+            Func prev = funcs[i-1];
+            if (i % 2) {
+                funcs[i](x, y) = (prev(x-1, y) + 2*prev(x, y) + prev(x+1, y)) / 4;
+            } else {
+                funcs[i](x, y) = (prev(x, y-1) + 2*prev(x, y) + prev(x, y+1)) / 4;
+            }
+            if (i % 4 == 0) {
+                funcs[i].compute_root().vectorize(x, 4);
+            }
+        }
+        f = funcs[stages-1];
+        f.compile_jit();
+    });
+
+    printf("%g ms to compile a %d stage pipeline\n", t * 1e3, stages);
+
+    // Make sure the pipeline actually works.
+    Image<float> in(32, 32);
+    for (int y = 0; y < in.height(); y++) {
+        for (int x = 0; x < in.width(); x++) {
+            in(x, y) = 1.0f;
+        }
+    }
+    input.set(in);
+    Image<float> out = f.realize(32, 32);
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            if (out(x, y) != 1.0f) {
+                printf("out(%d, %d) = %f instead of 1\n", x, y, out(x, y));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,88 @@
+#include "Halide.h"
+#include <cstdio>
+#include "benchmark.h"
+
+using namespace Halide;
+
+Var x("x"), y("y");
+
+// Check that two images are the same.
+template<typename T>
+bool check(Image<T> a, Image<T> b, const char *name) {
+    for (int y = 0; y < a.height(); y++) {
+        for (int x = 0; x < a.width(); x++) {
+            if (a(x, y) != b(x, y)) {
+                printf("%s: (%d, %d) = %f instead of %f\n",
+                       name, x, y, (double)b(x, y), (double)a(x, y));
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Image<uint8_t> input(1024, 1024);
+    for (int y = 0; y < input.height(); y++) {
+        for (int x = 0; x < input.width(); x++) {
+            input(x, y) = rand() & 0xff;
+        }
+    }
+
+    // A lookup in a table of 16 entries, indexed by the top four bits
+    // of each pixel. The table fits in a register, so the lookups are
+    // done with shuffles.
+    {
+        Func table("table"), small("small"), gather("gather");
+        table(x) = cast<uint8_t>(x * x + 3);
+        small(x, y) = table(cast<int>(input(x, y) >> 4));
+
+        // The same lookup, with an index that isn't known to be
+        // small when compiling, so it's done with a gather.
+        Param<int> max_index;
+        gather(x, y) = table(clamp(cast<int>(input(x, y) >> 4), 0, max_index));
+        max_index.set(15);
+
+        table.compute_root();
+        small.vectorize(x, 16);
+        gather.vectorize(x, 16);
+
+        Image<uint8_t> correct = gather.realize(input.width(), input.height());
+        Image<uint8_t> fast = small.realize(input.width(), input.height());
+        if (!check(correct, fast, "small")) {
+            return -1;
+        }
+
+        double t_gather = benchmark(10, 10, [&]() { gather.realize(correct); });
+        double t_small = benchmark(10, 10, [&]() { small.realize(fast); });
+        printf("16-entry table: gather %f ms, shuffle %f ms (%1.2fx faster)\n",
+               t_gather * 1e3, t_small * 1e3, t_gather / t_small);
+    }
+
+    // A gamma curve: a lookup of floats in a table of 256 entries,
+    // indexed by the value of each pixel. The table is too large for
+    // shuffles, so with AVX2 the lookups are done with vpgatherdd.
+    {
+        Func gamma("gamma"), vec("vec"), scalar("scalar");
+        gamma(x) = pow(x / 255.0f, 2.2f);
+        vec(x, y) = gamma(cast<int>(input(x, y)));
+        scalar(x, y) = gamma(cast<int>(input(x, y)));
+
+        gamma.compute_root();
+        vec.vectorize(x, 8);
+
+        Image<float> correct = scalar.realize(input.width(), input.height());
+        Image<float> fast = vec.realize(input.width(), input.height());
+        if (!check(correct, fast, "gamma")) {
+            return -1;
+        }
+
+        double t_scalar = benchmark(10, 10, [&]() { scalar.realize(correct); });
+        double t_vec = benchmark(10, 10, [&]() { vec.realize(fast); });
+        printf("256-entry table: scalar %f ms, vectorized %f ms (%1.2fx faster)\n",
+               t_scalar * 1e3, t_vec * 1e3, t_scalar / t_vec);
+    }
+
+    printf("Success!\n");
+    return 0;
+}
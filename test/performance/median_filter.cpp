@@ -0,0 +1,84 @@
+#include "Halide.h"
+#include <cstdio>
+#include <algorithm>
+#include "benchmark.h"
+
+using namespace Halide;
+
+Var x("x"), y("y");
+
+// Check that two images are the same.
+bool check(Image<uint8_t> a, Image<uint8_t> b, const char *name) {
+    for (int y = 0; y < a.height(); y++) {
+        for (int x = 0; x < a.width(); x++) {
+            if (a(x, y) != b(x, y)) {
+                printf("%s: (%d, %d) = %d instead of %d\n",
+                       name, x, y, b(x, y), a(x, y));
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// A median filter that counts, for each value in the window, how many
+// values are less than it, and picks the one with the middle rank.
+// This is how you'd write it without a sort.
+Func median_by_counting(Func in, int size) {
+    const int n = size * size, mid = (n - 1) / 2;
+    const int r = size / 2;
+    Expr result = cast<uint8_t>(0);
+    for (int j = 0; j < n; j++) {
+        Expr v = in(x + j % size - r, y + j / size - r);
+        Expr less = 0, less_or_equal = 0;
+        for (int i = 0; i < n; i++) {
+            Expr w = in(x + i % size - r, y + i / size - r);
+            less += select(w < v, 1, 0);
+            less_or_equal += select(w <= v, 1, 0);
+        }
+        result = select(less <= mid && mid < less_or_equal, v, result);
+    }
+    Func f("median_by_counting");
+    f(x, y) = result;
+    return f;
+}
+
+int main(int argc, char **argv) {
+    const int W = 1024, H = 1024;
+    Image<uint8_t> input(W + 4, H + 4);
+    input.set_min(-2, -2);
+    for (int y = input.min(1); y < input.min(1) + input.height(); y++) {
+        for (int x = input.min(0); x < input.min(0) + input.width(); x++) {
+            input(x, y) = rand() & 0xff;
+        }
+    }
+
+    Func in("in");
+    in(x, y) = input(x, y);
+
+    for (int size = 3; size <= 5; size += 2) {
+        const int r = size / 2;
+        RDom window(-r, size, -r, size);
+
+        Func network("network");
+        network(x, y) = median(in(x + window.x, y + window.y));
+        network.vectorize(x, 32).parallel(y);
+
+        Func counting = median_by_counting(in, size);
+        counting.vectorize(x, 32).parallel(y);
+
+        Image<uint8_t> correct = counting.realize(W, H);
+        Image<uint8_t> fast = network.realize(W, H);
+        if (!check(correct, fast, "network")) {
+            return -1;
+        }
+
+        double t_counting = benchmark(5, 5, [&]() { counting.realize(correct); });
+        double t_network = benchmark(5, 5, [&]() { network.realize(fast); });
+        printf("%dx%d median: counting %f ms, sorting network %f ms (%1.2fx faster)\n",
+               size, size, t_counting * 1e3, t_network * 1e3, t_counting / t_network);
+    }
+
+    printf("Success!\n");
+    return 0;
+}
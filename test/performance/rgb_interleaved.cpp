@@ -222,10 +222,91 @@ void test_interleave(bool fast) {
     delete[] dst_storage;
 }
 
+// Write a Tuple-valued Func with one element per channel to an
+// interleaved output. The channel loop is bounded but not unrolled;
+// it still gets turned into dense interleaving stores.
+void test_interleave_tuple(int channels) {
+    ImageParam src(UInt(8), 3);
+    Func pixel, dst;
+    Var x, y, c;
+
+    std::vector<Expr> elements;
+    for (int i = 0; i < channels; i++) {
+        elements.push_back(src(x, y, i) + cast<uint8_t>(1));
+    }
+    pixel(x, y) = Tuple(elements);
+
+    Expr value = pixel(x, y)[channels - 1];
+    for (int i = channels - 2; i >= 0; i--) {
+        value = select(c == i, pixel(x, y)[i], value);
+    }
+    dst(x, y, c) = value;
+
+    src.set_stride(0, 1);
+    src.set_extent(2, channels);
+
+    dst.output_buffer().set_min(2, 0);
+    dst.output_buffer().set_stride(0, channels);
+    dst.output_buffer().set_stride(2, 1);
+    dst.output_buffer().set_extent(2, channels);
+
+    dst.reorder(c, x, y).bound(c, 0, channels).vectorize(x, 16);
+
+    const int iterations = 20;
+    const int32_t buffer_side_length = (1 << 12);
+    const int32_t buffer_size = buffer_side_length * buffer_side_length;
+
+    Image<uint8_t> src_image(buffer_side_length, buffer_side_length, channels);
+    for (int32_t y = 0; y < buffer_side_length; y++) {
+        for (int32_t x = 0; x < buffer_side_length; x++) {
+            for (int c = 0; c < channels; c++) {
+                src_image(x, y, c) = (uint8_t)(c * 64 + 10);
+            }
+        }
+    }
+    src.set(src_image);
+
+    // Interleaved output, with no extra padding between rows.
+    uint8_t *dst_storage(new uint8_t[buffer_size * channels]);
+    buffer_t dst_buffer;
+    memset(&dst_buffer, 0, sizeof(dst_buffer));
+    dst_buffer.host = dst_storage;
+    dst_buffer.extent[0] = buffer_side_length;
+    dst_buffer.stride[0] = channels;
+    dst_buffer.extent[1] = buffer_side_length;
+    dst_buffer.stride[1] = dst_buffer.stride[0] * dst_buffer.extent[0];
+    dst_buffer.extent[2] = channels;
+    dst_buffer.stride[2] = 1;
+    dst_buffer.elem_size = 1;
+    Image<uint8_t> dst_image(&dst_buffer, "dst_image");
+
+    dst.compile_jit();
+    dst.realize(dst_image);
+
+    double t = benchmark(1, iterations, [&]() {
+        dst.realize(dst_image);
+    });
+
+    printf("Tuple with %d elements to interleaved bandwidth %.3e byte/s.\n",
+           channels, buffer_size / t);
+
+    for (int32_t y = 0; y < buffer_side_length; y++) {
+        for (int32_t x = 0; x < buffer_side_length; x++) {
+            for (int c = 0; c < channels; c++) {
+                assert(dst_image(x, y, c) == c * 64 + 11);
+            }
+        }
+    }
+
+    delete[] dst_storage;
+}
+
 int main(int argc, char **argv) {
     test_deinterleave();
     test_interleave(false);
     test_interleave(true);
+    test_interleave_tuple(3);
+    test_interleave_tuple(4);
     printf("Success!\n");
     return 0;
 }